@@ -215,6 +215,9 @@
 
 #include <arpa/inet.h>
 #include <ext/hash_map>
+#include <vector>
+#include <utility>
+#include <stdint.h>
 
 #include "lookup3.h"
 #include "cflow.h"
@@ -325,4 +328,267 @@ template<typename T> struct HashFunction {
 	}
 };
 
+/**
+ *	\class	flat_hash_map
+ *	\brief	Hash map with open addressing, a replacement for hash_map using the same key classes and HashFunction
+ *
+ *	The elements are stored in a dense vector (in insertion order), the table itself holds just the hash
+ *	and the position of every element. Collisions are resolved by linear probing with Robin Hood
+ *	insertion: an element never stays closer to its home slot than the one it displaced, which keeps
+ *	the probe sequences short even at high load. Thus a lookup touches one or two cache lines of the
+ *	table plus the element, and there is no allocation per element.
+ *
+ *	The interface is a subset of the one of hash_map. Differences:
+ *	- value_type is std::pair<Key, T> (the key is not const)
+ *	- Iterators and references are invalidated by insertions (the vector may grow) and by erase()
+ *	  (the last element is moved into the gap). Thus elements must not be erased while iterating.
+ *	- Iterating visits the elements in insertion order (as long as nothing was erased)
+ */
+template<typename Key, typename T, typename HashFcn = HashFunction<Key>, typename EqualKey = HashFunction<Key> > class flat_hash_map {
+	public:
+		typedef Key key_type;
+		typedef T mapped_type;
+		typedef std::pair<Key, T> value_type;
+		typedef typename std::vector<value_type>::size_type size_type;
+		typedef typename std::vector<value_type>::iterator iterator;
+		typedef typename std::vector<value_type>::const_iterator const_iterator;
+
+		flat_hash_map() :
+			mask(0) {
+		}
+
+		iterator begin() {
+			return elements.begin();
+		}
+		iterator end() {
+			return elements.end();
+		}
+		const_iterator begin() const {
+			return elements.begin();
+		}
+		const_iterator end() const {
+			return elements.end();
+		}
+		size_type size() const {
+			return elements.size();
+		}
+		bool empty() const {
+			return elements.empty();
+		}
+
+		/**
+		 *	Searches an element
+		 *
+		 *	\param key Key to search
+		 *
+		 *	\return Iterator to the element, end() if not found
+		 */
+		iterator find(const Key & key) {
+			size_t slot = find_slot(key, hash_key(key));
+			return (slot == NOT_FOUND) ? elements.end() : elements.begin() + slots[slot].element;
+		}
+		const_iterator find(const Key & key) const {
+			size_t slot = find_slot(key, hash_key(key));
+			return (slot == NOT_FOUND) ? elements.end() : elements.begin() + slots[slot].element;
+		}
+		size_type count(const Key & key) const {
+			return (find_slot(key, hash_key(key)) == NOT_FOUND) ? 0 : 1;
+		}
+
+		/**
+		 *	Inserts an element if its key is not yet present
+		 *
+		 *	\param value Element to insert
+		 *
+		 *	\return Iterator to the element with this key, and true if the element was inserted
+		 */
+		std::pair<iterator, bool> insert(const value_type & value) {
+			uint32_t hash = hash_key(value.first);
+			size_t slot = find_slot(value.first, hash);
+			if (slot != NOT_FOUND)
+				return std::make_pair(elements.begin() + slots[slot].element, false);
+			elements.push_back(value);
+			insert_slot(hash, elements.size() - 1);
+			return std::make_pair(elements.end() - 1, true);
+		}
+
+		/**
+		 *	Returns the element with the given key, inserts a default constructed one if missing
+		 */
+		T & operator[](const Key & key) {
+			uint32_t hash = hash_key(key);
+			size_t slot = find_slot(key, hash);
+			if (slot != NOT_FOUND)
+				return elements[slots[slot].element].second;
+			elements.push_back(value_type(key, T()));
+			insert_slot(hash, elements.size() - 1);
+			return elements.back().second;
+		}
+
+		/**
+		 *	Removes an element. The last element is moved into its place.
+		 *
+		 *	\param it Element to remove
+		 */
+		void erase(iterator it) {
+			erase_slot(find_slot(it->first, hash_key(it->first)));
+		}
+
+		/**
+		 *	Removes the element with the given key, if present
+		 *
+		 *	\return Number of removed elements
+		 */
+		size_type erase(const Key & key) {
+			size_t slot = find_slot(key, hash_key(key));
+			if (slot == NOT_FOUND)
+				return 0;
+			erase_slot(slot);
+			return 1;
+		}
+
+		void clear() {
+			elements.clear();
+			slots.clear();
+			mask = 0;
+		}
+
+		/**
+		 *	Prepares the map for count elements, such that inserting them does not rehash
+		 */
+		void reserve(size_type count) {
+			elements.reserve(count);
+			size_t capacity = MIN_SLOTS;
+			while (capacity * MAX_LOAD_PERCENT < count * 100)
+				capacity *= 2;
+			if (capacity > slots.size())
+				rehash(capacity);
+		}
+
+		void swap(flat_hash_map & other) {
+			elements.swap(other.elements);
+			slots.swap(other.slots);
+			std::swap(mask, other.mask);
+			std::swap(hasher, other.hasher);
+			std::swap(equals, other.equals);
+		}
+
+	private:
+		/**
+		 *	\struct slot_t
+		 *	\brief Slot of the table: hash and position of an element
+		 */
+		struct slot_t {
+				uint32_t hash; ///< Hash of the key
+				uint32_t element; ///< Index into elements, EMPTY if the slot is unused
+		};
+
+		static const uint32_t EMPTY = 0xffffffff;
+		static const size_t NOT_FOUND = (size_t) -1;
+		static const size_t MIN_SLOTS = 16;
+		static const size_t MAX_LOAD_PERCENT = 80;
+
+		uint32_t hash_key(const Key & key) const {
+			return (uint32_t) hasher(key);
+		}
+
+		/**
+		 *	\return Distance of the element in a slot from its home slot
+		 */
+		size_t distance(size_t slot) const {
+			return (slot - (slots[slot].hash & mask)) & mask;
+		}
+
+		/**
+		 *	\return Slot of the element with the given key, NOT_FOUND if missing
+		 */
+		size_t find_slot(const Key & key, uint32_t hash) const {
+			if (slots.empty())
+				return NOT_FOUND;
+			size_t slot = hash & mask;
+			for (size_t dist = 0;; dist++) {
+				const slot_t & s = slots[slot];
+				// Robin Hood invariant: the key would have displaced an element closer to its home
+				if (s.element == EMPTY || distance(slot) < dist)
+					return NOT_FOUND;
+				if (s.hash == hash && equals(elements[s.element].first, key))
+					return slot;
+				slot = (slot + 1) & mask;
+			}
+		}
+
+		/**
+		 *	Adds an element to the table, grows the table if needed
+		 */
+		void insert_slot(uint32_t hash, size_t element) {
+			if (slots.empty() || elements.size() * 100 > slots.size() * MAX_LOAD_PERCENT)
+				rehash(slots.empty() ? MIN_SLOTS : 2 * slots.size());
+			slot_t entry;
+			entry.hash = hash;
+			entry.element = element;
+			place(entry);
+		}
+
+		/**
+		 *	Places a slot entry, displacing entries closer to their home slot
+		 */
+		void place(slot_t entry) {
+			size_t slot = entry.hash & mask;
+			for (size_t dist = 0;; dist++) {
+				if (slots[slot].element == EMPTY) {
+					slots[slot] = entry;
+					return;
+				}
+				size_t existing = distance(slot);
+				if (existing < dist) {
+					std::swap(entry, slots[slot]);
+					dist = existing;
+				}
+				slot = (slot + 1) & mask;
+			}
+		}
+
+		/**
+		 *	Removes the element of a slot: the following entries of the cluster are shifted back,
+		 *	then the last element is moved into the gap of the vector
+		 */
+		void erase_slot(size_t slot) {
+			uint32_t element = slots[slot].element;
+			size_t next = (slot + 1) & mask;
+			while (slots[next].element != EMPTY && distance(next) > 0) {
+				slots[slot] = slots[next];
+				slot = next;
+				next = (next + 1) & mask;
+			}
+			slots[slot].element = EMPTY;
+
+			uint32_t last = elements.size() - 1;
+			if (element != last) {
+				// The slot of the last element is found by its key (the erased slot is gone already)
+				elements[element] = elements[last];
+				slots[find_slot(elements[element].first, hash_key(elements[element].first))].element = element;
+			}
+			elements.pop_back();
+		}
+
+		void rehash(size_t capacity) {
+			slot_t empty;
+			empty.hash = 0;
+			empty.element = EMPTY;
+			std::vector<slot_t> old(capacity, empty);
+			old.swap(slots);
+			mask = capacity - 1;
+			for (typename std::vector<slot_t>::const_iterator it = old.begin(); it != old.end(); ++it) {
+				if (it->element != EMPTY)
+					place(*it);
+			}
+		}
+
+		std::vector<value_type> elements; ///< The elements
+		std::vector<slot_t> slots; ///< The table, its size is a power of 2 (or 0)
+		size_t mask; ///< Number of slots - 1
+		HashFcn hasher; ///< Hash function
+		EqualKey equals; ///< Key comparison
+};
+
 #endif
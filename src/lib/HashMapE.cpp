@@ -405,3 +405,86 @@ const boost::array<uint16_t, 8> CHashKey8::getRoles() const {
 	 */
 	return roles;
 }
+
+/* *************************************************************
+ * Typed keys                                                  *
+ * *************************************************************/
+
+std::string CKeyIP::printkey() const {
+	return get_ip(0).toString();
+}
+
+std::string CKeyIPPair::printkey() const {
+	return get_ip(0).toString() + " " + get_ip(2).toString();
+}
+
+std::string CKeyIP_3T::printkey() const {
+	std::stringstream ss;
+	ss << "ip: " << get_ip(0) << " proto: " << (words[2] & 0xff) << " port: " << ((words[2] >> 8) & 0xffff);
+	return ss.str();
+}
+
+std::string CKeyIP_4T::printkey() const {
+	std::stringstream ss;
+	ss << "ip: " << get_ip(0) << " proto: " << (words[2] & 0xff) << " port: " << ((words[2] >> 8) & 0xffff) << " flowtype: " << (words[2] >> 24);
+	return ss.str();
+}
+
+std::string CKeyIP_5T::printkey() const {
+	std::stringstream ss;
+	ss << get_ip(0) << ":" << (words[4] & 0xffff) << " " << get_ip(2) << ":" << ((words[4] >> 16) & 0xffff) << " proto: " << (words[4] >> 32);
+	return ss.str();
+}
+
+std::string CKeyIP_5T_2::printkey() const {
+	std::stringstream ss;
+	ss << "localip: " << get_ip(0) << " remoteip: " << get_ip(2) << " proto: " << (words[4] & 0xff) << " port: " << ((words[4] >> 8) & 0xffff)
+	      << " flowtype: " << (words[4] >> 24);
+	return ss.str();
+}
+
+std::string CKey6_6::printkey() const {
+	std::stringstream ss;
+	ss << std::hex << words[1] << ":" << words[0] << " - " << words[3] << ":" << words[2];
+	return ss.str();
+}
+
+std::string CKeyRoles8::printkey() const {
+	boost::array<uint16_t, 8> roles = getRoles();
+	std::stringstream ss;
+	for (unsigned int i = 0; i < roles.size(); i++)
+		ss << roles[i] << " - ";
+	return ss.str();
+}
+
+std::string CKeyProtoFlowtype::printkey() const {
+	std::stringstream ss;
+	ss << "proto: " << (words[0] & 0xff) << " flowtype: " << (words[0] >> 8);
+	return ss.str();
+}
+
+std::string CKeyId::printkey() const {
+	std::stringstream ss;
+	ss << "id: " << words[0];
+	return ss.str();
+}
+
+std::string CKeyIdPair::printkey() const {
+	std::stringstream ss;
+	ss << "id: " << (words[0] & 0xffffffff) << " id: " << (words[0] >> 32);
+	return ss.str();
+}
+
+std::string CKeyId_4T::printkey() const {
+	std::stringstream ss;
+	ss << "id: " << (words[0] & 0xffffffff) << " proto: " << ((words[0] >> 32) & 0xff) << " port: " << ((words[0] >> 40) & 0xffff) << " flowtype: "
+	      << (words[0] >> 56);
+	return ss.str();
+}
+
+std::string CKeyId_5T_2::printkey() const {
+	std::stringstream ss;
+	ss << "localid: " << (words[0] & 0xffffffff) << " remoteid: " << (words[0] >> 32) << " proto: " << (words[1] & 0xff) << " port: "
+	      << ((words[1] >> 8) & 0xffff) << " flowtype: " << (words[1] >> 24);
+	return ss.str();
+}
@@ -11,6 +11,7 @@
 #define HASHMAPE_H_
 
 #include <arpa/inet.h>
+#include <string.h>
 #include <string>
 #include <boost/array.hpp>
 #include <ext/hash_map>
@@ -266,4 +267,288 @@ protected:
 	key_type key;
 };
 
+/* *************************************************************
+ * Typed keys: fields stored as aligned 64 bit words           *
+ * *************************************************************/
+
+/**
+ *	Mixes the 64 bit word k into the hash state h (body of MurmurHash3, x64 variant)
+ */
+inline uint64_t hash_word(uint64_t h, uint64_t k) {
+	k *= 0x87c37b91114253d5ULL;
+	k = (k << 31) | (k >> 33);
+	k *= 0x4cf5ad432745937fULL;
+	h ^= k;
+	h = (h << 27) | (h >> 37);
+	return h * 5 + 0x52dce729;
+}
+
+/**
+ *	Final avalanche of a hash state, every input bit affects the low bits used for the table index
+ */
+inline uint64_t hash_finish(uint64_t h) {
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+/**
+ *	\class CKeyWords
+ *	\brief Base of the typed hash keys: N words of 64 bit, hashed and compared word by word.
+ *
+ *	The HashKey classes above copy their fields into a byte array which HashFunction hashes and
+ *	compares byte by byte. The typed keys store an IPv6 address as two words and pack the small
+ *	fields (ports, protocol, flow type) into one word, so a key has no padding and the hash and
+ *	the comparison run over 2 to 5 words. The constructors take the same arguments as the
+ *	HashKey class they replace. Use them with KeyHashFunction.
+ */
+template<unsigned int N> class CKeyWords {
+public:
+	size_t hash() const {
+		uint64_t h = N;
+		for (unsigned int i = 0; i < N; i++)
+			h = hash_word(h, words[i]);
+		return hash_finish(h);
+	}
+
+	bool operator==(const CKeyWords & b) const {
+		for (unsigned int i = 0; i < N; i++) {
+			if (words[i] != b.words[i])
+				return false;
+		}
+		return true;
+	}
+
+protected:
+	/**
+	 *	Stores ip into words[pos] and words[pos + 1]
+	 */
+	void set_ip(unsigned int pos, const IPv6_addr & ip) {
+		memcpy(&words[pos], ip.begin(), sizeof(IPv6_addr));
+	}
+
+	IPv6_addr get_ip(unsigned int pos) const {
+		IPv6_addr ip;
+		memcpy(ip.begin(), &words[pos], sizeof(IPv6_addr));
+		return ip;
+	}
+
+	uint64_t words[N];
+};
+
+/**
+ *	\struct KeyHashFunction
+ *	\brief Hash and equals operator for the typed keys (counterpart of HashFunction)
+ */
+template<typename T> struct KeyHashFunction {
+	size_t operator()(const T & key) const {
+		return key.hash();
+	}
+
+	bool operator()(const T & key1, const T & key2) const {
+		return key1 == key2;
+	}
+};
+
+/**
+ *	\class CKeyIP
+ *	\brief Typed key for an IPv6 address (replaces HashKeyIPv6)
+ */
+class CKeyIP: public CKeyWords<2> {
+public:
+	CKeyIP(const IPv6_addr & ip) {
+		set_ip(0, ip);
+	}
+	IPv6_addr getIP() const {
+		return get_ip(0);
+	}
+	std::string printkey() const;
+};
+
+/**
+ *	\class CKeyIPPair
+ *	\brief Typed key for a pair of IPv6 addresses (replaces HashKeyIPv6Pair)
+ */
+class CKeyIPPair: public CKeyWords<4> {
+public:
+	CKeyIPPair(const IPv6_addr & ip1, const IPv6_addr & ip2) {
+		set_ip(0, ip1);
+		set_ip(2, ip2);
+	}
+	std::string printkey() const;
+};
+
+/**
+ *	\class CKeyIP_3T
+ *	\brief Typed key for the 3-tuple [IP, protocol, port] (replaces HashKeyIPv6_3T)
+ */
+class CKeyIP_3T: public CKeyWords<3> {
+public:
+	CKeyIP_3T(const IPv6_addr & IP, const uint8_t protocol, const uint16_t port) {
+		set_ip(0, IP);
+		words[2] = protocol | ((uint64_t) port << 8);
+	}
+	std::string printkey() const;
+};
+
+/**
+ *	\class CKeyIP_4T
+ *	\brief Typed key for the 4-tuple [IP, protocol, port, flowtype] (replaces HashKeyIPv6_4T)
+ */
+class CKeyIP_4T: public CKeyWords<3> {
+public:
+	CKeyIP_4T(const IPv6_addr & IP, const uint8_t protocol, const uint16_t port, const uint8_t flowtype) {
+		set_ip(0, IP);
+		words[2] = protocol | ((uint64_t) port << 8) | ((uint64_t) flowtype << 24);
+	}
+	std::string printkey() const;
+};
+
+/**
+ *	\class CKeyIP_5T
+ *	\brief Typed key for the 5-tuple [srcIP, dstIP, srcPort, dstPort, protocol] (replaces HashKeyIPv6_5T)
+ */
+class CKeyIP_5T: public CKeyWords<5> {
+public:
+	CKeyIP_5T(const IPv6_addr & srcIP, const IPv6_addr & dstIP, const uint16_t srcPort, const uint16_t dstPort, const uint8_t protocol) {
+		set_ip(0, srcIP);
+		set_ip(2, dstIP);
+		words[4] = srcPort | ((uint64_t) dstPort << 16) | ((uint64_t) protocol << 32);
+	}
+	std::string printkey() const;
+};
+
+/**
+ *	\class CKeyIP_5T_2
+ *	\brief Typed key for the 5-tuple [localIP, remoteIP, protocol, port, flowtype] (replaces HashKeyIPv6_5T_2)
+ */
+class CKeyIP_5T_2: public CKeyWords<5> {
+public:
+	CKeyIP_5T_2(const IPv6_addr & localIP, const IPv6_addr & remoteIP, const uint8_t protocol, const uint16_t port, const uint8_t flowtype) {
+		set_ip(0, localIP);
+		set_ip(2, remoteIP);
+		words[4] = protocol | ((uint64_t) port << 8) | ((uint64_t) flowtype << 24);
+	}
+	std::string printkey() const;
+};
+
+/**
+ *	\class CKey6_6
+ *	\brief Typed key for a pair of 128 bit values, each an IPv6 address or a number (replaces CHashKey6_6)
+ */
+class CKey6_6: public CKeyWords<4> {
+public:
+	CKey6_6(const IPv6_addr & val1, const IPv6_addr & val2) {
+		set_ip(0, val1);
+		set_ip(2, val2);
+	}
+	CKey6_6(const IPv6_addr & val1, const uint64_t val2) {
+		set_ip(0, val1);
+		words[2] = val2;
+		words[3] = 0;
+	}
+	CKey6_6(const uint64_t val1, const IPv6_addr & val2) {
+		words[0] = val1;
+		words[1] = 0;
+		set_ip(2, val2);
+	}
+	CKey6_6(const uint32_t val1, const uint32_t val2) {
+		words[0] = val1;
+		words[1] = 0;
+		words[2] = val2;
+		words[3] = 0;
+	}
+	CKey6_6(const uint64_t val1, const uint64_t val2) {
+		words[0] = val1;
+		words[1] = 0;
+		words[2] = val2;
+		words[3] = 0;
+	}
+	std::string printkey() const;
+};
+
+/**
+ *	\class CKeyRoles8
+ *	\brief Typed key for eight numbers of 16 bit size (replaces CHashKey8)
+ */
+class CKeyRoles8: public CKeyWords<2> {
+public:
+	CKeyRoles8(const boost::array<uint16_t, 8> & val) {
+		memcpy(words, val.begin(), sizeof(words));
+	}
+	const boost::array<uint16_t, 8> getRoles() const {
+		boost::array<uint16_t, 8> roles;
+		memcpy(roles.begin(), words, sizeof(words));
+		return roles;
+	}
+	std::string printkey() const;
+};
+
+/**
+ *	\class CKeyProtoFlowtype
+ *	\brief Typed key for protocol and flow type (replaces HashKeyProtoFlowtype)
+ */
+class CKeyProtoFlowtype: public CKeyWords<1> {
+public:
+	CKeyProtoFlowtype(const uint8_t proto, const uint8_t flowtype) {
+		words[0] = proto | ((uint64_t) flowtype << 8);
+	}
+	std::string printkey() const;
+};
+
+/**
+ *	\class CKeyId
+ *	\brief Typed key for an address id assigned by CIpDictionary (replaces CKeyIP in the role code)
+ */
+class CKeyId: public CKeyWords<1> {
+public:
+	CKeyId(const uint32_t id) {
+		words[0] = id;
+	}
+	uint32_t getId() const {
+		return (uint32_t) words[0];
+	}
+	std::string printkey() const;
+};
+
+/**
+ *	\class CKeyIdPair
+ *	\brief Typed key for a pair of address ids (replaces CKeyIPPair)
+ */
+class CKeyIdPair: public CKeyWords<1> {
+public:
+	CKeyIdPair(const uint32_t id1, const uint32_t id2) {
+		words[0] = id1 | ((uint64_t) id2 << 32);
+	}
+	std::string printkey() const;
+};
+
+/**
+ *	\class CKeyId_4T
+ *	\brief Typed key for the 4-tuple [address id, protocol, port, flowtype] (replaces CKeyIP_4T)
+ */
+class CKeyId_4T: public CKeyWords<1> {
+public:
+	CKeyId_4T(const uint32_t id, const uint8_t protocol, const uint16_t port, const uint8_t flowtype) {
+		words[0] = id | ((uint64_t) protocol << 32) | ((uint64_t) port << 40) | ((uint64_t) flowtype << 56);
+	}
+	std::string printkey() const;
+};
+
+/**
+ *	\class CKeyId_5T_2
+ *	\brief Typed key for the 5-tuple [local id, remote id, protocol, port, flowtype] (replaces CKeyIP_5T_2)
+ */
+class CKeyId_5T_2: public CKeyWords<2> {
+public:
+	CKeyId_5T_2(const uint32_t localId, const uint32_t remoteId, const uint8_t protocol, const uint16_t port, const uint8_t flowtype) {
+		words[0] = localId | ((uint64_t) remoteId << 32);
+		words[1] = protocol | ((uint64_t) port << 8) | ((uint64_t) flowtype << 24);
+	}
+	std::string printkey() const;
+};
+
 #endif /* HASHMAPE_H_ */
@@ -10,6 +10,7 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <boost/array.hpp>
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
@@ -254,6 +255,129 @@ const cflow_t & Subflowlist::operator[](difference_type n) const {
 	return *(_begin + n);
 }
 
+/**
+ *	\struct flowrun_cursor
+ *	\brief Read position within a sorted run of flows, used by mergeSortedFlows()
+ */
+struct flowrun_cursor {
+		const cflow_t * pos; ///< Next flow
+		const cflow_t * end; ///< End of the run
+};
+
+/**
+ *	\struct flowrun_cursor_greater
+ *	\brief Orders cursors by their next flow, such that the heap functions keep the smallest one at the front
+ */
+struct flowrun_cursor_greater {
+		bool operator()(const flowrun_cursor & a, const flowrun_cursor & b) const {
+			return *b.pos < *a.pos;
+		}
+};
+
+/**
+ *	Merge sorted runs of flows into a single sorted sequence (k-way merge), appended to a flowlist.
+ *	Runs of flows which are not greater than the next flow of any other run are copied in one go.
+ *
+ *	\param runs Runs of flows, each sorted by cflow_t::operator<. They must not be part of flowlist.
+ *	\param flowlist Flowlist to append the merged flows to
+ */
+void mergeSortedFlows(const std::vector<Subflowlist> & runs, CFlowList & flowlist) {
+	size_t total = 0;
+	std::vector<flowrun_cursor> heap;
+	for (unsigned int i = 0; i < runs.size(); i++) {
+		if (runs[i].size() == 0)
+			continue;
+		total += runs[i].size();
+		flowrun_cursor cursor = { &(*runs[i].begin()), &(*runs[i].begin()) + runs[i].size() };
+		heap.push_back(cursor);
+	}
+	flowlist.reserve(flowlist.size() + total);
+
+	flowrun_cursor_greater greater;
+	std::make_heap(heap.begin(), heap.end(), greater);
+	while (heap.size() > 1) {
+		std::pop_heap(heap.begin(), heap.end(), greater);
+		flowrun_cursor & cursor = heap.back();
+		const cflow_t & limit = *heap.front().pos;
+		const cflow_t * run = cursor.pos;
+		do {
+			run++;
+		} while (run < cursor.end && !(limit < *run));
+		flowlist.insert(flowlist.end(), cursor.pos, run);
+		cursor.pos = run;
+		if (cursor.pos == cursor.end)
+			heap.pop_back();
+		else
+			std::push_heap(heap.begin(), heap.end(), greater);
+	}
+	if (!heap.empty())
+		flowlist.insert(flowlist.end(), heap[0].pos, heap[0].end);
+}
+
+/**
+ *	Default constructor: an empty list
+ */
+CFlippedFlowlist::CFlippedFlowlist() :
+	flowlist(NULL) {
+}
+
+/**
+ *	Constructor
+ *
+ *	\param flowlist Flowlist
+ *	\param begin First flow number of the index into flowlist
+ *	\param end One behind the last flow number
+ */
+CFlippedFlowlist::CFlippedFlowlist(const CFlowList & flowlist, index_iterator begin, index_iterator end) :
+	flowlist(&flowlist), _begin(begin), _end(end) {
+}
+
+/**
+ *	\return Number of flows
+ */
+CFlippedFlowlist::size_type CFlippedFlowlist::size() const {
+	return flowlist ? _end - _begin : 0;
+}
+
+/**
+ *	\param n Position
+ *	\return Flipped copy of the flow at position n
+ */
+cflow_t CFlippedFlowlist::operator[](size_type n) const {
+	return flip(original(n));
+}
+
+/**
+ *	\param n Position
+ *	\return Flow at position n as stored in the flowlist
+ */
+const cflow_t & CFlippedFlowlist::original(size_type n) const {
+	return (*flowlist)[_begin[n]];
+}
+
+/**
+ *	Exchange local and remote address and port of a flow, and swap inflow and outflow.
+ *
+ *	\param flow Flow
+ *	\return Flow seen from its remote host
+ */
+cflow_t CFlippedFlowlist::flip(const cflow_t & flow) {
+	cflow_t flipped = flow;
+	flipped.localIP = flow.remoteIP;
+	flipped.remoteIP = flow.localIP;
+	flipped.localPort = flow.remotePort;
+	flipped.remotePort = flow.localPort;
+	// Adjust flow direction if needed
+	if ((flow.flowtype & uniflow) == uniflow) {
+		; // Do not modify transit flows
+	} else if ((flow.flowtype & inflow) != 0) {
+		flipped.flowtype = (flow.flowtype & (~inflow)) | outflow;
+	} else if ((flow.flowtype & outflow) != 0) {
+		flipped.flowtype = (flow.flowtype & (~outflow)) | inflow;
+	}
+	return flipped;
+}
+
 /**
  *	Constructor:	CFlowFilter
  *
@@ -149,6 +149,44 @@ class Subflowlist {
 		bool initializedEnd; ///< true if _end was set
 };
 
+void mergeSortedFlows(const std::vector<Subflowlist> & runs, CFlowList & flowlist);
+
+/**
+ *	\class	CFlippedFlowlist
+ *	\brief	Presents flows of a CFlowList, selected by an index, from the perspective of their remote host.
+ *
+ *	Element n is the flow number index[n] with local and remote address and port exchanged and
+ *	in- and outflow swapped. The flows are flipped on access: neither the flowlist nor the index
+ *	get copied.
+ */
+class CFlippedFlowlist {
+	public:
+		/**
+		 *	\typedef index_iterator
+		 *	\brief Iterator into an index of flow numbers
+		 */
+		typedef std::vector<int>::const_iterator index_iterator;
+		/**
+		 *	\typedef size_type
+		 *	\brief Size type
+		 */
+		typedef CFlowList::size_type size_type;
+
+		CFlippedFlowlist();
+		CFlippedFlowlist(const CFlowList & flowlist, index_iterator begin, index_iterator end);
+
+		size_type size() const;
+		cflow_t operator[](size_type n) const;
+		const cflow_t & original(size_type n) const;
+
+		static cflow_t flip(const cflow_t & flow);
+
+	private:
+		const CFlowList * flowlist; ///< Flows the index refers to
+		index_iterator _begin; ///< First flow number
+		index_iterator _end; ///< One behind the last flow number
+};
+
 // Compacted flow4 format (suitable for ipv4 only; size is 48 bytes)
 // ================================================================
 
@@ -63,6 +63,22 @@ std::string GFilter::getHumanReadablePattern() const {
 	return humanReadablePattern;
 }
 
+/**
+ *	Read only the flows of some hosts: the host localIP and the following hosts
+ *	up to a total of host_count hosts. Filters which can not do this return false
+ *	without touching flowlist; the caller then has to read the whole file.
+ *
+ *	\param in_filename Inputfilename
+ *	\param flowlist Reference to the flowlist
+ *	\param localIP First host to read
+ *	\param host_count Number of hosts to read
+ *
+ *	\return True if flowlist contains the requested flows
+ */
+bool GFilter::read_file_hosts(std::string in_filename, CFlowList & flowlist, const IPv6_addr & localIP, int host_count) const {
+	return false;
+}
+
 /**
  *	Return if this GFilter can write to a file
  *
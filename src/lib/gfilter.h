@@ -33,14 +33,15 @@ class GFilter {
 		// import methods
 		virtual void read_file(std::string in_filename, CFlowList & flowlist, const IPv6_addr & local_net, const IPv6_addr & netmask, bool append) const=0;
 		virtual bool acceptFileForReading(std::string in_filename) const=0;
+		virtual bool read_file_hosts(std::string in_filename, CFlowList & flowlist, const IPv6_addr & localIP, int host_count) const;
 
 		// export methods
 		virtual bool acceptFileForWriting(std::string in_filename) const;
 		virtual void write_file(const std::string & in_filename, const Subflowlist subflowlist, bool appendIfExisting = true) const;
 
 	protected:
-		typedef HashKeyIPv6_5T flowHashKey;
-		typedef hash_map<HashKeyIPv6_5T, cflow_t *, HashFunction<HashKeyIPv6_5T> , HashFunction<HashKeyIPv6_5T> > flowHashMap;
+		typedef CKeyIP_5T flowHashKey;
+		typedef flat_hash_map<CKeyIP_5T, cflow_t *, KeyHashFunction<CKeyIP_5T> , KeyHashFunction<CKeyIP_5T> > flowHashMap;
 
 		std::string formatName; ///< Name of this format (e.g. pcap, cflow, nfdump)
 		std::string humanReadablePattern; ///< A human "readable" pattern for the fileextension (e.g. *.pcap)
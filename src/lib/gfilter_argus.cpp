@@ -9,17 +9,76 @@
 #include "gfilter_argus.h"
 
 #include <cstdio>
+#include <cstring>
 #include <sys/stat.h>
 #include <iostream>
 #include <fstream>
+#include <vector>
 
 #include <netinet/in.h>
 
-#include <boost/lexical_cast.hpp>
 #include <boost/regex.hpp>
-#include <netinet/in.h>
+
+#include "gparallel.h"
 
 using namespace std;
+using util::text_token;
+
+#define ARGUS_CHUNK (1024 * 1024) ///< Bytes of ra output read at once
+#define ARGUS_CHUNKS_PER_WORKER 2 ///< Chunks parsed per worker thread and batch
+
+/**
+ *	\class	GFilter_argus::CArgusParseTask
+ *	\brief	Parses chunks of ra output, each consisting of complete lines
+ */
+class GFilter_argus::CArgusParseTask: public util::CParallelTask {
+	public:
+		CArgusParseTask(const vector<vector<char> > & chunks, vector<CFlowList> & results, vector<unsigned int> & low_confidence,
+		      const IPv6_addr & local_net, const IPv6_addr & netmask) :
+			chunks(chunks), results(results), low_confidence(low_confidence), local_net(local_net), netmask(netmask) {
+		}
+
+		/**
+		 *	Parse all lines of a chunk
+		 *
+		 *	\param number Number of the chunk within the batch
+		 *
+		 *	\exception std::string Errortext
+		 */
+		virtual void run(unsigned int number) {
+			const vector<char> & chunk = chunks[number];
+			CFlowList & flows = results[number];
+			flows.clear();
+			low_confidence[number] = 0;
+			const char * pos = chunk.empty() ? NULL : &chunk[0];
+			const char * end = pos + chunk.size();
+			while (pos < end) {
+				const char * eol = (const char *) memchr(pos, '\n', end - pos);
+				if (eol == NULL)
+					eol = end;
+				const char * p = pos;
+				while (p < eol && (*p == ' ' || *p == '\t' || *p == '\r'))
+					p++;
+				if (p < eol) { // skip empty lines
+					cflow_t argus_flow;
+					bool low = false;
+					parse_line(pos, eol, argus_flow, low);
+					if (low)
+						low_confidence[number]++;
+					invert_flow_if_needed(argus_flow, local_net, netmask);
+					flows.push_back(argus_flow);
+				}
+				pos = eol + 1;
+			}
+		}
+
+	private:
+		const vector<vector<char> > & chunks; ///< Chunks of the batch
+		vector<CFlowList> & results; ///< Flows, one list per chunk
+		vector<unsigned int> & low_confidence; ///< Number of flows with a low confidence direction, per chunk
+		IPv6_addr local_net; ///< Local network address
+		IPv6_addr netmask; ///< Network mask for local network address
+};
 
 /**
  *	Constructor
@@ -112,22 +171,102 @@ bool GFilter_argus::acceptFileForReading(std::string in_filename) const {
 	return false;
 }
 
+/**
+ *	Parses a line of ra output into a flow (not yet oriented by the local network)
+ *
+ *	\param line Start of the line
+ *	\param end End of the line (without newline)
+ *	\param argus_flow Flow to fill
+ *	\param low_confidence Set to true if argus detected the direction with low confidence
+ *
+ *	\exception string Errortext
+ */
+void GFilter_argus::parse_line(const char * line, const char * end, cflow_t & argus_flow, bool & low_confidence) {
+	const char * pos = line;
+	text_token field;
+	uint64_t value = 0;
+	uint8_t match_id = 0;
+	for (; match_id <= DST_TOS && util::next_field(pos, end, field); match_id++) {
+		bool ok = true;
+		switch (match_id) {
+			case START_TS:
+				ok = util::parse_seconds_ms(field, value);
+				argus_flow.startMs = value;
+				break;
+			case DURATION:
+				ok = util::parse_seconds_ms(field, value);
+				argus_flow.durationMs = value;
+				break;
+			case PROTOCOL:
+				argus_flow.prot = proto_string_to_proto_num(field);
+				break;
+			case SRC_IP:
+				ok = util::parse_ip(field, argus_flow.localIP);
+				break;
+			case DST_IP:
+				ok = util::parse_ip(field, argus_flow.remoteIP);
+				break;
+			case DIRECTION:
+				argus_flow.dir = flow_dir_string_to_flow_dir(field, low_confidence);
+				break;
+			case SRC_PORT:
+			case DST_PORT:
+				// ICMP type and code are shown instead of ports
+				value = 0;
+				if (argus_flow.prot != IPPROTO_ICMP)
+					ok = util::parse_uint(field, value) && value <= 0xffff;
+				if (match_id == SRC_PORT)
+					argus_flow.localPort = value;
+				else
+					argus_flow.remotePort = value;
+				break;
+			case SRC_PACKETS:
+			case DST_PACKETS:
+				ok = util::parse_uint(field, value);
+				argus_flow.dPkts += value;
+				break;
+			case SRC_BYTES:
+			case DST_BYTES:
+				ok = util::parse_uint(field, value);
+				argus_flow.dOctets += value;
+				break;
+			case SRC_TOS:
+			case DST_TOS:
+				ok = util::parse_uint(field, value);
+				argus_flow.tos_flags |= (uint8_t) value;
+				break;
+		}
+		if (!ok) {
+			stringstream error_msg;
+			error_msg << "argus parse error in (";
+			error_msg << string(line, end);
+			error_msg << "), column_id: ";
+			error_msg << ((int) match_id);
+			error_msg << " column_value: ";
+			error_msg << field.toString();
+			throw error_msg.str();
+		}
+	}
+}
+
 /**
  *	Read argus data from file into memory-based temporary flow list.
  *	Converts argus flows into cflow_t flows.
  *	The temporary flow list is not yet sorted and uniflows are not yet qualified.
  *
+ *	The output of ra is read in chunks of ARGUS_CHUNK bytes, cut at line ends. A batch of chunks
+ *	is parsed on all processors, then the flows are appended to the flowlist in the order of
+ *	the input.
+ *
  *	\param in_filename Inputfilename
  *	\param flowlist Reference to the flowlist
  *	\param local_net Local network address
  *	\param netmask Network mask for local network address
- *	\param append Future flag to allow the import of more than one file (not yet used)
+ *	\param append If true, do not clear the flowlist, instead append the flows to the existing data
  *
  * \exception string Errortext
  */
 void GFilter_argus::read_file(std::string in_filename, CFlowList & flowlist, const IPv6_addr & local_net, const IPv6_addr & netmask, bool append) const {
-	static const boost::regex re("\\s+"); // columns are separated by spaces
-
 	stringstream ss;
 	ss << "ra"; // ra command
 	ss << " -e ascii -u -c -r ";
@@ -140,92 +279,62 @@ void GFilter_argus::read_file(std::string in_filename, CFlowList & flowlist, con
 		throw "failed to run ra";
 	}
 
-	flowlist.get_allocator().allocate(1000);
-	char buffer[8 * 1024];
-	char* l = NULL;
-	while ((l = fgets(buffer, sizeof buffer, fp)) != NULL) {
-		if (flowlist.size() > 0 && (flowlist.size() % 1000) == 0) {
-			cout << flowlist.size() << " argus records read so far" << endl;
-		}
-		string line(l);
-		cflow_t argus_flow;
-		boost::sregex_token_iterator i(line.begin(), line.end(), re, -1);
-		boost::sregex_token_iterator j;
-		uint8_t match_id = 0;
-		try {
-			while (i != j) {
-				switch (match_id) {
-					case START_TS:
-						argus_flow.startMs = (uint32_t) boost::lexical_cast<double>(*i);
-						break;
-					case DURATION:
-						argus_flow.durationMs = (uint32_t) boost::lexical_cast<double>(*i);
-						break;
-					case PROTOCOL:
-						argus_flow.prot = proto_string_to_proto_num(*i);
-						break;
-					case SRC_IP:
-						argus_flow.localIP = IPv6_addr(*i);
-						break;
-					case DST_IP:
-						argus_flow.remoteIP = IPv6_addr(*i);
-						break;
-					case DIRECTION:
-						argus_flow.dir = flow_dir_string_to_flow_dir(*i);
-						break;
-					case SRC_PORT:
-						if (argus_flow.prot == ICMP) {
-							argus_flow.localPort = 0;
-						} else {
-							argus_flow.localPort = boost::lexical_cast<uint16_t>(*i);
-						}
-						break;
-					case DST_PORT:
-						if (argus_flow.prot == ICMP) {
-							argus_flow.remotePort = 0;
-						} else {
-							argus_flow.remotePort = boost::lexical_cast<uint16_t>(*i);
-						}
-						break;
-					case SRC_PACKETS:
-						argus_flow.dPkts += boost::lexical_cast<uint32_t>(*i);
-						break;
-					case DST_PACKETS:
-						argus_flow.dPkts += boost::lexical_cast<uint32_t>(*i);
-						break;
-					case SRC_BYTES:
-						argus_flow.dOctets += boost::lexical_cast<uint32_t>(*i);
-						break;
-					case DST_BYTES:
-						argus_flow.dOctets += boost::lexical_cast<uint32_t>(*i);
-						break;
-					case SRC_TOS:
-						argus_flow.tos_flags |= (uint8_t) boost::lexical_cast<uint16_t>(*i);
-						break;
-					case DST_TOS:
-						argus_flow.tos_flags |= (uint8_t) boost::lexical_cast<uint16_t>(*i);
-						break;
-					default:
-						cout << "unknown column detected(" << *i << ")" << endl;
+	if (!append)
+		flowlist.clear();
+	size_t first_flow = flowlist.size();
+
+	unsigned int workers = util::getWorkerCount();
+	vector<vector<char> > chunks(workers * ARGUS_CHUNKS_PER_WORKER);
+	vector<CFlowList> results(chunks.size());
+	vector<unsigned int> low_confidence(chunks.size());
+	CArgusParseTask task(chunks, results, low_confidence, local_net, netmask);
+	unsigned int low_confidence_total = 0;
+	vector<char> rest; // incomplete line at the end of the previous chunk
+
+	try {
+		bool eof = false;
+		while (!eof) {
+			// Read a batch of chunks, each ending at a line end
+			unsigned int count = 0;
+			while (count < chunks.size() && !eof) {
+				vector<char> & chunk = chunks[count];
+				chunk.swap(rest);
+				size_t used = chunk.size();
+				chunk.resize(used + ARGUS_CHUNK);
+				size_t n = fread(&chunk[used], 1, ARGUS_CHUNK, fp);
+				chunk.resize(used + n);
+				rest.clear();
+				if (n < ARGUS_CHUNK) {
+					eof = true; // end of the pipe (or read error, checked by pclose)
+				} else {
+					// keep the incomplete last line for the next chunk
+					size_t last = chunk.size();
+					while (last > 0 && chunk[last - 1] != '\n')
+						last--;
+					if (last > 0) {
+						rest.assign(chunk.begin() + last, chunk.end());
+						chunk.resize(last);
+					}
 				}
-				i++;
-				match_id++;
+				count++;
 			}
-		} catch (boost::bad_lexical_cast & e) {
-			stringstream error_msg;
-			error_msg << "argus parse error in (";
-			error_msg << line;
-			error_msg << "), column_id: ";
-			error_msg << ((int) match_id);
-			error_msg << " column_value: ";
-			error_msg << (*i);
-			error_msg << " error: ";
-			error_msg << e.what();
-			throw error_msg.str();
+
+			util::runParallel(task, count, workers);
+			for (unsigned int i = 0; i < count; i++) {
+				flowlist.insert(flowlist.end(), results[i].begin(), results[i].end());
+				low_confidence_total += low_confidence[i];
+				CFlowList().swap(results[i]);
+			}
+			cout << (flowlist.size() - first_flow) << " argus records read so far" << endl;
 		}
-		invert_flow_if_needed(argus_flow, local_net, netmask);
-		flowlist.push_back(argus_flow);
+	} catch (...) {
+		pclose(fp);
+		throw;
 	}
+	pclose(fp);
+
+	if (low_confidence_total > 0)
+		cout << low_confidence_total << " flow directions have been detected with low confidence. using argus' suggestion" << endl;
 	cout << "end of argus import" << endl;
 }
 
@@ -264,26 +373,24 @@ void GFilter_argus::invert_flow_if_needed(cflow_t& flow, const IPv6_addr& local_
  *
  *	\exception string Errortext
  */
-uint8_t GFilter_argus::proto_string_to_proto_num(const std::string & p_str) {
-	string lc_p_str(p_str);
-	std::transform(lc_p_str.begin(), lc_p_str.end(), lc_p_str.begin(), ::tolower);
-	if (lc_p_str == "icmp") {
+uint8_t GFilter_argus::proto_string_to_proto_num(const text_token & p_str) {
+	if (util::token_equals(p_str, "icmp")) {
 		return IPPROTO_ICMP;
 	}
-	if (lc_p_str == "tcp") {
+	if (util::token_equals(p_str, "tcp")) {
 		return IPPROTO_TCP;
 	}
 	// argus automatically tries to detect RCP and RTCP and displays this instead of UDP
 	// 	http://www.qosient.com/argus/index.shtml
-	if (lc_p_str == "udp" || lc_p_str == "rtp" || lc_p_str == "rtcp") {
+	if (util::token_equals(p_str, "udp") || util::token_equals(p_str, "rtp") || util::token_equals(p_str, "rtcp")) {
 		return IPPROTO_UDP;
 	}
-	if (lc_p_str == "igmp") {
+	if (util::token_equals(p_str, "igmp")) {
 		return IPPROTO_IGMP;
 	}
 	stringstream error_message;
 	error_message << "unknown protocol detected(";
-	error_message << p_str;
+	error_message << p_str.toString();
 	error_message << "). to add support, add a mapping to GFilter_argus::proto_string_to_proto_num";
 	throw error_message.str();
 }
@@ -292,12 +399,13 @@ uint8_t GFilter_argus::proto_string_to_proto_num(const std::string & p_str) {
  *	Return the flow direction as uint8_t (flow_type_t) from a variable representing the flowdir as a string
  *
  *	\param fd_str Textual representation of a flow direction
+ *	\param low_confidence Set to true if the direction was detected with low confidence
  *
  *	\return uint8_t Flow number
  *
  *	\exception string Errortext
  */
-uint8_t GFilter_argus::flow_dir_string_to_flow_dir(const std::string & fd_str) {
+uint8_t GFilter_argus::flow_dir_string_to_flow_dir(const text_token & fd_str, bool & low_confidence) {
 	// basic information about argus flow directions:
 	//
 	// Argus direction identifiers use the following symbols:
@@ -320,27 +428,27 @@ uint8_t GFilter_argus::flow_dir_string_to_flow_dir(const std::string & fd_str) {
 	// flow directions containing ?:     http://comments.gmane.org/gmane.network.argus/7923
 	// argus website:                    http://www.qosient.com/argus/index.shtml
 
-	if (fd_str == "<->" || fd_str == "<|>" || fd_str == "<o>") {
+	if (util::token_equals(fd_str, "<->") || util::token_equals(fd_str, "<|>") || util::token_equals(fd_str, "<o>")) {
 		return biflow;
 	}
-	if (fd_str == "->" || fd_str == "|>" || fd_str == "o>") {
+	if (util::token_equals(fd_str, "->") || util::token_equals(fd_str, "|>") || util::token_equals(fd_str, "o>")) {
 		return outflow;
 	}
-	if (fd_str == "<-" || fd_str == "<|" || fd_str == "<o") {
+	if (util::token_equals(fd_str, "<-") || util::token_equals(fd_str, "<|") || util::token_equals(fd_str, "<o")) {
 		return inflow;
 	}
-	cout << "flow direction(" << fd_str << ") has been detected with low confidence. using argus' suggestion" << endl;
-	if (fd_str == "<?>") {
+	low_confidence = true;
+	if (util::token_equals(fd_str, "<?>")) {
 		return biflow;
 	}
-	if (fd_str == "?>") {
+	if (util::token_equals(fd_str, "?>")) {
 		return outflow;
 	}
-	if (fd_str == "<?") {
+	if (util::token_equals(fd_str, "<?")) {
 		return inflow;
 	}
 	stringstream error_msg;
 	error_msg << "unknown flow direction:\t";
-	error_msg << fd_str;
+	error_msg << fd_str.toString();
 	throw error_msg.str();
 }
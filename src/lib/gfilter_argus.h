@@ -9,6 +9,7 @@
 #define GFILTER_ARGUS_H_
 
 #include "gfilter.h"
+#include "gtextparse.h"
 
 /**
  *	\class	GFilter_argus
@@ -21,9 +22,12 @@ class GFilter_argus: public GFilter {
 		virtual bool acceptFileForReading(std::string in_filename) const;
 
 	private:
-		static uint8_t proto_string_to_proto_num(const std::string& p_str);
-		static uint8_t flow_dir_string_to_flow_dir(const std::string& fd_str);
+		class CArgusParseTask;
+
+		static uint8_t proto_string_to_proto_num(const util::text_token & p_str);
+		static uint8_t flow_dir_string_to_flow_dir(const util::text_token & fd_str, bool & low_confidence);
 		static void invert_flow_if_needed(cflow_t& flow, const IPv6_addr& local_net, const IPv6_addr& netmask);
+		static void parse_line(const char * line, const char * end, cflow_t & flow, bool & low_confidence);
 
 		enum ARGUS_FIELDS {
 			START_TS = 0,
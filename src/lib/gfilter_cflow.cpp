@@ -7,7 +7,16 @@
  */
 
 #include <iostream>
+#include <fstream>
 #include <sstream>
+#include <cstring>
+#include <cstdio>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <zlib.h>
 #include <boost/iostreams/filtering_streambuf.hpp>
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
@@ -16,6 +25,7 @@
 #include "gfilter_cflow.h"
 #include "gutil.h"
 #include "cflow.h"
+#include "gparallel.h"
 
 using namespace std;
 
@@ -73,9 +83,14 @@ GFilter_cflow::cflow_version GFilter_cflow::detect_cflow_version(string in_filen
 	if (FLG & 0x4) { // Detect if there is an extra field and jump over if
 		uint16_t xlen = 0;
 		cflow_inputstream.read((char*) &xlen, 2);
-		cout << "Input file has FLG.FEXTRA set, size = " << xlen << endl;
 		long newpos = cflow_inputstream.tellg();
 		newpos += (long) xlen;
+		// The members of block-compressed cflow6 files carry 'CB', 'CX', 'CL', 'CS' or 'CE' subfields
+		char SI[2] = { 0, 0 };
+		if (xlen >= 4)
+			cflow_inputstream.read(SI, 2);
+		if (SI[0] != 'C' || SI[1] == 0 || strchr("BXLSE", SI[1]) == NULL)
+			cout << "Input file has FLG.FEXTRA set, size = " << xlen << endl;
 		cflow_inputstream.seekg(newpos);
 	}
 
@@ -109,7 +124,8 @@ GFilter_cflow::cflow_version GFilter_cflow::detect_cflow_version(string in_filen
 }
 
 /**
- *	Returns the number of bytes the uncompressed gz-file contains
+ *	Returns the number of bytes the uncompressed gz-file contains, modulo 4 GiB.
+ *	This is taken from the last gzip member only, thus it is just a hint.
  *
  *	\param in_filename Filestream for which the size gets looked up
  *
@@ -155,7 +171,7 @@ void GFilter_cflow::openGunzipStream(boost::iostreams::filtering_istream & in_fi
  *	\param flowlist List which will be filled with the cflows
  *	\param local_net Contains the IP
  *	\param netmask Contains the netmask
- *	\param append If true, do not clear the flowlist, instead append it to the existing data (not yet used)
+ *	\param append If true, do not clear the flowlist, instead append it to the existing data
  */
 void GFilter_cflow::read_file(std::string filename, CFlowList & flowlist, const IPv6_addr & local_net, const IPv6_addr & netmask, bool append) const {
 	read_file(filename, flowlist, append);
@@ -165,34 +181,25 @@ void GFilter_cflow::read_file(std::string filename, CFlowList & flowlist, const
 /**
  *	Reads a given file into a given flowlist.
  *
+ *	The file is decompressed as a stream and decoded in batches of records. Neither the
+ *	gzip ISIZE trailer (just 32 bit, thus wrong for files beyond 4 GiB) nor a single gzip
+ *	member is required; ISIZE is only used as a hint for the initial allocation.
+ *
  *	\param filename Filename of the compressed cflow_t file
  *	\param flowlist List which will be filled with the cflows
- *	\param append If true, do not clear the flowlist, instead append it to the existing data (not yet used)
+ *	\param append If true, do not clear the flowlist, instead append it to the existing data
  *
  *	\exception std::string Errortext
  */
 void GFilter_cflow::read_file(string in_filename, CFlowList & flowlist, bool append) const {
-	// TODO: take care about the append flag
 	ifstream cflow_compressed_inputstream;
-	uint32_t uncompressed_size = 0;
-
 	try {
 		util::open_infile(cflow_compressed_inputstream, in_filename);
 	} catch (...) {
 		string errormsg = "ERROR: check input file " + in_filename + " and try again.";
 		throw errormsg;
 	}
-
-	uncompressed_size = getUncompressedFileSize(cflow_compressed_inputstream);
-
-	// Check if this file can be a cflow_t-file
-	if (!checkCflowFileSize(uncompressed_size)) {
-		string errortext = in_filename;
-		errortext += " does not look like a cflow file (wrong size)";
-		throw errortext;
-	}
-
-	//close the file for now
+	uint32_t isize = getUncompressedFileSize(cflow_compressed_inputstream);
 	cflow_compressed_inputstream.close();
 
 	// Open up a stream chain
@@ -200,41 +207,64 @@ void GFilter_cflow::read_file(string in_filename, CFlowList & flowlist, bool app
 	boost::iostreams::file_source infs(in_filename);
 	openGunzipStream(cflow_uncompressed_inputstream, infs, in_filename);
 
-	unsigned int maxnum_flows = getNumberOfFlows(uncompressed_size);
-
-	// Resize flowlist to fit for all cflows
-	flowlist.resize(maxnum_flows);
+	if (!append)
+		flowlist.clear();
+	const size_t recordSize = getRecordSize();
+	if (isize % recordSize == 0)
+		flowlist.reserve(flowlist.size() + isize / recordSize);
 
-	CFlowList::iterator flowlist_iterator = flowlist.begin();
+	// Read file data: decode batches of flows
+	const unsigned int batchSize = 4096;
+	vector<char> buffer(batchSize * recordSize);
+	while (true) {
+		cflow_uncompressed_inputstream.read(&buffer[0], buffer.size());
+		streamsize num_read = cflow_uncompressed_inputstream.gcount();
+		if (num_read % recordSize != 0) {
+			stringstream error;
+			error << "ERROR: " << in_filename << " ends with an incomplete flow record (" << num_read % recordSize << " of " << recordSize
+			      << " bytes).";
+			throw error.str();
+		}
 
-	// Read file data: get all flows
-	while (flowlist_iterator != flowlist.end()) {
-		try {
-			read_flow(cflow_uncompressed_inputstream, *flowlist_iterator);
-		} catch (string & error) {
-			throw error;
+		size_t count = num_read / recordSize;
+		if (flowlist.size() + count > flowlist.capacity()) {
+			// Grow by half of the current size at least: linear total cost, less slack than doubling
+			flowlist.reserve(flowlist.capacity() + max(flowlist.capacity() / 2, (size_t) batchSize));
+		}
+		CFlowList::size_type first = flowlist.size();
+		flowlist.resize(first + count);
+		for (size_t i = 0; i < count; i++) {
+			cflow_t & cf = flowlist[first + i];
+			decode_flow(&buffer[i * recordSize], cf);
+			// Clear early/late attributes
+			cf.flowtype &= (flow_type_t) simpleflow;
 		}
-		// advance to next index in flowlist
-		flowlist_iterator++;
 
-		// Clear early/late attributes
-		flowlist_iterator->flowtype &= (flow_type_t) simpleflow;
+		if (!cflow_uncompressed_inputstream.good())
+			break;
 	}
+}
 
-	// tellg() does not work on boost::iostreams::filtering_istream, so we have to work around
-	char tmpChar = 'X';
-	cflow_uncompressed_inputstream.read(&tmpChar, 1);
+/**
+ *	Reads a single flow and stores it into a cflow_t struct
+ *
+ *	\param infs Inputstream to read from
+ *	\param cf Cflow struct to write to
+ *
+ *	\exception std::string Errortext
+ */
+void GFilter_cflow::read_flow(boost::iostreams::filtering_istream & infs, cflow_t & cf) const {
+	const size_t recordSize = getRecordSize();
+	vector<char> record(recordSize);
+	infs.read(&record[0], recordSize);
 
-	// if this is still good, something went wrong
-	if (cflow_uncompressed_inputstream.good()) {
-		string error = "ERROR: flow list overflow. ";
-		error += "Calculated flow count ";
-		error += maxnum_flows;
-		error += " from input file isize ";
-		error += uncompressed_size;
-		error += " is exceeded.";
-		throw error;
+	streamsize num_read = infs.gcount();
+	if (num_read != (streamsize) recordSize) {
+		stringstream error;
+		error << "ERROR: read " << num_read << " byte instead of " << recordSize << ". Possibly incomplete flow read from file.";
+		throw error.str();
 	}
+	decode_flow(&record[0], cf);
 }
 
 /**
@@ -249,13 +279,7 @@ void GFilter_cflow::read_file(string in_filename, CFlowList & flowlist, bool app
 void GFilter_cflow::write_file(const std::string & out_filename, const Subflowlist subflowlist, bool appendIfExisting) const {
 	CFlowList oldflowlist;
 	if (util::fileExists(out_filename) && appendIfExisting) {
-		GFilter_cflow4 gfilter_cflow4;
-		GFilter_cflow6 gfilter_cflow6;
-		if (gfilter_cflow4.acceptFileForReading(out_filename))
-			gfilter_cflow4.read_file(out_filename, oldflowlist, false);
-		else if (gfilter_cflow6.acceptFileForReading(out_filename))
-			gfilter_cflow6.read_file(out_filename, oldflowlist, false);
-		else {
+		if (!read_existing_file(out_filename, oldflowlist)) {
 			stringstream error;
 			error << "Can not append to " << out_filename << ". Can not read in this file.";
 			throw error.str();
@@ -285,6 +309,145 @@ void GFilter_cflow::write_file(const std::string & out_filename, const Subflowli
 	}
 }
 
+/**
+ *	Reads an already existing cflow4 or cflow6 file, e.g. to append new flows to it.
+ *
+ *	\param filename Filename of the compressed cflow_t file
+ *	\param flowlist List which will be filled with the cflows
+ *
+ *	\return False if the file is not a cflow file
+ *
+ *	\exception std::string Errortext
+ */
+bool GFilter_cflow::read_existing_file(const std::string & filename, CFlowList & flowlist) const {
+	GFilter_cflow4 gfilter_cflow4;
+	GFilter_cflow6 gfilter_cflow6;
+	if (gfilter_cflow4.acceptFileForReading(filename))
+		gfilter_cflow4.read_file(filename, flowlist, false);
+	else if (gfilter_cflow6.acceptFileForReading(filename))
+		gfilter_cflow6.read_file(filename, flowlist, false);
+	else
+		return false;
+	return true;
+}
+
+/**
+ *	Reads the block index of a block container (see struct cflow_block), the optional
+ *	host index (see struct cflow_block_hosts) and the segment index (see struct cflow_segment).
+ *
+ *	\param fd Descriptor of the opened file
+ *	\param index Block index to fill
+ *	\param hostIndex Host index to fill (optional). Stays empty if the file has none.
+ *	\param segments Segment index to fill (optional). Holds a single segment if the file has no segment index.
+ *	\param indexOffset Receives the file offset of the first index member (optional)
+ *
+ *	\return False if this file is not a block container (e.g. an old single-stream file)
+ */
+bool GFilter_cflow::read_block_index(int fd, CFlowBlockIndex & index, CFlowHostIndex * hostIndex, CFlowSegmentIndex * segments,
+      uint64_t * indexOffset) const {
+	struct stat filestat;
+	if (fstat(fd, &filestat) == -1 || filestat.st_size < CFLOW_BLOCK_END_SIZE)
+		return false;
+
+	// The final member is an empty gzip member with a 'CE' subfield: {index offset, block count, flow count}
+	uint64_t endOffset = filestat.st_size - CFLOW_BLOCK_END_SIZE;
+	unsigned char end[CFLOW_BLOCK_END_SIZE];
+	if (pread(fd, end, sizeof(end), endOffset) != (ssize_t) sizeof(end))
+		return false;
+	uint16_t xlen, sublen;
+	memcpy(&xlen, end + 10, 2);
+	memcpy(&sublen, end + 14, 2);
+	if (end[0] != 0x1f || end[1] != 0x8b || end[2] != 8 || end[3] != 0x04 || xlen != 28 || end[12] != 'C' || end[13] != 'E' || sublen != 24)
+		return false;
+	uint64_t firstIndex, blockCount, flowCount;
+	memcpy(&firstIndex, end + 16, 8);
+	memcpy(&blockCount, end + 24, 8);
+	memcpy(&flowCount, end + 32, 8);
+
+	// Index members: empty gzip members with a 'CX' subfield holding cflow_block entries,
+	// optionally followed by members with a 'CL' subfield holding cflow_block_hosts entries
+	// and members with a 'CS' subfield holding cflow_segment entries
+	index.clear();
+	if (hostIndex != NULL)
+		hostIndex->clear();
+	if (segments != NULL)
+		segments->clear();
+	uint64_t offset = firstIndex;
+	uint64_t flows = 0;
+	uint64_t hostEntries = 0;
+	while (offset < endOffset) {
+		unsigned char header[16];
+		if (pread(fd, header, sizeof(header), offset) != (ssize_t) sizeof(header))
+			return false;
+		memcpy(&xlen, header + 10, 2);
+		memcpy(&sublen, header + 14, 2);
+		if (header[0] != 0x1f || header[1] != 0x8b || header[3] != 0x04 || header[12] != 'C' || sublen + 4 != xlen)
+			return false;
+		if (header[13] == 'X') {
+			if (sublen % sizeof(cflow_block) != 0)
+				return false;
+			CFlowBlockIndex::size_type first = index.size();
+			index.resize(first + sublen / sizeof(cflow_block));
+			if (pread(fd, &index[first], sublen, offset + 16) != (ssize_t) sublen)
+				return false;
+			for (CFlowBlockIndex::size_type i = first; i < index.size(); i++)
+				flows += index[i].flowCount;
+		} else if (header[13] == 'L') {
+			if (sublen % sizeof(cflow_block_hosts) != 0)
+				return false;
+			hostEntries += sublen / sizeof(cflow_block_hosts);
+			if (hostIndex != NULL) {
+				CFlowHostIndex::size_type first = hostIndex->size();
+				hostIndex->resize(first + sublen / sizeof(cflow_block_hosts));
+				if (pread(fd, (char *) &(*hostIndex)[first], sublen, offset + 16) != (ssize_t) sublen)
+					return false;
+			}
+		} else if (header[13] == 'S' && segments != NULL) {
+			if (sublen % sizeof(cflow_segment) != 0)
+				return false;
+			CFlowSegmentIndex::size_type first = segments->size();
+			segments->resize(first + sublen / sizeof(cflow_segment));
+			if (pread(fd, (char *) &(*segments)[first], sublen, offset + 16) != (ssize_t) sublen)
+				return false;
+		}
+		offset += 12 + xlen + 10; // header, extra field, empty deflate data and trailer
+	}
+	if (hostIndex != NULL && hostIndex->size() != index.size())
+		hostIndex->clear(); // unusable
+	if (index.size() != blockCount || flows != flowCount)
+		return false;
+	if (indexOffset != NULL)
+		*indexOffset = firstIndex;
+
+	if (segments != NULL) {
+		if (segments->empty()) {
+			// Written without segment index: a single segment, sorted if it has a host index
+			cflow_segment segment;
+			segment.firstBlock = 0;
+			segment.blockCount = index.size();
+			segment.flowCount = flowCount;
+			segment.flags = (hostEntries == index.size() && !index.empty()) ? CFLOW_SEGMENT_HOST_ORDER : 0;
+			segment.reserved = 0;
+			segments->push_back(segment);
+		}
+		// The segments have to cover all blocks in order
+		uint64_t block = 0;
+		for (CFlowSegmentIndex::const_iterator it = segments->begin(); it != segments->end(); it++) {
+			if (it->firstBlock != block || block + it->blockCount > index.size())
+				return false;
+			uint64_t segmentFlows = 0;
+			for (uint32_t i = 0; i < it->blockCount; i++)
+				segmentFlows += index[block + i].flowCount;
+			if (segmentFlows != it->flowCount)
+				return false;
+			block += it->blockCount;
+		}
+		if (block != index.size())
+			return false;
+	}
+	return true;
+}
+
 /**
  * Writes a single flow to filtering_ostream
  *
@@ -343,34 +506,12 @@ bool GFilter_cflow4::acceptFileForReading(string in_filename) const {
 }
 
 /**
- *	Decides, if the given number of bytes is a multiple of the size of a cflow4 struct
- *
- *	\param uncompressed_size Size in bytes of the whole e.g. file
- *
- *	\return True if the given number is a multiple of sizeof(cflow4)
- */
-bool GFilter_cflow4::checkCflowFileSize(uint32_t uncompressed_size) const {
-	if (uncompressed_size % sizeof(cflow4) != 0) {
-		string errtext = "\nERROR: input file data size is not a multiple of a cflow4 record.\n";
-		errtext += "Possibly this is not a gzipped file containing cflow4 data.\n";
-		stringstream ss;
-		ss << "File size is: " << uncompressed_size << ", sizeof(struct cflow4) is: " << sizeof(struct cflow4) << "\n";
-		errtext += ss.str();
-		cerr << errtext;
-		return false;
-	}
-	return true;
-}
-
-/**
- *	Return the number of flows which can be stored in a given filesize
- *
- *	\param size Size in bytes of the whole e.g. file
+ *	Size of a cflow4 record as stored in files
  *
- *	\return Number of cflow4 version flows fit into this size
+ *	\return sizeof(cflow4)
  */
-unsigned int GFilter_cflow4::getNumberOfFlows(uint32_t size) const {
-	return size / (sizeof(struct cflow4));
+size_t GFilter_cflow4::getRecordSize() const {
+	return sizeof(struct cflow4);
 }
 
 /**
@@ -386,30 +527,20 @@ void GFilter_cflow4::read_flow(boost::iostreams::filtering_istream & infs, cflow
 }
 
 /**
- *	Reads a single flow and stores it into a cflow_t struct
+ *	Converts a single cflow4 record into a cflow_t struct
  *
- *	\param infs Inputstream to read from
+ *	\param record Record as read from file (getRecordSize() bytes)
  *	\param cf Cflow struct to write to
  *
  *	\exception std::string Errortext
  */
-void GFilter_cflow4::read_flow(boost::iostreams::filtering_istream & infs, cflow_t & cf) const {
+void GFilter_cflow4::decode_flow(const char * record, cflow_t & cf) const {
 	cflow4 tmpCflow4;
-	infs.read((char *) &tmpCflow4, sizeof(struct cflow4));
-
-	streamsize num_read = infs.gcount();
-	if (num_read != sizeof(struct cflow4)) {
-		string errtext = "ERROR: read ";
-		errtext += num_read;
-		errtext += " byte instead of ";
-		errtext += sizeof(struct cflow4);
-		errtext += ". Possibly incomplete flow read from file.";
-		throw errtext;
-	}
+	memcpy(&tmpCflow4, record, sizeof(struct cflow4));
 
 	// Check flow data
 	if (tmpCflow4.magic != CFLOW_4_MAGIC_NUMBER) {
-		string errtext = "ERROR: file check failed (wrong magic number) in in CImport::read_flow4.";
+		string errtext = "ERROR: file check failed (wrong magic number) in GFilter_cflow4::decode_flow.";
 		throw errtext;
 	}
 
@@ -462,34 +593,12 @@ bool GFilter_cflow6::acceptFileForReading(string in_filename) const {
 }
 
 /**
- *	Decides, if the given number of bytes is a multiple of the size of a cflow6 struct
- *
- *	\param uncompressed_size Size in bytes of the whole e.g. file
- *
- *	\return True if the given number is a multiple of sizeof(cflow6)
- */
-bool GFilter_cflow6::checkCflowFileSize(uint32_t uncompressed_size) const {
-	if (uncompressed_size % sizeof(cflow_t) != 0) {
-		string errtext = "\nERROR: input file data size is not a multiple of a cflow4 record.\n";
-		errtext += "Possibly this is not a gzipped file containing cflow4 data.\n";
-		stringstream ss;
-		ss << "File size is: " << uncompressed_size << ", sizeof(struct cflow) is: " << sizeof(cflow_t) << "\n";
-		errtext += ss.str();
-		cerr << errtext;
-		return false;
-	}
-	return true;
-}
-
-/**
- *	Return the number of flows which can be stored in a given filesize
- *
- *	\param size Size in bytes of the whole e.g. file
+ *	Size of a cflow6 record as stored in files
  *
- *	\return Number of cflow4 version flows fit into this size
+ *	\return sizeof(cflow_t)
  */
-unsigned int GFilter_cflow6::getNumberOfFlows(uint32_t size) const {
-	return size / (sizeof(cflow_t));
+size_t GFilter_cflow6::getRecordSize() const {
+	return sizeof(cflow_t);
 }
 
 /**
@@ -506,29 +615,19 @@ void GFilter_cflow6::read_flow(boost::iostreams::filtering_istream & infs, cflow
 }
 
 /**
- *	Reads a single flow and stores it into a cflow_t struct
+ *	Converts a single cflow6 record into a cflow_t struct
  *
- *	\param infs Inputstream to read from
+ *	\param record Record as read from file (getRecordSize() bytes)
  *	\param cf Cflow struct to write to
  *
  *	\exception std::string Errortext
  */
-void GFilter_cflow6::read_flow(boost::iostreams::filtering_istream & infs, cflow_t & cf) const {
-	infs.read((char *) &cf, sizeof(cflow_t));
-
-	streamsize num_read = infs.gcount();
-	if (num_read != sizeof(cflow_t)) {
-		string errtext = "ERROR: read ";
-		errtext += num_read;
-		errtext += " byte instead of ";
-		errtext += sizeof(struct cflow4);
-		errtext += ". Possibly incomplete flow read from file.";
-		throw errtext;
-	}
+void GFilter_cflow6::decode_flow(const char * record, cflow_t & cf) const {
+	memcpy((char *) &cf, record, sizeof(cflow_t));
 
 	// Check flow data
 	if (cf.magic != CFLOW_CURRENT_MAGIC_NUMBER) {
-		string errtext = "ERROR: file check failed (wrong magic number) in in CImport::read_flow6.";
+		string errtext = "ERROR: file check failed (wrong magic number) in GFilter_cflow6::decode_flow.";
 		throw errtext;
 	}
 }
@@ -567,3 +666,973 @@ void GFilter_cflow6::openGzipStream(boost::iostreams::filtering_ostream & out_fi
 void GFilter_cflow6::write_flow(boost::iostreams::filtering_ostream & out_filestream, const cflow_t & cf) const {
 	out_filestream.write((char *) &(cf), sizeof(cflow_t));
 }
+
+/**
+ *	Reads a given file into a given flowlist.
+ *
+ *	Block containers are decompressed in parallel, one block per work item. Old single-stream
+ *	files are read sequentially.
+ *
+ *	\param in_filename Filename of the compressed cflow_t file
+ *	\param flowlist List which will be filled with the cflows
+ *	\param append If true, do not clear the flowlist, instead append it to the existing data
+ *
+ *	\exception std::string Errortext
+ */
+void GFilter_cflow6::read_file(string in_filename, CFlowList & flowlist, bool append) const {
+	int fd = open(in_filename.c_str(), O_RDONLY);
+	CFlowBlockIndex index;
+	CFlowSegmentIndex segments;
+	if (fd != -1)
+		flock(fd, LOCK_SH); // wait for a concurrent append to finish
+	if (fd == -1 || !read_block_index(fd, index, NULL, &segments)) {
+		if (fd != -1)
+			close(fd);
+		GFilter_cflow::read_file(in_filename, flowlist, append);
+		return;
+	}
+
+	try {
+		read_blocks(fd, in_filename, index, segments, flowlist, append);
+	} catch (string & e) {
+		close(fd);
+		throw e;
+	}
+	close(fd);
+}
+
+/**
+ *	Decompresses a single block of a block container
+ *
+ *	\param fd File to read from (pread is used, thus it can be shared between threads)
+ *	\param entry Block index entry
+ *	\param block Number of the block (for messages)
+ *	\param out Destination, room for entry.flowCount flows
+ *
+ *	\exception std::string Errortext
+ */
+static void decompress_block(int fd, const cflow_block & entry, unsigned int block, cflow_t * out) {
+	stringstream error;
+	error << "ERROR: block " << block << " at offset " << entry.offset << " is corrupt";
+
+	vector<unsigned char> member(entry.size);
+	if (entry.size < 18 || pread(fd, &member[0], entry.size, entry.offset) != (ssize_t) entry.size)
+		throw error.str();
+	if (member[0] != 0x1f || member[1] != 0x8b || member[2] != 8)
+		throw error.str();
+
+	// Skip the optional header fields
+	unsigned int flags = member[3];
+	size_t pos = 10;
+	if (flags & 0x04) {
+		uint16_t xlen;
+		memcpy(&xlen, &member[pos], 2);
+		pos += 2 + xlen;
+	}
+	if (flags & 0x08)
+		while (pos < member.size() && member[pos++] != '\0')
+			;
+	if (flags & 0x10)
+		while (pos < member.size() && member[pos++] != '\0')
+			;
+	if (flags & 0x02)
+		pos += 2;
+	if (pos + 8 > member.size())
+		throw error.str();
+
+	uint32_t crc, isize;
+	memcpy(&crc, &member[member.size() - 8], 4);
+	memcpy(&isize, &member[member.size() - 4], 4);
+	uLong bytes = (uLong) entry.flowCount * sizeof(cflow_t);
+	if (isize != (uint32_t) bytes)
+		throw error.str();
+
+	z_stream stream;
+	memset(&stream, 0, sizeof(stream));
+	if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+		throw error.str();
+	stream.next_in = &member[pos];
+	stream.avail_in = member.size() - pos - 8;
+	stream.next_out = (Bytef *) out;
+	stream.avail_out = bytes;
+	int ret = inflate(&stream, Z_FINISH);
+	inflateEnd(&stream);
+	if (ret != Z_STREAM_END || stream.total_out != bytes || crc32(crc32(0L, Z_NULL, 0), (const Bytef *) out, bytes) != crc)
+		throw error.str();
+
+	for (uint32_t i = 0; i < entry.flowCount; i++) {
+		if (out[i].magic != CFLOW_CURRENT_MAGIC_NUMBER)
+			throw string("ERROR: file check failed (wrong magic number) in GFilter_cflow6::read_blocks.");
+		// Clear early/late attributes
+		out[i].flowtype &= (flow_type_t) simpleflow;
+	}
+}
+
+/**
+ *	\class	CBlockDecompressTask
+ *	\brief	Decompresses the blocks of a block container straight into the flowlist
+ */
+class CBlockDecompressTask: public util::CParallelTask {
+	public:
+		CBlockDecompressTask(int fd, const CFlowBlockIndex & index, const vector<uint64_t> & firstFlow, cflow_t * flows) :
+			fd(fd), index(index), firstFlow(firstFlow), flows(flows) {
+		}
+
+		/**
+		 *	Decompress a single block
+		 *
+		 *	\param block Number of the block
+		 *
+		 *	\exception std::string Errortext
+		 */
+		virtual void run(unsigned int block) {
+			decompress_block(fd, index[block], block, flows + firstFlow[block]);
+		}
+
+	private:
+		int fd; ///< File to read from (pread is used, thus it can be shared)
+		const CFlowBlockIndex & index; ///< Blocks to decompress
+		const vector<uint64_t> & firstFlow; ///< Index into flows of the first flow of each block
+		cflow_t * flows; ///< Destination
+};
+
+/**
+ *	Compares the last localIP of a block with a localIP (for binary search in the host index)
+ *
+ *	\param hosts Host index entry
+ *	\param localIP IP to compare to
+ *
+ *	\return True if all hosts of the block are below localIP
+ */
+static bool blockBeforeHost(const cflow_block_hosts & hosts, const IPv6_addr & localIP) {
+	return hosts.lastLocalIP < localIP;
+}
+
+/**
+ *	Reads the flows of the first host_count hosts not below localIP from a single segment.
+ *	The host index is used to find the first block by binary search, then just the needed blocks get decompressed.
+ *
+ *	\param fd Descriptor of the opened file
+ *	\param index Block index of the file
+ *	\param hostIndex Host index of the file
+ *	\param segment Segment to read from
+ *	\param localIP First host to read
+ *	\param host_count Number of hosts to read
+ *	\param flowlist List to append the flows to
+ *
+ *	\exception std::string Errortext
+ */
+void GFilter_cflow6::read_segment_hosts(int fd, const CFlowBlockIndex & index, const CFlowHostIndex & hostIndex, const cflow_segment & segment,
+      const IPv6_addr & localIP, int host_count, CFlowList & flowlist) const {
+	CFlowHostIndex::const_iterator segmentBegin = hostIndex.begin() + segment.firstBlock;
+	CFlowHostIndex::const_iterator segmentEnd = segmentBegin + segment.blockCount;
+	CFlowHostIndex::const_iterator it = lower_bound(segmentBegin, segmentEnd, localIP, blockBeforeHost);
+	unsigned int hosts_seen = 0;
+	bool done = false;
+	vector<cflow_t> block;
+	for (CFlowHostIndex::size_type b = it - hostIndex.begin(); b < (CFlowHostIndex::size_type) (segmentEnd - hostIndex.begin()) && !done; b++) {
+		block.resize(index[b].flowCount);
+		if (block.empty())
+			continue;
+		decompress_block(fd, index[b], b, &block[0]);
+		for (vector<cflow_t>::const_iterator flow = block.begin(); flow != block.end(); flow++) {
+			if (hosts_seen == 0) {
+				if (flow->localIP < localIP)
+					continue;
+				hosts_seen = 1;
+			} else if (flow->localIP != flowlist.back().localIP) {
+				if (hosts_seen >= (unsigned int) host_count) {
+					done = true;
+					break;
+				}
+				hosts_seen++;
+			}
+			flowlist.push_back(*flow);
+		}
+	}
+}
+
+/**
+ *	Reads only the flows of the host localIP and of the hosts following it, up to a total of host_count hosts.
+ *	Every segment of the file is searched using the host index, the flows found are merged.
+ *
+ *	\param in_filename Filename of the compressed cflow_t file
+ *	\param flowlist List which will be filled with the cflows (empty if localIP is not found)
+ *	\param localIP First host to read
+ *	\param host_count Number of hosts to read
+ *
+ *	\return False if the file has no host index, flowlist is untouched then
+ *
+ *	\exception std::string Errortext
+ */
+bool GFilter_cflow6::read_file_hosts(std::string in_filename, CFlowList & flowlist, const IPv6_addr & localIP, int host_count) const {
+	int fd = open(in_filename.c_str(), O_RDONLY);
+	if (fd == -1)
+		return false;
+	flock(fd, LOCK_SH); // wait for a concurrent append to finish
+	CFlowBlockIndex index;
+	CFlowHostIndex hostIndex;
+	CFlowSegmentIndex segments;
+	if (!read_block_index(fd, index, &hostIndex, &segments) || hostIndex.empty()) {
+		close(fd);
+		return false;
+	}
+
+	CFlowList found;
+	try {
+		if (segments.size() == 1) {
+			read_segment_hosts(fd, index, hostIndex, segments[0], localIP, host_count, found);
+		} else {
+			// Each segment holds its own sorted run of hosts
+			vector<CFlowList> parts(segments.size());
+			vector<Subflowlist> runs;
+			for (CFlowSegmentIndex::size_type i = 0; i < segments.size(); i++) {
+				read_segment_hosts(fd, index, hostIndex, segments[i], localIP, host_count, parts[i]);
+				runs.push_back(Subflowlist(parts[i]));
+			}
+			mergeSortedFlows(runs, found);
+		}
+	} catch (string & e) {
+		close(fd);
+		throw in_filename + ": " + e;
+	}
+	close(fd);
+
+	// Keep the first host_count hosts, provided the first one is localIP
+	flowlist.clear();
+	unsigned int hosts_seen = 0;
+	if (!found.empty() && found[0].localIP == localIP) {
+		CFlowList::iterator flow = found.begin();
+		for (; flow != found.end(); flow++) {
+			if (flow == found.begin() || flow->localIP != (flow - 1)->localIP) {
+				if (hosts_seen >= (unsigned int) host_count)
+					break;
+				hosts_seen++;
+			}
+		}
+		flowlist.assign(found.begin(), flow);
+	}
+	cout << "Read " << flowlist.size() << " flows of " << hosts_seen << " host(s) from " << in_filename << " using its host index.\n";
+	return true;
+}
+
+/**
+ *	Decompresses all blocks of a block container in parallel. If the file consists of several
+ *	segments, these get merged (or sorted, if not all of them are sorted).
+ *
+ *	\param fd Descriptor of the opened file
+ *	\param in_filename Filename (for messages)
+ *	\param index Block index of the file
+ *	\param segments Segment index of the file
+ *	\param flowlist List which will be filled with the cflows
+ *	\param append If true, do not clear the flowlist, instead append it to the existing data
+ *
+ *	\exception std::string Errortext
+ */
+void GFilter_cflow6::read_blocks(int fd, const std::string & in_filename, const CFlowBlockIndex & index, const CFlowSegmentIndex & segments,
+      CFlowList & flowlist, bool append) const {
+	vector<uint64_t> firstFlow(index.size());
+	uint64_t flowCount = 0;
+	for (CFlowBlockIndex::size_type i = 0; i < index.size(); i++) {
+		firstFlow[i] = flowCount;
+		flowCount += index[i].flowCount;
+	}
+
+	cout << "Reading file " << in_filename << " (" << index.size() << " blocks):\n";
+	if (!append)
+		flowlist.clear();
+	CFlowList::size_type base = flowlist.size();
+	if (flowCount == 0)
+		return;
+	flowlist.resize(base + flowCount);
+
+	CBlockDecompressTask task(fd, index, firstFlow, &flowlist[base]);
+	try {
+		util::runParallel(task, index.size());
+	} catch (string & e) {
+		flowlist.resize(base);
+		throw in_filename + ": " + e;
+	}
+	if (segments.size() < 2)
+		return;
+
+	bool sorted = true;
+	for (CFlowSegmentIndex::const_iterator it = segments.begin(); it != segments.end(); it++) {
+		if (!(it->flags & CFLOW_SEGMENT_SORTED))
+			sorted = false;
+	}
+	if (sorted) {
+		CFlowList merged;
+		vector<Subflowlist> runs;
+		for (CFlowSegmentIndex::const_iterator it = segments.begin(); it != segments.end(); it++) {
+			if (it->flowCount == 0)
+				continue;
+			CFlowList::iterator first = flowlist.begin() + base + firstFlow[it->firstBlock];
+			runs.push_back(Subflowlist(first, first + it->flowCount));
+		}
+		mergeSortedFlows(runs, merged);
+		copy(merged.begin(), merged.end(), flowlist.begin() + base);
+	} else {
+		sort(flowlist.begin() + base, flowlist.end());
+	}
+	cout << "Merged " << segments.size() << " segments of " << in_filename << ".\n";
+}
+
+/**
+ *	Writes a given flowlist as block container into a given filename. Appends to already existing files if requested.
+ *	Appending to a block container adds a new segment (see append_segment()), other files are read in and rewritten.
+ *
+ *	\param out_filename Filename of the compressed cflow_t file
+ *	\param subflowlist Flows to write
+ *	\param appendIfExisting If true, do not fail if the file is already existing, instead append out flowlist to it
+ *
+ *	\exception std::string Errortext
+ */
+void GFilter_cflow6::write_file(const std::string & out_filename, const Subflowlist subflowlist, bool appendIfExisting) const {
+	if (appendIfExisting && util::fileExists(out_filename) && append_segment(out_filename, subflowlist))
+		return;
+
+	CFlowList oldflowlist;
+	if (util::fileExists(out_filename) && appendIfExisting) {
+		if (!read_existing_file(out_filename, oldflowlist)) {
+			stringstream error;
+			error << "Can not append to " << out_filename << ". Can not read in this file.";
+			throw error.str();
+		}
+	}
+
+	if (util::fileExists(out_filename)) {
+		if (unlink(out_filename.c_str()) == -1) {
+			stringstream error;
+			error << "ERROR: could not delete old file \"" << out_filename << "\"";
+			throw error.str();
+		}
+	}
+
+	int fd = open(out_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd == -1) {
+		string errtext = "ERROR: could not open file destination \"" + out_filename + "\".";
+		throw errtext;
+	}
+
+	try {
+		if (oldflowlist.size() > 0) {
+			copy(subflowlist.begin(), subflowlist.end(), back_inserter(oldflowlist));
+			sort(oldflowlist.begin(), oldflowlist.end());
+			write_blocks(fd, out_filename, &oldflowlist[0], oldflowlist.size());
+		} else {
+			write_blocks(fd, out_filename, (subflowlist.size() > 0) ? &(*subflowlist.begin()) : NULL, subflowlist.size());
+		}
+	} catch (string & e) {
+		close(fd);
+		throw e;
+	}
+
+	if (close(fd) == -1) {
+		string errtext = "ERROR: could not write file \"" + out_filename + "\".";
+		throw errtext;
+	}
+}
+
+/**
+ *	\class	CBlockCompressTask
+ *	\brief	Compresses blocks of flows into complete gzip members
+ */
+class CBlockCompressTask: public util::CParallelTask {
+	public:
+		CBlockCompressTask(const cflow_t * flows, uint64_t count, uint64_t firstBlock, vector<string> & members) :
+			flows(flows), count(count), firstBlock(firstBlock), members(members) {
+		}
+
+		/**
+		 *	Compress a single block
+		 *
+		 *	\param item Number of the block relative to firstBlock
+		 *
+		 *	\exception std::string Errortext
+		 */
+		virtual void run(unsigned int item) {
+			uint64_t first = (firstBlock + item) * CFLOW_BLOCK_FLOWS;
+			uint32_t flowCount = (count - first < CFLOW_BLOCK_FLOWS) ? count - first : CFLOW_BLOCK_FLOWS;
+			uLong bytes = (uLong) flowCount * sizeof(cflow_t);
+			const Bytef * in = (const Bytef *) (flows + first);
+
+			z_stream stream;
+			memset(&stream, 0, sizeof(stream));
+			if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+				throw string("ERROR: could not initialize compression");
+			vector<Bytef> deflated(deflateBound(&stream, bytes));
+			stream.next_in = (Bytef *) in;
+			stream.avail_in = bytes;
+			stream.next_out = &deflated[0];
+			stream.avail_out = deflated.size();
+			int ret = deflate(&stream, Z_FINISH);
+			deflateEnd(&stream);
+			if (ret != Z_STREAM_END)
+				throw string("ERROR: compression of flow block failed");
+
+			// gzip member: header with 'CB' subfield {member size, flow count} and cflow6 comment, data, trailer
+			static const char comment[] = "CFLOW: cflow6";
+			uint32_t size = 10 + 2 + 12 + sizeof(comment) + stream.total_out + 8;
+			uint16_t xlen = 12, sublen = 8;
+			uint32_t crc = crc32(crc32(0L, Z_NULL, 0), in, bytes);
+			uint32_t isize = bytes;
+			string & member = members[item];
+			member.reserve(size);
+			member.assign("\x1f\x8b\x08\x14\0\0\0\0\0\x03", 10);
+			member.append((const char *) &xlen, 2);
+			member.append("CB", 2);
+			member.append((const char *) &sublen, 2);
+			member.append((const char *) &size, 4);
+			member.append((const char *) &flowCount, 4);
+			member.append(comment, sizeof(comment));
+			member.append((const char *) &deflated[0], stream.total_out);
+			member.append((const char *) &crc, 4);
+			member.append((const char *) &isize, 4);
+		}
+
+	private:
+		const cflow_t * flows; ///< All flows to write
+		uint64_t count; ///< Number of flows
+		uint64_t firstBlock; ///< Block number of item 0
+		vector<string> & members; ///< Destination, one gzip member per item
+};
+
+/**
+ *	Writes the whole data to a file descriptor
+ *
+ *	\param fd File descriptor
+ *	\param data Data to write
+ *	\param out_filename Filename (for messages)
+ *
+ *	\exception std::string Errortext
+ */
+static void write_all(int fd, const string & data, const std::string & out_filename) {
+	size_t done = 0;
+	while (done < data.size()) {
+		ssize_t ret = write(fd, data.data() + done, data.size() - done);
+		if (ret <= 0) {
+			string errtext = "ERROR: could not write file \"" + out_filename + "\".";
+			throw errtext;
+		}
+		done += ret;
+	}
+}
+
+/**
+ *	Copies the beginning of a file to another file descriptor
+ *
+ *	\param from Descriptor of the file to copy from
+ *	\param to Descriptor of the file to write to, positioned at its beginning
+ *	\param size Number of bytes to copy
+ *	\param out_filename Filename (for messages)
+ *
+ *	\exception std::string Errortext
+ */
+static void copy_head(int from, int to, uint64_t size, const std::string & out_filename) {
+	string buffer(1 << 20, '\0');
+	for (uint64_t done = 0; done < size;) {
+		size_t n = (size - done < buffer.size()) ? size - done : buffer.size();
+		ssize_t ret = pread(from, &buffer[0], n, done);
+		if (ret <= 0) {
+			string errtext = "ERROR: could not read file \"" + out_filename + "\".";
+			throw errtext;
+		}
+		buffer.resize(ret);
+		write_all(to, buffer, out_filename);
+		buffer.resize(1 << 20);
+		done += ret;
+	}
+}
+
+/**
+ *	Writes index entries as empty gzip members. The entries are stored in a 'C'+type subfield
+ *	of the FEXTRA field, which is limited to 64KiB, thus several members may be needed.
+ *
+ *	\param fd File descriptor
+ *	\param out_filename Filename (for messages)
+ *	\param type Second subfield identifier byte
+ *	\param entries First entry
+ *	\param entrySize Size of a single entry in bytes
+ *	\param count Number of entries
+ *
+ *	\exception std::string Errortext
+ */
+static void write_index_members(int fd, const std::string & out_filename, char type, const char * entries, size_t entrySize, size_t count) {
+	static const char emptyMember[] = "\x03\0\0\0\0\0\0\0\0\0"; // empty deflate block, CRC32 and ISIZE
+	const size_t maxEntries = (65535 - 4) / entrySize;
+	for (size_t first = 0; first < count; first += maxEntries) {
+		size_t n = (count - first < maxEntries) ? count - first : maxEntries;
+		uint16_t sublen = n * entrySize;
+		uint16_t xlen = sublen + 4;
+		string member("\x1f\x8b\x08\x04\0\0\0\0\0\x03", 10);
+		member.append((const char *) &xlen, 2);
+		member += 'C';
+		member += type;
+		member.append((const char *) &sublen, 2);
+		member.append(entries + first * entrySize, sublen);
+		member.append(emptyMember, 10);
+		write_all(fd, member, out_filename);
+	}
+}
+
+/**
+ *	Writes flows as block container consisting of a single segment
+ *
+ *	\param fd Descriptor of the file to write to
+ *	\param out_filename Filename (for messages)
+ *	\param flows First flow to write
+ *	\param count Number of flows to write
+ *
+ *	\exception std::string Errortext
+ */
+void GFilter_cflow6::write_blocks(int fd, const std::string & out_filename, const cflow_t * flows, uint64_t count) const {
+	uint64_t offset = 0;
+	CFlowBlockIndex index;
+	CFlowHostIndex hostIndex;
+	CFlowSegmentIndex segments;
+	segments.push_back(write_segment(fd, out_filename, flows, count, offset, index, hostIndex));
+	write_index(fd, out_filename, offset, index, hostIndex, segments);
+}
+
+/**
+ *	Writes flows as blocks of a new segment: the blocks are compressed in parallel, a batch of
+ *	blocks per round to keep the memory used for compressed data bounded. Host index entries
+ *	are added as long as the host index covers all previous blocks.
+ *
+ *	\param fd Descriptor of the file to write to, positioned at offset
+ *	\param out_filename Filename (for messages)
+ *	\param flows First flow to write
+ *	\param count Number of flows to write
+ *	\param offset File offset of the first block, advanced past the written blocks
+ *	\param index Block index to add the new blocks to
+ *	\param hostIndex Host index to add the new blocks to
+ *
+ *	\return Segment index entry of the new segment
+ *
+ *	\exception std::string Errortext
+ */
+cflow_segment GFilter_cflow6::write_segment(int fd, const std::string & out_filename, const cflow_t * flows, uint64_t count, uint64_t & offset,
+      CFlowBlockIndex & index, CFlowHostIndex & hostIndex) const {
+	uint64_t blockCount = (count + CFLOW_BLOCK_FLOWS - 1) / CFLOW_BLOCK_FLOWS;
+	uint64_t batchSize = 4 * util::getWorkerCount();
+
+	cflow_segment segment;
+	segment.firstBlock = index.size();
+	segment.blockCount = blockCount;
+	segment.flowCount = count;
+	segment.flags = CFLOW_SEGMENT_HOST_ORDER | CFLOW_SEGMENT_SORTED;
+	segment.reserved = 0;
+	for (uint64_t i = 1; i < count && segment.flags != 0; i++) {
+		if (flows[i] < flows[i - 1])
+			segment.flags &= ~CFLOW_SEGMENT_SORTED;
+		if (flows[i].localIP < flows[i - 1].localIP)
+			segment.flags = 0;
+	}
+	bool addHosts = (segment.flags & CFLOW_SEGMENT_HOST_ORDER) && hostIndex.size() == index.size();
+
+	for (uint64_t firstBlock = 0; firstBlock < blockCount; firstBlock += batchSize) {
+		uint64_t batch = (blockCount - firstBlock < batchSize) ? blockCount - firstBlock : batchSize;
+		vector<string> members(batch);
+		CBlockCompressTask task(flows, count, firstBlock, members);
+		util::runParallel(task, batch);
+
+		for (uint64_t i = 0; i < batch; i++) {
+			uint64_t firstFlow = (firstBlock + i) * CFLOW_BLOCK_FLOWS;
+			cflow_block entry;
+			entry.offset = offset;
+			entry.size = members[i].size();
+			entry.flowCount = (count - firstFlow < CFLOW_BLOCK_FLOWS) ? count - firstFlow : CFLOW_BLOCK_FLOWS;
+			index.push_back(entry);
+			if (addHosts) {
+				cflow_block_hosts hosts;
+				hosts.firstLocalIP = flows[firstFlow].localIP;
+				hosts.lastLocalIP = flows[firstFlow + entry.flowCount - 1].localIP;
+				hostIndex.push_back(hosts);
+			}
+			write_all(fd, members[i], out_filename);
+			offset += entry.size;
+		}
+	}
+	return segment;
+}
+
+/**
+ *	Writes the index members behind the blocks: block index ('CX'), host index ('CL', only if
+ *	complete and all segments are sorted by localIP), segment index ('CS') and the final member.
+ *
+ *	\param fd Descriptor of the file to write to, positioned at indexOffset
+ *	\param out_filename Filename (for messages)
+ *	\param indexOffset File offset of the first index member
+ *	\param index Block index
+ *	\param hostIndex Host index
+ *	\param segments Segment index
+ *
+ *	\exception std::string Errortext
+ */
+void GFilter_cflow6::write_index(int fd, const std::string & out_filename, uint64_t indexOffset, const CFlowBlockIndex & index,
+      const CFlowHostIndex & hostIndex, const CFlowSegmentIndex & segments) const {
+	uint64_t blockCount = index.size();
+	uint64_t count = 0;
+	for (CFlowBlockIndex::const_iterator it = index.begin(); it != index.end(); it++)
+		count += it->flowCount;
+	bool hostOrder = true;
+	for (CFlowSegmentIndex::const_iterator it = segments.begin(); it != segments.end(); it++) {
+		if (!(it->flags & CFLOW_SEGMENT_HOST_ORDER))
+			hostOrder = false;
+	}
+
+	if (!index.empty())
+		write_index_members(fd, out_filename, 'X', (const char *) &index[0], sizeof(cflow_block), index.size());
+	if (!index.empty() && hostOrder && hostIndex.size() == index.size())
+		write_index_members(fd, out_filename, 'L', (const char *) &hostIndex[0], sizeof(cflow_block_hosts), hostIndex.size());
+	if (!segments.empty())
+		write_index_members(fd, out_filename, 'S', (const char *) &segments[0], sizeof(cflow_segment), segments.size());
+
+	// Final member: 'CE' subfield {index offset, block count, flow count}
+	uint16_t xlen = 28, sublen = 24;
+	string member("\x1f\x8b\x08\x04\0\0\0\0\0\x03", 10);
+	member.append((const char *) &xlen, 2);
+	member.append("CE", 2);
+	member.append((const char *) &sublen, 2);
+	member.append((const char *) &indexOffset, 8);
+	member.append((const char *) &blockCount, 8);
+	member.append((const char *) &count, 8);
+	member.append("\x03\0\0\0\0\0\0\0\0\0", 10);
+	write_all(fd, member, out_filename);
+}
+
+/**
+ *	Appends flows to an existing block container as a new segment. The new blocks and index members
+ *	are written behind the old index members, which stay valid until the new final member is complete:
+ *	on errors the file is cut back to its old size. The old index members remain in the file as empty
+ *	gzip members until the segment gets compacted. The file is locked meanwhile.
+ *
+ *	\param out_filename Filename of the block container
+ *	\param subflowlist Flows to append
+ *
+ *	\return False if the file is not a block container (nothing was changed then)
+ *
+ *	\exception std::string Errortext
+ */
+bool GFilter_cflow6::append_segment(const std::string & out_filename, const Subflowlist & subflowlist) const {
+	int fd;
+	struct stat filestat;
+	for (;;) {
+		fd = open(out_filename.c_str(), O_RDWR);
+		if (fd == -1)
+			return false;
+		if (flock(fd, LOCK_EX) == -1 || fstat(fd, &filestat) == -1) {
+			close(fd);
+			throw "ERROR: could not lock file \"" + out_filename + "\".";
+		}
+		// A compaction may have replaced the file while waiting for the lock
+		struct stat current;
+		if (stat(out_filename.c_str(), &current) == 0 && current.st_dev == filestat.st_dev && current.st_ino == filestat.st_ino)
+			break;
+		close(fd);
+	}
+	CFlowBlockIndex index;
+	CFlowHostIndex hostIndex;
+	CFlowSegmentIndex segments;
+	uint64_t offset;
+	if (!read_block_index(fd, index, &hostIndex, &segments, &offset)) {
+		close(fd);
+		return false;
+	}
+
+	try {
+		if (subflowlist.size() > 0) {
+			CFlowList flows(subflowlist.begin(), subflowlist.end());
+			sort(flows.begin(), flows.end());
+			offset = filestat.st_size;
+			if (lseek(fd, offset, SEEK_SET) == -1)
+				throw "ERROR: could not write file \"" + out_filename + "\".";
+			try {
+				segments.push_back(write_segment(fd, out_filename, &flows[0], flows.size(), offset, index, hostIndex));
+				write_index(fd, out_filename, offset, index, hostIndex, segments);
+			} catch (string & e) {
+				// Bring the old final member back to the end of the file
+				if (ftruncate(fd, filestat.st_size) == -1)
+					cerr << "ERROR: could not restore file \"" << out_filename << "\".\n";
+				throw e;
+			}
+			cout << "Appended " << flows.size() << " flows to " << out_filename << " as segment " << segments.size() << ".\n";
+			try {
+				compact_segments(fd, out_filename, index, hostIndex, segments);
+			} catch (string & e) {
+				// The flows are appended anyway, a later append compacts the segments
+				cerr << e << "\n";
+			}
+		}
+	} catch (string & e) {
+		close(fd);
+		throw e;
+	}
+
+	if (close(fd) == -1)
+		throw "ERROR: could not write file \"" + out_filename + "\".";
+	return true;
+}
+
+/**
+ *	Merges the newest segments of a block container into one, if they hold at least as many flows as
+ *	the segment before them. Like a binary counter, this keeps the number of segments logarithmic in the
+ *	number of appends, while each flow gets rewritten only a logarithmic number of times.
+ *
+ *	The untouched blocks are copied to a temporary file followed by the merged segment, which then
+ *	replaces the file. Thus the file stays valid if writing fails or is interrupted.
+ *
+ *	\param fd Descriptor of the file, locked for writing
+ *	\param out_filename Filename (for messages)
+ *	\param index Block index, updated
+ *	\param hostIndex Host index, updated
+ *	\param segments Segment index, updated
+ *
+ *	\exception std::string Errortext
+ */
+void GFilter_cflow6::compact_segments(int fd, const std::string & out_filename, CFlowBlockIndex & index, CFlowHostIndex & hostIndex,
+      CFlowSegmentIndex & segments) const {
+	if (segments.size() < 2)
+		return;
+	CFlowSegmentIndex::size_type first = segments.size() - 1;
+	uint64_t merged = segments[first].flowCount;
+	while (first > 0 && segments[first - 1].flowCount <= merged) {
+		first--;
+		merged += segments[first].flowCount;
+	}
+	if (first == segments.size() - 1)
+		return;
+
+	// Read the segments to merge, relative to their first block
+	uint32_t firstBlock = segments[first].firstBlock;
+	CFlowBlockIndex blocks(index.begin() + firstBlock, index.end());
+	CFlowSegmentIndex merging(segments.begin() + first, segments.end());
+	for (CFlowSegmentIndex::iterator it = merging.begin(); it != merging.end(); it++)
+		it->firstBlock -= firstBlock;
+	CFlowList flows;
+	read_blocks(fd, out_filename, blocks, merging, flows, false);
+
+	// Replace them by a single one (the newest segment is never empty, thus firstBlock is a valid block)
+	struct stat filestat;
+	if (fstat(fd, &filestat) == -1)
+		throw "ERROR: could not write file \"" + out_filename + "\".";
+	string tmp_filename = out_filename + ".tmp";
+	int tmpfd = open(tmp_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, filestat.st_mode & 0777);
+	if (tmpfd == -1)
+		throw "ERROR: could not open file destination \"" + tmp_filename + "\".";
+	CFlowBlockIndex newIndex(index.begin(), index.begin() + firstBlock);
+	CFlowHostIndex newHostIndex(hostIndex.begin(), hostIndex.begin() + min((CFlowHostIndex::size_type) firstBlock, hostIndex.size()));
+	CFlowSegmentIndex newSegments(segments.begin(), segments.begin() + first);
+	uint64_t offset = index[firstBlock].offset;
+	try {
+		copy_head(fd, tmpfd, offset, out_filename);
+		newSegments.push_back(write_segment(tmpfd, out_filename, flows.empty() ? NULL : &flows[0], flows.size(), offset, newIndex, newHostIndex));
+		write_index(tmpfd, out_filename, offset, newIndex, newHostIndex, newSegments);
+		if (fsync(tmpfd) == -1)
+			throw "ERROR: could not write file \"" + out_filename + "\".";
+	} catch (string & e) {
+		close(tmpfd);
+		unlink(tmp_filename.c_str());
+		throw e;
+	}
+	if (close(tmpfd) == -1 || rename(tmp_filename.c_str(), out_filename.c_str()) == -1) {
+		unlink(tmp_filename.c_str());
+		throw "ERROR: could not write file \"" + out_filename + "\".";
+	}
+	index.swap(newIndex);
+	hostIndex.swap(newHostIndex);
+	segments.swap(newSegments);
+	cout << "Compacted " << merging.size() << " segments of " << out_filename << " into one of " << flows.size() << " flows.\n";
+}
+
+/**
+ *	\class	GFilter_cflow6raw
+ *	\brief	Class to import and export uncompressed cflow6raw files
+ *
+ *	\param	formatName	Name of this format
+ *	\param	humanReadablePattern	A simple name pattern for files of this type, used by e.g. the GUI
+ *	\param	regexPattern	Regex pattern used internally
+ */
+GFilter_cflow6raw::GFilter_cflow6raw(std::string formatName, std::string humanReadablePattern, std::string regexPattern) :
+	GFilter(formatName, humanReadablePattern, regexPattern) {
+	// nothing to do here
+}
+
+/**
+ *	Reads and checks the header of a cflow6raw file
+ *
+ *	\param fd Descriptor of the opened file
+ *	\param header Header struct to fill
+ *
+ *	\return True if the header is valid and matches the cflow_t layout of this build
+ */
+bool GFilter_cflow6raw::read_header(int fd, cflow6raw_header & header) const {
+	if (pread(fd, &header, sizeof(header), 0) != (ssize_t) sizeof(header))
+		return false;
+	if (memcmp(header.signature, CFLOW6RAW_SIGNATURE, sizeof(header.signature)) != 0)
+		return false;
+	return header.recordSize == sizeof(cflow_t);
+}
+
+/**
+ *	Decides if this file is a cflow6raw file (file name and header)
+ *
+ *	\param in_filename File which should be tested
+ *
+ *	\return True if this file contains cflow6raw flows, false if not
+ */
+bool GFilter_cflow6raw::acceptFileForReading(std::string in_filename) const {
+	if (!GFilter::acceptFilename(in_filename))
+		return false;
+
+	int fd = open(in_filename.c_str(), O_RDONLY);
+	if (fd == -1)
+		return false;
+	cflow6raw_header header;
+	bool valid = read_header(fd, header);
+	close(fd);
+	return valid;
+}
+
+/**
+ *	Reads a given file into a given flowlist.
+ *
+ *	\param filename Filename of the cflow6raw file
+ *	\param flowlist List which will be filled with the cflows
+ *	\param local_net Contains the IP
+ *	\param netmask Contains the netmask
+ *	\param append If true, do not clear the flowlist, instead append it to the existing data
+ */
+void GFilter_cflow6raw::read_file(std::string filename, CFlowList & flowlist, const IPv6_addr & local_net, const IPv6_addr & netmask, bool append) const {
+	read_file(filename, flowlist, append);
+}
+
+/**
+ *	Reads a given file into a given flowlist.
+ *
+ *	The file is mapped into memory and all records are copied into the flowlist in one bulk
+ *	copy. The flowlist is a private copy: the mapping is released before returning.
+ *
+ *	\param in_filename Filename of the cflow6raw file
+ *	\param flowlist List which will be filled with the cflows
+ *	\param append If true, do not clear the flowlist, instead append it to the existing data
+ *
+ *	\exception std::string Errortext
+ */
+void GFilter_cflow6raw::read_file(std::string in_filename, CFlowList & flowlist, bool append) const {
+	int fd = open(in_filename.c_str(), O_RDONLY);
+	if (fd == -1) {
+		string errtext = "ERROR: could not open file source \"" + in_filename + "\".";
+		throw errtext;
+	}
+
+	cflow6raw_header header;
+	struct stat filestat;
+	if (!read_header(fd, header) || fstat(fd, &filestat) == -1) {
+		close(fd);
+		string errtext = in_filename + " does not look like a cflow6raw file (bad header)";
+		throw errtext;
+	}
+
+	uint64_t mapsize = sizeof(header) + header.flowCount * sizeof(cflow_t);
+	if ((uint64_t) filestat.st_size != mapsize) {
+		close(fd);
+		stringstream error;
+		error << in_filename << " does not look like a cflow6raw file (wrong size): header announces " << header.flowCount << " flows, file size is "
+		      << filestat.st_size << " bytes";
+		throw error.str();
+	}
+
+	if (!append)
+		flowlist.clear();
+
+	if (header.flowCount == 0) {
+		close(fd);
+		return;
+	}
+
+	void * mapping = mmap(NULL, mapsize, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd); // the mapping stays valid
+	if (mapping == MAP_FAILED) {
+		string errtext = "ERROR: could not map file \"" + in_filename + "\" into memory.";
+		throw errtext;
+	}
+	madvise(mapping, mapsize, MADV_SEQUENTIAL);
+
+	cout << "Reading file " << in_filename << " (" << header.flowCount << " flows, uncompressed):\n";
+
+	const cflow_t * first = (const cflow_t *) ((const char *) mapping + sizeof(header));
+	CFlowList::size_type oldsize = flowlist.size();
+	flowlist.insert(flowlist.end(), first, first + header.flowCount);
+	munmap(mapping, mapsize);
+
+	for (CFlowList::iterator it = flowlist.begin() + oldsize; it != flowlist.end(); it++) {
+		if (it->magic != CFLOW_CURRENT_MAGIC_NUMBER) {
+			flowlist.resize(oldsize);
+			string errtext = "ERROR: file check failed (wrong magic number) in GFilter_cflow6raw::read_file.";
+			throw errtext;
+		}
+		// Clear early/late attributes
+		it->flowtype &= (flow_type_t) simpleflow;
+	}
+}
+
+/**
+ *	Writes a given flowlist into a given filename. Appends to already existing files if requested.
+ *
+ *	The data is written to a temporary file first which then replaces the old file. Processes
+ *	still reading the old file are not disturbed by this.
+ *
+ *	\param out_filename Filename of the cflow6raw file
+ *	\param subflowlist Flows to write
+ *	\param appendIfExisting If true, do not fail if the file is already existing, instead append out flowlist to it
+ *
+ *	\exception std::string Errortext
+ */
+void GFilter_cflow6raw::write_file(const std::string & out_filename, const Subflowlist subflowlist, bool appendIfExisting) const {
+	CFlowList oldflowlist;
+	if (util::fileExists(out_filename) && appendIfExisting) {
+		if (!acceptFileForReading(out_filename)) {
+			stringstream error;
+			error << "Can not append to " << out_filename << ". Can not read in this file.";
+			throw error.str();
+		}
+		read_file(out_filename, oldflowlist, false);
+	}
+
+	const cflow_t * first = NULL;
+	uint64_t count = subflowlist.size();
+	if (oldflowlist.size() > 0) {
+		copy(subflowlist.begin(), subflowlist.end(), back_inserter(oldflowlist));
+		sort(oldflowlist.begin(), oldflowlist.end());
+		first = &oldflowlist[0];
+		count = oldflowlist.size();
+	} else if (count > 0) {
+		first = &(*subflowlist.begin());
+	}
+
+	cflow6raw_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.signature, CFLOW6RAW_SIGNATURE, sizeof(header.signature));
+	header.recordSize = sizeof(cflow_t);
+	header.flowCount = count;
+
+	string tmp_filename = out_filename + ".tmp";
+	ofstream out_filestream(tmp_filename.c_str(), ios::out | ios::binary | ios::trunc);
+	if (!out_filestream.is_open()) {
+		string errtext = "ERROR: could not open file destination \"" + tmp_filename + "\".";
+		throw errtext;
+	}
+	out_filestream.write((const char *) &header, sizeof(header));
+	if (count > 0)
+		out_filestream.write((const char *) first, count * sizeof(cflow_t));
+	out_filestream.close();
+
+	if (out_filestream.fail() || rename(tmp_filename.c_str(), out_filename.c_str()) == -1) {
+		unlink(tmp_filename.c_str());
+		stringstream error;
+		error << "ERROR: could not write file \"" << out_filename << "\"";
+		throw error.str();
+	}
+}
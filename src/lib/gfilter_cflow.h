@@ -11,6 +11,7 @@
 
 #include <iosfwd>
 #include <string>
+#include <vector>
 #include <stdint.h>
 #include <boost/iostreams/filtering_streambuf.hpp>
 #include <boost/iostreams/filtering_stream.hpp>
@@ -21,12 +22,73 @@
 #include "IPv6_addr.h"
 #include "cflow.h"
 
+#define CFLOW_BLOCK_FLOWS 16384 ///< Flows per independently compressed block of a block container
+#define CFLOW_BLOCK_END_SIZE 50 ///< Size in bytes of the final gzip member of a block container
+
+/**
+ *	\struct	cflow_block
+ *	\brief	Entry of the block index of a block container
+ *
+ *	A block container is a multi-member gzip file. Each member holds up to CFLOW_BLOCK_FLOWS flows and
+ *	can be decompressed on its own. The members are followed by empty members carrying the block index
+ *	in their FEXTRA field. Standard gzip tools still see a valid file containing the plain flow records.
+ */
+#pragma pack(1)
+struct cflow_block {
+	uint64_t offset; ///< File offset of the gzip member
+	uint32_t size; ///< Size of the whole gzip member in bytes
+	uint32_t flowCount; ///< Number of flows in this block
+};
+#pragma pack()
+
+typedef std::vector<cflow_block> CFlowBlockIndex;
+
+/**
+ *	\struct	cflow_block_hosts
+ *	\brief	Entry of the optional host index of a block container
+ *
+ *	Written for files sorted by localIP only. Holds the localIP range of the corresponding block, which
+ *	allows to find the blocks of a host by binary search and to load just these.
+ */
+#pragma pack(1)
+struct cflow_block_hosts {
+	IPv6_addr firstLocalIP; ///< localIP of the first flow in the block
+	IPv6_addr lastLocalIP; ///< localIP of the last flow in the block
+};
+#pragma pack()
+
+typedef std::vector<cflow_block_hosts> CFlowHostIndex;
+
+#define CFLOW_SEGMENT_HOST_ORDER 0x01 ///< Segment flag: the flows are sorted by localIP
+#define CFLOW_SEGMENT_SORTED 0x02 ///< Segment flag: the flows are sorted by cflow_t::operator<
+
+/**
+ *	\struct	cflow_segment
+ *	\brief	Entry of the segment index (manifest) of a block container
+ *
+ *	Appending to a block container adds a new segment: a sorted run of blocks behind the existing
+ *	ones. Only the index members get rewritten, the existing blocks stay untouched. Readers merge the
+ *	segments, and small segments get merged (compacted) into larger ones when appending.
+ *	Files without segment index consist of a single segment.
+ */
+#pragma pack(1)
+struct cflow_segment {
+	uint32_t firstBlock; ///< First block of the segment
+	uint32_t blockCount; ///< Number of blocks of the segment
+	uint64_t flowCount; ///< Number of flows in the segment
+	uint32_t flags; ///< CFLOW_SEGMENT_* flags
+	uint32_t reserved; ///< Set to zero
+};
+#pragma pack()
+
+typedef std::vector<cflow_segment> CFlowSegmentIndex;
+
 class GFilter_cflow: public GFilter {
 public:
 	GFilter_cflow(std::string formatName = "cflow", std::string humanReadablePattern = "*.gz", std::string regexPattern = ".*\\.gz$");
 
 	// import methods
-	void read_file(std::string filename, CFlowList & flowlist, bool append = false) const;
+	virtual void read_file(std::string filename, CFlowList & flowlist, bool append = false) const;
 	virtual void read_file(std::string filename, CFlowList & flowlist, const IPv6_addr & local_net, const IPv6_addr & netmask, bool append) const;
 
 	// export methods
@@ -40,7 +102,8 @@ protected:
 
 	// general methods
 	cflow_version detect_cflow_version(std::string in_filename) const;
-	virtual bool checkCflowFileSize(uint32_t size) const=0;
+	virtual size_t getRecordSize() const=0;
+	bool read_existing_file(const std::string & filename, CFlowList & flowlist) const;
 
 	// export methods
 	virtual void openGzipStream(boost::iostreams::filtering_ostream & out_filestream, boost::iostreams::file_sink & out_filesink,
@@ -49,8 +112,10 @@ protected:
 	// import methods
 	void openGunzipStream(boost::iostreams::filtering_istream & in_filestream, boost::iostreams::file_source & infs, const std::string & in_filename) const;
 	uint32_t getUncompressedFileSize(std::ifstream & in_filestream) const;
-	virtual unsigned int getNumberOfFlows(uint32_t size) const=0;
-	virtual void read_flow(boost::iostreams::filtering_istream & infs, cflow_t & cf) const=0;
+	void read_flow(boost::iostreams::filtering_istream & infs, cflow_t & cf) const;
+	virtual void decode_flow(const char * record, cflow_t & cf) const=0;
+	bool read_block_index(int fd, CFlowBlockIndex & index, CFlowHostIndex * hostIndex = NULL, CFlowSegmentIndex * segments = NULL,
+	      uint64_t * indexOffset = NULL) const;
 };
 
 class GFilter_cflow4: public GFilter_cflow {
@@ -61,9 +126,9 @@ public:
 	virtual bool acceptFileForReading(std::string in_filename) const;
 
 protected:
-	virtual bool checkCflowFileSize(uint32_t size) const;
-	virtual unsigned int getNumberOfFlows(uint32_t size) const;
-	virtual void read_flow(boost::iostreams::filtering_istream & infs, cflow_t & cf) const;
+	virtual size_t getRecordSize() const;
+	virtual void decode_flow(const char * record, cflow_t & cf) const;
+	using GFilter_cflow::read_flow;
 	virtual void read_flow(boost::iostreams::filtering_istream & infs, cflow_t & cf, uint8_t & oldmagic) const;
 };
 
@@ -72,21 +137,82 @@ public:
 	GFilter_cflow6(std::string formatName = "cflow6", std::string humanReadablePattern = "*.gz", std::string regexPattern = ".*\\.gz$");
 
 	// import methods
+	using GFilter_cflow::read_file;
+	virtual void read_file(std::string filename, CFlowList & flowlist, bool append = false) const;
+	virtual bool read_file_hosts(std::string in_filename, CFlowList & flowlist, const IPv6_addr & localIP, int host_count) const;
 	virtual bool acceptFileForReading(std::string in_filename) const;
 
 	// export methods
 	virtual bool acceptFileForWriting(std::string in_filename) const {
 		return acceptFilename(in_filename);
 	}
+	virtual void write_file(const std::string & out_filename, const Subflowlist flowlist, bool appendIfExisting = true) const;
 	virtual void openGzipStream(boost::iostreams::filtering_ostream & out_filestream, boost::iostreams::file_sink & out_filesink,
 	      const std::string & in_filename) const;
 	virtual void write_flow(boost::iostreams::filtering_ostream & out_filestream, const cflow_t & cf) const;
 
 protected:
-	virtual bool checkCflowFileSize(uint32_t size) const;
-	virtual unsigned int getNumberOfFlows(uint32_t size) const;
-	virtual void read_flow(boost::iostreams::filtering_istream & infs, cflow_t & cf) const;
+	virtual size_t getRecordSize() const;
+	virtual void decode_flow(const char * record, cflow_t & cf) const;
+	using GFilter_cflow::read_flow;
 	virtual void read_flow(boost::iostreams::filtering_istream & infs, cflow_t & cf, uint8_t & oldmagic) const;
+	void read_blocks(int fd, const std::string & in_filename, const CFlowBlockIndex & index, const CFlowSegmentIndex & segments, CFlowList & flowlist,
+	      bool append) const;
+	void read_segment_hosts(int fd, const CFlowBlockIndex & index, const CFlowHostIndex & hostIndex, const cflow_segment & segment,
+	      const IPv6_addr & localIP, int host_count, CFlowList & flowlist) const;
+	void write_blocks(int fd, const std::string & out_filename, const cflow_t * flows, uint64_t count) const;
+	cflow_segment write_segment(int fd, const std::string & out_filename, const cflow_t * flows, uint64_t count, uint64_t & offset,
+	      CFlowBlockIndex & index, CFlowHostIndex & hostIndex) const;
+	void write_index(int fd, const std::string & out_filename, uint64_t indexOffset, const CFlowBlockIndex & index, const CFlowHostIndex & hostIndex,
+	      const CFlowSegmentIndex & segments) const;
+	bool append_segment(const std::string & out_filename, const Subflowlist & subflowlist) const;
+	void compact_segments(int fd, const std::string & out_filename, CFlowBlockIndex & index, CFlowHostIndex & hostIndex, CFlowSegmentIndex & segments) const;
+};
+
+/**
+ *	\struct	cflow6raw_header
+ *	\brief	File header of an uncompressed cflow6raw file
+ *
+ *	The header is followed by flowCount packed cflow6 records. The header size is a multiple
+ *	of 8 bytes, thus the records keep their natural alignment within the file.
+ */
+#pragma pack(1)
+struct cflow6raw_header {
+	char signature[8]; ///< Always CFLOW6RAW_SIGNATURE
+	uint32_t recordSize; ///< sizeof(cflow6) of the writer
+	uint32_t reserved; ///< Set to zero
+	uint64_t flowCount; ///< Number of records following this header
+};
+#pragma pack()
+
+#define CFLOW6RAW_SIGNATURE "CFLOW6R"
+
+/**
+ *	\class	GFilter_cflow6raw
+ *	\brief	Filter to import and export uncompressed cflow6 files
+ *
+ *	Meant as a cache next to the gzipped cflow6 files: loading such a file is a fast bulk read,
+ *	it needs neither decompression nor per-flow reads. The records are still copied into the
+ *	flowlist, thus the flowlist does not share the page cache with other readers.
+ */
+class GFilter_cflow6raw: public GFilter {
+public:
+	GFilter_cflow6raw(std::string formatName = "cflow6raw", std::string humanReadablePattern = "*.cflow6raw", std::string regexPattern =
+	      ".*\\.cflow6raw$");
+
+	// import methods
+	void read_file(std::string filename, CFlowList & flowlist, bool append = false) const;
+	virtual void read_file(std::string filename, CFlowList & flowlist, const IPv6_addr & local_net, const IPv6_addr & netmask, bool append) const;
+	virtual bool acceptFileForReading(std::string in_filename) const;
+
+	// export methods
+	virtual bool acceptFileForWriting(std::string in_filename) const {
+		return acceptFilename(in_filename);
+	}
+	virtual void write_file(const std::string & out_filename, const Subflowlist flowlist, bool appendIfExisting = true) const;
+
+protected:
+	bool read_header(int fd, cflow6raw_header & header) const;
 };
 
 #endif /* GFILTER_CFLOW_H_ */
@@ -0,0 +1,592 @@
+/**
+ *	\file gfilter_cflowcol.cpp
+ *	\brief Filter to import and export columnar cflow files
+ *
+ * 	This file is subject to the terms and conditions defined in
+ * 	files 'BSD.txt' and 'GPL.txt'. For a list of authors see file 'AUTHORS'.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include "gfilter_cflowcol.h"
+#include "gutil.h"
+#include "gparallel.h"
+
+using namespace std;
+
+/**
+ *	\struct	column_layout
+ *	\brief	Position of a column within a cflow_t
+ */
+struct column_layout {
+	size_t offset; ///< Offset of the member in cflow_t
+	size_t width; ///< Size of the member in bytes
+};
+
+static const cflow_t layout_flow;
+
+#define COLUMN_LAYOUT(member) { (size_t) ((const char *) &layout_flow.member - (const char *) &layout_flow), sizeof(layout_flow.member) }
+
+/// Layout of all columns, indexed by cflowcol_column_t
+static const column_layout columns[CFLOWCOL_COLUMNS] = {
+	COLUMN_LAYOUT(magic),
+	COLUMN_LAYOUT(prot),
+	COLUMN_LAYOUT(flowtype),
+	COLUMN_LAYOUT(tos_flags),
+	COLUMN_LAYOUT(durationMs),
+	COLUMN_LAYOUT(startMs),
+	COLUMN_LAYOUT(localIP),
+	COLUMN_LAYOUT(remoteIP),
+	COLUMN_LAYOUT(dOctets),
+	COLUMN_LAYOUT(dPkts),
+	COLUMN_LAYOUT(localPort),
+	COLUMN_LAYOUT(remotePort),
+	COLUMN_LAYOUT(localAS),
+	COLUMN_LAYOUT(remoteAS)
+};
+
+/**
+ *	Constructor: accepts all flows
+ */
+CFlowPredicate::CFlowPredicate() :
+	flowtype_filter(0), restrictIP(false) {
+	for (unsigned int p = 0; p <= OTHER; p++)
+		filter_prot[p] = false;
+}
+
+/**
+ *	Constructor: filters the flows which are filtered by a CFlowFilter using the same preferences.
+ *	The biflow filter and the filters for unproductive flows are ignored: the unibiflow qualification
+ *	done by CImport::prepare_flowlist() needs the biflows.
+ *
+ *	\param prefs Preferences
+ */
+CFlowPredicate::CFlowPredicate(const prefs_t & prefs) :
+	flowtype_filter(0), restrictIP(false) {
+	filter_prot[UDP] = prefs.filter_UDP;
+	filter_prot[TCP] = prefs.filter_TCP;
+	filter_prot[ICMP] = prefs.filter_ICMP;
+	filter_prot[OTHER] = prefs.filter_OTHER;
+	if (prefs.filter_uniflows)
+		flowtype_filter |= uniflow;
+}
+
+/**
+ *	Accept only flows whose localIP is within a given network
+ *
+ *	\param local_net Network address
+ *	\param netmask Netmask of the network
+ */
+void CFlowPredicate::setLocalNet(const IPv6_addr & local_net, const IPv6_addr & netmask) {
+	IPv6_addr net(local_net);
+	this->local_net = net & netmask;
+	this->netmask = netmask;
+	restrictIP = true;
+}
+
+/**
+ *	\return True if some flows get rejected by acceptType()
+ */
+bool CFlowPredicate::restrictsType() const {
+	if (flowtype_filter != 0)
+		return true;
+	for (unsigned int p = 0; p <= OTHER; p++) {
+		if (filter_prot[p])
+			return true;
+	}
+	return false;
+}
+
+/**
+ *	\return True if some flows get rejected by acceptLocalIP()
+ */
+bool CFlowPredicate::restrictsLocalIP() const {
+	return restrictIP;
+}
+
+/**
+ *	Checks the protocol and flowtype of a flow
+ *
+ *	\param prot Protocol number
+ *	\param flowtype Flow type
+ *
+ *	\return True if the flow is accepted
+ */
+bool CFlowPredicate::acceptType(uint8_t prot, uint8_t flowtype) const {
+	if (filter_prot[map_protonum(prot)])
+		return false;
+	return (flowtype & flowtype_filter) == 0;
+}
+
+/**
+ *	Checks the localIP of a flow
+ *
+ *	\param localIP localIP of the flow
+ *
+ *	\return True if the flow is accepted
+ */
+bool CFlowPredicate::acceptLocalIP(const IPv6_addr & localIP) const {
+	if (!restrictIP)
+		return true;
+	IPv6_addr ip(localIP);
+	return (ip & netmask) == local_net;
+}
+
+/**
+ *	Checks the statistics of a row group
+ *
+ *	\param group Row group
+ *
+ *	\return False if none of the flows of the group can be accepted
+ */
+bool CFlowPredicate::acceptGroup(const cflowcol_group & group) const {
+	if (restrictIP) {
+		// Masking with a prefix netmask keeps the order of addresses
+		IPv6_addr first(group.minLocalIP);
+		IPv6_addr last(group.maxLocalIP);
+		if (local_net < (first & netmask) || (last & netmask) < local_net)
+			return false;
+	}
+	if (restrictsType()) {
+		bool protAccepted = false;
+		for (unsigned int p = 0; p <= OTHER; p++) {
+			if ((group.protocols & (1 << p)) && !filter_prot[p])
+				protAccepted = true;
+		}
+		bool typeAccepted = false;
+		for (unsigned int t = 0; t <= simpleflow; t++) {
+			if ((group.flowtypes & (1 << t)) && (t & flowtype_filter) == 0)
+				typeAccepted = true;
+		}
+		if (!protAccepted || !typeAccepted)
+			return false;
+	}
+	return true;
+}
+
+/**
+ *	Reads and decompresses one column of a row group
+ *
+ *	\param fd File to read from (pread is used, thus it can be shared between threads)
+ *	\param group Row group
+ *	\param number Number of the row group (for messages)
+ *	\param column Column to read
+ *	\param raw Destination
+ *	\param bytesRead Gets increased by the number of bytes read from the file
+ *
+ *	\exception std::string Errortext
+ */
+static void read_column(int fd, const cflowcol_group & group, unsigned int number, unsigned int column, vector<char> & raw, uint64_t & bytesRead) {
+	const cflowcol_chunk & chunk = group.chunks[column];
+	uLongf expected = (uLongf) group.flowCount * columns[column].width;
+	uLongf rawSize = expected;
+	vector<Bytef> compressed(chunk.size);
+	raw.resize(expected);
+	if (chunk.size == 0 || pread(fd, &compressed[0], chunk.size, chunk.offset) != (ssize_t) chunk.size || uncompress((Bytef *) &raw[0],
+	      &rawSize, &compressed[0], chunk.size) != Z_OK || rawSize != expected) {
+		stringstream error;
+		error << "ERROR: column " << column << " of row group " << number << " is corrupt";
+		throw error.str();
+	}
+	bytesRead += chunk.size;
+}
+
+/**
+ *	\class	CGroupReadTask
+ *	\brief	Reads the accepted flows of row groups
+ */
+class CGroupReadTask: public util::CParallelTask {
+	public:
+		CGroupReadTask(int fd, const vector<cflowcol_group> & groups, const CFlowPredicate & predicate, vector<CFlowList> & results,
+		      vector<uint64_t> & bytesRead) :
+			fd(fd), groups(groups), predicate(predicate), results(results), bytesRead(bytesRead) {
+		}
+
+		/**
+		 *	Evaluate the predicate on the narrow columns of a row group, then assemble the accepted flows
+		 *
+		 *	\param number Number of the row group
+		 *
+		 *	\exception std::string Errortext
+		 */
+		virtual void run(unsigned int number) {
+			const cflowcol_group & group = groups[number];
+			if (!predicate.acceptGroup(group))
+				return;
+
+			vector<vector<char> > raw(CFLOWCOL_COLUMNS);
+			vector<uint32_t> rows(group.flowCount);
+			for (uint32_t i = 0; i < group.flowCount; i++)
+				rows[i] = i;
+
+			if (predicate.restrictsType()) {
+				read_column(fd, group, number, COL_PROT, raw[COL_PROT], bytesRead[number]);
+				read_column(fd, group, number, COL_FLOWTYPE, raw[COL_FLOWTYPE], bytesRead[number]);
+				size_t accepted = 0;
+				for (size_t i = 0; i < rows.size(); i++) {
+					if (predicate.acceptType(raw[COL_PROT][rows[i]], raw[COL_FLOWTYPE][rows[i]] & simpleflow))
+						rows[accepted++] = rows[i];
+				}
+				rows.resize(accepted);
+			}
+			if (!rows.empty() && predicate.restrictsLocalIP()) {
+				read_column(fd, group, number, COL_LOCALIP, raw[COL_LOCALIP], bytesRead[number]);
+				size_t accepted = 0;
+				IPv6_addr localIP;
+				for (size_t i = 0; i < rows.size(); i++) {
+					const char * ip = &raw[COL_LOCALIP][rows[i] * sizeof(IPv6_addr)];
+					copy(ip, ip + sizeof(IPv6_addr), localIP.begin());
+					if (predicate.acceptLocalIP(localIP))
+						rows[accepted++] = rows[i];
+				}
+				rows.resize(accepted);
+			}
+			if (rows.empty())
+				return;
+
+			// Materialize the accepted rows
+			CFlowList & flows = results[number];
+			flows.resize(rows.size());
+			for (unsigned int column = 0; column < CFLOWCOL_COLUMNS; column++) {
+				if (raw[column].empty())
+					read_column(fd, group, number, column, raw[column], bytesRead[number]);
+				size_t offset = columns[column].offset;
+				size_t width = columns[column].width;
+				for (size_t i = 0; i < rows.size(); i++)
+					memcpy((char *) &flows[i] + offset, &raw[column][rows[i] * width], width);
+			}
+			for (CFlowList::iterator it = flows.begin(); it != flows.end(); it++) {
+				if (it->magic != CFLOW_CURRENT_MAGIC_NUMBER)
+					throw string("ERROR: file check failed (wrong magic number) in GFilter_cflow6col::read_file.");
+				// Clear early/late attributes
+				it->flowtype &= (flow_type_t) simpleflow;
+			}
+		}
+
+	private:
+		int fd; ///< File to read from (pread is used, thus it can be shared)
+		const vector<cflowcol_group> & groups; ///< Row group directory
+		const CFlowPredicate & predicate; ///< Flows to accept
+		vector<CFlowList> & results; ///< Accepted flows, one list per row group
+		vector<uint64_t> & bytesRead; ///< Bytes read, per row group
+};
+
+/**
+ *	\class	CGroupWriteTask
+ *	\brief	Splits row groups into columns and compresses them
+ */
+class CGroupWriteTask: public util::CParallelTask {
+	public:
+		CGroupWriteTask(const cflow_t * flows, uint64_t count, uint64_t firstGroup, vector<cflowcol_group> & groups, vector<string> & chunks) :
+			flows(flows), count(count), firstGroup(firstGroup), groups(groups), chunks(chunks) {
+		}
+
+		/**
+		 *	Compress the columns of a single row group and collect its statistics
+		 *
+		 *	\param item Number of the row group relative to firstGroup
+		 *
+		 *	\exception std::string Errortext
+		 */
+		virtual void run(unsigned int item) {
+			uint64_t first = (firstGroup + item) * CFLOWCOL_GROUP_FLOWS;
+			uint32_t flowCount = (count - first < CFLOWCOL_GROUP_FLOWS) ? count - first : CFLOWCOL_GROUP_FLOWS;
+			const cflow_t * groupFlows = flows + first;
+
+			cflowcol_group & group = groups[item];
+			group.flowCount = flowCount;
+			group.protocols = 0;
+			group.reserved = 0;
+			group.flowtypes = 0;
+			group.minLocalIP = groupFlows[0].localIP;
+			group.maxLocalIP = groupFlows[0].localIP;
+			for (uint32_t i = 0; i < flowCount; i++) {
+				group.protocols |= 1 << map_protonum(groupFlows[i].prot);
+				group.flowtypes |= 1 << (groupFlows[i].flowtype & simpleflow);
+				if (groupFlows[i].localIP < group.minLocalIP)
+					group.minLocalIP = groupFlows[i].localIP;
+				if (group.maxLocalIP < groupFlows[i].localIP)
+					group.maxLocalIP = groupFlows[i].localIP;
+			}
+
+			vector<char> raw;
+			for (unsigned int column = 0; column < CFLOWCOL_COLUMNS; column++) {
+				size_t offset = columns[column].offset;
+				size_t width = columns[column].width;
+				raw.resize(flowCount * width);
+				for (uint32_t i = 0; i < flowCount; i++)
+					memcpy(&raw[i * width], (const char *) &groupFlows[i] + offset, width);
+
+				uLongf size = compressBound(raw.size());
+				string & chunk = chunks[item * CFLOWCOL_COLUMNS + column];
+				chunk.resize(size);
+				if (compress2((Bytef *) &chunk[0], &size, (const Bytef *) &raw[0], raw.size(), Z_DEFAULT_COMPRESSION) != Z_OK)
+					throw string("ERROR: compression of flow column failed");
+				chunk.resize(size);
+				group.chunks[column].offset = 0;
+				group.chunks[column].size = size;
+			}
+		}
+
+	private:
+		const cflow_t * flows; ///< All flows to write
+		uint64_t count; ///< Number of flows
+		uint64_t firstGroup; ///< Row group number of item 0
+		vector<cflowcol_group> & groups; ///< Directory entries, one per item
+		vector<string> & chunks; ///< Compressed columns, CFLOWCOL_COLUMNS per item
+};
+
+/**
+ *	\class	GFilter_cflow6col
+ *	\brief	Class to import and export columnar cflow files
+ *
+ *	\param	formatName	Name of this format
+ *	\param	humanReadablePattern	A simple name pattern for files of this type, used by e.g. the GUI
+ *	\param	regexPattern	Regex pattern used internally
+ */
+GFilter_cflow6col::GFilter_cflow6col(std::string formatName, std::string humanReadablePattern, std::string regexPattern) :
+	GFilter(formatName, humanReadablePattern, regexPattern) {
+	// nothing to do here
+}
+
+/**
+ *	Reads and checks the header of a columnar cflow file
+ *
+ *	\param fd Descriptor of the opened file
+ *	\param header Header struct to fill
+ *
+ *	\return True if the header is valid and matches the cflow_t layout of this build
+ */
+bool GFilter_cflow6col::read_header(int fd, cflowcol_header & header) const {
+	if (pread(fd, &header, sizeof(header), 0) != (ssize_t) sizeof(header))
+		return false;
+	if (memcmp(header.signature, CFLOWCOL_SIGNATURE, sizeof(header.signature)) != 0)
+		return false;
+	return header.recordSize == sizeof(cflow_t) && header.columnCount == CFLOWCOL_COLUMNS;
+}
+
+/**
+ *	Decides if this file is a columnar cflow file (file name and header)
+ *
+ *	\param in_filename File which should be tested
+ *
+ *	\return True if this file contains columnar cflow6 flows, false if not
+ */
+bool GFilter_cflow6col::acceptFileForReading(std::string in_filename) const {
+	if (!GFilter::acceptFilename(in_filename))
+		return false;
+
+	int fd = open(in_filename.c_str(), O_RDONLY);
+	if (fd == -1)
+		return false;
+	cflowcol_header header;
+	bool valid = read_header(fd, header);
+	close(fd);
+	return valid;
+}
+
+/**
+ *	Reads a given file into a given flowlist.
+ *
+ *	\param filename Filename of the columnar cflow file
+ *	\param flowlist List which will be filled with the cflows
+ *	\param local_net Contains the IP
+ *	\param netmask Contains the netmask
+ *	\param append If true, do not clear the flowlist, instead append it to the existing data
+ */
+void GFilter_cflow6col::read_file(std::string filename, CFlowList & flowlist, const IPv6_addr & local_net, const IPv6_addr & netmask, bool append) const {
+	read_file(filename, flowlist, append);
+}
+
+/**
+ *	Reads all flows of a given file into a given flowlist.
+ *
+ *	\param in_filename Filename of the columnar cflow file
+ *	\param flowlist List which will be filled with the cflows
+ *	\param append If true, do not clear the flowlist, instead append it to the existing data
+ *
+ *	\exception std::string Errortext
+ */
+void GFilter_cflow6col::read_file(std::string in_filename, CFlowList & flowlist, bool append) const {
+	read_file_filtered(in_filename, flowlist, CFlowPredicate(), append);
+}
+
+/**
+ *	Reads the flows accepted by a predicate into a given flowlist.
+ *
+ *	Row groups are skipped based on their statistics. Within the remaining groups the predicate is
+ *	evaluated on the protocol, flowtype and localIP columns; the other columns are only read and
+ *	decompressed for groups with accepted flows. The row groups are processed in parallel.
+ *
+ *	\param in_filename Filename of the columnar cflow file
+ *	\param flowlist List which will be filled with the cflows
+ *	\param predicate Flows to accept
+ *	\param append If true, do not clear the flowlist, instead append it to the existing data
+ *
+ *	\exception std::string Errortext
+ */
+void GFilter_cflow6col::read_file_filtered(std::string in_filename, CFlowList & flowlist, const CFlowPredicate & predicate, bool append) const {
+	int fd = open(in_filename.c_str(), O_RDONLY);
+	if (fd == -1) {
+		string errtext = "ERROR: could not open file source \"" + in_filename + "\".";
+		throw errtext;
+	}
+
+	cflowcol_header header;
+	struct stat filestat;
+	if (!read_header(fd, header) || fstat(fd, &filestat) == -1) {
+		close(fd);
+		string errtext = in_filename + " does not look like a columnar cflow file (bad header)";
+		throw errtext;
+	}
+
+	uint64_t directorySize = header.groupCount * sizeof(cflowcol_group);
+	vector<cflowcol_group> groups(header.groupCount);
+	if (header.directoryOffset + directorySize != (uint64_t) filestat.st_size || (directorySize > 0 && pread(fd, &groups[0], directorySize,
+	      header.directoryOffset) != (ssize_t) directorySize)) {
+		close(fd);
+		string errtext = in_filename + " does not look like a columnar cflow file (bad row group directory)";
+		throw errtext;
+	}
+
+	uint64_t flowCount = 0;
+	uint64_t columnBytes = 0;
+	for (vector<cflowcol_group>::const_iterator group = groups.begin(); group != groups.end(); group++) {
+		flowCount += group->flowCount;
+		for (unsigned int column = 0; column < CFLOWCOL_COLUMNS; column++)
+			columnBytes += group->chunks[column].size;
+	}
+	if (flowCount != header.flowCount) {
+		close(fd);
+		string errtext = in_filename + " does not look like a columnar cflow file (wrong flow count)";
+		throw errtext;
+	}
+
+	vector<CFlowList> results(groups.size());
+	vector<uint64_t> bytesRead(groups.size(), 0);
+	CGroupReadTask task(fd, groups, predicate, results, bytesRead);
+	try {
+		util::runParallel(task, groups.size());
+	} catch (string & e) {
+		close(fd);
+		throw in_filename + ": " + e;
+	}
+	close(fd);
+
+	if (!append)
+		flowlist.clear();
+	uint64_t accepted = 0;
+	uint64_t totalRead = 0;
+	for (vector<CFlowList>::size_type i = 0; i < results.size(); i++) {
+		accepted += results[i].size();
+		totalRead += bytesRead[i];
+	}
+	flowlist.reserve(flowlist.size() + accepted);
+	for (vector<CFlowList>::const_iterator result = results.begin(); result != results.end(); result++)
+		flowlist.insert(flowlist.end(), result->begin(), result->end());
+
+	cout << "Reading file " << in_filename << " (" << accepted << " of " << header.flowCount << " flows, " << totalRead << " of " << columnBytes
+	      << " column bytes read)\n";
+}
+
+/**
+ *	Writes a given flowlist into a given filename. Appends to already existing files if requested.
+ *
+ *	The row groups are compressed in parallel, a batch of groups per round to keep the memory
+ *	used for compressed data bounded. The data is written to a temporary file first which then
+ *	replaces the old file.
+ *
+ *	\param out_filename Filename of the columnar cflow file
+ *	\param subflowlist Flows to write
+ *	\param appendIfExisting If true, do not fail if the file is already existing, instead append out flowlist to it
+ *
+ *	\exception std::string Errortext
+ */
+void GFilter_cflow6col::write_file(const std::string & out_filename, const Subflowlist subflowlist, bool appendIfExisting) const {
+	CFlowList oldflowlist;
+	if (util::fileExists(out_filename) && appendIfExisting) {
+		if (!acceptFileForReading(out_filename)) {
+			stringstream error;
+			error << "Can not append to " << out_filename << ". Can not read in this file.";
+			throw error.str();
+		}
+		read_file(out_filename, oldflowlist, false);
+	}
+
+	const cflow_t * flows = NULL;
+	uint64_t count = subflowlist.size();
+	if (oldflowlist.size() > 0) {
+		copy(subflowlist.begin(), subflowlist.end(), back_inserter(oldflowlist));
+		sort(oldflowlist.begin(), oldflowlist.end());
+		flows = &oldflowlist[0];
+		count = oldflowlist.size();
+	} else if (count > 0) {
+		flows = &(*subflowlist.begin());
+	}
+
+	cflowcol_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.signature, CFLOWCOL_SIGNATURE, sizeof(header.signature));
+	header.recordSize = sizeof(cflow_t);
+	header.columnCount = CFLOWCOL_COLUMNS;
+	header.flowCount = count;
+	header.groupCount = (count + CFLOWCOL_GROUP_FLOWS - 1) / CFLOWCOL_GROUP_FLOWS;
+
+	string tmp_filename = out_filename + ".tmp";
+	ofstream out_filestream(tmp_filename.c_str(), ios::out | ios::binary | ios::trunc);
+	if (!out_filestream.is_open()) {
+		string errtext = "ERROR: could not open file destination \"" + tmp_filename + "\".";
+		throw errtext;
+	}
+	out_filestream.write((const char *) &header, sizeof(header));
+
+	vector<cflowcol_group> directory;
+	uint64_t offset = sizeof(header);
+	uint64_t batchSize = util::getWorkerCount();
+	for (uint64_t firstGroup = 0; firstGroup < header.groupCount; firstGroup += batchSize) {
+		uint64_t batch = (header.groupCount - firstGroup < batchSize) ? header.groupCount - firstGroup : batchSize;
+		vector<cflowcol_group> groups(batch);
+		vector<string> chunks(batch * CFLOWCOL_COLUMNS);
+		CGroupWriteTask task(flows, count, firstGroup, groups, chunks);
+		try {
+			util::runParallel(task, batch);
+		} catch (string & e) {
+			out_filestream.close();
+			unlink(tmp_filename.c_str());
+			throw e;
+		}
+
+		for (uint64_t i = 0; i < batch; i++) {
+			for (unsigned int column = 0; column < CFLOWCOL_COLUMNS; column++) {
+				const string & chunk = chunks[i * CFLOWCOL_COLUMNS + column];
+				groups[i].chunks[column].offset = offset;
+				out_filestream.write(chunk.data(), chunk.size());
+				offset += chunk.size();
+			}
+			directory.push_back(groups[i]);
+		}
+	}
+
+	header.directoryOffset = offset;
+	if (!directory.empty())
+		out_filestream.write((const char *) &directory[0], directory.size() * sizeof(cflowcol_group));
+	out_filestream.seekp(0);
+	out_filestream.write((const char *) &header, sizeof(header));
+	out_filestream.close();
+
+	if (out_filestream.fail() || rename(tmp_filename.c_str(), out_filename.c_str()) == -1) {
+		unlink(tmp_filename.c_str());
+		stringstream error;
+		error << "ERROR: could not write file \"" << out_filename << "\"";
+		throw error.str();
+	}
+}
@@ -0,0 +1,145 @@
+/**
+ *	\file gfilter_cflowcol.h
+ *	\brief Filter to import and export columnar cflow files
+ *
+ * 	This file is subject to the terms and conditions defined in
+ * 	files 'BSD.txt' and 'GPL.txt'. For a list of authors see file 'AUTHORS'.
+ */
+
+#ifndef GFILTER_CFLOWCOL_H_
+#define GFILTER_CFLOWCOL_H_
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "gfilter.h"
+#include "IPv6_addr.h"
+#include "cflow.h"
+#include "global.h"
+
+#define CFLOWCOL_SIGNATURE "CFLOW6C"
+#define CFLOWCOL_GROUP_FLOWS 65536 ///< Flows per row group
+
+/**
+ *	\enum cflowcol_column_t
+ *	\brief Columns of a columnar cflow file, one per member of cflow6
+ */
+enum cflowcol_column_t {
+	COL_MAGIC,
+	COL_PROT,
+	COL_FLOWTYPE,
+	COL_TOS_FLAGS,
+	COL_DURATION,
+	COL_START,
+	COL_LOCALIP,
+	COL_REMOTEIP,
+	COL_OCTETS,
+	COL_PKTS,
+	COL_LOCALPORT,
+	COL_REMOTEPORT,
+	COL_LOCALAS,
+	COL_REMOTEAS,
+	CFLOWCOL_COLUMNS
+};
+
+/**
+ *	\struct	cflowcol_header
+ *	\brief	File header of a columnar cflow file
+ */
+#pragma pack(1)
+struct cflowcol_header {
+	char signature[8]; ///< Always CFLOWCOL_SIGNATURE
+	uint32_t recordSize; ///< sizeof(cflow6) of the writer
+	uint32_t columnCount; ///< Always CFLOWCOL_COLUMNS
+	uint64_t flowCount; ///< Number of flows in the file
+	uint64_t groupCount; ///< Number of row groups
+	uint64_t directoryOffset; ///< File offset of the row group directory
+};
+
+/**
+ *	\struct	cflowcol_chunk
+ *	\brief	Location of one zlib compressed column of a row group
+ */
+struct cflowcol_chunk {
+	uint64_t offset; ///< File offset
+	uint32_t size; ///< Compressed size in bytes
+};
+
+/**
+ *	\struct	cflowcol_group
+ *	\brief	Entry of the row group directory
+ *
+ *	Besides the column locations it holds some statistics which allow to skip a whole group
+ *	without reading any of its columns.
+ */
+struct cflowcol_group {
+	uint32_t flowCount; ///< Number of flows in this group
+	uint8_t protocols; ///< Bit (1 << proto_t) is set for every protocol present in this group
+	uint8_t reserved; ///< Set to zero
+	uint16_t flowtypes; ///< Bit (1 << (flowtype & simpleflow)) is set for every flow type present in this group
+	IPv6_addr minLocalIP; ///< Smallest localIP of this group
+	IPv6_addr maxLocalIP; ///< Largest localIP of this group
+	cflowcol_chunk chunks[CFLOWCOL_COLUMNS]; ///< Compressed columns
+};
+#pragma pack()
+
+/**
+ *	\class	CFlowPredicate
+ *	\brief	Restrictions on the flows to load from a columnar cflow file
+ *
+ *	Accepts all flows by default. The uniflow and protocol filters of prefs_t are supported.
+ *	The biflow filter and the filters for unproductive flows are not: the unibiflow qualification,
+ *	which is done over the whole flowlist after loading, needs the biflows.
+ */
+class CFlowPredicate {
+	public:
+		CFlowPredicate();
+		CFlowPredicate(const prefs_t & prefs);
+
+		void setLocalNet(const IPv6_addr & local_net, const IPv6_addr & netmask);
+		bool restrictsType() const;
+		bool restrictsLocalIP() const;
+		bool acceptType(uint8_t prot, uint8_t flowtype) const;
+		bool acceptLocalIP(const IPv6_addr & localIP) const;
+		bool acceptGroup(const cflowcol_group & group) const;
+
+	private:
+		bool filter_prot[OTHER + 1]; ///< True for the protocols (indexed by proto_t) to filter
+		uint8_t flowtype_filter; ///< Bitmask of the flowtypes to filter
+		bool restrictIP; ///< True if only flows with localIP in local_net are accepted
+		IPv6_addr local_net; ///< Accepted network
+		IPv6_addr netmask; ///< Netmask of local_net
+};
+
+/**
+ *	\class	GFilter_cflow6col
+ *	\brief	Filter to import and export columnar (struct-of-arrays) cflow6 files
+ *
+ *	The flows are stored in row groups of CFLOWCOL_GROUP_FLOWS flows. Within a group every member of
+ *	cflow6 is stored as a separately compressed column. A reader with a CFlowPredicate first
+ *	evaluates the narrow protocol, flowtype and localIP columns, the other columns of a group are
+ *	only read if at least one of its flows is accepted.
+ */
+class GFilter_cflow6col: public GFilter {
+public:
+	GFilter_cflow6col(std::string formatName = "cflow6col", std::string humanReadablePattern = "*.cflowcol", std::string regexPattern =
+	      ".*\\.cflowcol$");
+
+	// import methods
+	void read_file(std::string filename, CFlowList & flowlist, bool append = false) const;
+	virtual void read_file(std::string filename, CFlowList & flowlist, const IPv6_addr & local_net, const IPv6_addr & netmask, bool append) const;
+	void read_file_filtered(std::string in_filename, CFlowList & flowlist, const CFlowPredicate & predicate, bool append = false) const;
+	virtual bool acceptFileForReading(std::string in_filename) const;
+
+	// export methods
+	virtual bool acceptFileForWriting(std::string in_filename) const {
+		return acceptFilename(in_filename);
+	}
+	virtual void write_file(const std::string & out_filename, const Subflowlist flowlist, bool appendIfExisting = true) const;
+
+protected:
+	bool read_header(int fd, cflowcol_header & header) const;
+};
+
+#endif /* GFILTER_CFLOWCOL_H_ */
@@ -7,11 +7,15 @@
  */
 
 #include <string>
+#include <vector>
 
 #include "gfilter_ipfix.h"
+#include "gflowassembler.h"
 
 using namespace std;
 
+#define IPFIX_BATCH 4096 ///< Records read from the file at once
+
 /**
  *	Constructor
  *
@@ -24,32 +28,82 @@ GFilter_ipfix::GFilter_ipfix(std::string formatName, std::string humanReadablePa
 	// nothing to do here
 }
 
+/**
+ *	Converts an ipfix record into a flow, oriented by the local network
+ *
+ *	\param irec IPFIX record of the vx5 template
+ *	\param local_net Local network address
+ *	\param netmask Network mask for local network address
+ *	\param flow Flow to fill
+ */
+static void ipfix_to_cflow(const vx5Flow_t & irec, const IPv6_addr & local_net, const IPv6_addr & netmask, cflow_t & flow) {
+	// check if record contains IPv6 data
+	bool isIPv6 = (irec.sourceIPv4Address == 0/*irec.ipVersion == IP_VERS_NR_IPv6*/); // TODO: check & fix
+
+	// Get IP addresses
+	IPv6_addr srcIP;
+	IPv6_addr dstIP;
+	if (isIPv6) {
+		srcIP = util::ipV6IpfixToIpV6(irec.sourceIPv6Address);
+		dstIP = util::ipV6IpfixToIpV6(irec.destinationIPv6Address);
+	} else {
+		srcIP = IPv6_addr(irec.sourceIPv4Address);
+		dstIP = IPv6_addr(irec.destinationIPv4Address);
+	}
+
+	// Infer flow direction from known network/netmask values.
+	// Biflow matching: revert src/dst such that biflows are formed
+	if ((srcIP & netmask) == local_net) {
+		flow.flowtype = outflow;
+		flow.localIP = srcIP;
+		flow.remoteIP = dstIP;
+		flow.localPort = irec.sourceTransportPort;
+		flow.remotePort = irec.destinationTransportPort;
+	} else {
+		flow.flowtype = inflow;
+		flow.localIP = dstIP;
+		flow.remoteIP = srcIP;
+		flow.localPort = irec.destinationTransportPort;
+		flow.remotePort = irec.sourceTransportPort;
+	}
+	if (irec.reverseOctetTotalCount > 0)
+		flow.flowtype = biflow;
+
+	flow.prot = irec.protocolIdentifier;
+	flow.dOctets = irec.octetTotalCount + irec.reverseOctetTotalCount;
+	flow.dPkts = irec.packetTotalCount + irec.reversePacketTotalCount;
+	flow.startMs = irec.flowStartMilliseconds;
+	flow.durationMs = irec.flowEndMilliseconds - irec.flowStartMilliseconds;
+	flow.localAS = 0;
+	flow.remoteAS = 0;
+	flow.tos_flags = 0;
+	flow.magic = 1;
+}
+
 /**
  *	Read ipfix data from file into memory-based temporary flow list.
  *	Converts ipfix flows into cflow_t flows.
  *	Uses routines from libfixbuf and the file read/writer example to read ipfix files.
  *	The template used supports IPv4 uniflows only.
  *
+ *	Records are read in batches of IPFIX_BATCH records straight into vx5Flow_t structs, then
+ *	converted and merged by a CFlowAssembler without timeouts. There is no limit on the
+ *	number of flows.
+ *
  *	The temporary flow list is not yet sorted and uniflows are not yet qualified.
  *
  *	\param in_filename Inputfilename
  *	\param flowlist Reference to the flowlist
  *	\param local_net Local network address
  *	\param netmask Network mask for local network address
- *	\param append Future flag to allow the import of more than one file (not yet used)
+ *	\param append If true, do not clear the flowlist, instead append the flows to the existing data
  *
  *	\exception std::string Errortext
  */
 void GFilter_ipfix::read_file(std::string in_filename, CFlowList & flowlist, const IPv6_addr & local_net, const IPv6_addr & netmask, bool append) const {
-	bool debug5 = false; //FIXME: remove this kind of errorhandling
-
-	// Allocate temp_flowlist
-	int maxnum_flows = 1000000; // TODO We do not know in advance how many flows will be assembled
-	flowlist.resize(maxnum_flows);
-
-	// Hash map for biflow pairing
-	flowHashMap * flowHM = new flowHashMap();
-	flowHashMap::iterator iter;
+	if (!append)
+		flowlist.clear();
+	size_t first_flow = flowlist.size();
 
 	// Prepare for reading of ipfix file
 	// *********************************
@@ -57,164 +111,65 @@ void GFilter_ipfix::read_file(std::string in_filename, CFlowList & flowlist, con
 
 	GError * err1 = NULL;
 	fBuf_t * fbuf = vx5ReaderForFP(pFile, &err1);
+	if (fbuf == NULL) {
+		string errtext = "ERROR: could not set up IPFIX reader for " + in_filename;
+		if (err1 != NULL) {
+			errtext += ": ";
+			errtext += err1->message;
+			g_clear_error(&err1);
+		}
+		util::closeFile(pFile);
+		throw errtext;
+	}
 
-	size_t s = 256;
-	uint8_t * recbase = new uint8_t[s];
+	// Merges records of the same 5-tuple (no timeouts: records are complete flows)
+	CFlowAssembler assembler(flowlist, 0, 0);
 
 	// Read ipfix file
 	// ***************
-	// Read flow-by-flow, transform into cflow_t format and store in temporary flowlist
-	int j = 0;
-	int k = 0;
-	gboolean ok = true;
-	// cout<<"----"<<sizeof(vx5Flow_st)<<endl;
-	while (ok) {
-		GError * err2 = NULL;
-		ok = fBufNext(fbuf, recbase, &s, &err2);
-
-		if (!ok) {
-			if (err2->code == FB_ERROR_EOF) {
-				cout << "Read complete: EOF\n";
-			} else {
-				cerr << "INFO: failed reading, reason: ";
-				cerr << err2->message << endl;
-				throw string(err2->message);
-			}
-		} else {
-			vx5Flow_t * irec = (vx5Flow_t *) recbase; // cast to ipfix record
-
-			// check if record contains IPv6 data
-			//cout << "version:" << util::bin2hexstring(&(irec->ipVersion), 1) << endl;
-			bool isIPv6 = (irec->sourceIPv4Address == 0/*irec->ipVersion == IP_VERS_NR_IPv6*/); // TODO: check & fix
-
-			// Get protocol
-			uint8_t prot = irec->protocolIdentifier;
-			// uint8_t prot = irec->nextHeaderIPv6;
-
-			// Get ports and IP addresses
-			uint16_t srcPort = irec->sourceTransportPort;
-			uint16_t dstPort = irec->destinationTransportPort;
-			IPv6_addr srcIP;
-			IPv6_addr dstIP;
-			if (isIPv6) {
-				srcIP = util::ipV6IpfixToIpV6(irec->sourceIPv6Address);
-				dstIP = util::ipV6IpfixToIpV6(irec->destinationIPv6Address);
-			} else {
-				srcIP = IPv6_addr(irec->sourceIPv4Address);
-				dstIP = IPv6_addr(irec->destinationIPv4Address);
-			}
-
-			if (debug5) {
-				if (srcIP == IPv6_addr() || dstIP == IPv6_addr()) {
-					print_ipfix_record(recbase);
+	// Read a batch of records, then transform them into cflow_t format and merge them
+	vector<vx5Flow_t> batch(IPFIX_BATCH);
+	CFlowList flows(IPFIX_BATCH);
+	uint64_t k = 0;
+	try {
+		bool eof = false;
+		while (!eof) {
+			size_t count = 0;
+			while (count < batch.size()) {
+				GError * err2 = NULL;
+				size_t len = sizeof(vx5Flow_t);
+				if (fBufNext(fbuf, (uint8_t *) &batch[count], &len, &err2)) {
+					count++;
+					continue;
 				}
-			}
-
-			// Assign src/dst fields to appropriate local/remote fields
-			// Assign src/dst fields to appropriate local/remote fields
-			IPv6_addr localIP, remoteIP;
-			uint32_t localPort, remotePort;
-
-			// Infer flow direction from known network/netmask values
-			flow_type_t flowtype = inflow;
-			if ((srcIP & netmask) == local_net) {
-				flowtype = outflow;
-			}
-
-			// Biflow matching: revert src/dst such that biflows are formed
-			if (flowtype == outflow) {
-				localIP = srcIP;
-				remoteIP = dstIP;
-				localPort = srcPort;
-				remotePort = dstPort;
-			} else {
-				localIP = dstIP;
-				remoteIP = srcIP;
-				localPort = dstPort;
-				remotePort = srcPort;
-			}
-
-			uint64_t startMs = irec->flowStartMilliseconds;
-			uint64_t endMs = irec->flowEndMilliseconds;
-
-			uint64_t revdOctets = irec->reverseOctetTotalCount;
-			uint32_t revdPkts = irec->reversePacketTotalCount;
-
-			bool bidir = false;
-			if (revdOctets > 0)
-				bidir = true;
-
-			uint64_t dOctets = irec->octetTotalCount + revdOctets;
-			uint32_t dPkts = irec->packetTotalCount + revdPkts;
-
-			// Check if flow is a new flow or updates/matches an existing flow
-			flowHashKey mykey(localIP, remoteIP, localPort, remotePort, prot);
-			iter = flowHM->find(mykey);
-
-			if (iter != flowHM->end()) {
-				// Found: update found cflow_t with new nfdump's flow data
-				// Fetch reference to flow entry hash map
-				cflow_t * f = iter->second;
-				// Found: update flow by contents of current packet
-				f->dOctets += dOctets;
-
-				if (startMs > f->startMs) {
-					// New flow starts later: modify duration
-					f->durationMs = endMs - f->startMs;
-				} else {
-					// New flow starts earlier
-					f->durationMs = (f->startMs + f->durationMs) - startMs;
-					// Set flow start to earlier flow start
-					flowlist[j].startMs = startMs;
-				}
-
-				f->dPkts += dPkts;
-				if ((f->flowtype != flowtype) && (f->flowtype != biflow)) {
-					// New packet has opposite direction to earlier packets
-					// Make it a biflow
-					f->flowtype = biflow;
-				}
-
-			} else { // Not found
-				// Make an initial entry into temp_flowlist
-				flowlist[j].localIP = localIP;
-				flowlist[j].remoteIP = remoteIP;
-				flowlist[j].localPort = localPort;
-				flowlist[j].remotePort = remotePort;
-				if (bidir) {
-					flowlist[j].flowtype = biflow;
-				} else {
-					flowlist[j].flowtype = flowtype;
-				}
-				flowlist[j].prot = prot;
-				flowlist[j].dOctets = dOctets;
-				flowlist[j].startMs = startMs;
-				flowlist[j].durationMs = endMs - startMs;
-				flowlist[j].dPkts = dPkts;
-				flowlist[j].localAS = 0;
-				flowlist[j].remoteAS = 0;
-				flowlist[j].tos_flags = 0;
-				flowlist[j].magic = 1;
-
-				// Store 5-tuple together with reference to flow record in flow list
-				(*flowHM)[mykey] = &flowlist[j];
-				j++;
-				if (j >= maxnum_flows) {
-					string errtext = "INFO: terminating file reading due to full flow list.\n";
-					errtext += maxnum_flows;
-					errtext += " is the configured import limit.\n";
-					cerr << errtext;
-					throw errtext;
+				eof = true;
+				if (err2->code == FB_ERROR_EOF) {
+					cout << "Read complete: EOF\n";
+					g_clear_error(&err2);
+					break;
 				}
+				string errtext = err2->message;
+				cerr << "INFO: failed reading, reason: " << errtext << endl;
+				g_clear_error(&err2);
+				throw errtext;
 			}
-			k++;
+
+			for (size_t i = 0; i < count; i++)
+				ipfix_to_cflow(batch[i], local_net, netmask, flows[i]);
+			if (count > 0)
+				assembler.add_flows(&flows[0], count);
+			k += count;
 		}
+	} catch (...) {
+		fBufFree(fbuf);
+		util::closeFile(pFile);
+		throw;
 	}
+	assembler.flush();
+	fBufFree(fbuf);
 	util::closeFile(pFile);
 
-	flowlist.resize(j);
-
-	cout << "*** Processed " << k << " ipfix flows to " << flowlist.size() << " final flows.\n";
+	cout << "*** Processed " << k << " ipfix flows to " << (flowlist.size() - first_flow) << " final flows.\n";
 }
 
 /**
@@ -11,14 +11,424 @@
 #include <sys/stat.h>
 #include <errno.h>
 #include <sstream>
+#include <deque>
+#include <vector>
+#include <pthread.h>
+#ifdef HAVE_BZIP2
+#include <bzlib.h>
+#endif
+#ifdef HAVE_LZO
+#include <lzo/lzo1x.h>
+#endif
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
 
 #include "gfilter_nfdump.h"
 #include "gfilter_nfdump_gnfdump.h"	// nfdump file format support (extracted from nfdump tool set)
+#include "gparallel.h"
+#include "gflowassembler.h"
 #include "cflow.h"
 #include "IPv6_addr.h"
 
 using namespace std;
 
+#define NFDUMP_READ_AHEAD 2 ///< Data blocks read ahead while a batch of blocks is decoded
+#define NFDUMP_BLOCKS_PER_WORKER 2 ///< Data blocks decoded per worker thread and batch
+#define NFDUMP_EXPANDED_BUFFSIZE (5 * BUFFSIZE) ///< Maximum size of a decompressed data block
+
+/// OpenFile() and GetFlags() share the file header in a static variable: serializes concurrent imports
+static pthread_mutex_t nfdump_open_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ *	\class	CNfdumpBlockReader
+ *	\brief	Reads the data blocks of an nfdump file in a separate thread
+ *
+ *	While the caller decodes some blocks, the following blocks are read into a small pool of
+ *	buffers of BUFFSIZE bytes each. Thus the memory used does not depend on the file size and
+ *	reading the file overlaps with decoding it.
+ */
+class CNfdumpBlockReader {
+	public:
+		CNfdumpBlockReader(int rfd, unsigned int buffer_count);
+		~CNfdumpBlockReader();
+
+		common_record_t * next_block(data_block_header_t & header);
+		void release_block(common_record_t * data);
+		uint64_t getTotalBytes() const;
+		const std::string & getError() const;
+
+	private:
+		/**
+		 *	\struct block
+		 *	\brief A data block read from the file
+		 */
+		struct block {
+				data_block_header_t header; ///< Block header
+				common_record_t * data; ///< Records of the block
+		};
+
+		static void * reader_worker(void * arg);
+		void read_blocks();
+
+		int rfd; ///< File to read from
+		std::vector<common_record_t *> buffers; ///< All buffers of the pool
+		std::vector<common_record_t *> free_buffers; ///< Buffers available to the reader thread
+		std::deque<block> filled; ///< Blocks read but not yet handed out
+		bool done; ///< True when the reader thread reached the end of the file or failed
+		bool stopping; ///< True when the reader thread has to stop early
+		std::string error; ///< Message if the file could not be read completely
+		uint64_t total_bytes; ///< Number of bytes read
+		pthread_t thread; ///< Reader thread
+		pthread_mutex_t mutex; ///< Protects all the members above
+		pthread_cond_t not_empty; ///< Signaled when a block was read or done was set
+		pthread_cond_t not_full; ///< Signaled when a buffer was returned or stopping was set
+};
+
+/**
+ *	Constructor: allocates the buffers and starts the reader thread
+ *
+ *	\param rfd File opened by OpenFile()
+ *	\param buffer_count Number of blocks which can be held by the caller and the reader thread together
+ *
+ *	\exception std::string Errortext
+ */
+CNfdumpBlockReader::CNfdumpBlockReader(int rfd, unsigned int buffer_count) :
+	rfd(rfd), done(false), stopping(false), total_bytes(0) {
+	for (unsigned int i = 0; i < buffer_count; i++) {
+		buffers.push_back((common_record_t *) malloc(BUFFSIZE));
+		if (buffers.back() == NULL) {
+			for (unsigned int j = 0; j < i; j++)
+				free(buffers[j]);
+			throw string("ERROR: out of memory while allocating nfdump read buffers.");
+		}
+	}
+	free_buffers = buffers;
+	pthread_mutex_init(&mutex, NULL);
+	pthread_cond_init(&not_empty, NULL);
+	pthread_cond_init(&not_full, NULL);
+	if (pthread_create(&thread, NULL, reader_worker, this) != 0) {
+		pthread_mutex_destroy(&mutex);
+		pthread_cond_destroy(&not_empty);
+		pthread_cond_destroy(&not_full);
+		for (unsigned int i = 0; i < buffers.size(); i++)
+			free(buffers[i]);
+		throw string("ERROR: could not start nfdump reader thread.");
+	}
+}
+
+/**
+ *	Destructor: stops the reader thread and frees the buffers
+ */
+CNfdumpBlockReader::~CNfdumpBlockReader() {
+	pthread_mutex_lock(&mutex);
+	stopping = true;
+	pthread_cond_signal(&not_full);
+	pthread_mutex_unlock(&mutex);
+	pthread_join(thread, NULL);
+	pthread_mutex_destroy(&mutex);
+	pthread_cond_destroy(&not_empty);
+	pthread_cond_destroy(&not_full);
+	for (unsigned int i = 0; i < buffers.size(); i++)
+		free(buffers[i]);
+}
+
+/**
+ *	Entry point of the reader thread
+ *
+ *	\param arg The CNfdumpBlockReader
+ *
+ *	\return NULL
+ */
+void * CNfdumpBlockReader::reader_worker(void * arg) {
+	((CNfdumpBlockReader *) arg)->read_blocks();
+	return NULL;
+}
+
+/**
+ *	Reads blocks into free buffers until the end of the file, an error or until stopped
+ */
+void CNfdumpBlockReader::read_blocks() {
+	while (true) {
+		pthread_mutex_lock(&mutex);
+		while (free_buffers.empty() && !stopping)
+			pthread_cond_wait(&not_full, &mutex);
+		if (stopping) {
+			pthread_mutex_unlock(&mutex);
+			return;
+		}
+		block b;
+		b.data = free_buffers.back();
+		free_buffers.pop_back();
+		pthread_mutex_unlock(&mutex);
+
+		char * estring = NULL;
+		int ret = ReadBlock(rfd, &b.header, (void *) b.data, &estring);
+		int read_errno = errno;
+
+		pthread_mutex_lock(&mutex);
+		if (ret > 0) {
+			total_bytes += ret;
+			filled.push_back(b);
+		} else {
+			free_buffers.push_back(b.data);
+			if (ret == NF_CORRUPT)
+				error = string("Skip corrupt data file: ") + (estring ? estring : "");
+			else if (ret == NF_ERROR)
+				error = string("Read error: ") + strerror(read_errno);
+			done = true;
+		}
+		pthread_cond_signal(&not_empty);
+		pthread_mutex_unlock(&mutex);
+		if (ret <= 0)
+			return;
+	}
+}
+
+/**
+ *	Hands out the next block. The block has to be given back by release_block() when it is not needed any more.
+ *
+ *	\param header Receives the block header
+ *
+ *	\return Records of the block, NULL at the end of the file or after an error (see getError())
+ */
+common_record_t * CNfdumpBlockReader::next_block(data_block_header_t & header) {
+	common_record_t * data = NULL;
+	pthread_mutex_lock(&mutex);
+	while (filled.empty() && !done)
+		pthread_cond_wait(&not_empty, &mutex);
+	if (!filled.empty()) {
+		header = filled.front().header;
+		data = filled.front().data;
+		filled.pop_front();
+	}
+	pthread_mutex_unlock(&mutex);
+	return data;
+}
+
+/**
+ *	Gives a block handed out by next_block() back to the reader thread
+ *
+ *	\param data Records of the block
+ */
+void CNfdumpBlockReader::release_block(common_record_t * data) {
+	pthread_mutex_lock(&mutex);
+	free_buffers.push_back(data);
+	pthread_cond_signal(&not_full);
+	pthread_mutex_unlock(&mutex);
+}
+
+/**
+ *	\return Number of bytes read so far
+ */
+uint64_t CNfdumpBlockReader::getTotalBytes() const {
+	return total_bytes;
+}
+
+/**
+ *	\return Message if the file could not be read completely, empty otherwise. Valid after next_block() returned NULL.
+ */
+const std::string & CNfdumpBlockReader::getError() const {
+	return error;
+}
+
+/**
+ *	\struct	nfdump_block
+ *	\brief	A data block on its way from the file to the flowlist
+ */
+struct nfdump_block {
+	data_block_header_t header; ///< Block header (size: size of the decompressed records)
+	common_record_t * raw; ///< Block as read from the file
+	std::vector<char> expanded; ///< Decompressed records (compressed files only)
+	common_record_t * records; ///< Records of the block: raw or expanded
+	std::vector<extension_info_t *> maps; ///< Extension map of every flow record
+	CFlowList flows; ///< Flows of the block
+};
+
+/**
+ *	\class	CNfdumpDecompressTask
+ *	\brief	Decompresses data blocks
+ */
+class CNfdumpDecompressTask: public util::CParallelTask {
+	public:
+		CNfdumpDecompressTask(vector<nfdump_block> & blocks, uint32_t flags) :
+			blocks(blocks), flags(flags) {
+		}
+
+		/**
+		 *	Decompress a block, if the file is compressed
+		 *
+		 *	\param number Number of the block within the batch
+		 *
+		 *	\exception std::string Errortext
+		 */
+		virtual void run(unsigned int number) {
+			nfdump_block & block = blocks[number];
+			if ((flags & (FLAG_COMPRESSED | FLAG_BZ2 | FLAG_LZ4)) == 0) {
+				block.records = block.raw;
+				return;
+			}
+			block.expanded.resize(NFDUMP_EXPANDED_BUFFSIZE);
+			bool ok = false;
+			if (flags & FLAG_BZ2) {
+#ifdef HAVE_BZIP2
+				unsigned int size = block.expanded.size();
+				ok = BZ2_bzBuffToBuffDecompress(&block.expanded[0], &size, (char *) block.raw, block.header.size, 0, 0) == BZ_OK;
+				block.header.size = size;
+#endif
+			} else if (flags & FLAG_LZ4) {
+#ifdef HAVE_LZ4
+				int size = LZ4_decompress_safe((const char *) block.raw, &block.expanded[0], block.header.size, block.expanded.size());
+				ok = size >= 0;
+				block.header.size = size;
+#endif
+			} else {
+#ifdef HAVE_LZO
+				lzo_uint size = block.expanded.size();
+				ok = lzo1x_decompress_safe((const unsigned char *) block.raw, block.header.size, (unsigned char *) &block.expanded[0], &size, NULL)
+				      == LZO_E_OK;
+				block.header.size = size;
+#endif
+			}
+			if (!ok)
+				throw string("ERROR: could not decompress nfdump data block (corrupt file or compression not supported by this build).");
+			block.records = (common_record_t *) &block.expanded[0];
+		}
+
+	private:
+		vector<nfdump_block> & blocks; ///< Batch of blocks
+		uint32_t flags; ///< File header flags
+};
+
+/**
+ *	Converts an expanded nfdump record into a flow, oriented by the local network
+ *
+ *	\param master_record Expanded record
+ *	\param local_net Local network address
+ *	\param netmask Network mask for local network address
+ *	\param flow Flow to fill
+ */
+static void nfdump_to_cflow(const master_record_t & master_record, const IPv6_addr & local_net, const IPv6_addr & netmask, cflow_t & flow) {
+	// Get ports and IP addresses
+	IPv6_addr srcIP;
+	IPv6_addr dstIP;
+	if ((master_record.flags & FLAG_IPV6_ADDR) != 0) {
+		srcIP = util::ipV6NfDumpToIpV6(master_record.v6.srcaddr);
+		dstIP = util::ipV6NfDumpToIpV6(master_record.v6.dstaddr);
+	} else {
+		srcIP = IPv6_addr(master_record.v4.srcaddr);
+		dstIP = IPv6_addr(master_record.v4.dstaddr);
+	}
+
+	// Infer flow direction from known network/netmask values.
+	// Biflow matching: revert src/dst such that biflows are formed
+	if ((srcIP & netmask) == local_net) {
+		flow.flowtype = outflow;
+		flow.localIP = srcIP;
+		flow.remoteIP = dstIP;
+		flow.localPort = master_record.srcport;
+		flow.remotePort = master_record.dstport;
+	} else {
+		flow.flowtype = inflow;
+		flow.localIP = dstIP;
+		flow.remoteIP = srcIP;
+		flow.localPort = master_record.dstport;
+		flow.remotePort = master_record.srcport;
+	}
+
+	uint64_t startMs = (uint64_t) master_record.first * 1000 + master_record.msec_first;
+	uint64_t endMs = (uint64_t) master_record.last * 1000 + master_record.msec_last;
+	flow.prot = master_record.prot;
+	flow.dOctets = master_record.dOctets;
+	flow.startMs = startMs;
+	flow.durationMs = endMs - startMs;
+	flow.dPkts = master_record.dPkts;
+	flow.localAS = 0;
+	flow.remoteAS = 0;
+	flow.tos_flags = master_record.tos;
+	flow.magic = 1;
+}
+
+/**
+ *	\class	CNfdumpExpandTask
+ *	\brief	Expands the flow records of data blocks into flows
+ */
+class CNfdumpExpandTask: public util::CParallelTask {
+	public:
+		CNfdumpExpandTask(vector<nfdump_block> & blocks, const IPv6_addr & local_net, const IPv6_addr & netmask) :
+			blocks(blocks), local_net(local_net), netmask(netmask) {
+		}
+
+		/**
+		 *	Expand the flow records of a block. The extension maps must already be assigned to the records.
+		 *
+		 *	\param number Number of the block within the batch
+		 */
+		virtual void run(unsigned int number) {
+			nfdump_block & block = blocks[number];
+			block.flows.resize(block.maps.size());
+			master_record_t master_record;
+			common_record_t * flow_record = block.records;
+			size_t flow = 0;
+			for (unsigned int i = 0; i < block.header.NumRecords && flow < block.maps.size(); i++) {
+				if (flow_record->type == CommonRecordType) {
+					/*
+					 * Expand file record into master record for further processing
+					 * LP64 CPUs need special 32bit operations as it is not guarateed, that 64bit
+					 * values are aligned
+					 */
+					ExpandRecord_v2(flow_record, block.maps[flow], &master_record);
+					nfdump_to_cflow(master_record, local_net, netmask, block.flows[flow]);
+					flow++;
+				}
+				// Advance pointer by number of bytes for netflow record
+				flow_record = (common_record_t *) ((pointer_addr_t) flow_record + flow_record->size);
+			}
+		}
+
+	private:
+		vector<nfdump_block> & blocks; ///< Batch of blocks
+		IPv6_addr local_net; ///< Local network address
+		IPv6_addr netmask; ///< Network mask for local network address
+};
+
+/**
+ *	Registers the extension maps of a block and assigns the current extension map to each flow record.
+ *	Extension maps may be redefined by later records, thus this is done block by block in file order.
+ *
+ *	\param block Decompressed block
+ *	\param extension_map_list Extension maps defined so far
+ */
+static void assign_extension_maps(nfdump_block & block, extension_map_list_t & extension_map_list) {
+	block.maps.clear();
+	common_record_t * flow_record = block.records;
+	char * end = (char *) block.records + block.header.size;
+	for (unsigned int i = 0; i < block.header.NumRecords; i++) {
+		if ((char *) flow_record + sizeof(record_header_t) > end || flow_record->size < sizeof(record_header_t)
+		      || (char *) flow_record + flow_record->size > end) {
+			fprintf(stderr, "Skip corrupt data block: record %u exceeds the block\n", i);
+			block.header.NumRecords = i;
+			break;
+		}
+		if (flow_record->type == CommonRecordType) {
+			extension_info_t * info = extension_map_list.slot[flow_record->ext_map];
+			if (info == NULL) {
+				fprintf(stderr, "Skip corrupt data block: record %u refers to undefined extension map %u\n", i, flow_record->ext_map);
+				block.header.NumRecords = i;
+				break;
+			}
+			block.maps.push_back(info);
+		} else if (flow_record->type == ExtensionMapType) {
+			Insert_Extension_Map(&extension_map_list, (extension_map_t *) flow_record);
+		} else {
+			fprintf(stderr, "Skip unknown record type %i\n", flow_record->type);
+		}
+
+		// Advance pointer by number of bytes for netflow record
+		flow_record = (common_record_t *) ((pointer_addr_t) flow_record + flow_record->size);
+	}
+}
+
 /**
  *	Constructor
  *
@@ -33,15 +443,22 @@ GFilter_nfdump::GFilter_nfdump(std::string formatName, std::string humanReadable
 
 /**
  *	Read nfdump data from file into memory-based temporary flow list.
- *	Supports nfdump 1.6.x file format.
+ *	Supports nfdump 1.6.x file format, uncompressed or compressed with any of the
+ *	compression libraries available at build time (bzip2, LZO, LZ4).
  *	Converts nfdump flows into cflow_t flows.
  *	The resulting flowlist is not yet sorted and uniflows are not yet qualified.
  *
+ *	The file is streamed block by block through CNfdumpBlockReader, thus there is no limit on the
+ *	file size or the number of flows and the read buffers take a constant amount of memory.
+ *	Blocks are processed in batches: they are decompressed and their records expanded on all
+ *	processors, only the extension maps and the aggregation into the flowlist are handled in
+ *	file order. Thus the result does not depend on the number of threads.
+ *
  *	\param in_filename Inputfilename
  *	\param flowlist Reference to the flowlist
  *	\param local_net Local network address
  *	\param netmask Network mask for local network address
- *	\param append Future flag to allow the import of more than one file (not yet used)
+ *	\param append If true, do not clear the flowlist, instead append the flows to the existing data
  *
  * \exception char* Errortext
  * \exception string Errortext
@@ -49,47 +466,26 @@ GFilter_nfdump::GFilter_nfdump(std::string formatName, std::string humanReadable
 void GFilter_nfdump::read_file(std::string in_filename, CFlowList & flowlist, const IPv6_addr & local_net, const IPv6_addr & netmask, bool append) const {
 	cout << "Input file " << in_filename << " contains " << util::getFileSize(in_filename) << " bytes.\n";
 
-	bool debug4 = false;
-
-	// Allocate temp_flowlist
-	int maxnum_flows = 1000000; // TODO We do not know in advance how many flows will be assembled
-	flowlist.resize(maxnum_flows);
+	if (!append)
+		flowlist.clear();
+	size_t first_flow = flowlist.size();
 
-	// Hash map for biflow pairing
-	flowHashMap * flowHM = new flowHashMap();
-	flowHashMap::iterator iter;
+	// Biflow pairing: merges records of the same 5-tuple (no timeouts: records are complete flows)
+	CFlowAssembler assembler(flowlist, 0, 0);
 
 	// Prepare for reading of nfdump file
 	// **********************************
-	data_block_header_t in_block_header;
-	common_record_t *flow_record, *in_buff;
-	master_record_t *master_record;
-	stat_record_t stat_record;
-	char * estring;
-
 	extension_map_list_t extension_map_list;
 	InitExtensionMaps(&extension_map_list);
 
-	uint32_t total_flows = 0;
-	uint64_t total_bytes = 0;
-
-	// time window of all matched flows
-	memset((void *) &stat_record, 0, sizeof(stat_record_t));
-	stat_record.first_seen = 0x7fffffff;
-	stat_record.msec_first = 999;
-
-	// time window of all processed flows
-	time_t t_first_flow, t_last_flow;
-	t_first_flow = 0x7fffffff;
-	t_last_flow = 0;
-
-	// allocate network buffer
-	uint64_t bufsize = (util::getFileSize(in_filename) * 12) / 10; // Add 20% reserve
-	in_buff = (common_record_t *) malloc(bufsize);
+	uint64_t total_flows = 0;
 
 	char *error;
 	stat_record_t *stat_ptr;
+	pthread_mutex_lock(&nfdump_open_mutex);
 	int rfd = OpenFile((char *) in_filename.c_str(), &stat_ptr, &error); // Open the file
+	uint32_t flags = GetFlags();
+	pthread_mutex_unlock(&nfdump_open_mutex);
 
 	if (rfd < 0) {
 		stringstream error;
@@ -97,206 +493,62 @@ void GFilter_nfdump::read_file(std::string in_filename, CFlowList & flowlist, co
 		throw error.str();
 	}
 
-	nffile_t nffile;
-	memset((void *) &nffile, 0, sizeof(nffile));
-
 	// Read nfdump file
 	// ****************
-	// Read flow-by-flow, transform into cflow_t format and store in temporary flowlist
-	int done = 0;
-	int j = 0;
-	while (!done) {
-		int ret;
-
-		// get next data block from file
-		ret = ReadBlock(rfd, &in_block_header, (void *) in_buff, &estring);
-		switch (ret) {
-			case NF_CORRUPT:
-			case NF_ERROR:
-				if (ret == NF_CORRUPT)
-					fprintf(stderr, "Skip corrupt data file '%s': '%s'\n", in_filename.c_str(), estring);
-				else
-					fprintf(stderr, "Read error in file '%s': %s\n", in_filename.c_str(), strerror(errno));
-				// fall through
-			case NF_EOF:
-				// rfd == EMPTY_LIST
-				done = 1;
-				continue;
-				break; // not really needed
-			default:
-				// successfully read block
-				total_bytes += ret;
-		}
-
-		flow_record = in_buff;
-		for (unsigned int i = 0; i < in_block_header.NumRecords; i++) {
-			if (flow_record->type == CommonRecordType) {
-				uint32_t map_id = flow_record->ext_map;
-
-				total_flows++;
-				master_record = &(extension_map_list.slot[map_id]->master_record);
-				/*
-				 * Expand file record into master record for further processing
-				 * LP64 CPUs need special 32bit operations as it is not guarateed, that 64bit
-				 * values are aligned
-				 */
-				ExpandRecord_v2(flow_record, extension_map_list.slot[map_id], master_record);
-
-				// Get protocol
-				uint8_t prot = master_record->prot;
-
-				// Get ports and IP addresses
-				uint16_t srcPort = master_record->srcport;
-				uint16_t dstPort = master_record->dstport;
-				IPv6_addr srcIP;
-				IPv6_addr dstIP;
-				if ((master_record->flags & FLAG_IPV6_ADDR) != 0) {
-					srcIP = util::ipV6NfDumpToIpV6(master_record->v6.srcaddr);
-					dstIP = util::ipV6NfDumpToIpV6(master_record->v6.dstaddr);
-
-				} else {
-					srcIP = IPv6_addr(master_record->v4.srcaddr);
-					dstIP = IPv6_addr(master_record->v4.dstaddr);
-				}
-
-				// Assign src/dst fields to appropriate local/remote fields
-				// Assign src/dst fields to appropriate local/remote fields
-				IPv6_addr localIP, remoteIP;
-				uint16_t localPort, remotePort;
-
-				// Infer flow direction from known network/netmask values
-				flow_type_t flowtype = inflow;
-				if ((srcIP & netmask) == local_net) {
-					flowtype = outflow;
-				}
-
-				// Biflow matching: revert src/dst such that biflows are formed
-				if (flowtype == outflow) {
-					localIP = srcIP;
-					remoteIP = dstIP;
-					localPort = srcPort;
-					remotePort = dstPort;
-				} else {
-					localIP = dstIP;
-					remoteIP = srcIP;
-					localPort = dstPort;
-					remotePort = srcPort;
-				}
-
-				uint64_t startMs = (uint64_t) master_record->first * 1000 + master_record->msec_first;
-				uint64_t endMs = (uint64_t) master_record->last * 1000 + master_record->msec_last;
-
-				uint64_t dOctets = master_record->dOctets;
-				uint32_t dPkts = master_record->dPkts;
-				uint8_t tos_flags = master_record->tos;
-
-				if (debug4) {
-					// Print cflow_t record
-					char s[512];
-					//					util::record2StringShort(&flow, s);
-					//					printf("%s\n", s);
-
-					// print nfdump record
-					print_record(master_record, s);
-					printf("%s\n", s);
-				}
-
-				// Check if flow is a new flow or updates/matches an existing flow
-				flowHashKey mykey(localIP, remoteIP, localPort, remotePort, prot);
-				iter = flowHM->find(mykey);
-
-				if (iter != flowHM->end()) {
-					// Found: update found cflow_t with new nfdump's flow data
-					// Fetch reference to flow entry hash map
-					cflow_t * f = iter->second;
-					// Found: update flow by contents of current packet
-					f->dOctets += dOctets;
-
-					if (startMs > f->startMs) {
-						// New flow starts later: modify duration
-						f->durationMs = endMs - f->startMs;
-					} else {
-						// New flow starts earlier
-						f->durationMs = (f->startMs + f->durationMs) - startMs;
-						// Set flow start to earlierflow start
-						flowlist[j].startMs = startMs;
-					}
-
-					f->dPkts += dPkts;
-					if ((f->flowtype != flowtype) && (f->flowtype != biflow)) {
-						// New packet has opposite direction to earlier packets
-						// Make it a biflow
-						f->flowtype = biflow;
-					}
-
-				} else { // Not found
-					// Make an initial entry into flowlist
-					flowlist[j].localIP = localIP;
-					flowlist[j].remoteIP = remoteIP;
-					flowlist[j].localPort = localPort;
-					flowlist[j].remotePort = remotePort;
-					flowlist[j].flowtype = flowtype;
-					flowlist[j].prot = prot;
-					flowlist[j].dOctets = dOctets;
-					flowlist[j].startMs = startMs;
-					flowlist[j].durationMs = endMs - startMs;
-					flowlist[j].dPkts = dPkts;
-					flowlist[j].localAS = 0;
-					flowlist[j].remoteAS = 0;
-					flowlist[j].tos_flags = tos_flags;
-					flowlist[j].magic = 1;
-
-					// Store 5-tuple together with reference to flow record in flow list
-					(*flowHM)[mykey] = &flowlist[j];
-					j++;
-					if (j >= maxnum_flows) {
-						string errtext = "INFO: terminating file reading due to full flow list.\n";
-						errtext += maxnum_flows;
-						errtext += " is the configured import limit.\n";
-						cerr << errtext;
-						throw errtext;
-					}
-				}
-
-				// Update statistics
-				UpdateStat(&stat_record, master_record);
-
-				// Update global time span window
-				if (master_record->first < (uint32_t) t_first_flow)
-					t_first_flow = master_record->first;
-				if (master_record->last > (uint32_t) t_last_flow)
-					t_last_flow = master_record->last;
-
-				// update number of flows matching a given map
-				extension_map_list.slot[map_id]->ref_count++;
-
-			} else if (flow_record->type == ExtensionMapType) {
-				extension_map_t *map = (extension_map_t *) flow_record;
-
-				Insert_Extension_Map(&extension_map_list, map);
-
-			} else {
-				fprintf(stderr, "Skip unknown record type %i\n", flow_record->type);
+	// Read a batch of blocks, decompress them and transform the records into cflow_t format in parallel,
+	// then aggregate them into the flowlist in file order. The next blocks are read by the reader thread meanwhile.
+	try {
+		unsigned int workers = util::getWorkerCount();
+		vector<nfdump_block> batch(workers * NFDUMP_BLOCKS_PER_WORKER);
+		CNfdumpBlockReader reader(rfd, batch.size() + NFDUMP_READ_AHEAD);
+		CNfdumpDecompressTask decompressTask(batch, flags);
+		CNfdumpExpandTask expandTask(batch, local_net, netmask);
+		bool done = false;
+		while (!done) {
+			unsigned int count = 0;
+			while (count < batch.size() && (batch[count].raw = reader.next_block(batch[count].header)) != NULL)
+				count++;
+			done = (count < batch.size());
+			if (count == 0)
+				break;
+
+			try {
+				util::runParallel(decompressTask, count, workers);
+				for (unsigned int i = 0; i < count; i++)
+					assign_extension_maps(batch[i], extension_map_list);
+				util::runParallel(expandTask, count, workers);
+			} catch (...) {
+				for (unsigned int i = 0; i < count; i++)
+					reader.release_block(batch[i].raw);
+				throw;
 			}
 
-			// Advance pointer by number of bytes for netflow record
-			flow_record = (common_record_t *) ((pointer_addr_t) flow_record + flow_record->size);
-
-		} // for all records
-	} // while
+			for (unsigned int i = 0; i < count; i++) {
+				reader.release_block(batch[i].raw);
+				total_flows += batch[i].flows.size();
+				if (!batch[i].flows.empty())
+					assembler.add_flows(&batch[i].flows[0], batch[i].flows.size());
+				batch[i].flows.clear();
+			}
+		}
 
-	if (rfd > 0)
+		if (!reader.getError().empty())
+			cerr << in_filename << ": " << reader.getError() << "\n";
+		cout << "Read " << reader.getTotalBytes() << " bytes of nfdump data blocks.\n";
+	} catch (...) {
 		close(rfd);
+		FreeExtensionMaps(&extension_map_list);
+		throw;
+	}
 
-	PackExtensionMapList(&extension_map_list);
-
-	free((void *) in_buff);
+	close(rfd);
+	FreeExtensionMaps(&extension_map_list);
+	assembler.flush();
 
-	flowlist.resize(j);
-	if(j == 0)
-		throw "This looks like a compressed nfdump file which we can not handle";
+	if (flowlist.size() == first_flow)
+		throw "This looks like an empty or unsupported nfdump file";
 
-	cout << "*** Processed " << total_flows << " nfdump flows to " << flowlist.size() << " final flows.\n";
+	cout << "*** Processed " << total_flows << " nfdump flows to " << (flowlist.size() - first_flow) << " final flows.\n";
 }
 
 /**
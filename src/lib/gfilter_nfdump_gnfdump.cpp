@@ -355,8 +355,6 @@ void PackExtensionMapList(extension_map_list_t *extension_map_list) {
 
 // *** Code from nffile.c *********************************************************
 
-#define BUFFSIZE 1048576
-
 /* global vars */
 
 char *CurrentIdent;
@@ -367,6 +365,8 @@ static stat_record_t NetflowStat;
 
 #define ERR_SIZE 256
 static char error_string[ERR_SIZE];
+// ReadBlock() is called by the reader threads of concurrent imports: each thread reports into a buffer of its own
+static __thread char read_error_string[ERR_SIZE];
 
 static void ZeroStat() {
 
@@ -495,9 +495,9 @@ int ReadBlock(int rfd, data_block_header_t *block_header, void *read_buff, char
 
 	// Check for sane buffer size
 	if (block_header->size > BUFFSIZE) {
-		snprintf(error_string, ERR_SIZE, "Corrupt data file: Requested buffer size %u exceeds max. buffer size.\n", block_header->size);
-		error_string[ERR_SIZE - 1] = 0;
-		*err = error_string;
+		snprintf(read_error_string, ERR_SIZE, "Corrupt data file: Requested buffer size %u exceeds max. buffer size.\n", block_header->size);
+		read_error_string[ERR_SIZE - 1] = 0;
+		*err = read_error_string;
 		// this is most likely a corrupt file
 		return NF_CORRUPT;
 	}
@@ -511,9 +511,9 @@ int ReadBlock(int rfd, data_block_header_t *block_header, void *read_buff, char
 
 	if (ret == 0) {
 		// EOF not expected here - this should never happen, file may be corrupt
-		snprintf(error_string, ERR_SIZE, "Corrupt data file: Unexpected EOF while reading data block.\n");
-		error_string[ERR_SIZE - 1] = 0;
-		*err = error_string;
+		snprintf(read_error_string, ERR_SIZE, "Corrupt data file: Unexpected EOF while reading data block.\n");
+		read_error_string[ERR_SIZE - 1] = 0;
+		*err = read_error_string;
 		return NF_CORRUPT;
 	}
 
@@ -537,9 +537,9 @@ int ReadBlock(int rfd, data_block_header_t *block_header, void *read_buff, char
 
 		if (ret == 0) {
 			//  0: EOF   - not expected
-			snprintf(error_string, ERR_SIZE, "Corrupt data file: Unexpected EOF. Short read of data block.\n");
-			error_string[ERR_SIZE - 1] = 0;
-			*err = error_string;
+			snprintf(read_error_string, ERR_SIZE, "Corrupt data file: Unexpected EOF. Short read of data block.\n");
+			read_error_string[ERR_SIZE - 1] = 0;
+			*err = read_error_string;
 			return NF_CORRUPT;
 		}
 
@@ -557,6 +557,11 @@ int ReadBlock(int rfd, data_block_header_t *block_header, void *read_buff, char
 
 } // End of ReadBlock
 
+uint32_t GetFlags(void) {
+	return FileHeader.flags;
+
+} // End of GetFlags
+
 // *** Code from nffile_inline.c *********************************************************
 
 /*
@@ -79,6 +79,8 @@ typedef uint32_t pointer_addr_t;
 #define NF_ERROR		-1
 #define NF_CORRUPT	-2
 
+#define BUFFSIZE 1048576	// maximum size of a data block
+
 #define NF_DUMPFILE         "nfcapd.current"
 /*
  * nfdump binary file layout
@@ -105,6 +107,8 @@ typedef struct file_header_s {
 #define NUM_FLAGS		2
 #define FLAG_COMPRESSED 	0x1
 #define FLAG_EXTENDED_STATS 0x2
+#define FLAG_BZ2		0x8		// nfdump 1.6.x: blocks are compressed with bzip2
+#define FLAG_LZ4		0x10	// nfdump 1.6.x: blocks are compressed with LZ4
 	/*
 	 0x1 File is compressed with LZO1X-1 compression
 	 */
@@ -1385,6 +1389,8 @@ void UnCompressFile(char * filename);
 
 char *GetIdent(void);
 
+uint32_t GetFlags(void);
+
 int InitExportFile(char *filename, int compress, nffile_t *nffile);
 
 void ExpandRecord_v1(common_record_t *input_record, master_record_t *output_record);
@@ -6,28 +6,209 @@
  * 	files 'BSD.txt' and 'GPL.txt'. For a list of authors see file 'AUTHORS'.
  */
 
-#include <pcap++.h>	// C++ wrapper for libpcap
+#include <iostream>
 #include <string>
-#ifdef __linux__
-#include <linux/if_ether.h>	// Ethernet header, ethernet protocol types
-#else
-#include <netinet/if_ether.h>	// Ethernet header, ethernet protocol types
-#endif // __linux__
-#include <netinet/in_systm.h>
-#include <sys/socket.h>
-#include <net/if.h>
-#include <netinet/in.h>
-#include <netinet/ip.h>			// IPv4 header
-#include <netinet/ip6.h>		// IPv6 header
-#include <netinet/tcp.h>		// TCP header
-#include <netinet/udp.h>		// UDP header
+#include <algorithm>
+#include <cstring>
 #include <netinet/in.h>			// IP protocol types
 #include "gfilter_pcap.h"
+#include "gflowassembler.h"
+#include "gpcapreader.h"
 #include "cflow.h"
 
-using namespace pcappp;
 using namespace std;
 
+#define PCAP_BATCH 256 ///< Packets decoded per batch
+
+#define ETHERTYPE_IPV4 0x0800
+#define ETHERTYPE_ARP 0x0806
+#define ETHERTYPE_IPV6 0x86dd
+#define ETHERTYPE_VLAN 0x8100
+#define ETHERTYPE_QINQ 0x88a8
+#define ETHERTYPE_QINQ_OLD 0x9100
+#define ETHERTYPE_MPLS 0x8847
+#define ETHERTYPE_MPLS_MULTICAST 0x8848
+
+/**
+ *	\enum decode_result_t
+ *	\brief Outcome of decoding a packet
+ */
+enum decode_result_t {
+	DECODED_IP, DECODED_ARP, DECODED_OTHER, DECODED_MALFORMED
+};
+
+/**
+ *	\struct	decoded_packet
+ *	\brief	The fields of a packet relevant for flow assembling
+ */
+struct decoded_packet {
+	IPv6_addr srcIP; ///< Source address
+	IPv6_addr dstIP; ///< Destination address
+	uint16_t srcPort; ///< Source port (TCP/UDP only)
+	uint16_t dstPort; ///< Destination port (TCP/UDP only)
+	uint8_t prot; ///< Transport protocol
+	uint8_t tos; ///< IPv4 ToS or IPv6 traffic class
+	uint32_t layer3len; ///< Size of the packet on the wire, without the link layer headers
+};
+
+/**
+ *	Reads a 16 bit value in network byte order
+ *
+ *	\param p Position in the packet
+ *
+ *	\return Value
+ */
+static inline uint16_t read_be16(const unsigned char * p) {
+	return (p[0] << 8) | p[1];
+}
+
+/**
+ *	Guesses the ethertype of a raw IP packet from its version field
+ *
+ *	\param p Start of the IP header
+ *	\param end End of the captured data
+ *
+ *	\return ETHERTYPE_IPV4, ETHERTYPE_IPV6 or 0
+ */
+static inline uint16_t ip_ethertype(const unsigned char * p, const unsigned char * end) {
+	if (p >= end)
+		return 0;
+	switch (p[0] >> 4) {
+		case 4:
+			return ETHERTYPE_IPV4;
+		case 6:
+			return ETHERTYPE_IPV6;
+		default:
+			return 0;
+	}
+}
+
+/**
+ *	Decodes the link layer, any VLAN/QinQ tags and MPLS labels, the IP header and the TCP/UDP ports of a packet.
+ *
+ *	\param packet Packet to decode
+ *	\param decoded Receives the decoded fields (if DECODED_IP is returned)
+ *
+ *	\return Outcome
+ */
+static decode_result_t decode_packet(const pcap_packet & packet, decoded_packet & decoded) {
+	const unsigned char * p = packet.data;
+	const unsigned char * end = packet.data + packet.caplen;
+	uint16_t ethertype;
+
+	// Link layer
+	switch (packet.linktype) {
+		case LINKTYPE_ETHERNET:
+			if (end - p < 14)
+				return DECODED_MALFORMED;
+			ethertype = read_be16(p + 12);
+			p += 14;
+			break;
+		case LINKTYPE_LINUX_SLL:
+			if (end - p < 16)
+				return DECODED_MALFORMED;
+			ethertype = read_be16(p + 14);
+			p += 16;
+			break;
+		case LINKTYPE_NULL:
+			if (end - p < 4)
+				return DECODED_MALFORMED;
+			p += 4;
+			ethertype = ip_ethertype(p, end);
+			break;
+		case LINKTYPE_RAW:
+		case LINKTYPE_IPV4:
+		case LINKTYPE_IPV6:
+			ethertype = ip_ethertype(p, end);
+			break;
+		default:
+			return DECODED_OTHER;
+	}
+
+	// VLAN and QinQ tags
+	while (ethertype == ETHERTYPE_VLAN || ethertype == ETHERTYPE_QINQ || ethertype == ETHERTYPE_QINQ_OLD) {
+		if (end - p < 4)
+			return DECODED_MALFORMED;
+		ethertype = read_be16(p + 2);
+		p += 4;
+	}
+
+	// MPLS label stack
+	if (ethertype == ETHERTYPE_MPLS || ethertype == ETHERTYPE_MPLS_MULTICAST) {
+		bool bottom = false;
+		while (!bottom) {
+			if (end - p < 4)
+				return DECODED_MALFORMED;
+			bottom = (p[2] & 0x01) != 0;
+			p += 4;
+		}
+		ethertype = ip_ethertype(p, end);
+	}
+
+	if (ethertype == ETHERTYPE_ARP)
+		return DECODED_ARP;
+	if (ethertype != ETHERTYPE_IPV4 && ethertype != ETHERTYPE_IPV6)
+		return DECODED_OTHER;
+	uint32_t linklen = p - packet.data;
+	if (packet.len < linklen)
+		return DECODED_MALFORMED;
+	decoded.layer3len = packet.len - linklen;
+
+	// Network layer
+	const unsigned char * l4;
+	bool firstFragment = true;
+	if (ethertype == ETHERTYPE_IPV4) {
+		if (end - p < 20)
+			return DECODED_MALFORMED;
+		unsigned int ihl = (p[0] & 0x0f) * 4;
+		if (ihl < 20)
+			return DECODED_MALFORMED;
+		decoded.tos = p[1];
+		decoded.prot = p[9];
+		firstFragment = (read_be16(p + 6) & 0x1fff) == 0;
+		uint32_t addr;
+		memcpy(&addr, p + 12, 4);
+		decoded.srcIP = IPv6_addr(ntohl(addr));
+		memcpy(&addr, p + 16, 4);
+		decoded.dstIP = IPv6_addr(ntohl(addr));
+		l4 = p + ihl;
+	} else {
+		if (end - p < 40)
+			return DECODED_MALFORMED;
+		decoded.tos = ((p[0] & 0x0f) << 4) | (p[1] >> 4);
+		copy(p + 8, p + 24, decoded.srcIP.begin());
+		copy(p + 24, p + 40, decoded.dstIP.begin());
+		uint8_t next = p[6];
+		l4 = p + 40;
+		// Skip extension headers
+		while (end - l4 >= 8) {
+			if (next == IPPROTO_HOPOPTS || next == IPPROTO_ROUTING || next == IPPROTO_DSTOPTS) {
+				next = l4[0];
+				l4 += (l4[1] + 1) * 8;
+			} else if (next == IPPROTO_FRAGMENT) {
+				firstFragment = (read_be16(l4 + 2) & 0xfff8) == 0;
+				next = l4[0];
+				l4 += 8;
+			} else if (next == IPPROTO_AH) {
+				next = l4[0];
+				l4 += (l4[1] + 2) * 4;
+			} else {
+				break;
+			}
+		}
+		decoded.prot = next;
+	}
+
+	// Transport layer: ports are only in the first fragment and may be cut off by the snap length
+	decoded.srcPort = 0;
+	decoded.dstPort = 0;
+	if ((decoded.prot == IPPROTO_TCP || decoded.prot == IPPROTO_UDP) && firstFragment && end - l4 >= 4) {
+		decoded.srcPort = read_be16(l4);
+		decoded.dstPort = read_be16(l4 + 2);
+	}
+	return DECODED_IP;
+}
+
 /**
  *	Constructor
  *
@@ -41,399 +222,115 @@ GFilter_pcap::GFilter_pcap(std::string formatName, std::string humanReadablePatt
 }
 
 /**
- *	Read pcap data from file into memory-based temporary flow list.
+ *	Read pcap or pcapng data from file into memory-based temporary flow list.
  *	Assembles packets to flows.
  *	The temporary flow list is not yet sorted and uniflows are not yet qualified.
+ *	Flows are split by the idle and active timeouts of CFlowAssembler, thus the memory used for
+ *	assembling depends on the number of concurrent flows only. While this thread decodes the
+ *	packets, they are assembled by CShardedFlowAssembler in further threads.
+ *
+ *	The file is read by CPcapReader, which walks the mapped file in place. Packets are decoded in
+ *	batches; Ethernet, Linux cooked, raw IP and loopback captures are supported, including VLAN/QinQ
+ *	tags and MPLS label stacks.
  *
  *	\param in_filename Filename to read
  *	\param flowlist List to fill with the flows
  *	\param local_net Local network address
  *	\param netmask Network mask for local network address
- *	\param append Future flag to allow the import of more than one file (not yet used)
+ *	\param append If true, do not clear the flowlist, instead append the flows to the existing data
  *
  *	\exception std::string Errortext
  */
 void GFilter_pcap::read_file(std::string in_filename, CFlowList & flowlist, const IPv6_addr & local_net, const IPv6_addr & netmask, bool append) const {
-	// Allocate temp_flowlist
-	int maxnum_flows = 1000000; // We do not know in advance how many flows will be assembled FIXME: we could guess it from the filesize ?!
-	flowlist.clear();
-	flowlist.resize(maxnum_flows);
-
-	// Hash map for packet-to-flow assembling and biflow pairing
-	flowHashMap * flowHM = new flowHashMap();
-	flowHashMap::iterator iter;
-
-	int i = 0;
-	long pcount = 0; // Packet counter
-	long arp_packet_count = 0;
-	long other_packet_count = 0;
+	if (!append)
+		flowlist.clear();
 
 	// (1) Open file for packet reading
 	// ********************************
-	try {
-		PcapOffline pco(in_filename.c_str());
-
-		DataLink dl = pco.get_datalink();
-
-		if (true) {
-			// Get some general infos from file
-			string filename = pco.get_filename();
-			cout << "File name is: " << filename << endl;
+	CPcapReader reader(in_filename);
+	cout << "Reading " << (reader.isPcapng() ? "pcapng" : "pcap") << " file " << in_filename << endl;
+	cout << "Using local_net=" << local_net << " and netmask=" << netmask << endl;
 
-			int major = pco.get_major_version();
-			int minor = pco.get_minor_version();
-			cout << "Pcap file format used is version: " << major << "." << minor << endl;
+	// Packet-to-flow assembling and biflow pairing, spread over several threads. Only active
+	// flows are kept in the flow tables, expired flows are moved to flowlist.
+	CShardedFlowAssembler assembler(flowlist);
 
-			cout << "Using local_net=" << local_net << " and netmask=0x" << hex << netmask << dec << endl;
-
-			if (pco.is_swapped()) {
-				cout << "Capture data byte order differs from byte order used on this system.\n";
-			} else {
-				cout << "Capture data byte order complies with byte order used on this system.\n";
-			}
-
-			cout << "Data link code: " << dl.get_description() << endl;
-		}
-
-		if (dl.get_type() == DataLink::EN10MB) {
-			if (true)
-				cout << "INFO: data link type is standard Ethernet (10 MB up).\n";
-		} else {
-			string errtext = "ERROR: data link type is NOT Ethernet. Type code is: ";
-			errtext += dl.get_type();
-			errtext += " (not supported).\n";
-			cerr << errtext;
-			throw errtext;
-		}
-		if (true) {
-			unsigned int slen = pco.get_snaplen();
-			cout << "Snap length: " << slen << endl;
-		}
-
-		// (2) Process saved packets
-		// *************************
-		// Loop through pcap file by reading packet-by-packet.
-		// Assemble packets to a flowlist.
-		// Flowtype is correctly set to inflow/outflow or biflow.
-		// NOTE: uniflow qualification is done in step 3
-
-		Packet p;
-		while (pco.ok()) {
-			// Get next packet from file
-			if (!pco.next(p))
-				break; // Quit if no more packets avaliable
-			pcount++;
-
-			// Get packet length from header, but limit it to capture length
-			Packet::Length len = (p.get_length() > p.get_capture_length()) ? p.get_length() : p.get_capture_length();
-
-			if (len < sizeof(struct ethhdr)) { // Is packet too small?
-				string errtext = "Found malformed packet. Packet # ";
-				errtext += pcount;
-				errtext += ".\n";
-				cerr << errtext;
-				throw errtext;
+	long pcount = 0; // Packet counter
+	long arp_packet_count = 0;
+	long other_packet_count = 0;
+	long malformed_packet_count = 0;
+
+	// (2) Process saved packets
+	// *************************
+	// Loop through the file by reading batches of packets.
+	// Assemble packets to a flowlist.
+	// Flowtype is correctly set to inflow/outflow or biflow.
+	// NOTE: uniflow qualification is done in step 3
+	pcap_packet packets[PCAP_BATCH];
+	CFlowList batch;
+	batch.reserve(PCAP_BATCH);
+	decoded_packet decoded;
+	IPv6_addr mask(netmask);
+	unsigned int count;
+	while ((count = reader.next_batch(packets, PCAP_BATCH)) > 0) {
+		pcount += count;
+		batch.clear();
+		for (unsigned int i = 0; i < count; i++) {
+			switch (decode_packet(packets[i], decoded)) {
+				case DECODED_IP:
+					break;
+				case DECODED_ARP:
+					arp_packet_count++;
+					continue;
+				case DECODED_OTHER:
+					other_packet_count++;
+					continue;
+				default:
+					malformed_packet_count++;
+					continue;
 			}
 
-			Packet::Data const * pdata = p.get_data();
-
-			struct ethhdr * ether_hdr = (struct ethhdr *) pdata;
-
-			// Process packet header data: check if data link protocol is ethernet
-			if (ntohs(ether_hdr->h_proto) == ETH_P_IP) { // Check if IPv4 packet
-
-				// Process IPv4 packet
-				// -------------------
-
-				if (len < (sizeof(struct ethhdr) + sizeof(struct iphdr))) { // Is packet too small?
-					string errtext = "Found malformed packet. Packet # ";
-					errtext += pcount;
-					errtext += ".\n";
-					cerr << errtext;
-					throw errtext;
-				}
-				struct iphdr * ip_hdr = (struct iphdr *) (pdata + sizeof(struct ethhdr));
-
-				// Get protocol
-				uint8_t prot = ip_hdr->protocol;
-
-				// Get IP addresses
-				IPv6_addr srcIP = IPv6_addr(ntohl(ip_hdr->saddr));
-				IPv6_addr dstIP = IPv6_addr(ntohl(ip_hdr->daddr));
-
-				// Infer flow direction from known network/netmask values
-				flow_type_t flowtype = inflow;
-				IPv6_addr net(srcIP & netmask);
-				if (net == local_net)
-					flowtype = outflow;
-
-				{
-					string dir;
-					if (flowtype == outflow)
-						dir = "local";
-					else
-						dir = "remote";
-					cout << "Found " << dir << " address srcIP = " << srcIP << endl;
-				}
-
-				// Get ports and flags (if TCP)
-				uint16_t srcPort = 0, dstPort = 0;
-				struct tcphdr * tcp_hdr = NULL;
-				struct udphdr * udp_hdr = NULL;
-				uint8_t flags = 0;
-				if (prot == IPPROTO_TCP) {
-					tcp_hdr = (struct tcphdr *) (pdata + sizeof(struct ethhdr) + sizeof(struct iphdr));
-					srcPort = ntohs(tcp_hdr->source);
-					dstPort = ntohs(tcp_hdr->dest);
-					flags = *(((uint8_t *) &(tcp_hdr->ack_seq)) + 5);
-				} else if (prot == IPPROTO_UDP) {
-					udp_hdr = (struct udphdr *) (pdata + sizeof(struct ethhdr) + sizeof(struct iphdr));
-					srcPort = ntohs(udp_hdr->source);
-					dstPort = ntohs(udp_hdr->dest);
-				}
-
-				// Get start time (note: get_miliseconds() returns microsecs in libpcap++ V 0.0.2)
-				// NOTE: we do not round the microsecs here, but cut-off not needed digits;
-				// by this, an error of up to 1 ms may result which is acceptable for a ms-precision.
-				uint64_t startMs = (uint64_t) (p.get_miliseconds() / 1000);
-				startMs += 1000 * (uint64_t) (p.get_seconds());
-				// Get layer 3 byte count
-				long layer3len = p.get_length() - sizeof(struct ethhdr);
-				uint8_t ToS = ip_hdr->tos;
-
-				// Assign src/dst fields to appropriate local/remote fields
-				IPv6_addr localIP, remoteIP;
-				uint16_t localPort, remotePort;
-
-				// Biflow matching: revert src/dst such that biflows are formed
-				if (flowtype == outflow) {
-					localIP = srcIP;
-					remoteIP = dstIP;
-					localPort = srcPort;
-					remotePort = dstPort;
-				} else {
-					localIP = dstIP;
-					remoteIP = srcIP;
-					localPort = dstPort;
-					remotePort = srcPort;
-				}
-
-				// Check if packet belongs to a new flow or updates an existing flow
-
-				flowHashKey mykey(localIP, remoteIP, localPort, remotePort, prot);
-				iter = flowHM->find(mykey);
-
-				if (iter != flowHM->end()) {
-					// Found: update found flow with new packet's data
-					// Fetch reference to flow entry hash map
-					cflow_t * f = iter->second;
-					// Found: update flow by contents of current packet
-					f->dOctets += layer3len;
-					if (startMs > flowlist[i].startMs) {
-						// New packet starts later
-						f->durationMs = startMs - f->startMs;
-					} else {
-						// New packet starts earlier
-						f->durationMs = f->startMs - startMs;
-						// Set flow start to earlier packet start
-						flowlist[i].startMs = startMs;
-					}
-					f->dPkts++;
-					if ((f->flowtype != flowtype) && (f->flowtype != biflow)) {
-						// New packet has opposite direction to earlier packets
-						// Make it a biflow
-						f->flowtype = biflow;
-					}
-
-				} else { // Not found
-					// Make an initial entry into temp_flowlist
-					flowlist[i].localIP = localIP;
-					flowlist[i].remoteIP = remoteIP;
-					flowlist[i].localPort = localPort;
-					flowlist[i].remotePort = remotePort;
-					flowlist[i].flowtype = flowtype;
-					flowlist[i].prot = prot;
-					flowlist[i].dOctets = layer3len;
-					flowlist[i].startMs = startMs;
-					flowlist[i].durationMs = 0;
-					flowlist[i].dPkts = 1;
-					flowlist[i].localAS = 0;
-					flowlist[i].remoteAS = 0;
-					flowlist[i].tos_flags = ToS;
-					flowlist[i].magic = CFLOW_CURRENT_MAGIC_NUMBER;
-
-					// Store 5-tuple together with reference to flow record in flow list
-					(*flowHM)[mykey] = &flowlist[i];
-					i++;
-					if (i >= maxnum_flows) {
-						string errtext = "INFO: terminating file reading due to full flow list.\n";
-						errtext += maxnum_flows;
-						errtext += " is the configured import limit.\n";
-						cerr << errtext;
-						throw errtext;
-					}
-				}
-
-			} else if (ntohs(ether_hdr->h_proto) == ETH_P_IPV6) {
-				// Process IPv6 packet
-				// -------------------
-				if (len < (sizeof(struct ethhdr) + sizeof(struct ip6_hdr))) { // Is packet too small?
-					string errtext = "Found malformed packet. Packet # ";
-					errtext += pcount;
-					errtext += ".\n";
-					cerr << errtext;
-					throw errtext;
-				}
-				struct ip6_hdr * ip6_header = (struct ip6_hdr *) (pdata + sizeof(struct ethhdr));
-
-				// Get protocol
-				uint8_t prot = ip6_header->ip6_ctlun.ip6_un1.ip6_un1_nxt;
-
-				// Get IP addresses
-				IPv6_addr srcIP(ip6_header->ip6_src);
-				IPv6_addr dstIP(ip6_header->ip6_dst);
-
-				// Infer flow direction from known network/netmask values
-				flow_type_t flowtype = inflow;
-				IPv6_addr net(srcIP & netmask);
-				if (net == local_net)
-					flowtype = outflow;
-
-				{
-					string dir;
-					if (flowtype == outflow)
-						dir = "local";
-					else
-						dir = "remote";
-					cout << "Found " << dir << " address srcIPv6 = " << srcIP << endl;
-				}
-
-				// Get ports and flags (if TCP)
-				uint16_t srcPort = 0, dstPort = 0;
-				struct tcphdr * tcp_hdr = NULL;
-				struct udphdr * udp_hdr = NULL;
-				uint8_t flags = 0;
-				if (prot == IPPROTO_TCP) {
-					tcp_hdr = (struct tcphdr *) (pdata + sizeof(struct ethhdr) + sizeof(struct ip6_hdr));
-					srcPort = ntohs(tcp_hdr->source);
-					dstPort = ntohs(tcp_hdr->dest);
-					flags = *(((uint8_t *) &(tcp_hdr->ack_seq)) + 5);
-				} else if (prot == IPPROTO_UDP) {
-					udp_hdr = (struct udphdr *) (pdata + sizeof(struct ethhdr) + sizeof(struct ip6_hdr));
-					srcPort = ntohs(udp_hdr->source);
-					dstPort = ntohs(udp_hdr->dest);
-				}
-
-				// Get start time (note: get_miliseconds() returns microsecs in libpcap++ V 0.0.2)
-				// NOTE: we do not round the microsecs here, but cut-off not needed digits;
-				// by this, an error of up to 1 ms may result which is acceptable for a ms-precision.
-				uint64_t startMs = (uint64_t) (p.get_miliseconds() / 1000);
-				startMs += 1000 * (uint64_t) (p.get_seconds());
-				// Get layer 3 byte count
-				long layer3len = p.get_length() - sizeof(struct ethhdr);
-				uint8_t ToS = ip6_header->ip6_ctlun.ip6_un1.ip6_un1_hlim;
-
-				// Assign src/dst fields to appropriate local/remote fields
-				IPv6_addr localIP, remoteIP;
-				uint16_t localPort, remotePort;
-
-				// Biflow matching: revert src/dst such that biflows are formed
-				if (flowtype == outflow) {
-					localIP = srcIP;
-					remoteIP = dstIP;
-					localPort = srcPort;
-					remotePort = dstPort;
-				} else {
-					localIP = dstIP;
-					remoteIP = srcIP;
-					localPort = dstPort;
-					remotePort = srcPort;
-				}
-
-				// Check if packet belongs to a new flow or updates an existing flow
-
-				flowHashKey mykey(localIP, remoteIP, localPort, remotePort, prot);
-				iter = flowHM->find(mykey);
-
-				if (iter != flowHM->end()) {
-					// Found: update found flow with new packet's data
-					// Fetch reference to flow entry hash map
-					cflow_t * f = iter->second;
-					// Found: update flow by contents of current packet
-					f->dOctets += layer3len;
-					if (startMs > flowlist[i].startMs) {
-						// New packet starts later
-						f->durationMs = startMs - f->startMs;
-					} else {
-						// New packet starts earlier
-						f->durationMs = f->startMs - startMs;
-						// Set flow start to earlier packet start
-						flowlist[i].startMs = startMs;
-					}
-					f->dPkts++;
-					if ((f->flowtype != flowtype) && (f->flowtype != biflow)) {
-						// New packet has opposite direction to earlier packets
-						// Make it a biflow
-						f->flowtype = biflow;
-					}
-
-				} else { // Not found
-					// Make an initial entry into temp_flowlist
-					flowlist[i].localIP = localIP;
-					flowlist[i].remoteIP = remoteIP;
-					flowlist[i].localPort = localPort;
-					flowlist[i].remotePort = remotePort;
-					flowlist[i].flowtype = flowtype;
-					flowlist[i].prot = prot;
-					flowlist[i].dOctets = layer3len;
-					flowlist[i].startMs = startMs;
-					flowlist[i].durationMs = 0;
-					flowlist[i].dPkts = 1;
-					flowlist[i].localAS = 0;
-					flowlist[i].remoteAS = 0;
-					flowlist[i].tos_flags = ToS;
-					flowlist[i].magic = CFLOW_CURRENT_MAGIC_NUMBER;
-
-					// Store 5-tuple together with reference to flow record in flow list
-					(*flowHM)[mykey] = &flowlist[i];
-					i++;
-					if (i >= maxnum_flows) {
-						string errtext = "INFO: terminating file reading due to full flow list.\n";
-						errtext += maxnum_flows;
-						errtext += " is the configured import limit.\n";
-						cerr << errtext;
-						throw errtext;
-					}
-				}
+			// Infer flow direction from known network/netmask values.
+			// Biflow matching: revert src/dst such that biflows are formed
+			cflow_t packet;
+			if ((decoded.srcIP & mask) == local_net) {
+				packet.flowtype = outflow;
+				packet.localIP = decoded.srcIP;
+				packet.remoteIP = decoded.dstIP;
+				packet.localPort = decoded.srcPort;
+				packet.remotePort = decoded.dstPort;
 			} else {
-
-				// Handle all non-IPv4/IPv6 traffic
-				// ---------------------------
-				//
-				// Just update some statistics.
-				switch (ntohs(ether_hdr->h_proto)) {
-					case ETH_P_ARP:
-						arp_packet_count++;
-						break;
-					default:
-						other_packet_count++;
-				}
+				packet.flowtype = inflow;
+				packet.localIP = decoded.dstIP;
+				packet.remoteIP = decoded.srcIP;
+				packet.localPort = decoded.dstPort;
+				packet.remotePort = decoded.srcPort;
 			}
+			packet.prot = decoded.prot;
+			packet.startMs = packets[i].startMs;
+			packet.dOctets = decoded.layer3len;
+			packet.dPkts = 1;
+			packet.tos_flags = decoded.tos;
+			batch.push_back(packet);
 		}
-
-	} catch (PcapError & pcerror) {
-		cerr << "ERROR: " << pcerror.what() << endl;
-		throw pcerror.what();
-	} catch (...) {
-		throw "Error in CImport::read_pcap_file_raw()";
+		if (!batch.empty())
+			assembler.add_flows(&batch[0], batch.size());
 	}
 
-	flowlist.resize(i);
-	cout << "(ignored packets: " << arp_packet_count << " (ARP), " << other_packet_count << " (OTHER).\n";
+	assembler.flush();
+	if (reader.isTruncated())
+		cerr << "WARNING: " << in_filename << " ends within a packet record, the last packet was ignored.\n";
+	flow_assembler_stats stats = assembler.getStats();
+	cout << "Assembled " << pcount << " packets in " << assembler.getShardCount() << " thread(s), at most " << assembler.getPeakActiveFlows()
+	      << " concurrent flows.\n";
+	cout << "(flow table: " << stats.inserts << " inserts, " << stats.hits << " hits, " << stats.probes << " probes, " << stats.expired
+	      << " expired)\n";
+	cout << "(ignored packets: " << arp_packet_count << " (ARP), " << other_packet_count << " (OTHER), " << malformed_packet_count
+	      << " (MALFORMED).\n";
 }
 
 /**
- *	Decide if this filter supports this file, using the filename to decide
+ *	Decide if this filter supports this file, using the filename and the magic number to decide
  *
  *	\param in_filename Inputfilename
  *
@@ -441,5 +338,5 @@ void GFilter_pcap::read_file(std::string in_filename, CFlowList & flowlist, cons
  *
  */
 bool GFilter_pcap::acceptFileForReading(std::string in_filename) const {
-	return acceptFilename(in_filename);
+	return acceptFilename(in_filename) && CPcapReader::isPcapFile(in_filename);
 }
@@ -16,11 +16,11 @@
 
 /**
  *	\class	GFilter_pcap
- *	\brief	GFilter_pcap is an class which can import pcap files
+ *	\brief	GFilter_pcap is an class which can import pcap and pcapng files
  */
 class GFilter_pcap: public GFilter {
 	public:
-		GFilter_pcap(std::string name = "pcap", std::string simplePattern = "*.pcap", std::string regexPattern = "^.+\\.pcap$");
+		GFilter_pcap(std::string name = "pcap", std::string simplePattern = "*.pcap", std::string regexPattern = "^.+\\.pcap(ng)?$");
 		virtual void read_file(std::string in_filename, CFlowList & flowlist, const IPv6_addr & local_net, const IPv6_addr & netmask, bool append) const;
 		virtual bool acceptFileForReading(std::string in_filename) const;
 };
@@ -0,0 +1,516 @@
+/**
+ *	\file gfilter_text.cpp
+ *	\brief Filter to import flows from text files (mk_cflows formats and CSV with a header line)
+ *
+ * 	This file is subject to the terms and conditions defined in
+ * 	files 'BSD.txt' and 'GPL.txt'. For a list of authors see file 'AUTHORS'.
+ */
+
+#include "gfilter_text.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include <netinet/in.h>
+
+#include "gparallel.h"
+
+using namespace std;
+using util::text_token;
+
+#define TEXT_CHUNKS_PER_WORKER 4 ///< Chunks the file is cut into per worker thread (for load balancing)
+#define TEXT_MIN_CHUNK (256 * 1024) ///< Smallest chunk worth a thread of its own
+#define TEXT_SNIFF_LINES 64 ///< Lines looked at by acceptFileForReading() to find the first flow
+
+/**
+ *	\struct text_column_name
+ *	\brief Name of a column in a CSV header line
+ */
+struct text_column_name {
+	const char * name; ///< Lower case name
+	int field; ///< Field of GFilter_text
+};
+
+/**
+ *	\class	GFilter_text::CTextParseTask
+ *	\brief	Parses chunks of the mapped file, each consisting of complete lines
+ */
+class GFilter_text::CTextParseTask: public util::CParallelTask {
+	public:
+		CTextParseTask(const vector<pair<const char *, const char *> > & chunks, vector<CFlowList> & results, const vector<int> & layout) :
+			chunks(chunks), results(results), layout(layout) {
+		}
+
+		/**
+		 *	Parse all lines of a chunk
+		 *
+		 *	\param number Number of the chunk
+		 *
+		 *	\exception std::string Errortext
+		 */
+		virtual void run(unsigned int number) {
+			const char * pos = chunks[number].first;
+			const char * end = chunks[number].second;
+			CFlowList & flows = results[number];
+			while (pos < end) {
+				// memchr() scans a word or vector at a time, which is much faster than a loop over the characters
+				const char * eol = (const char *) memchr(pos, '\n', end - pos);
+				if (eol == NULL)
+					eol = end;
+				if (!skip_line(pos, eol)) {
+					cflow_t flow;
+					parse_line(pos, eol, layout, flow);
+					flows.push_back(flow);
+				}
+				pos = eol + 1;
+			}
+		}
+
+	private:
+		const vector<pair<const char *, const char *> > & chunks; ///< Begin and end of each chunk
+		vector<CFlowList> & results; ///< Flows, one list per chunk
+		const vector<int> & layout; ///< Field of each column
+};
+
+/**
+ *	Reads a fixed number of decimal digits
+ *
+ *	\param p First digit
+ *	\param n Number of digits
+ *	\param value Receives the value
+ *
+ *	\return False if a character is not a digit
+ */
+static inline bool read_digits(const char * p, unsigned int n, unsigned int & value) {
+	value = 0;
+	for (unsigned int i = 0; i < n; i++) {
+		unsigned int digit = (unsigned char) p[i] - '0';
+		if (digit > 9)
+			return false;
+		value = value * 10 + digit;
+	}
+	return true;
+}
+
+/**
+ *	Constructor
+ *
+ *	\param	formatName	Name of this format
+ *	\param	humanReadablePattern	A simple name pattern for files of this type, used by e.g. the GUI
+ *	\param	regexPattern	Regex pattern used internally
+ */
+GFilter_text::GFilter_text(std::string formatName, std::string humanReadablePattern, std::string regexPattern) :
+	GFilter(formatName, humanReadablePattern, regexPattern) {
+	// nothing to do here
+}
+
+/**
+ *	Cuts the next column off a line. Columns are separated by any amount of commas and blanks,
+ *	surrounding double quotes are removed.
+ *
+ *	\param pos Current position, advanced behind the column
+ *	\param end End of the line
+ *	\param token Receives the column
+ *
+ *	\return False if there are no more columns
+ */
+inline bool GFilter_text::next_column(const char * & pos, const char * end, text_token & token) {
+	while (pos < end && (*pos == ',' || *pos == ' ' || *pos == '\t' || *pos == '\r'))
+		pos++;
+	if (pos == end)
+		return false;
+	token.begin = pos;
+	while (pos < end && *pos != ',' && *pos != ' ' && *pos != '\t' && *pos != '\r')
+		pos++;
+	token.length = pos - token.begin;
+	if (token.length >= 2 && token.begin[0] == '"' && token.begin[token.length - 1] == '"') {
+		token.begin++;
+		token.length -= 2;
+	}
+	return true;
+}
+
+/**
+ *	Decides if a line does not contain a flow
+ *
+ *	\param line Start of the line
+ *	\param end End of the line (without newline)
+ *
+ *	\return True for empty lines and comments (starting with '#')
+ */
+inline bool GFilter_text::skip_line(const char * line, const char * end) {
+	while (line < end && (*line == ' ' || *line == '\t' || *line == '\r'))
+		line++;
+	return line == end || *line == '#';
+}
+
+/**
+ *	Determines the columns of the file from its first line (which is not skipped).
+ *
+ *	\param line Start of the line
+ *	\param end End of the line (without newline)
+ *	\param layout Receives the field of each column
+ *
+ *	\return True if the line is a header line, false if it contains a flow already
+ *
+ *	\exception std::string Errortext
+ */
+bool GFilter_text::detect_layout(const char * line, const char * end, vector<int> & layout) {
+	static const text_column_name names[] = { { "localip", LOCAL_IP }, { "localport", LOCAL_PORT }, { "remoteip", REMOTE_IP }, { "remoteport",
+	      REMOTE_PORT }, { "protocol", PROTOCOL }, { "prot", PROTOCOL }, { "proto", PROTOCOL }, { "direction", DIRECTION }, { "flowdirection",
+	      DIRECTION }, { "dir", DIRECTION }, { "bytes", BYTES }, { "octets", BYTES }, { "packets", PACKETS }, { "pkts", PACKETS }, { "start", START },
+	      { "startms", START_MS }, { "lengthms", LENGTH_MS }, { "durationms", LENGTH_MS }, { NULL, IGNORED } };
+
+	layout.clear();
+	const char * pos = line;
+	text_token token;
+	if (!next_column(pos, end, token))
+		throw string("text import: no columns found");
+
+	IPv6_addr ip;
+	if (util::parse_ip(token, ip)) {
+		// No header: the format type is given by the number of columns
+		unsigned int columns = 1;
+		while (next_column(pos, end, token))
+			columns++;
+		if (columns != 6 && columns != 8 && columns != 11) {
+			stringstream error_msg;
+			error_msg << "text import: lines with " << columns << " columns are not supported (expected 6, 8 or 11): " << string(line, end);
+			throw error_msg.str();
+		}
+		for (unsigned int i = 0; i < columns; i++)
+			layout.push_back(i);
+		return false;
+	}
+
+	// Header line: map the column names to fields
+	vector<bool> found(FIELD_COUNT, false);
+	do {
+		int field = IGNORED;
+		for (unsigned int i = 0; names[i].name != NULL; i++) {
+			if (util::token_equals(token, names[i].name)) {
+				field = names[i].field;
+				break;
+			}
+		}
+		if (field != IGNORED) {
+			if (found[field]) {
+				string errtext = "text import: column \"" + token.toString() + "\" appears twice in the header line";
+				throw errtext;
+			}
+			found[field] = true;
+		}
+		layout.push_back(field);
+	} while (next_column(pos, end, token));
+	for (int field = LOCAL_IP; field <= DIRECTION; field++) {
+		if (!found[field]) {
+			string errtext = "text import: header line lacks a mandatory column (localIP, localPort, remoteIP, remotePort, protocol, direction): "
+			      + string(line, end);
+			throw errtext;
+		}
+	}
+	return true;
+}
+
+/**
+ *	Parses a line into a flow
+ *
+ *	\param line Start of the line
+ *	\param end End of the line (without newline)
+ *	\param layout Field of each column
+ *	\param flow Flow to fill
+ *
+ *	\exception std::string Errortext
+ */
+void GFilter_text::parse_line(const char * line, const char * end, const vector<int> & layout, cflow_t & flow) {
+	const char * pos = line;
+	text_token token;
+	uint64_t value = 0;
+	uint64_t start = 0;
+	uint64_t startMs = 0;
+	// Flows without volume information count as a single packet (as mk_cflows does for type 1)
+	flow.dOctets = 1;
+	flow.dPkts = 1;
+	size_t column = 0;
+	for (; column < layout.size() && next_column(pos, end, token); column++) {
+		bool ok = true;
+		switch (layout[column]) {
+			case LOCAL_IP:
+				ok = util::parse_ip(token, flow.localIP);
+				break;
+			case REMOTE_IP:
+				ok = util::parse_ip(token, flow.remoteIP);
+				break;
+			case LOCAL_PORT:
+				ok = util::parse_uint(token, value) && value <= 0xffff;
+				flow.localPort = value;
+				break;
+			case REMOTE_PORT:
+				ok = util::parse_uint(token, value) && value <= 0xffff;
+				flow.remotePort = value;
+				break;
+			case PROTOCOL:
+				ok = parse_protocol(token, flow.prot);
+				break;
+			case DIRECTION:
+				ok = parse_direction(token, flow.flowtype);
+				break;
+			case BYTES:
+				ok = util::parse_uint(token, value);
+				flow.dOctets = value;
+				break;
+			case PACKETS:
+				ok = util::parse_uint(token, value) && value <= 0xffffffff;
+				flow.dPkts = value;
+				break;
+			case START:
+				ok = parse_start(token, start);
+				break;
+			case START_MS:
+				ok = util::parse_uint(token, startMs) && startMs < 1000;
+				break;
+			case LENGTH_MS:
+				ok = util::parse_uint(token, value) && value <= 0xffffffff;
+				flow.durationMs = value;
+				break;
+			default:
+				break; // column not used
+		}
+		if (!ok) {
+			stringstream error_msg;
+			error_msg << "text import: invalid value \"" << token.toString() << "\" in column " << (column + 1) << " of line: " << string(line, end);
+			throw error_msg.str();
+		}
+	}
+	if (column < layout.size()) {
+		string errtext = "text import: incomplete line: " + string(line, end);
+		throw errtext;
+	}
+	flow.startMs = start + startMs;
+}
+
+/**
+ *	Converts a protocol name or number
+ *
+ *	\param token Field
+ *	\param prot Receives the protocol number
+ *
+ *	\return False if the protocol is unknown
+ */
+bool GFilter_text::parse_protocol(const text_token & token, uint8_t & prot) {
+	if (util::token_equals(token, "tcp")) {
+		prot = IPPROTO_TCP;
+	} else if (util::token_equals(token, "udp")) {
+		prot = IPPROTO_UDP;
+	} else if (util::token_equals(token, "icmp")) {
+		prot = IPPROTO_ICMP;
+	} else {
+		uint64_t value;
+		if (!util::parse_uint(token, value) || value > 0xff)
+			return false;
+		prot = value;
+	}
+	return true;
+}
+
+/**
+ *	Converts a flow direction (in, out, bi, qin, qout) to a flow type
+ *
+ *	\param token Field
+ *	\param flowtype Receives the flow type (see flow_type_t)
+ *
+ *	\return False if the direction is unknown
+ */
+bool GFilter_text::parse_direction(const text_token & token, uint8_t & flowtype) {
+	if (util::token_equals(token, "in")) {
+		flowtype = inflow;
+	} else if (util::token_equals(token, "out")) {
+		flowtype = outflow;
+	} else if (util::token_equals(token, "bi")) {
+		flowtype = biflow;
+	} else if (util::token_equals(token, "qin")) {
+		flowtype = inflow | unibiflow;
+	} else if (util::token_equals(token, "qout")) {
+		flowtype = outflow | unibiflow;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+/**
+ *	Converts a start time, either a UTC date/time YYYYMMDD.hhmm or YYYYMMDD.hhmmss, or seconds since
+ *	the epoch with an optional fraction
+ *
+ *	\param token Field
+ *	\param ms Receives the milliseconds since the epoch
+ *
+ *	\return False if the field is not a valid time
+ */
+bool GFilter_text::parse_start(const text_token & token, uint64_t & ms) {
+	if ((token.length != 13 && token.length != 15) || token.begin[8] != '.')
+		return util::parse_seconds_ms(token, ms);
+
+	unsigned int year, month, day, hour, minute, second = 0;
+	const char * p = token.begin;
+	if (!read_digits(p, 4, year) || !read_digits(p + 4, 2, month) || !read_digits(p + 6, 2, day) || !read_digits(p + 9, 2, hour)
+	      || !read_digits(p + 11, 2, minute) || (token.length == 15 && !read_digits(p + 13, 2, second)))
+		return false;
+	if (year < 1970 || month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60)
+		return false;
+
+	// Days since the epoch of the proleptic Gregorian calendar (without calling the locale and
+	// time zone dependent mktime())
+	unsigned int y = (month <= 2) ? year - 1 : year;
+	unsigned int era = y / 400;
+	unsigned int yearOfEra = y - era * 400;
+	unsigned int dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+	unsigned int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+	uint64_t days = (uint64_t) era * 146097 + dayOfEra - 719468;
+
+	ms = (((days * 24 + hour) * 60 + minute) * 60 + second) * 1000;
+	return true;
+}
+
+/**
+ *	Read flows from a text file into memory-based temporary flow list.
+ *	The temporary flow list is not yet sorted and uniflows are not yet qualified.
+ *	Flows are taken as they are: local and remote side as well as the direction are defined by
+ *	the file, thus local_net and netmask are not used.
+ *
+ *	The file is mapped into memory and cut into chunks of complete lines, which are parsed on
+ *	all processors. The flows are appended to the flowlist in the order of the file.
+ *
+ *	\param in_filename Inputfilename
+ *	\param flowlist Reference to the flowlist
+ *	\param local_net Local network address
+ *	\param netmask Network mask for local network address
+ *	\param append If true, do not clear the flowlist, instead append the flows to the existing data
+ *
+ *	\exception std::string Errortext
+ */
+void GFilter_text::read_file(std::string in_filename, CFlowList & flowlist, const IPv6_addr & local_net, const IPv6_addr & netmask, bool append) const {
+	if (!append)
+		flowlist.clear();
+
+	int fd = open(in_filename.c_str(), O_RDONLY);
+	if (fd == -1) {
+		string errtext = "ERROR: could not open file \"" + in_filename + "\".";
+		throw errtext;
+	}
+	struct stat filestat;
+	if (fstat(fd, &filestat) == -1) {
+		close(fd);
+		string errtext = "ERROR: could not read file \"" + in_filename + "\".";
+		throw errtext;
+	}
+	size_t size = filestat.st_size;
+	if (size == 0) {
+		close(fd);
+		cout << "0 flows read from " << in_filename << endl;
+		return;
+	}
+	void * mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // the mapping stays valid
+	if (mapping == MAP_FAILED) {
+		string errtext = "ERROR: could not map file \"" + in_filename + "\" into memory.";
+		throw errtext;
+	}
+	madvise(mapping, size, MADV_SEQUENTIAL);
+	const char * data = (const char *) mapping;
+	const char * end = data + size;
+
+	try {
+		// (1) Find the first line which is not empty: it is either the header or tells the format type
+		vector<int> layout;
+		const char * body = data;
+		while (body < end) {
+			const char * eol = (const char *) memchr(body, '\n', end - body);
+			if (eol == NULL)
+				eol = end;
+			if (!skip_line(body, eol)) {
+				if (detect_layout(body, eol, layout))
+					body = eol + 1; // header line
+				break;
+			}
+			body = eol + 1;
+		}
+
+		// (2) Cut the rest into chunks of complete lines and parse them in parallel
+		unsigned int workers = util::getWorkerCount();
+		vector<pair<const char *, const char *> > chunks;
+		if (body < end) {
+			size_t chunk_size = (end - body) / (workers * TEXT_CHUNKS_PER_WORKER) + 1;
+			if (chunk_size < TEXT_MIN_CHUNK)
+				chunk_size = TEXT_MIN_CHUNK;
+			const char * pos = body;
+			while (pos < end) {
+				const char * cut = end;
+				if ((size_t) (end - pos) > chunk_size) {
+					cut = (const char *) memchr(pos + chunk_size, '\n', end - pos - chunk_size);
+					cut = (cut == NULL) ? end : cut + 1;
+				}
+				chunks.push_back(make_pair(pos, cut));
+				pos = cut;
+			}
+		}
+		vector<CFlowList> results(chunks.size());
+		CTextParseTask task(chunks, results, layout);
+		util::runParallel(task, chunks.size(), workers);
+
+		// (3) Collect the flows
+		size_t count = 0;
+		for (unsigned int i = 0; i < results.size(); i++)
+			count += results[i].size();
+		flowlist.reserve(flowlist.size() + count);
+		for (unsigned int i = 0; i < results.size(); i++) {
+			flowlist.insert(flowlist.end(), results[i].begin(), results[i].end());
+			CFlowList().swap(results[i]);
+		}
+		cout << count << " flows read from " << in_filename << " (" << chunks.size() << " chunks)" << endl;
+	} catch (...) {
+		munmap(mapping, size);
+		throw;
+	}
+	munmap(mapping, size);
+}
+
+/**
+ *	Decide if this filter supports this file: the name must match and the first line which is not
+ *	empty must be a valid header line or flow.
+ *
+ *	\param in_filename Inputfilename
+ *
+ *	\return True if the file is supported by this filter
+ */
+bool GFilter_text::acceptFileForReading(std::string in_filename) const {
+	if (!acceptFilename(in_filename))
+		return false;
+	ifstream infs(in_filename.c_str());
+	if (!infs.is_open())
+		return false;
+	string line;
+	for (unsigned int i = 0; i < TEXT_SNIFF_LINES && getline(infs, line); i++) {
+		const char * begin = line.data();
+		const char * end = begin + line.size();
+		if (skip_line(begin, end))
+			continue;
+		try {
+			vector<int> layout;
+			if (!detect_layout(begin, end, layout)) {
+				cflow_t flow;
+				parse_line(begin, end, layout, flow);
+			}
+		} catch (string & e) {
+			return false;
+		}
+		return true;
+	}
+	return infs.eof(); // an empty file is fine, too
+}
@@ -0,0 +1,68 @@
+#ifndef GFILTER_TEXT_H_
+#define GFILTER_TEXT_H_
+
+/**
+ *	\file gfilter_text.h
+ *	\brief Filter to import flows from text files (mk_cflows formats and CSV with a header line)
+ *
+ * 	This file is subject to the terms and conditions defined in
+ * 	files 'BSD.txt' and 'GPL.txt'. For a list of authors see file 'AUTHORS'.
+ */
+#include <string>
+#include <vector>
+
+#include "gfilter.h"
+#include "gtextparse.h"
+
+/**
+ *	\class	GFilter_text
+ *	\brief	GFilter_text is an class which can import flows from text files
+ *
+ *	Every line describes one flow, fields are separated by commas and/or blanks. Without a header
+ *	line, the format types of mk_cflows are recognized by the number of fields:
+ *	- type 1: localIP, localPort, remoteIP, remotePort, protocol, direction
+ *	- type 2: as type 1, followed by bytes, packets
+ *	- type 3: as type 2, followed by start, startms, lengthms
+ *
+ *	Alternatively the first line names the columns (CSV header), using the names above (case
+ *	insensitive); columns with other names are ignored. The columns of type 1 are mandatory.
+ *
+ *	protocol is one of udp, tcp, icmp or a protocol number, direction one of in, out, bi, qin, qout.
+ *	start is either a UTC date/time YYYYMMDD.hhmm[ss] or seconds since the epoch (with optional
+ *	fraction). Empty lines and lines starting with '#' are skipped.
+ */
+class GFilter_text: public GFilter {
+	public:
+		GFilter_text(std::string formatName = "text", std::string humanReadablePattern = "*.txt", std::string regexPattern = "^.+\\.(txt|csv)$");
+		virtual void read_file(std::string in_filename, CFlowList & flowlist, const IPv6_addr & local_net, const IPv6_addr & netmask, bool append) const;
+		virtual bool acceptFileForReading(std::string in_filename) const;
+
+	private:
+		class CTextParseTask;
+
+		enum TEXT_FIELDS {
+			IGNORED = -1,
+			LOCAL_IP = 0,
+			LOCAL_PORT = 1,
+			REMOTE_IP = 2,
+			REMOTE_PORT = 3,
+			PROTOCOL = 4,
+			DIRECTION = 5,
+			BYTES = 6,
+			PACKETS = 7,
+			START = 8,
+			START_MS = 9,
+			LENGTH_MS = 10,
+			FIELD_COUNT = 11
+		};
+
+		static bool next_column(const char * & pos, const char * end, util::text_token & token);
+		static bool skip_line(const char * line, const char * end);
+		static bool detect_layout(const char * line, const char * end, std::vector<int> & layout);
+		static void parse_line(const char * line, const char * end, const std::vector<int> & layout, cflow_t & flow);
+		static bool parse_protocol(const util::text_token & token, uint8_t & prot);
+		static bool parse_direction(const util::text_token & token, uint8_t & flowtype);
+		static bool parse_start(const util::text_token & token, uint64_t & ms);
+};
+
+#endif /* GFILTER_TEXT_H_ */
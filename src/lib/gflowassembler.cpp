@@ -0,0 +1,535 @@
+/**
+ *	\file gflowassembler.cpp
+ *	\brief Assembles packets or flow fragments to flows, using NetFlow-style timeouts.
+ *
+ * 	This file is subject to the terms and conditions defined in
+ * 	files 'BSD.txt' and 'GPL.txt'. For a list of authors see file 'AUTHORS'.
+ */
+
+#include <exception>
+#include <algorithm>
+#include <cstring>
+
+#include "gflowassembler.h"
+#include "gparallel.h"
+#include "lookup3.h"
+
+using namespace std;
+
+/**
+ *	Constructor
+ *
+ *	\param flowlist List which receives the expired flows (flows are appended)
+ *	\param idleTimeoutMs Expire flows without traffic for this time (0: never)
+ *	\param activeTimeoutMs Expire flows which started this time ago (0: never)
+ */
+CFlowAssembler::CFlowAssembler(CFlowList & flowlist, uint64_t idleTimeoutMs, uint64_t activeTimeoutMs) :
+	flowlist(flowlist), activeFlows(0), idleTimeoutMs(idleTimeoutMs), activeTimeoutMs(activeTimeoutMs), now(0), lastSweep(0), peakActiveFlows(0) {
+	memset(&stats, 0, sizeof(stats));
+	clear();
+}
+
+/**
+ *	Hash of the 5-tuple of a flow
+ *
+ *	\param flow Flow
+ *
+ *	\return Hash value
+ */
+uint32_t CFlowAssembler::flow_hash(const cflow_t & flow) {
+	uint32_t hash = hashlittle(&flow.localIP[0], sizeof(IPv6_addr), ((uint32_t) flow.localPort << 16) | flow.remotePort);
+	return hashlittle(&flow.remoteIP[0], sizeof(IPv6_addr), hash + flow.prot);
+}
+
+/**
+ *	\return True if both flows have the same 5-tuple
+ */
+bool CFlowAssembler::same_tuple(const cflow_t & a, const cflow_t & b) {
+	return a.localPort == b.localPort && a.remotePort == b.remotePort && a.prot == b.prot && a.localIP == b.localIP && a.remoteIP == b.remoteIP;
+}
+
+/**
+ *	Decides if a flow has timed out
+ *
+ *	\param flow Active flow
+ *	\param now Current time
+ *
+ *	\return True if the flow has to be expired
+ */
+bool CFlowAssembler::is_expired(const cflow_t & flow, uint64_t now) const {
+	if (idleTimeoutMs > 0 && now > flow.startMs + flow.durationMs + idleTimeoutMs)
+		return true;
+	return activeTimeoutMs > 0 && now > flow.startMs + activeTimeoutMs;
+}
+
+/**
+ *	Moves all timed out flows from the flow table to the flowlist
+ *
+ *	\param now Current time
+ */
+void CFlowAssembler::expire_flows(uint64_t now) {
+	for (uint32_t entry = 0; entry < pool.size(); entry++) {
+		if (entryFree[entry] || !is_expired(pool[entry], now))
+			continue;
+		flowlist.push_back(pool[entry]);
+		remove_slot(find_slot(pool[entry], entryHash[entry]));
+		entryFree[entry] = true;
+		freeEntries.push_back(entry);
+		activeFlows--;
+		stats.expired++;
+	}
+	lastSweep = now;
+}
+
+/**
+ *	Searches the slot of a flow in the flow table
+ *
+ *	\param flow Flow
+ *	\param hash Hash of its 5-tuple
+ *
+ *	\return Slot holding the flow, or the empty slot where it would have to be inserted
+ */
+size_t CFlowAssembler::find_slot(const cflow_t & flow, uint32_t hash) {
+	size_t mask = slots.size() - 1;
+	size_t slot = hash & mask;
+	while (true) {
+		stats.probes++;
+		const flow_slot & s = slots[slot];
+		if (s.entry == FLOW_SLOT_EMPTY || (s.hash == hash && same_tuple(pool[s.entry], flow)))
+			return slot;
+		slot = (slot + 1) & mask;
+	}
+}
+
+/**
+ *	Empties a slot of the flow table. Following slots of the same probe sequence are moved
+ *	backwards, thus lookups never need to skip deleted slots.
+ *
+ *	\param slot Slot to empty
+ */
+void CFlowAssembler::remove_slot(size_t slot) {
+	size_t mask = slots.size() - 1;
+	size_t next = slot;
+	while (true) {
+		next = (next + 1) & mask;
+		if (slots[next].entry == FLOW_SLOT_EMPTY)
+			break;
+		// The entry in next may move to slot only if its home slot is not within (slot, next]
+		size_t home = slots[next].hash & mask;
+		bool between = (slot <= next) ? (slot < home && home <= next) : (slot < home || home <= next);
+		if (!between) {
+			slots[slot] = slots[next];
+			slot = next;
+		}
+	}
+	slots[slot].entry = FLOW_SLOT_EMPTY;
+}
+
+/**
+ *	Doubles the number of slots of the flow table
+ */
+void CFlowAssembler::grow() {
+	vector<flow_slot> old(slots.size() * 2);
+	old.swap(slots);
+	flow_slot empty = { 0, FLOW_SLOT_EMPTY };
+	fill(slots.begin(), slots.end(), empty);
+	size_t mask = slots.size() - 1;
+	for (vector<flow_slot>::const_iterator it = old.begin(); it != old.end(); it++) {
+		if (it->entry == FLOW_SLOT_EMPTY)
+			continue;
+		size_t slot = it->hash & mask;
+		while (slots[slot].entry != FLOW_SLOT_EMPTY)
+			slot = (slot + 1) & mask;
+		slots[slot] = *it;
+	}
+}
+
+/**
+ *	Empties the flow table and releases the flow records
+ */
+void CFlowAssembler::clear() {
+	flow_slot empty = { 0, FLOW_SLOT_EMPTY };
+	vector<flow_slot>(FLOW_TABLE_MIN_SLOTS, empty).swap(slots);
+	CFlowList().swap(pool);
+	vector<uint32_t>().swap(entryHash);
+	vector<bool>().swap(entryFree);
+	vector<uint32_t>().swap(freeEntries);
+	activeFlows = 0;
+}
+
+/**
+ *	Adds a packet or a flow fragment. A packet is passed as a flow with dPkts=1 and durationMs=0.
+ *	Its flowtype must be inflow or outflow (or biflow), with localIP and remoteIP assigned accordingly.
+ *
+ *	\param flow Packet or flow fragment
+ */
+void CFlowAssembler::add_flow(const cflow_t & flow) {
+	add_hashed_flow(flow, flow_hash(flow));
+}
+
+/**
+ *	Adds several packets or flow fragments, see add_flow(). The hashes of a batch of flows are
+ *	computed first and their slots are prefetched, such that the memory accesses overlap.
+ *
+ *	\param flows First packet or flow fragment
+ *	\param count Number of packets or flow fragments
+ */
+void CFlowAssembler::add_flows(const cflow_t * flows, size_t count) {
+	uint32_t hashes[FLOW_INSERT_BATCH];
+	for (size_t first = 0; first < count; first += FLOW_INSERT_BATCH) {
+		size_t n = (count - first < FLOW_INSERT_BATCH) ? count - first : FLOW_INSERT_BATCH;
+		size_t mask = slots.size() - 1;
+		for (size_t i = 0; i < n; i++) {
+			hashes[i] = flow_hash(flows[first + i]);
+			__builtin_prefetch(&slots[hashes[i] & mask]);
+		}
+		for (size_t i = 0; i < n; i++)
+			add_hashed_flow(flows[first + i], hashes[i]);
+	}
+}
+
+/**
+ *	Adds a packet or a flow fragment, see add_flow()
+ *
+ *	\param flow Packet or flow fragment
+ *	\param hash Hash of its 5-tuple
+ */
+void CFlowAssembler::add_hashed_flow(const cflow_t & flow, uint32_t hash) {
+	if (flow.startMs > now)
+		now = flow.startMs;
+	if ((idleTimeoutMs > 0 || activeTimeoutMs > 0) && now >= lastSweep + FLOW_SWEEP_INTERVAL_MS)
+		expire_flows(now);
+
+	size_t slot = find_slot(flow, hash);
+	if (slots[slot].entry == FLOW_SLOT_EMPTY) {
+		// New flow: take an unused flow record
+		uint32_t entry;
+		if (!freeEntries.empty()) {
+			entry = freeEntries.back();
+			freeEntries.pop_back();
+			pool[entry] = flow;
+			entryHash[entry] = hash;
+			entryFree[entry] = false;
+		} else {
+			entry = pool.size();
+			pool.push_back(flow);
+			entryHash.push_back(hash);
+			entryFree.push_back(false);
+		}
+		slots[slot].hash = hash;
+		slots[slot].entry = entry;
+		stats.inserts++;
+		if (++activeFlows > peakActiveFlows)
+			peakActiveFlows = activeFlows;
+		if (2 * activeFlows > slots.size())
+			grow();
+		return;
+	}
+
+	stats.hits++;
+	cflow_t & f = pool[slots[slot].entry];
+	if (is_expired(f, flow.startMs)) {
+		// Timed out, but not yet swept: start a new flow record
+		flowlist.push_back(f);
+		f = flow;
+		stats.expired++;
+		return;
+	}
+
+	// Update flow by contents of current packet
+	uint64_t endMs = f.startMs + f.durationMs;
+	if (flow.startMs + flow.durationMs > endMs)
+		endMs = flow.startMs + flow.durationMs;
+	if (flow.startMs < f.startMs)
+		f.startMs = flow.startMs; // new packet starts earlier
+	f.durationMs = endMs - f.startMs;
+	f.dOctets += flow.dOctets;
+	f.dPkts += flow.dPkts;
+	if ((f.flowtype != flow.flowtype) && (f.flowtype != biflow)) {
+		// New packet has opposite direction to earlier packets
+		// Make it a biflow
+		f.flowtype = biflow;
+	}
+}
+
+/**
+ *	Moves all remaining flows to the flowlist, e.g. at the end of the input
+ */
+void CFlowAssembler::flush() {
+	if (flowlist.empty() && freeEntries.empty()) {
+		flowlist.swap(pool);
+	} else {
+		flowlist.reserve(flowlist.size() + activeFlows);
+		for (uint32_t entry = 0; entry < pool.size(); entry++) {
+			if (!entryFree[entry])
+				flowlist.push_back(pool[entry]);
+		}
+	}
+	clear();
+}
+
+/**
+ *	\return Number of flows currently in the flow table
+ */
+size_t CFlowAssembler::getActiveFlows() const {
+	return activeFlows;
+}
+
+/**
+ *	\return Largest number of flows in the flow table so far
+ */
+size_t CFlowAssembler::getPeakActiveFlows() const {
+	return peakActiveFlows;
+}
+
+/**
+ *	\return Counters of inserted, merged and expired flows and of the probed slots
+ */
+const flow_assembler_stats & CFlowAssembler::getStats() const {
+	return stats;
+}
+
+/**
+ *	Constructor: starts the assembler threads
+ *
+ *	\param flowlist List which receives the assembled flows (flows are appended by flush())
+ *	\param shard_count Number of assembler threads (0: one less than util::getWorkerCount(), as the calling thread is busy as well)
+ *	\param idleTimeoutMs Expire flows without traffic for this time (0: never)
+ *	\param activeTimeoutMs Expire flows which started this time ago (0: never)
+ *
+ *	\exception std::string Errortext
+ */
+CShardedFlowAssembler::CShardedFlowAssembler(CFlowList & flowlist, unsigned int shard_count, uint64_t idleTimeoutMs, uint64_t activeTimeoutMs) :
+	flowlist(flowlist), assembler(NULL) {
+	if (shard_count == 0)
+		shard_count = util::getWorkerCount() - 1;
+	if (shard_count <= 1) {
+		assembler = new CFlowAssembler(flowlist, idleTimeoutMs, activeTimeoutMs);
+		return;
+	}
+
+	shards.resize(shard_count);
+	for (unsigned int i = 0; i < shards.size(); i++) {
+		shard & s = shards[i];
+		s.running = false;
+		s.done = false;
+		s.assembler = new CFlowAssembler(s.flows, idleTimeoutMs, activeTimeoutMs);
+		s.batch.reserve(FLOW_SHARD_BATCH);
+		pthread_mutex_init(&s.mutex, NULL);
+		pthread_cond_init(&s.not_empty, NULL);
+		pthread_cond_init(&s.not_full, NULL);
+	}
+	for (unsigned int i = 0; i < shards.size(); i++) {
+		if (pthread_create(&shards[i].thread, NULL, shard_worker, &shards[i]) != 0) {
+			// The destructor is not called for a failed constructor: shut down the started shards here
+			stop();
+			release_shards();
+			throw string("ERROR: could not start flow assembler thread");
+		}
+		shards[i].running = true;
+	}
+}
+
+/**
+ *	Destructor: stops the assembler threads (without delivering their flows, use flush() for this)
+ */
+CShardedFlowAssembler::~CShardedFlowAssembler() {
+	stop();
+	delete assembler;
+	release_shards();
+}
+
+/**
+ *	Frees the assemblers and synchronization objects of all shards. The threads must be stopped.
+ */
+void CShardedFlowAssembler::release_shards() {
+	for (unsigned int i = 0; i < shards.size(); i++) {
+		delete shards[i].assembler;
+		pthread_mutex_destroy(&shards[i].mutex);
+		pthread_cond_destroy(&shards[i].not_empty);
+		pthread_cond_destroy(&shards[i].not_full);
+	}
+	shards.clear();
+}
+
+/**
+ *	Assembler thread: assembles the batches of its shard until done is set and the queue is empty
+ *
+ *	\param arg Pointer to the shard
+ *
+ *	\return Always NULL
+ */
+void * CShardedFlowAssembler::shard_worker(void * arg) {
+	shard & s = *(shard *) arg;
+	vector<cflow_t> batch;
+	while (true) {
+		pthread_mutex_lock(&s.mutex);
+		while (s.queue.empty() && !s.done)
+			pthread_cond_wait(&s.not_empty, &s.mutex);
+		if (s.queue.empty()) {
+			pthread_mutex_unlock(&s.mutex);
+			break;
+		}
+		batch.swap(s.queue.front());
+		s.queue.pop_front();
+		pthread_cond_signal(&s.not_full);
+		pthread_mutex_unlock(&s.mutex);
+
+		if (!s.error.empty())
+			continue; // keep on taking batches, the calling thread must not block
+		try {
+			s.assembler->add_flows(&batch[0], batch.size());
+		} catch (std::exception & e) {
+			s.error = e.what();
+		} catch (...) {
+			s.error = "Unknown error in flow assembler thread";
+		}
+	}
+	return NULL;
+}
+
+/**
+ *	Hash of the 5-tuple of a flow which is the same for both directions
+ *
+ *	\param flow Flow
+ *
+ *	\return Hash value
+ */
+uint32_t CShardedFlowAssembler::shard_hash(const cflow_t & flow) {
+	uint32_t local = hashlittle(&flow.localIP[0], sizeof(IPv6_addr), flow.localPort);
+	uint32_t remote = hashlittle(&flow.remoteIP[0], sizeof(IPv6_addr), flow.remotePort);
+	return (local ^ remote) + flow.prot;
+}
+
+/**
+ *	Hands the current batch of a shard over to its thread. Blocks while the queue of the shard is full.
+ *
+ *	\param s Shard
+ */
+void CShardedFlowAssembler::push_batch(shard & s) {
+	pthread_mutex_lock(&s.mutex);
+	while (s.queue.size() >= FLOW_SHARD_QUEUE)
+		pthread_cond_wait(&s.not_full, &s.mutex);
+	s.queue.push_back(vector<cflow_t> ());
+	s.queue.back().swap(s.batch);
+	pthread_cond_signal(&s.not_empty);
+	pthread_mutex_unlock(&s.mutex);
+	s.batch.reserve(FLOW_SHARD_BATCH);
+}
+
+/**
+ *	Adds a packet or a flow fragment, see CFlowAssembler::add_flow()
+ *
+ *	\param flow Packet or flow fragment
+ */
+void CShardedFlowAssembler::add_flow(const cflow_t & flow) {
+	if (assembler != NULL) {
+		assembler->add_flow(flow);
+		return;
+	}
+	shard & s = shards[shard_hash(flow) % shards.size()];
+	s.batch.push_back(flow);
+	if (s.batch.size() >= FLOW_SHARD_BATCH)
+		push_batch(s);
+}
+
+/**
+ *	Adds several packets or flow fragments, see CFlowAssembler::add_flow()
+ *
+ *	\param flows First packet or flow fragment
+ *	\param count Number of packets or flow fragments
+ */
+void CShardedFlowAssembler::add_flows(const cflow_t * flows, size_t count) {
+	if (assembler != NULL) {
+		assembler->add_flows(flows, count);
+		return;
+	}
+	for (size_t i = 0; i < count; i++)
+		add_flow(flows[i]);
+}
+
+/**
+ *	Tells all assembler threads to finish their queues and waits for them
+ */
+void CShardedFlowAssembler::stop() {
+	for (unsigned int i = 0; i < shards.size(); i++) {
+		pthread_mutex_lock(&shards[i].mutex);
+		shards[i].done = true;
+		pthread_cond_signal(&shards[i].not_empty);
+		pthread_mutex_unlock(&shards[i].mutex);
+	}
+	for (unsigned int i = 0; i < shards.size(); i++) {
+		if (shards[i].running) {
+			pthread_join(shards[i].thread, NULL);
+			shards[i].running = false;
+		}
+	}
+}
+
+/**
+ *	Assembles all remaining packets and appends all flows of all shards to the flowlist.
+ *	No more flows may be added afterwards.
+ *
+ *	\exception std::string Errortext of a failed assembler thread
+ */
+void CShardedFlowAssembler::flush() {
+	if (assembler != NULL) {
+		assembler->flush();
+		return;
+	}
+	for (unsigned int i = 0; i < shards.size(); i++) {
+		if (!shards[i].batch.empty())
+			push_batch(shards[i]);
+	}
+	stop();
+
+	size_t count = flowlist.size();
+	for (unsigned int i = 0; i < shards.size(); i++) {
+		if (!shards[i].error.empty())
+			throw shards[i].error;
+		shards[i].assembler->flush();
+		count += shards[i].flows.size();
+	}
+	flowlist.reserve(count);
+	for (unsigned int i = 0; i < shards.size(); i++) {
+		flowlist.insert(flowlist.end(), shards[i].flows.begin(), shards[i].flows.end());
+		CFlowList().swap(shards[i].flows);
+	}
+}
+
+/**
+ *	\return Number of assembler threads (1 if assembling in the calling thread)
+ */
+unsigned int CShardedFlowAssembler::getShardCount() const {
+	return (assembler != NULL) ? 1 : shards.size();
+}
+
+/**
+ *	\return Sum of the largest flow table sizes of all shards
+ */
+size_t CShardedFlowAssembler::getPeakActiveFlows() const {
+	if (assembler != NULL)
+		return assembler->getPeakActiveFlows();
+	size_t peak = 0;
+	for (unsigned int i = 0; i < shards.size(); i++)
+		peak += shards[i].assembler->getPeakActiveFlows();
+	return peak;
+}
+
+/**
+ *	\return Counters of all shards added up
+ */
+flow_assembler_stats CShardedFlowAssembler::getStats() const {
+	if (assembler != NULL)
+		return assembler->getStats();
+	flow_assembler_stats total;
+	memset(&total, 0, sizeof(total));
+	for (unsigned int i = 0; i < shards.size(); i++) {
+		const flow_assembler_stats & s = shards[i].assembler->getStats();
+		total.inserts += s.inserts;
+		total.hits += s.hits;
+		total.probes += s.probes;
+		total.expired += s.expired;
+	}
+	return total;
+}
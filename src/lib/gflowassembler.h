@@ -0,0 +1,155 @@
+#ifndef GFLOWASSEMBLER_H_
+#define GFLOWASSEMBLER_H_
+
+/**
+ *	\file gflowassembler.h
+ *	\brief Assembles packets or flow fragments to flows, using NetFlow-style timeouts.
+ *
+ * 	This file is subject to the terms and conditions defined in
+ * 	files 'BSD.txt' and 'GPL.txt'. For a list of authors see file 'AUTHORS'.
+ */
+
+#include <stdint.h>
+#include <cstddef>
+#include <pthread.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "cflow.h"
+
+#define FLOW_IDLE_TIMEOUT_MS 15000 ///< Default: flows without traffic for 15 s are expired
+#define FLOW_ACTIVE_TIMEOUT_MS 1800000 ///< Default: flows running longer than 30 min are split
+#define FLOW_SWEEP_INTERVAL_MS 1000 ///< Time between two searches for idle flows
+#define FLOW_SHARD_BATCH 1024 ///< Packets handed over to an assembler thread at once
+#define FLOW_SHARD_QUEUE 8 ///< Maximum number of batches waiting per assembler thread
+#define FLOW_TABLE_MIN_SLOTS 1024 ///< Initial number of slots of the flow table (power of 2)
+#define FLOW_INSERT_BATCH 32 ///< Flows hashed and prefetched at once by CFlowAssembler::add_flows()
+
+/**
+ *	\struct flow_assembler_stats
+ *	\brief Counters of a CFlowAssembler
+ */
+struct flow_assembler_stats {
+		uint64_t inserts; ///< Flows which started a new flow record
+		uint64_t hits; ///< Flows merged into an active flow record
+		uint64_t probes; ///< Slots of the flow table inspected by lookups
+		uint64_t expired; ///< Flow records moved to the output by the timeouts
+};
+
+/**
+ *	\class CFlowAssembler
+ *	\brief Merges packets or flow fragments with the same 5-tuple [localIP, remoteIP, localPort, remotePort, protocol]
+ *
+ *	Only the active flows are kept in the flow table. A flow is expired into the output flowlist
+ *	when no traffic has been seen for idleTimeoutMs or when it started more than activeTimeoutMs
+ *	ago. Thus the memory used by the table depends on the number of concurrent flows, not on
+ *	the total number of flows. The time is taken from the added packets, which must be roughly
+ *	in chronological order. A timeout of 0 disables this timeout.
+ *
+ *	The flow table uses open addressing with linear probing: a slot holds the hash and the
+ *	number of a flow record only, the records themselves are kept in a pool. Records of
+ *	expired flows are reused. Without timeouts, the records are delivered in the order of
+ *	their first flow.
+ */
+class CFlowAssembler {
+	public:
+		CFlowAssembler(CFlowList & flowlist, uint64_t idleTimeoutMs = FLOW_IDLE_TIMEOUT_MS, uint64_t activeTimeoutMs = FLOW_ACTIVE_TIMEOUT_MS);
+
+		void add_flow(const cflow_t & flow);
+		void add_flows(const cflow_t * flows, size_t count);
+		void flush();
+		size_t getActiveFlows() const;
+		size_t getPeakActiveFlows() const;
+		const flow_assembler_stats & getStats() const;
+
+	private:
+		/**
+		 *	\struct flow_slot
+		 *	\brief Slot of the flow table
+		 */
+		struct flow_slot {
+				uint32_t hash; ///< Hash of the 5-tuple
+				uint32_t entry; ///< Index of the flow record in pool, FLOW_SLOT_EMPTY if unused
+		};
+
+		static const uint32_t FLOW_SLOT_EMPTY = 0xffffffff;
+
+		static uint32_t flow_hash(const cflow_t & flow);
+		static bool same_tuple(const cflow_t & a, const cflow_t & b);
+		bool is_expired(const cflow_t & flow, uint64_t now) const;
+		void expire_flows(uint64_t now);
+		void add_hashed_flow(const cflow_t & flow, uint32_t hash);
+		size_t find_slot(const cflow_t & flow, uint32_t hash);
+		void remove_slot(size_t slot);
+		void grow();
+		void clear();
+
+		CFlowList & flowlist; ///< Output: expired flows
+		std::vector<flow_slot> slots; ///< Flow table, the number of slots is a power of 2
+		CFlowList pool; ///< Flow records referenced by the flow table
+		std::vector<uint32_t> entryHash; ///< Hash of every flow record in pool
+		std::vector<bool> entryFree; ///< True for the unused flow records in pool
+		std::vector<uint32_t> freeEntries; ///< Unused flow records in pool
+		size_t activeFlows; ///< Number of flows in the flow table
+		uint64_t idleTimeoutMs; ///< Idle timeout (0: none)
+		uint64_t activeTimeoutMs; ///< Active timeout (0: none)
+		uint64_t now; ///< Latest start time seen so far
+		uint64_t lastSweep; ///< Time of the last search for expired flows
+		size_t peakActiveFlows; ///< Largest size of the flow table so far
+		flow_assembler_stats stats; ///< Counters
+};
+
+/**
+ *	\class CShardedFlowAssembler
+ *	\brief Spreads flow assembling over several threads
+ *
+ *	The packets are distributed over a number of shards by a hash of the 5-tuple which does not depend
+ *	on the direction, thus all packets of a flow end up in the same shard. Every shard is a CFlowAssembler
+ *	running in its own thread and fed with batches of packets by the calling thread. With a single shard,
+ *	the packets are assembled directly in the calling thread.
+ */
+class CShardedFlowAssembler {
+	public:
+		CShardedFlowAssembler(CFlowList & flowlist, unsigned int shard_count = 0, uint64_t idleTimeoutMs = FLOW_IDLE_TIMEOUT_MS,
+		      uint64_t activeTimeoutMs = FLOW_ACTIVE_TIMEOUT_MS);
+		~CShardedFlowAssembler();
+
+		void add_flow(const cflow_t & flow);
+		void add_flows(const cflow_t * flows, size_t count);
+		void flush();
+		unsigned int getShardCount() const;
+		size_t getPeakActiveFlows() const;
+		flow_assembler_stats getStats() const;
+
+	private:
+		/**
+		 *	\struct shard
+		 *	\brief Input queue, assembler and output of one assembler thread
+		 */
+		struct shard {
+				pthread_t thread; ///< Assembler thread
+				bool running; ///< True while the thread has not been joined
+				std::vector<cflow_t> batch; ///< Batch being filled by the calling thread
+				std::deque<std::vector<cflow_t> > queue; ///< Batches waiting for the assembler thread
+				bool done; ///< True when no more batches will be added
+				std::string error; ///< Errortext if the assembler thread failed
+				CFlowList flows; ///< Flows assembled by this shard
+				CFlowAssembler * assembler; ///< Assembler of this shard
+				pthread_mutex_t mutex; ///< Protects queue and done
+				pthread_cond_t not_empty; ///< Signaled when a batch was added or done was set
+				pthread_cond_t not_full; ///< Signaled when a batch was taken
+		};
+
+		static void * shard_worker(void * arg);
+		static uint32_t shard_hash(const cflow_t & flow);
+		void push_batch(shard & s);
+		void stop();
+		void release_shards();
+
+		CFlowList & flowlist; ///< Output: assembled flows
+		CFlowAssembler * assembler; ///< Used instead of threads if there is a single shard only
+		std::vector<shard> shards; ///< Assembler threads
+};
+
+#endif /* GFLOWASSEMBLER_H_ */
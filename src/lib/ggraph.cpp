@@ -382,7 +382,7 @@ void CGraphlet::add_single_flow(const cflow_t & pflow, int role_num, int flow_id
 	// remotePort -- remoteIP  (key5/entry5)
 
 	// Handle multi-connected remote hosts
-	struct CRoleMembership::sumnode_t * sn = proleMembership->get_summaryNode(pflow.remoteIP);
+	struct CRoleMembership::sumnode_t * sn = proleMembership->get_summaryNode(proleMembership->get_remote_id(flow_idx));
 	if (sn != NULL && sn->clients > 1) {
 		// Use summary identifier (a negative role number)
 		uint32_t sumid = sn->role_num;
@@ -571,10 +571,10 @@ void CGraphlet::add_generic_role(CRole::role_t & role, const CRole::role_t& pare
 			localEport = localEports[0];
 			// Update unique remote host list
 			uint32_t current_hostnum = 0;
-			graphletHashKey myHnumIpkey(0, (role.remoteIP)); // Use remoteIP as key only
+			graphletHashKey myHnumIpkey((uint64_t) 0, (uint64_t) role.remoteId); // Use remoteIP id as key only
 			iterHnumIp = hm_hnum_remoteIp->find(myHnumIpkey);
 			if (iterHnumIp == hm_hnum_remoteIp->end()) {
-				(*hm_hnum_remoteIp)[myHnumIpkey] = hNumRIpToEdge(hostnum, role.remoteIP);
+				(*hm_hnum_remoteIp)[myHnumIpkey] = hNumRIpToEdge(hostnum, proleMembership->get_ip_dictionary().get_ip(role.remoteId));
 				current_hostnum = hostnum++; // May wrap around
 			} else {
 				// Fetch current host number from hash map
@@ -638,7 +638,7 @@ void CGraphlet::add_generic_role(CRole::role_t & role, const CRole::role_t& pare
 	for (set<int>::iterator flow_id = flows.begin(); flow_id != flows.end(); flow_id++) {
 		const cflow_t* flow = &(flow_list[*flow_id]);
 		uint64_t remoteEport = remoteEports[remoteEport_id];
-		struct CRoleMembership::sumnode_t * sn = proleMembership->get_summaryNode(flow->remoteIP);
+		struct CRoleMembership::sumnode_t * sn = proleMembership->get_summaryNode(proleMembership->get_remote_id(*flow_id));
 		if (rport_rip_association == gpa_1_n) {
 			if (sn != NULL && sn->clients >= 1) {
 				// Use summary identifier (a negative role number)
@@ -717,7 +717,7 @@ void CGraphlet::add_generic_role(CRole::role_t & role, const CRole::role_t& pare
 		} else { // must be gpa_n_1 or gpa_n_n
 			remoteEport = remoteEports[0];
 			int client_count = role.rIP_set->size();
-			for (set<IPv6_addr>::const_iterator it = role.rIP_set->begin(); (rport_rip_association == gpa_n_n) && (it != role.rIP_set->end()); it++) {
+			for (set<CIpDictionary::ipId>::const_iterator it = role.rIP_set->begin(); (rport_rip_association == gpa_n_n) && (it != role.rIP_set->end()); it++) {
 				struct CRoleMembership::sumnode_t * sn = proleMembership->get_summaryNode(*it);
 				if (sn != NULL) {
 					client_count--;
@@ -731,7 +731,7 @@ void CGraphlet::add_generic_role(CRole::role_t & role, const CRole::role_t& pare
 					} else {
 						iterEportIp = hm_remotePort_remoteIp_n1->find(myEportIpkey);
 						if (iterEportIp == hm_remotePort_remoteIp_n1->end()) {
-							(*hm_remotePort_remoteIp_n1)[myEportIpkey] = ePortIpToEdge(remoteEport, *it);
+							(*hm_remotePort_remoteIp_n1)[myEportIpkey] = ePortIpToEdge(remoteEport, proleMembership->get_ip_dictionary().get_ip(*it));
 						}
 					}
 					if (!rip_sum_node_created) {
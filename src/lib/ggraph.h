@@ -54,20 +54,20 @@ class CGraphlet {
 		// key = 5-tuple {srcIP, dstIP, srcPort, dstPort, protocol}
 		// data = references to flowlist records
 		//
-		typedef HashKeyIPv6_5T flowHashKey;
-		typedef hash_map<HashKeyIPv6_5T, cflow_t *, HashFunction<HashKeyIPv6_5T> , HashFunction<HashKeyIPv6_5T> > flowHashMap;
+		typedef CKeyIP_5T flowHashKey;
+		typedef flat_hash_map<CKeyIP_5T, cflow_t *, KeyHashFunction<CKeyIP_5T> , KeyHashFunction<CKeyIP_5T> > flowHashMap;
 
 		// For lookup of all traffic between a host pair: to identify unibiflow property
 		// key = 2-tuple {IP1, IP2}
 		// data = sample id
 		//
-		typedef HashKeyIPv6Pair FlowHashKeyHostPair;
-		typedef hash_map<HashKeyIPv6Pair, int, HashFunction<HashKeyIPv6Pair> , HashFunction<HashKeyIPv6Pair> > FlowHashMapHostPair;
+		typedef CKeyIPPair FlowHashKeyHostPair;
+		typedef flat_hash_map<CKeyIPPair, int, KeyHashFunction<CKeyIPPair> , KeyHashFunction<CKeyIPPair> > FlowHashMapHostPair;
 
 		// For a list of hosts
 		//	key = IP address
 		// data = (?)
-		typedef hash_map<HashKeyIPv6, int, HashFunction<HashKeyIPv6> , HashFunction<HashKeyIPv6> > FlowHashMapHost;
+		typedef flat_hash_map<CKeyIP, int, KeyHashFunction<CKeyIP> , KeyHashFunction<CKeyIP> > FlowHashMapHost;
 
 		// Hash keys & maps for graphlet inference
 		// ***************************************
@@ -113,7 +113,7 @@ class CGraphlet {
 		// key3 = { - , Ip }
 		// key4 = { Eport, Eport }
 		// key5 = { Eport, Ip }
-		typedef CHashKey6_6 graphletHashKey;
+		typedef CKey6_6 graphletHashKey;
 		//typedef boost::array<char, 32> HashMapEdge;
 
 		// Entries describe edges in a unique way.
@@ -149,7 +149,7 @@ class CGraphlet {
 				void addBytesPackets(const HashMapEdge fp2);
 		};
 
-		typedef hash_map<graphletHashKey, HashMapEdge, HashFunction<graphletHashKey> , HashFunction<graphletHashKey> > graphletHashMap;
+		typedef flat_hash_map<graphletHashKey, HashMapEdge, KeyHashFunction<graphletHashKey> , KeyHashFunction<graphletHashKey> > graphletHashMap;
 
 		// *** Use individual hash maps for each rank type
 
@@ -179,7 +179,7 @@ class CGraphlet {
 		// with exactly one remote host. To save space we do not identify remote host by its IP address,
 		// but with a consecutively allocated host number (host code).
 		// -> store unique remote Ips together with a host code (starting at 0; up to (2**14)-1)
-		graphletHashMap * hm_hnum_remoteIp; // Auxiliary hash map for unique remote host numbers
+		graphletHashMap * hm_hnum_remoteIp; // Auxiliary hash map for unique remote host numbers (key: remoteIP id)
 
 		// Each remote port per protocol is associated with exactly one remoteIp.
 		graphletHashMap * hm_remotePort_remoteIp_11; // remotePort--remoteIP
@@ -0,0 +1,149 @@
+/**
+ *	\file ghostdirectory.cpp
+ *	\brief Directory of the local hosts of a sorted flowlist.
+ *
+ * 	This file is subject to the terms and conditions defined in
+ * 	files 'BSD.txt' and 'GPL.txt'. For a list of authors see file 'AUTHORS'.
+ */
+
+#include <algorithm>
+#include <bitset>
+
+#include "ghostdirectory.h"
+
+using namespace std;
+
+/**
+ *	Orders hosts by their address, and hosts against addresses
+ */
+struct host_ip_less {
+		bool operator()(const ChostMetadata & host, const IPv6_addr & IP) const {
+			return host.IP < IP;
+		}
+		bool operator()(const IPv6_addr & IP, const ChostMetadata & host) const {
+			return IP < host.IP;
+		}
+};
+
+/**
+ *	Orders flow indices against the first flow of hosts
+ */
+struct host_flow_less {
+		bool operator()(size_t flow, const ChostMetadata & host) const {
+			return flow < host.index;
+		}
+};
+
+/**
+ *	Default constructor
+ */
+ChostMetadata::ChostMetadata() {
+	IP = IPv6_addr();
+	flow_count = 0;
+	prot_count = 0;
+	packet_count = 0;
+	index = 0;
+	bytesForAllFlows = 0;
+}
+
+const size_t CHostDirectory::npos;
+
+CHostDirectory::CHostDirectory() :
+	sorted(true) {
+}
+
+/**
+ *	Replace the directory by the hosts of a flowlist in a single pass.
+ *
+ *	\param begin First flow of the flowlist (ChostMetadata::index counts from here)
+ *	\param end End of the flowlist
+ */
+void CHostDirectory::build(CFlowList::const_iterator begin, CFlowList::const_iterator end) {
+	clear();
+	bitset<256> protocols;
+	for (CFlowList::const_iterator it = begin; it != end; ++it) {
+		if (hosts.empty() || it->localIP != hosts.back().IP) {
+			if (!hosts.empty() && !(hosts.back().IP < it->localIP))
+				sorted = false;
+			ChostMetadata host;
+			host.IP = it->localIP;
+			host.graphlet_number = hosts.size();
+			host.uniflow_count = 0;
+			host.index = it - begin;
+			hosts.push_back(host);
+			protocols.reset();
+		}
+		ChostMetadata & host = hosts.back();
+		host.flow_count++;
+		if (it->flowtype & uniflow)
+			host.uniflow_count++;
+		host.packet_count += it->dPkts;
+		host.bytesForAllFlows += it->dOctets;
+		protocols.set(it->prot);
+		host.prot_count = protocols.count();
+	}
+}
+
+/**
+ *	Remove all hosts.
+ */
+void CHostDirectory::clear() {
+	hosts.clear();
+	sorted = true;
+}
+
+/**
+ *	\param IP Address of a local host
+ *	\return Graphlet number of IP, npos if there are no flows of IP
+ */
+size_t CHostDirectory::find(const IPv6_addr & IP) const {
+	if (!sorted) {
+		for (size_t i = 0; i < hosts.size(); i++) {
+			if (hosts[i].IP == IP)
+				return i;
+		}
+		return npos;
+	}
+	size_t i = rank(IP);
+	return (i < hosts.size() && hosts[i].IP == IP) ? i : npos;
+}
+
+/**
+ *	\param IP Address
+ *	\return Number of hosts with an address less than IP, i.e. the graphlet number IP has or would have
+ *
+ *	\pre The flowlist passed to build() was sorted by localIP
+ */
+size_t CHostDirectory::rank(const IPv6_addr & IP) const {
+	return lower_bound(hosts.begin(), hosts.end(), IP, host_ip_less()) - hosts.begin();
+}
+
+/**
+ *	\param flow Index of a flow of the flowlist passed to build()
+ *	\return Graphlet number of the host the flow belongs to, npos if flow is out of range
+ */
+size_t CHostDirectory::find_flow(size_t flow) const {
+	if (hosts.empty() || flow >= flow_end(hosts.size() - 1))
+		return npos;
+	return (upper_bound(hosts.begin(), hosts.end(), flow, host_flow_less()) - hosts.begin()) - 1;
+}
+
+/**
+ *	Get the hosts of a network.
+ *
+ *	\param net Network address
+ *	\param netmask Network mask
+ *	\param first Receives the graphlet number of the first host of the network
+ *	\param last Receives the graphlet number after the last host of the network (first == last if there is none)
+ *
+ *	\pre The flowlist passed to build() was sorted by localIP
+ */
+void CHostDirectory::find_prefix(const IPv6_addr & net, const IPv6_addr & netmask, size_t & first, size_t & last) const {
+	IPv6_addr lowest, highest;
+	for (unsigned int i = 0; i < sizeof(IPv6_addr); i++) {
+		lowest[i] = net[i] & netmask[i];
+		highest[i] = net[i] | ~netmask[i];
+	}
+	first = lower_bound(hosts.begin(), hosts.end(), lowest, host_ip_less()) - hosts.begin();
+	last = upper_bound(hosts.begin(), hosts.end(), highest, host_ip_less()) - hosts.begin();
+}
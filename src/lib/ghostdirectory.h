@@ -0,0 +1,93 @@
+#ifndef GHOSTDIRECTORY_H_
+#define GHOSTDIRECTORY_H_
+
+/**
+ *	\file ghostdirectory.h
+ *	\brief Directory of the local hosts of a sorted flowlist.
+ *
+ * 	This file is subject to the terms and conditions defined in
+ * 	files 'BSD.txt' and 'GPL.txt'. For a list of authors see file 'AUTHORS'.
+ */
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+
+#include "cflow.h"
+#include "IPv6_addr.h"
+
+/**
+ *	\class ChostMetadata
+ *	\brief Data class for graphlet properties (host metadata).
+ *
+ *	This metadata is derived from sorted flow data (as read from a cflow file or derived from
+ *	a pcap/ipfix/etc. file.
+ */
+class ChostMetadata {
+	public:
+		IPv6_addr IP; ///< localIP (IP address of host)
+		unsigned int graphlet_number; ///< graphlet number as read from file
+		unsigned int flow_count; ///< Count of all flows to/from host
+		unsigned int uniflow_count; ///< Count of uniflows to/from host
+		unsigned int prot_count; ///< Total count of used protocols
+		unsigned int packet_count; ///< Count of packets to/from host
+		unsigned int index; ///< Index into data array: points to first edge
+		uint64_t bytesForAllFlows; ///< Total byte count of all flows involved
+
+		ChostMetadata();
+};
+
+/**
+ *	\class CHostDirectory
+ *	\brief One ChostMetadata per local host of a flowlist, in flowlist order
+ *
+ *	A flowlist sorted by cflow_t::operator< holds the flows of each local host as one contiguous
+ *	run, and the runs follow the order of the addresses. The directory stores one entry per run
+ *	(address, first flow, flow count and the aggregates shown in the host list), thus the
+ *	graphlet number of a host is its position in the directory. Lookups by address, by flow and
+ *	by network prefix are binary searches.
+ *
+ *	If the flowlist passed to build() is not sorted by localIP, the address lookups fall back to
+ *	a linear scan.
+ */
+class CHostDirectory {
+	public:
+		static const size_t npos = (size_t) -1; ///< Returned by the lookups if there is no such host
+
+		CHostDirectory();
+
+		void build(CFlowList::const_iterator begin, CFlowList::const_iterator end);
+		void clear();
+
+		size_t find(const IPv6_addr & IP) const;
+		size_t rank(const IPv6_addr & IP) const;
+		size_t find_flow(size_t flow) const;
+		void find_prefix(const IPv6_addr & net, const IPv6_addr & netmask, size_t & first, size_t & last) const;
+
+		/**
+		 *	\return Metadata of the host with graphlet number graphlet
+		 */
+		const ChostMetadata & operator[](size_t graphlet) const {
+			return hosts[graphlet];
+		}
+
+		/**
+		 *	\return Index of the first flow after the flows of host graphlet
+		 */
+		size_t flow_end(size_t graphlet) const {
+			return hosts[graphlet].index + hosts[graphlet].flow_count;
+		}
+
+		/**
+		 *	\return Number of hosts
+		 */
+		size_t size() const {
+			return hosts.size();
+		}
+
+	private:
+		std::vector<ChostMetadata> hosts; ///< Hosts in flowlist order
+		bool sorted; ///< True if the addresses of hosts are ascending
+};
+
+#endif /* GHOSTDIRECTORY_H_ */
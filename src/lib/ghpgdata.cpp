@@ -87,12 +87,12 @@ uint32_t filedata2[] = { // Data for one graphlet. No other graphlet exists.
 using namespace std;
 
 // Hash key & map for unique node check (use ipv6 keys as they have a suitable size of 128 bit)
-typedef HashKeyIPv6 NodeHashKey;
-typedef hash_map<HashKeyIPv6, uint32_t, HashFunction<HashKeyIPv6> , HashFunction<HashKeyIPv6> > NodeHashMap;
+typedef CKeyIP NodeHashKey;
+typedef flat_hash_map<CKeyIP, uint32_t, KeyHashFunction<CKeyIP> , KeyHashFunction<CKeyIP> > NodeHashMap;
 
 // For hpg2dot3(): store node_id and node_type as low/high 32 bits of an uint64_t entry
-typedef CHashKey6_6 NodeHashKey2;
-typedef hash_map<CHashKey6_6, node_hm_value, HashFunction<CHashKey6_6> , HashFunction<CHashKey6_6> > NodeHashMap2;
+typedef CKey6_6 NodeHashKey2;
+typedef flat_hash_map<CKey6_6, node_hm_value, KeyHashFunction<CKey6_6> , KeyHashFunction<CKey6_6> > NodeHashMap2;
 
 /**
  *	Constructor: initialize (for unit test only).
@@ -13,6 +13,7 @@
 #include <set>
 #include <string>
 #include <iterator>
+#include <algorithm>
 
 #include <cstdio>
 #include <cstdlib>
@@ -45,16 +46,19 @@
 #endif // __linux__
 #include "gimport.h"
 #include "gimport_config.h"
-#include "heapsort.h"
 #include "hpg.h"
 #include "gutil.h"
 #include "ggraph.h"
 #include "HAPviewer.h"
 #include "cflow.h"
 #include "gfilter.h"
+#include "gparallel.h"
+#include "gradixsort.h"
 
 using namespace std;
 
+#define IMPORT_CONCURRENT_FILES 4 ///< Files read at the same time by a multi-file import (each filter uses several threads itself)
+
 #ifdef NDEBUG
 bool debug =false;
 bool debug2=false;
@@ -72,17 +76,73 @@ bool debug6 = true;
 #endif
 
 /**
- *	Default constructor
+ *	Orders entries of the r_index (flow numbers) by the remoteIP of their flow, and against addresses
  */
-ChostMetadata::ChostMetadata() {
-	IP = IPv6_addr();
-	flow_count = 0;
-	prot_count = 0;
-	packet_count = 0;
-	index = 0;
-	bytesForAllFlows = 0;
+struct remote_ip_index_less {
+		const CFlowList & flowlist;
+
+		remote_ip_index_less(const CFlowList & flowlist) :
+			flowlist(flowlist) {
+		}
+		bool operator()(int flow, const IPv6_addr & IP) const {
+			return flowlist[flow].remoteIP < IP;
+		}
+		bool operator()(const IPv6_addr & IP, int flow) const {
+			return IP < flowlist[flow].remoteIP;
+		}
+};
+
+/**
+ *	Check if a flowlist is sorted in ascending order of localIPs (see cflow_t::operator<)
+ *
+ *	\param flowlist Flowlist to check
+ *
+ *	\return True if sorted
+ */
+static bool is_sorted_flowlist(const CFlowList & flowlist) {
+	for (CFlowList::size_type i = 1; i < flowlist.size(); i++) {
+		if (flowlist[i] < flowlist[i - 1])
+			return false;
+	}
+	return true;
 }
 
+/**
+ *	\class CFileImportTask
+ *	\brief Reads one file per item into a flowlist of its own and sorts it
+ */
+class CFileImportTask: public util::CParallelTask {
+	public:
+		CFileImportTask(const vector<string> & files, const vector<GFilter *> & filters, vector<CFlowList> & parts, const IPv6_addr & local_net,
+		      const IPv6_addr & netmask, const IPv6_addr & localIP, int host_count) :
+			files(files), filters(filters), parts(parts), local_net(local_net), netmask(netmask), localIP(localIP), host_count(host_count) {
+		}
+
+		/**
+		 *	Read and sort a file
+		 *
+		 *	\param number Number of the file
+		 *
+		 *	\exception std::string Errortext
+		 */
+		virtual void run(unsigned int number) {
+			CFlowList & part = parts[number];
+			if (host_count < 0 || !filters[number]->read_file_hosts(files[number], part, localIP, host_count))
+				filters[number]->read_file(files[number], part, local_net, netmask, false);
+			if (!is_sorted_flowlist(part))
+				sort(part.begin(), part.end());
+		}
+
+	private:
+		const vector<string> & files; ///< Files to read
+		const vector<GFilter *> & filters; ///< Filter to use for each file
+		vector<CFlowList> & parts; ///< Flows, one list per file
+		IPv6_addr local_net; ///< Local network address
+		IPv6_addr netmask; ///< Network mask for local network address
+		IPv6_addr localIP; ///< First host needed
+		int host_count; ///< Count of hosts needed (-1: all hosts)
+};
+
 /**
  *	Simple constructor: pick data from memory instead from input file.
  *
@@ -92,6 +152,8 @@ ChostMetadata::ChostMetadata() {
 CImport::CImport(const CFlowList & flowlist, const prefs_t & newprefs) :
 	full_flowlist(flowlist), active_flowlist(full_flowlist.begin(), full_flowlist.end()), prefs(newprefs) {
 	next_host_idx = full_flowlist.begin();
+	ipDictionary.build(full_flowlist); // The flowlist is used as is (no prepare_flowlist())
+	hostDirectory.build(full_flowlist.begin(), full_flowlist.end());
 
 	use_reverse_index = true;
 	hpg_filename = default_hpg_filename; // No input file name to derive hpg file name from
@@ -101,7 +163,8 @@ CImport::CImport(const CFlowList & flowlist, const prefs_t & newprefs) :
 /**
  *	Constructor: initialize
  *
- *	\param in_filename Name of data input file.
+ *	\param in_filename Name of data input file. A directory or a glob pattern (e.g. nfcapd.20101007*) selects
+ *	several files, which are imported together.
  *	\param out_filename Name of data ouput file (*.hpg).
  * \param newprefs Preferences settings
  */
@@ -109,6 +172,7 @@ CImport::CImport(const std::string & in_filename, const std::string & out_filena
 	prefs(newprefs) {
 	// Store parameter for later use
 	this->in_filename = in_filename;
+	in_filenames = util::expandFilenames(in_filename);
 
 	//	prefs->show_prefs();
 
@@ -133,22 +197,12 @@ CImport::CImport(const std::string & in_filename, const std::string & out_filena
  *
  *	By use of the r_index it is possible to construct graphlets from the outside
  *	perspective. This is used by the IP-based graphlet search function (go to IP address).
+ *	Called by get_outside_graphlet() when needed.
  */
 void CImport::prepare_reverse_index() {
 	cout << "Preparing index for remote IP-based outside graphlet look-up.\n";
-	// Use 2 auxiliary arrays for sorting
-	vector<IPv6_addr> IPs(full_flowlist.size());
-	remoteIP_index.resize(full_flowlist.size());
-	// Initialize sorting indices
-	// IPs = localIP
-	// r_index = index into all_flowlist
-	for (unsigned int j = 0; j < full_flowlist.size(); j++) {
-		IPs[j] = full_flowlist[j].remoteIP;
-		remoteIP_index[j] = j;
-	}
-	// Now sort arrays such that IPs have ascending order
-	// ({IP, index} pairs are preserved)
-	heapSort(IPs, remoteIP_index);
+	// remoteIP_index[i] = index into full_flowlist of the flow with the i-th smallest remoteIP
+	util::sortIndexByRemoteIP(full_flowlist, remoteIP_index);
 	cout << "Done.\n";
 }
 
@@ -167,7 +221,9 @@ void CImport::prepare_flowlist() {
 	// hosts which also exchange biflows, are marked as "potential productive uniflows"
 
 	// a) Sort arrays such that IPs have ascending order
-	sort(full_flowlist.begin(), full_flowlist.end()); // Not necessary on cflow lists but still leave it here as we got way too many unsorted examples
+	// Flows read from cflow files or merged from several files are already sorted: a linear check is much cheaper than the sort
+	if (!is_sorted_flowlist(full_flowlist))
+		util::sortFlowlist(full_flowlist); // We got way too many unsorted examples
 
 	active_flowlist.invalidate();
 	active_flowlist.setBegin(full_flowlist.begin());
@@ -182,13 +238,17 @@ void CImport::prepare_flowlist() {
 	// Go through flowlist and store each host pair in hash map "flowHmHostPair"
 	// key = {IP1,IP2 }, value=biflow count
 
+	// Intern the addresses: the host pairs below and the role identification use the ids
+	ipDictionary.build(full_flowlist);
+
 	FlowHashMapHostPair * flowHmHostPair = new FlowHashMapHostPair();
 	FlowHashMapHostPair::iterator FlowHashMapHostPairIterator;
 
 	cout << "Preparing for qualification of uniflows." << endl;
 
 	int host_pairs = 0;
-	for (CFlowList::iterator flowiterator = full_flowlist.begin(); flowiterator != full_flowlist.end(); flowiterator++) { // Go through all flows
+	size_t flow = 0;
+	for (CFlowList::iterator flowiterator = full_flowlist.begin(); flowiterator != full_flowlist.end(); flowiterator++, flow++) { // Go through all flows
 		// Show progress on console
 		static int i = 0;
 		if (((i++ % 100000) == 0) && (i > 0)) {
@@ -198,7 +258,7 @@ void CImport::prepare_flowlist() {
 
 		int biflow_inc = ((flowiterator->flowtype & biflow) != 0) ? 1 : 0;
 
-		FlowHashKeyHostPair hostPairKey((flowiterator->localIP), (flowiterator->remoteIP));
+		FlowHashKeyHostPair hostPairKey(ipDictionary.get_local_id(flow), ipDictionary.get_remote_id(flow));
 		FlowHashMapHostPairIterator = flowHmHostPair->find(hostPairKey);
 		if (FlowHashMapHostPairIterator == flowHmHostPair->end()) {
 			// New host pair
@@ -218,7 +278,8 @@ void CImport::prepare_flowlist() {
 	int unibiflow_count = 0;
 	int uIP_error = 0;
 
-	for (CFlowList::iterator flowiterator = full_flowlist.begin(); flowiterator < full_flowlist.end(); flowiterator++) { // Go through all flows
+	flow = 0;
+	for (CFlowList::iterator flowiterator = full_flowlist.begin(); flowiterator < full_flowlist.end(); flowiterator++, flow++) { // Go through all flows
 
 		// Show progress on console
 		static int i = 0;
@@ -230,7 +291,7 @@ void CImport::prepare_flowlist() {
 		if ((flowiterator->flowtype & uniflow) != 0) {
 			uniflow_count++;
 
-			FlowHashKeyHostPair hostPairKey((flowiterator->localIP), (flowiterator->remoteIP));
+			FlowHashKeyHostPair hostPairKey(ipDictionary.get_local_id(flow), ipDictionary.get_remote_id(flow));
 			FlowHashMapHostPairIterator = flowHmHostPair->find(hostPairKey);
 			if (FlowHashMapHostPairIterator != flowHmHostPair->end()) {
 				// Host pair found
@@ -257,9 +318,14 @@ void CImport::prepare_flowlist() {
 		}
 	}
 
-	// (4) Prepare r_index for outside graphlets
-	// *****************************************
-	prepare_reverse_index();
+	// (4) Index the local hosts for set_localIP() and get_hostMetadata()
+	// *****************************************************************
+	hostDirectory.build(full_flowlist.begin(), full_flowlist.end());
+
+	// (5) The r_index for outside graphlets and the index for the role rating are built on first use
+	// ***********************************************************************************************
+	remoteIP_index.clear();
+	serviceIndex.clear();
 }
 
 /**
@@ -280,34 +346,17 @@ bool CImport::set_localIP(IPv6_addr newLocalIP, int host_count) {
 		return true;
 	}
 
-	// Search for first flow belonging to requested IP
-	// (this flow will have final value of variable flowlistIterator_start)
-	CFlowList::iterator flowlistIterator_start = full_flowlist.begin();
-	while (flowlistIterator_start != full_flowlist.end()) {
-		if (flowlistIterator_start->localIP == newLocalIP) {
-			break;
-		} else {
-			flowlistIterator_start++;
-		}
-	}
-
-	// Check if requested IP has been found or not.
-	if (flowlistIterator_start != full_flowlist.end()) {
-		// We have found requested IP:
-		// Now, search for first flow belonging to a host after we have
-		// seen flows belonging to a total of "host_count" hosts.
-		// (this flow will have final value of variable j)
+	// Look up the requested IP and the host_count-1 following hosts in the host directory
+	size_t host = hostDirectory.find(newLocalIP);
+	if (host != CHostDirectory::npos) {
+		CFlowList::iterator flowlistIterator_start = full_flowlist.begin() + hostDirectory[host].index;
 		CFlowList::iterator flowlistIterator_end = flowlistIterator_start;
-		IPv6_addr lastIP = flowlistIterator_end->localIP;
-		unsigned int hc = 0; // Host iterator
-		while (hc < (unsigned int) host_count && flowlistIterator_end != active_flowlist.end()) {
-			if (flowlistIterator_end->localIP != lastIP) {
-				lastIP = flowlistIterator_end->localIP;
-				hc++;
-			}
-			else
-				flowlistIterator_end++;
-		}
+		if (host_count > 0)
+			flowlistIterator_end = full_flowlist.begin() + hostDirectory.flow_end(min(hostDirectory.size(), host + host_count) - 1);
+		// Do not extend beyond the current active flowlist
+		CFlowList::const_iterator active_end = active_flowlist.end();
+		if (active_end > flowlistIterator_start && flowlistIterator_end > active_end)
+			flowlistIterator_end = full_flowlist.begin() + (active_end - full_flowlist.begin());
 
 		if (flowlistIterator_end - flowlistIterator_start <= 0) {
 			cerr << "ERROR: no flows found for requested IP.\n";
@@ -364,7 +413,9 @@ void CImport::cflow2hpg() {
 	// **************
 
 	// Role identifiers needed for summarization:
-	CRoleMembership roleMembership; // Manages groups of hosts having same role membership set
+	if (serviceIndex.size() != full_flowlist.size()) // First graphlet of this flowlist: index it for the role rating
+		serviceIndex.build(ipDictionary, full_flowlist);
+	CRoleMembership roleMembership(ipDictionary, serviceIndex, active_flowlist.begin() - full_flowlist.begin()); // Manages groups of hosts having same role membership set
 
 	CClientRole clientRole(active_flowlist, prefs);
 	CServerRole serverRole(active_flowlist, prefs);
@@ -481,7 +532,7 @@ void CImport::cflow2hpg() {
 		}
 
 		if (flow_client_role[j] == 0 && flow_server_role[j] == 0 && flow_p2p_role[j] == 0) {
-			single_flow_rolenum[j] = roleMembership.add_single_flow(active_flowlist[j].remoteIP, active_flowlist[j].dPkts);
+			single_flow_rolenum[j] = roleMembership.add_single_flow(roleMembership.get_remote_id(j), active_flowlist[j].dPkts);
 		} else {
 			single_flow_rolenum[j] = 0;
 		}
@@ -498,10 +549,10 @@ void CImport::cflow2hpg() {
 		roleMembership.print_multisummary_rolecount();
 	}
 
-	// rate all generated roles
-	clientRole.rate_roles(full_flowlist);
-	serverRole.rate_roles(full_flowlist);
-	p2pRole.rate_roles(full_flowlist);
+	// roles are rated on demand, when a flow conflict involves them (see CRole::getRating())
+	clientRole.set_full_flowlist(full_flowlist);
+	serverRole.set_full_flowlist(full_flowlist);
+	p2pRole.set_full_flowlist(full_flowlist);
 
 	// create sub-roles required for part. desummarization for all flow types
 	serverRole.create_sub_roles();
@@ -722,6 +773,9 @@ void CImport::cflow2hpg() {
 		cerr << "INFO: ambiguous roles (client+p2p) for " << ambiguous_cp2p_roles_flows << " flows.\n";
 	if (ambiguous_sp2p_roles_flows > 0)
 		cerr << "INFO: ambiguous roles (server+p2p) for " << ambiguous_sp2p_roles_flows << " flows.\n";
+	uint32_t rated_roles = clientRole.get_rating_count() + serverRole.get_rating_count() + p2pRole.get_rating_count();
+	if (rated_roles > 0)
+		cerr << "INFO: rated " << rated_roles << " roles for conflict resolution.\n";
 	if (summarized_flows)
 		cout << "Summarized flows: " << summarized_flows << endl;
 	if (filtered_flows)
@@ -826,65 +880,18 @@ void CImport::calculate_multi_summary_node_desummarizations(CRoleMembership & ro
 
 /**
  *	Get host metadata from "flowlist" and store it in "hostMetadata".
+ *	If the active flowlist is the full flowlist, the host directory of prepare_flowlist() is reused.
  */
 void CImport::get_hostMetadata() {
-	// Scan flow list and assemble for each localIP the metadata
 	assert(getActiveFlowlistSize() > 0);
-	IPv6_addr lastIP = active_flowlist[0].localIP; // Get 1. localIP
-	int hostFlowIndex = 0;
-	int host_flows = 0;
-	set<uint8_t> proto_set;
-
-	int maxnum_hosts = 1;
-	for (unsigned int j = 0; j < getActiveFlowlistSize(); j++) {
-		if (active_flowlist[j].localIP != lastIP) {
-			maxnum_hosts++;
-			lastIP = active_flowlist[j].localIP;
-		}
-	}
-	cout << "Input file " << in_filename << " contains " << maxnum_hosts << " unique local hosts.\n";
-
-	hostMetadata.resize(maxnum_hosts);
-
-	Subflowlist::const_iterator it = active_flowlist.begin();
-	int host_index = -1;
-	while (it != active_flowlist.end()) {
-		// Check if host data is complete
-		if (it->localIP != hostMetadata[host_index].IP || it == active_flowlist.begin()) {
-			host_index++;
-			hostMetadata[host_index].IP = it->localIP;
-			hostMetadata[host_index].graphlet_number = host_index;
-			hostMetadata[host_index].uniflow_count = 0;
-			hostMetadata[host_index].packet_count = 0;
-			hostMetadata[host_index].bytesForAllFlows = 0;
-			hostMetadata[host_index].prot_count = 0;
-			hostMetadata[host_index].index = 0;
-			host_flows = 0;
-			proto_set.clear();
-			// Prepare for next host
-			hostFlowIndex = distance(active_flowlist.begin(), it);
-			// Remember new srcIP for change testing
-			assert((unsigned int)host_index <= hostMetadata.size());
-
-			//			// Show progress on console
-			//			if ((host_index % 10000) == 0) {
-			//				cout << ".";
-			//				cout.flush();
-			//			}
-		}
-		if (it->flowtype & uniflow)
-			hostMetadata[host_index].uniflow_count++;
-		hostMetadata[host_index].packet_count += it->dPkts;
-		hostMetadata[host_index].bytesForAllFlows += it->dOctets;
-		proto_set.insert(it->prot);
-		hostMetadata[host_index].prot_count = proto_set.size();
-		hostMetadata[host_index].index = hostFlowIndex;
-		hostMetadata[host_index].flow_count = ++host_flows;
-		it++;
-	}
+	if (active_flowlist.begin() == full_flowlist.begin() && active_flowlist.end() == full_flowlist.end() && hostDirectory.size() > 0)
+		hostMetadata = hostDirectory;
+	else
+		hostMetadata.build(active_flowlist.begin(), active_flowlist.end());
+	cout << "Input file " << in_filename << " contains " << hostMetadata.size() << " unique local hosts.\n";
 
 	next_host = 0;
-	cout << "\nMetadata for " << host_index + 1 << " local hosts prepared.\n";
+	cout << "\nMetadata for " << hostMetadata.size() << " local hosts prepared.\n";
 }
 
 /**
@@ -921,6 +928,13 @@ const ChostMetadata & CImport::get_next_host_metadata() {
 	throw "invalid access behind the last element of hostMetadata";
 }
 
+/**
+ *	\return Hosts of the last get_hostMetadata() call, indexed by graphlet number
+ */
+const CHostDirectory & CImport::get_host_directory() const {
+	return hostMetadata;
+}
+
 /**
  *	Get a list of flows
  *
@@ -936,68 +950,40 @@ Subflowlist CImport::get_flow(unsigned int flIndex, unsigned int flow_count) con
 	return Subflowlist(full_flowlist.begin() + flIndex, full_flowlist.begin() + flIndex + flow_count);
 }
 
+/**
+ *	Get the flows of a remote host (remoteIP) from its own perspective, without copying them.
+ *	The r_index is built on the first call (see prepare_reverse_index()), then the flows of
+ *	remoteIP are found by binary search.
+ *
+ *	\param remoteIP IP address of a remote host
+ *	\return View of the flows, valid until the flowlist is modified
+ */
+CFlippedFlowlist CImport::get_outside_graphlet(const IPv6_addr & remoteIP) {
+	if (remoteIP_index.size() != full_flowlist.size())
+		prepare_reverse_index();
+	pair<vector<int>::const_iterator, vector<int>::const_iterator> range = equal_range(remoteIP_index.begin(), remoteIP_index.end(),
+	      remoteIP, remote_ip_index_less(full_flowlist));
+	return CFlippedFlowlist(full_flowlist, range.first, range.second);
+}
+
 /**
  *	Get the flowlist belonging to a graphlet of a remote host (remoteIP).
- *	Go through flow list and pick any flow containing remoteIP. To do this we need
- *	a previously initialized array r_index that contains an index such that remoteIPs are
- *	sorted in ascending order. All found flows are stored in a new temporary flowlist
- *	allocated on the fly for the requested remoteIP.
+ *	All flows of remoteIP are copied in the order of the r_index into a new flowlist, with local
+ *	and remote side exchanged. As the r_index is stable, the new flowlist is sorted as well.
  *
  *	\param remoteIP IP address of a remote host
  *	\return CFlowList flowlist
  */
 const CFlowList CImport::get_outside_graphlet_flows(IPv6_addr remoteIP) {
-	// Search for first flow belonging to graphlet
-	unsigned int i = 0;
-	for (; i < full_flowlist.size(); i++) {
-		int ii = remoteIP_index[i];
-		if (full_flowlist[ii].remoteIP == remoteIP)
-			break;
-	}
-
-	int flow_cnt = 0;
-	unsigned int j = 0;
-	if (i < full_flowlist.size()) { // Check if any flows found: i points to first such flow
-		// Count the number of flows belonging to graphlet
-		j = i + 1;
-		// A flow has been found: look for more
-		for (; j < full_flowlist.size(); j++) {
-			int jj = remoteIP_index[j];
-			if (full_flowlist[jj].remoteIP != remoteIP)
-				break; // Found all flows
-		}
-		flow_cnt = j - i; // j points to first flow not belonging to graphlet
-	}
-
-	CFlowList flows(flow_cnt);
-	if (flows.size() > 0) {
-		// Now we are going to allocate and fill the graphlet's temporary flowlist
-		//	flows = new cflow_t[flow_cnt + 1];
-		// flows[flow_cnt].remoteIP = util::getDummyIpV6();	// Use extra entry for finalization check
-
-		for (unsigned int k = 0; k < flows.size(); k++) { // Copy flow records in sorted order
-			cflow_t temp = full_flowlist[remoteIP_index[i + k]];
-			flows[k] = temp; // Make a copy and modify then direction-dependent fields
-			// Exchange local <-> remote
-			flows[k].localIP = temp.remoteIP;
-			flows[k].remoteIP = temp.localIP;
-			flows[k].localPort = temp.remotePort;
-			flows[k].remotePort = temp.localPort;
-			// Adjust flow direction if needed
-			if ((temp.flowtype & uniflow) == uniflow) {
-				; // Do not modify transit flows
-			} else if ((temp.flowtype & inflow) != 0) {
-				temp.flowtype = (temp.flowtype & (~inflow)) | outflow;
-			} else if ((temp.flowtype & outflow) != 0) {
-				temp.flowtype = (temp.flowtype & (~outflow)) | inflow;
-			}
-			flows[k].flowtype = temp.flowtype;
-		}
-		if (debug2) {
-			cout << "First 20 flows for this graphlet:\n";
-			for (int i = 0; i < 20; i++) {
-				cout << flows[i] << endl;
-			}
+	CFlippedFlowlist view = get_outside_graphlet(remoteIP);
+	CFlowList flows;
+	flows.reserve(view.size());
+	for (CFlippedFlowlist::size_type k = 0; k < view.size(); k++)
+		flows.push_back(view[k]);
+	if (debug2 && flows.size() > 0) {
+		cout << "First 20 flows for this graphlet:\n";
+		for (unsigned int i = 0; i < 20 && i < flows.size(); i++) {
+			cout << flows[i] << endl;
 		}
 	}
 	return flows;
@@ -1046,13 +1032,13 @@ int CImport::get_flow_count() const {
 }
 
 /**
- *	Return true if there is a gfilter which can read the supplied file
+ *	Return the gfilter which can read the supplied file
  *
  * \param in_filename Filename to check
  *
- *	\return	bool True if there is a gfilter available for this filetype, false if not
+ *	\return	GFilter First gfilter accepting the file, NULL if there is none
  */
-bool CImport::acceptForImport(const string & in_filename) {
+GFilter * CImport::getInputfilter(const string & in_filename) {
 	std::vector<GFilter *>::iterator importfilterIterator;
 
 	if (inputfilters.empty())
@@ -1060,6 +1046,23 @@ bool CImport::acceptForImport(const string & in_filename) {
 
 	for (importfilterIterator = inputfilters.begin(); importfilterIterator != inputfilters.end(); importfilterIterator++) {
 		if ((*importfilterIterator)->acceptFileForReading(in_filename))
+			return *importfilterIterator;
+	}
+	return NULL;
+}
+
+/**
+ *	Return true if there is a gfilter which can read the supplied file. For a directory or a glob
+ *	pattern, at least one of the files has to be supported.
+ *
+ * \param in_filename Filename to check
+ *
+ *	\return	bool True if there is a gfilter available for this filetype, false if not
+ */
+bool CImport::acceptForImport(const string & in_filename) {
+	vector<string> files = util::expandFilenames(in_filename);
+	for (unsigned int i = 0; i < files.size(); i++) {
+		if (getInputfilter(files[i]) != NULL)
 			return true;
 	}
 	return false;
@@ -1129,19 +1132,16 @@ void CImport::write_file(std::string out_filename, const CFlowList & flowlist, b
 /**
  *	Return the name of the filetype of the give filename
  *
- * \param in_filename Filename to check
+ * \param in_filename Filename to check (for a directory or a glob pattern: the first supported file is used)
  *
  *	\return	std::string Filetype of given filename or "none" if no gfilter accepts the supplied filename
  */
 std::string CImport::getFormatName(std::string & in_filename) {
-	std::vector<GFilter *>::iterator importfilterIterator;
-
-	if (inputfilters.empty())
-		initInputfilters();
-
-	for (importfilterIterator = inputfilters.begin(); importfilterIterator != inputfilters.end(); importfilterIterator++) {
-		if ((*importfilterIterator)->acceptFileForReading(in_filename))
-			return (*importfilterIterator)->getFormatName();
+	vector<string> files = util::expandFilenames(in_filename);
+	for (unsigned int i = 0; i < files.size(); i++) {
+		GFilter * filter = getInputfilter(files[i]);
+		if (filter != NULL)
+			return filter->getFormatName();
 	}
 	return "none";
 }
@@ -1224,27 +1224,67 @@ std::string CImport::getFormatNamesAsString() {
  * \exception string Errortext
  */
 void CImport::read_file(const IPv6_addr & local_net, const IPv6_addr & netmask) {
-	if (inputfilters.empty())
-		initInputfilters();
-
-	std::vector<GFilter *>::iterator importfilterIterator;
+	read_file(local_net, netmask, IPv6_addr(), -1);
+}
 
-	for (importfilterIterator = inputfilters.begin(); importfilterIterator != inputfilters.end(); importfilterIterator++) {
-		if ((*importfilterIterator)->acceptFileForReading(in_filename)) {
-			try {
-				(*importfilterIterator)->read_file(in_filename, full_flowlist, local_net, netmask, false);
-			} catch (string & e) {
-				throw e;
-			}
-			catch (...) {
-				throw string("Unkown error while importing");
-			}
-			prepare_flowlist();
-			return;
+/**
+ *	Reads the (previously) set filename into memory. If the file format supports it, just the
+ *	flows of the host localIP and its host_count-1 successors are read (see set_localIP()).
+ *	Note that the flows of other hosts are then missing for the client and p2p role ratings,
+ *	thus role conflicts may be resolved differently than after reading all hosts.
+ *
+ *	If in_filename selects several files (directory or glob pattern), up to IMPORT_CONCURRENT_FILES
+ *	of them are read at the same time, each into a flowlist of its own which is sorted right after
+ *	reading. The sorted lists are then merged into the full flowlist, thus prepare_flowlist() does
+ *	not need to sort. Files without a supporting gfilter are skipped.
+ *
+ *	\param local_net Local network address
+ *	\param netmask Network mask for local network address
+ *	\param localIP First host needed
+ *	\param host_count Count of hosts needed (-1: all hosts)
+ *
+ * \pre one of the installed GFilter supports the given file
+ *
+ * \exception string Errortext
+ */
+void CImport::read_file(const IPv6_addr & local_net, const IPv6_addr & netmask, const IPv6_addr & localIP, int host_count) {
+	// Select the filter for each file
+	vector<string> files;
+	vector<GFilter *> filters;
+	for (unsigned int i = 0; i < in_filenames.size(); i++) {
+		GFilter * filter = getInputfilter(in_filenames[i]);
+		if (filter != NULL) {
+			files.push_back(in_filenames[i]);
+			filters.push_back(filter);
+		} else if (in_filenames.size() > 1) {
+			cerr << "WARNING: skipping " << in_filenames[i] << ", no usable importfilter found.\n";
 		}
 	}
+	if (files.empty())
+		throw "no usable importfilter found";
 
-	throw "no usable importfilter found";
+	try {
+		if (files.size() == 1) {
+			if (host_count < 0 || !filters[0]->read_file_hosts(files[0], full_flowlist, localIP, host_count))
+				filters[0]->read_file(files[0], full_flowlist, local_net, netmask, false);
+		} else {
+			cout << "Importing " << files.size() << " files.\n";
+			vector<CFlowList> parts(files.size());
+			CFileImportTask task(files, filters, parts, local_net, netmask, localIP, host_count);
+			util::runParallel(task, files.size(), IMPORT_CONCURRENT_FILES);
+			vector<Subflowlist> runs;
+			for (unsigned int i = 0; i < parts.size(); i++)
+				runs.push_back(Subflowlist(parts[i]));
+			full_flowlist.clear();
+			mergeSortedFlows(runs, full_flowlist);
+		}
+	} catch (string & e) {
+		throw e;
+	}
+	catch (...) {
+		throw string("Unkown error while importing");
+	}
+	prepare_flowlist();
 }
 
 /**
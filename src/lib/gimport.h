@@ -32,29 +32,8 @@
 
 #include "grole.h"
 #include "gfilter.h"
-
-// ******************************************************************************************
-
-/**
- *	\class ChostMetadata
- *	\brief Data class for graphlet properties (host metadata).
- *
- *	This metadata is derived from sorted flow data (as read from a cflow file or derived from
- *	a pcap/ipfix/etc. file.
- */
-class ChostMetadata {
-	public:
-		IPv6_addr IP; ///< localIP (IP address of host)
-		unsigned int graphlet_number; ///< graphlet number as read from file
-		unsigned int flow_count; ///< Count of all flows to/from host
-		unsigned int uniflow_count; ///< Count of uniflows to/from host
-		unsigned int prot_count; ///< Total count of used protocols
-		unsigned int packet_count; ///< Count of packets to/from host
-		unsigned int index; ///< Index into data array: points to first edge
-		uint64_t bytesForAllFlows; ///< Total byte count of all flows involved
-
-		ChostMetadata();
-};
+#include "gipdictionary.h"
+#include "ghostdirectory.h"
 
 // ******************************************************************************************
 
@@ -64,15 +43,15 @@ class ChostMetadata {
 // key = 5-tuple {srcIP, dstIP, srcPort, dstPort, protocol}
 // data = references to flowlist records
 //
-typedef HashKeyIPv6_5T flowHashKey;
-typedef hash_map<HashKeyIPv6_5T, cflow_t *, HashFunction<HashKeyIPv6_5T> , HashFunction<HashKeyIPv6_5T> > flowHashMap;
+typedef CKeyIP_5T flowHashKey;
+typedef flat_hash_map<CKeyIP_5T, cflow_t *, KeyHashFunction<CKeyIP_5T> , KeyHashFunction<CKeyIP_5T> > flowHashMap;
 
 // For lookup of all traffic between a host pair: to identify unibiflow property
-// key = 2-tuple {IP1, IP2}
+// key = 2-tuple {IP1 id, IP2 id} (ids of CImport::ipDictionary)
 // data = sample id
 //
-typedef HashKeyIPv6Pair FlowHashKeyHostPair;
-typedef hash_map<HashKeyIPv6Pair, int, HashFunction<HashKeyIPv6Pair> , HashFunction<HashKeyIPv6Pair> > FlowHashMapHostPair;
+typedef CKeyIdPair FlowHashKeyHostPair;
+typedef flat_hash_map<CKeyIdPair, int, KeyHashFunction<CKeyIdPair> , KeyHashFunction<CKeyIdPair> > FlowHashMapHostPair;
 
 /**
  *	\class CImport
@@ -85,6 +64,7 @@ class CImport {
 		static bool acceptForImport(const std::string & in_filename);
 		static bool acceptForExport(const std::string & out_filename);
 		void read_file(const IPv6_addr & local_net = IPv6_addr(), const IPv6_addr & netmask = IPv6_addr());
+		void read_file(const IPv6_addr & local_net, const IPv6_addr & netmask, const IPv6_addr & localIP, int host_count);
 		void write_file(std::string out_filename, const CFlowList & flowlist, bool appendIfExisting);
 		void write_file(std::string out_filename, const Subflowlist & subflowlist, bool appendIfExisting);
 		static std::string getFormatName(std::string & in_filename);
@@ -95,6 +75,7 @@ class CImport {
 		static unsigned int initInputfilters();
 
 	private:
+		static GFilter * getInputfilter(const std::string & in_filename);
 		static std::vector<GFilter *> inputfilters; ///< Holds all enabled GFilter as configured
 
 	public:
@@ -108,6 +89,7 @@ class CImport {
 
 		// Flow set/get
 		Subflowlist get_flow(unsigned int flIndex, unsigned int flow_count) const;
+		CFlippedFlowlist get_outside_graphlet(const IPv6_addr & remoteIP);
 		const CFlowList get_outside_graphlet_flows(IPv6_addr remoteIP);
 
 		int get_flow_count() const;
@@ -124,6 +106,7 @@ class CImport {
 		void get_hostMetadata(void);
 		const ChostMetadata & get_first_host_metadata();
 		const ChostMetadata & get_next_host_metadata();
+		const CHostDirectory & get_host_directory() const;
 		std::string get_hpg_filename() const;
 		std::string get_in_filename() const;
 
@@ -142,21 +125,25 @@ class CImport {
 #endif
 
 	protected:
-		std::string in_filename; ///< Input file name
+		std::string in_filename; ///< Input file name (may also name a directory or a glob pattern)
+		std::vector<std::string> in_filenames; ///< Input files, as expanded from in_filename
 		std::string hpg_filename; ///< Name for hpg file
 
 		// "full flowlist": as loaded from file; "active_flowlist": as used for transformations
 		CFlowList full_flowlist; ///< Flowlist containg all loaded localIPs ("full flowlist")
 		Subflowlist active_flowlist; ///< Flowlist containg a part of all loaded localIPs ("active flowlist")
 		Subflowlist::const_iterator next_host_idx; ///< Flowlist iterator of first flow of next host
+		CIpDictionary ipDictionary; ///< Address ids of full_flowlist, used by the role identification
+		CRemoteServiceIndex serviceIndex; ///< Flows of full_flowlist by (remoteIP, prot, remotePort), used by the role rating
 
 		Subflowlist::size_type getActiveFlowlistSize() {
 			return active_flowlist.size();
 		}
-		std::vector<int> remoteIP_index; ///< Index into flowlist for sorted remoteIPs
+		std::vector<int> remoteIP_index; ///< Index into flowlist for sorted remoteIPs (empty until the first outside graphlet look-up)
 		bool use_reverse_index; ///< TRUE if a reverse index is needed (default:TRUE)
 
-		std::vector<ChostMetadata> hostMetadata; ///< Vector of metadata objects
+		CHostDirectory hostDirectory; ///< Hosts of full_flowlist
+		CHostDirectory hostMetadata; ///< Hosts of the active flowlist, as returned by get_first/next_host_metadata()
 		int next_host; ///< Auxiliary counter for get_first/next_host functions
 
 		const prefs_t & prefs; ///< Preferences settings
@@ -90,8 +90,13 @@ bool CInterface::handle_binary_import(std::string & in_filename, std::string & o
 	}
 
 	// Import traffic data to memory-based flowlist.
+	// Role conflicts are resolved by ratings counting the flows of other hosts sharing a client or p2p
+	// role's remote endpoints (see CClientRole::rate_role()). Thus, as soon as conflicts are possible,
+	// i.e., at least two role types are summarized, the whole file is needed.
+	int conflicting_roles = (prefs->summarize_clt_roles ? 1 : 0) + (prefs->summarize_srv_roles ? 1 : 0) + (prefs->summarize_p2p_roles ? 1 : 0);
+	int load_host_count = (conflicting_roles >= 2) ? -1 : host_count;
 	try {
-		flowImport->read_file(localIP, netmask);
+		flowImport->read_file(localIP, netmask, localIP, load_host_count); // loads just the needed hosts if the file has a host index
 	} catch (string & errtext) {
 		// Upon failed open on filename given
 		cerr << errtext << endl;
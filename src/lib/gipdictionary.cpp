@@ -0,0 +1,109 @@
+/**
+ *	\file gipdictionary.cpp
+ *	\brief Dictionary encoding of the IP addresses of a flowlist.
+ *
+ * 	This file is subject to the terms and conditions defined in
+ * 	files 'BSD.txt' and 'GPL.txt'. For a list of authors see file 'AUTHORS'.
+ */
+
+#include <algorithm>
+#include <string>
+
+#include "gipdictionary.h"
+
+using namespace std;
+
+/**
+ *	Orders ids by their address
+ */
+struct ip_id_less {
+		const vector<IPv6_addr> & addresses;
+
+		ip_id_less(const vector<IPv6_addr> & addresses) :
+			addresses(addresses) {
+		}
+		bool operator()(CIpDictionary::ipId a, CIpDictionary::ipId b) const {
+			return addresses[a] < addresses[b];
+		}
+};
+
+const CIpDictionary::ipId CIpDictionary::no_id;
+
+CIpDictionary::CIpDictionary() {
+}
+
+/**
+ *	Replace the dictionary by the addresses of flowlist and store the ids of each flow.
+ *
+ *	\param flowlist Flowlist to encode. The ids remain valid as long as the flowlist is not modified.
+ */
+void CIpDictionary::build(const CFlowList & flowlist) {
+	clear();
+	local_ids.resize(flowlist.size());
+	remote_ids.resize(flowlist.size());
+	for (size_t i = 0; i < flowlist.size(); i++) {
+		// The flowlist is sorted by localIP: most flows have the local address of their predecessor
+		if (i > 0 && flowlist[i].localIP == flowlist[i - 1].localIP)
+			local_ids[i] = local_ids[i - 1];
+		else
+			local_ids[i] = intern(flowlist[i].localIP);
+		remote_ids[i] = intern(flowlist[i].remoteIP);
+	}
+
+	// Renumber such that the ids follow the order of the addresses
+	vector<ipId> order(addresses.size());
+	for (ipId id = 0; id < order.size(); id++)
+		order[id] = id;
+	sort(order.begin(), order.end(), ip_id_less(addresses));
+	vector<ipId> rank(order.size());
+	vector<IPv6_addr> sorted(addresses.size());
+	for (ipId r = 0; r < order.size(); r++) {
+		rank[order[r]] = r;
+		sorted[r] = addresses[order[r]];
+	}
+	addresses.swap(sorted);
+	for (ipIdHashMap::iterator it = ids.begin(); it != ids.end(); ++it)
+		it->second = rank[it->second];
+	for (size_t i = 0; i < flowlist.size(); i++) {
+		local_ids[i] = rank[local_ids[i]];
+		remote_ids[i] = rank[remote_ids[i]];
+	}
+}
+
+/**
+ *	Get the id of an address, assign the next free id to a new address.
+ *
+ *	\param ip Address
+ *	\return Id of ip
+ */
+CIpDictionary::ipId CIpDictionary::intern(const IPv6_addr & ip) {
+	CKeyIP key(ip);
+	ipIdHashMap::iterator it = ids.find(key);
+	if (it != ids.end())
+		return it->second;
+	ipId id = addresses.size();
+	if (id == no_id)
+		throw string("Too many distinct IP addresses for the IP dictionary");
+	ids[key] = id;
+	addresses.push_back(ip);
+	return id;
+}
+
+/**
+ *	\param ip Address
+ *	\return Id of ip, no_id if ip is not contained in the dictionary
+ */
+CIpDictionary::ipId CIpDictionary::find(const IPv6_addr & ip) const {
+	ipIdHashMap::const_iterator it = ids.find(CKeyIP(ip));
+	return (it != ids.end()) ? it->second : no_id;
+}
+
+/**
+ *	Remove all addresses and flow ids.
+ */
+void CIpDictionary::clear() {
+	ids.clear();
+	addresses.clear();
+	local_ids.clear();
+	remote_ids.clear();
+}
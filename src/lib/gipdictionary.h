@@ -0,0 +1,86 @@
+#ifndef GIPDICTIONARY_H_
+#define GIPDICTIONARY_H_
+
+/**
+ *	\file gipdictionary.h
+ *	\brief Dictionary encoding of the IP addresses of a flowlist.
+ *
+ * 	This file is subject to the terms and conditions defined in
+ * 	files 'BSD.txt' and 'GPL.txt'. For a list of authors see file 'AUTHORS'.
+ */
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+
+#include "cflow.h"
+#include "HashMap.h"
+#include "HashMapE.h"
+#include "IPv6_addr.h"
+
+/**
+ *	\class CIpDictionary
+ *	\brief Assigns a dense 32 bit id to each distinct address of a flowlist
+ *
+ *	build() interns the local and the remote address of every flow and stores the ids of each
+ *	flow in two arrays aligned with the flowlist. The role identification then hashes, compares
+ *	and stores ids instead of 16 byte addresses, and get_ip() resolves an id where the address
+ *	itself is needed (labels, hpg edges, debug output).
+ *
+ *	After build() the ids follow the order of the addresses: id1 < id2 iff ip1 < ip2. Hence a
+ *	std::set of ids iterates in the same order as the std::set of the addresses.
+ */
+class CIpDictionary {
+	public:
+		/**
+		 *	\typedef ipId
+		 *	\brief Id of an address
+		 */
+		typedef uint32_t ipId;
+		static const ipId no_id = 0xffffffff; ///< Id of an address not contained in the dictionary
+
+		CIpDictionary();
+
+		void build(const CFlowList & flowlist);
+		ipId intern(const IPv6_addr & ip);
+		ipId find(const IPv6_addr & ip) const;
+		void clear();
+
+		/**
+		 *	\return Address of id
+		 */
+		const IPv6_addr & get_ip(ipId id) const {
+			return addresses[id];
+		}
+
+		/**
+		 *	\return Number of distinct addresses
+		 */
+		size_t size() const {
+			return addresses.size();
+		}
+
+		/**
+		 *	\return Id of the local address of flow number flow of the flowlist passed to build()
+		 */
+		ipId get_local_id(size_t flow) const {
+			return local_ids[flow];
+		}
+
+		/**
+		 *	\return Id of the remote address of flow number flow of the flowlist passed to build()
+		 */
+		ipId get_remote_id(size_t flow) const {
+			return remote_ids[flow];
+		}
+
+	private:
+		typedef flat_hash_map<CKeyIP, ipId, KeyHashFunction<CKeyIP> , KeyHashFunction<CKeyIP> > ipIdHashMap;
+
+		ipIdHashMap ids; ///< key = address, data = id
+		std::vector<IPv6_addr> addresses; ///< Address of each id
+		std::vector<ipId> local_ids; ///< Id of the local address, aligned with the flowlist
+		std::vector<ipId> remote_ids; ///< Id of the remote address, aligned with the flowlist
+};
+
+#endif /* GIPDICTIONARY_H_ */
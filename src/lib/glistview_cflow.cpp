@@ -895,15 +895,8 @@ void ChostListView::on_button_goto_graphlet(int graphlet) {
 	if (dbg)
 		cout << "INFO: goto graphlet " << graphlet << endl;
 
-	// We have to search the whole list for given graphlet number
 	const Gtk::TreeNodeChildren & list = m_refTreeModel->children();
-	Gtk::ListStore::iterator iter = list.begin();
-
-	for (iter = list.begin(); iter != list.end(); iter++) {
-		Gtk::ListStore::Row row = *iter;
-		if (row[pmodel->m_col_graphlet] == (unsigned int) graphlet)
-			break; // Hit
-	}
+	Gtk::ListStore::iterator iter = find_graphlet_row(graphlet);
 
 	if (iter == list.end()) { // Miss
 		if (dbg)
@@ -934,6 +927,37 @@ void ChostListView::on_button_goto_graphlet(int graphlet) {
 
 }
 
+/**
+ *	Get the row of a graphlet.
+ *
+ *	The rows are added in graphlet order, thus as long as the list has not been sorted by a column
+ *	row n shows graphlet n and is accessed directly. Otherwise the rows are searched.
+ *
+ *	\param graphlet Graphlet number
+ *
+ *	\return Row of graphlet, end of the list if there is no such row
+ */
+Gtk::ListStore::iterator ChostListView::find_graphlet_row(unsigned int graphlet) {
+	const Gtk::TreeNodeChildren & list = m_refTreeModel->children();
+	int sort_column;
+	Gtk::SortType sort_order;
+	if (!m_refTreeModel->get_sort_column_id(sort_column, sort_order) && graphlet < list.size()) {
+		Gtk::TreeModel::Path path;
+		path.push_back(graphlet);
+		Gtk::ListStore::iterator iter = m_refTreeModel->get_iter(path);
+		if (iter && (*iter)[pmodel->m_col_graphlet] == graphlet)
+			return iter;
+	}
+
+	Gtk::ListStore::iterator iter;
+	for (iter = list.begin(); iter != list.end(); iter++) {
+		Gtk::ListStore::Row row = *iter;
+		if (row[pmodel->m_col_graphlet] == graphlet)
+			break; // Hit
+	}
+	return iter;
+}
+
 /**
  *	Display graphlet of currently selected line of list view.
  */
@@ -1018,15 +1042,12 @@ void ChostListView::write_cflows(string & filename) {
 void ChostListView::on_button_goto_IP(IPv6_addr remote_IP) {
 	cout << "Search IP address is: " << remote_IP << endl;
 	const Gtk::TreeNodeChildren & list = m_refTreeModel->children();
-	Gtk::ListStore::iterator iter = list.begin();
+	Gtk::ListStore::iterator iter = list.end();
 
-	// Search for localIP first
-	for (iter = list.begin(); iter != list.end(); iter++) {
-		Gtk::ListStore::Row row = *iter;
-		string s = row[pmodel->m_col_IP];
-		if (IPv6_addr(s) == remote_IP)
-			break; // Hit
-	}
+	// Search for localIP first: the host directory holds the graphlet number of each local host
+	size_t graphlet = hostData->get_host_directory().find(remote_IP);
+	if (graphlet != CHostDirectory::npos)
+		iter = find_graphlet_row(graphlet);
 
 	if (iter == list.end()) { // When not found then look up remote IP's
 		// We have to use the flowlist as remoteIPs are not contained in metadata
@@ -153,6 +153,8 @@ class ChostListView: public Gtk::VBox {
 
 		virtual int on_sort_compareIP(const Gtk::TreeModel::iterator& a_, const Gtk::TreeModel::iterator& b_);
 
+		Gtk::ListStore::iterator find_graphlet_row(unsigned int graphlet);
+
 		Gtk::ScrolledWindow m_ScrolledWindow;
 		Gtk::TreeView m_TreeView;
 
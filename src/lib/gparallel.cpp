@@ -0,0 +1,138 @@
+/**
+ *	\file gparallel.cpp
+ *	\brief Spread independent work items over all available processors.
+ *
+ * 	This file is subject to the terms and conditions defined in
+ * 	files 'BSD.txt' and 'GPL.txt'. For a list of authors see file 'AUTHORS'.
+ */
+
+#include <pthread.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include "gparallel.h"
+
+using namespace std;
+
+namespace util {
+
+	/**
+	 *	\struct parallel_state
+	 *	\brief State shared by all workers of one runParallel() call
+	 */
+	struct parallel_state {
+			CParallelTask * task; ///< Work to do
+			unsigned int item_count; ///< Number of items to process
+			unsigned int next_item; ///< Next item to hand out (atomically incremented)
+			volatile bool failed; ///< Set as soon as one item has thrown
+			string error; ///< Error text of the first failed item
+			pthread_mutex_t error_mutex; ///< Protects failed and error
+	};
+
+	/**
+	 *	Record an error of a worker. Only the first error is kept.
+	 *
+	 *	\param state Shared state
+	 *	\param error Error text
+	 */
+	static void set_parallel_error(parallel_state * state, const string & error) {
+		pthread_mutex_lock(&state->error_mutex);
+		if (!state->failed) {
+			state->failed = true;
+			state->error = error;
+		}
+		pthread_mutex_unlock(&state->error_mutex);
+	}
+
+	/**
+	 *	Worker loop: fetch item numbers until all are done or an error occurred.
+	 *
+	 *	\param arg Pointer to the shared parallel_state
+	 *
+	 *	\return Always NULL
+	 */
+	static void * parallel_worker(void * arg) {
+		parallel_state * state = (parallel_state *) arg;
+		while (!state->failed) {
+			unsigned int item = __sync_fetch_and_add(&state->next_item, 1);
+			if (item >= state->item_count)
+				break;
+			try {
+				state->task->run(item);
+			} catch (string & e) {
+				set_parallel_error(state, e);
+			} catch (const char * e) {
+				set_parallel_error(state, e);
+			} catch (std::exception & e) {
+				set_parallel_error(state, e.what());
+			} catch (...) {
+				set_parallel_error(state, "Unknown error in worker thread");
+			}
+		}
+		return NULL;
+	}
+
+	/**
+	 *	Number of worker threads to use: the number of online processors, unless overridden
+	 *	by the environment variable HAPVIEWER_THREADS.
+	 *
+	 *	\return Number of workers (at least 1)
+	 */
+	unsigned int getWorkerCount() {
+		const char * env = getenv("HAPVIEWER_THREADS");
+		if (env != NULL && atoi(env) > 0)
+			return atoi(env);
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		return (cpus > 0) ? (unsigned int) cpus : 1;
+	}
+
+	/**
+	 *	Call task.run(i) for all i in [0, item_count), spread over several threads.
+	 *	Returns after all items are done. Runs in the calling thread if only one worker is needed.
+	 *
+	 *	\param task Work to do
+	 *	\param item_count Number of items
+	 *	\param max_workers Upper limit for the number of threads (0: use getWorkerCount())
+	 *
+	 *	\exception std::string Errortext of the first failed item
+	 */
+	void runParallel(CParallelTask & task, unsigned int item_count, unsigned int max_workers) {
+		unsigned int workers = getWorkerCount();
+		if (max_workers > 0 && max_workers < workers)
+			workers = max_workers;
+		if (workers > item_count)
+			workers = item_count;
+
+		if (workers <= 1) {
+			for (unsigned int item = 0; item < item_count; item++)
+				task.run(item);
+			return;
+		}
+
+		parallel_state state;
+		state.task = &task;
+		state.item_count = item_count;
+		state.next_item = 0;
+		state.failed = false;
+		pthread_mutex_init(&state.error_mutex, NULL);
+
+		// The calling thread is the first worker
+		vector<pthread_t> threads(workers - 1);
+		unsigned int started = 0;
+		for (; started < threads.size(); started++) {
+			if (pthread_create(&threads[started], NULL, parallel_worker, &state) != 0)
+				break; // continue with less threads
+		}
+		parallel_worker(&state);
+		for (unsigned int i = 0; i < started; i++)
+			pthread_join(threads[i], NULL);
+
+		pthread_mutex_destroy(&state.error_mutex);
+		if (state.failed)
+			throw state.error;
+	}
+
+}
@@ -0,0 +1,34 @@
+#ifndef GPARALLEL_H_
+#define GPARALLEL_H_
+
+/**
+ *	\file gparallel.h
+ *	\brief Spread independent work items over all available processors.
+ *
+ * 	This file is subject to the terms and conditions defined in
+ * 	files 'BSD.txt' and 'GPL.txt'. For a list of authors see file 'AUTHORS'.
+ */
+
+#include <string>
+
+namespace util {
+	/**
+	 *	\class CParallelTask
+	 *	\brief Work which can be split into independent, numbered items
+	 *
+	 *	run() gets called exactly once for every item number, possibly from different threads
+	 *	at the same time. Implementations must only touch data belonging to the given item.
+	 */
+	class CParallelTask {
+		public:
+			virtual ~CParallelTask() {
+			}
+			virtual void run(unsigned int item) = 0;
+	};
+
+	unsigned int getWorkerCount();
+	void runParallel(CParallelTask & task, unsigned int item_count, unsigned int max_workers = 0);
+}
+;
+
+#endif /* GPARALLEL_H_ */
@@ -0,0 +1,332 @@
+/**
+ *	\file gpcapreader.cpp
+ *	\brief Reads packets from pcap and pcapng files
+ *
+ * 	This file is subject to the terms and conditions defined in
+ * 	files 'BSD.txt' and 'GPL.txt'. For a list of authors see file 'AUTHORS'.
+ */
+
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "gpcapreader.h"
+
+using namespace std;
+
+#define PCAP_MAGIC_US 0xa1b2c3d4 ///< pcap with microsecond timestamps
+#define PCAP_MAGIC_NS 0xa1b23c4d ///< pcap with nanosecond timestamps
+#define PCAPNG_SECTION_HEADER 0x0a0d0d0a ///< pcapng section header block type
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1a2b3c4d ///< pcapng byte order magic
+#define PCAPNG_INTERFACE 1 ///< pcapng interface description block type
+#define PCAPNG_PACKET 2 ///< pcapng (obsolete) packet block type
+#define PCAPNG_SIMPLE_PACKET 3 ///< pcapng simple packet block type
+#define PCAPNG_ENHANCED_PACKET 6 ///< pcapng enhanced packet block type
+
+/**
+ *	Swaps the byte order of a 32 bit value
+ *
+ *	\param value Value
+ *
+ *	\return Swapped value
+ */
+static inline uint32_t swap32(uint32_t value) {
+	return (value >> 24) | ((value >> 8) & 0xff00) | ((value << 8) & 0xff0000) | (value << 24);
+}
+
+/**
+ *	Constructor: maps the file into memory and reads the file header
+ *
+ *	\param filename File to read
+ *
+ *	\exception std::string Errortext
+ */
+CPcapReader::CPcapReader(const std::string & filename) :
+	filename(filename), data(NULL), size(0), pos(0), pcapng(false), swapped(false), truncated(false), linktype(0), unitsPerSecond(1000000),
+	      lastMs(0) {
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd == -1) {
+		string errtext = "ERROR: could not open file source \"" + filename + "\".";
+		throw errtext;
+	}
+	struct stat filestat;
+	if (fstat(fd, &filestat) == -1 || filestat.st_size < 24) {
+		close(fd);
+		string errtext = filename + " is not a pcap file (too short)";
+		throw errtext;
+	}
+	size = filestat.st_size;
+	void * mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // the mapping stays valid
+	if (mapping == MAP_FAILED) {
+		string errtext = "ERROR: could not map file \"" + filename + "\" into memory.";
+		throw errtext;
+	}
+	madvise(mapping, size, MADV_SEQUENTIAL);
+	data = (const unsigned char *) mapping;
+
+	uint32_t magic;
+	memcpy(&magic, data, 4);
+	if (magic == PCAPNG_SECTION_HEADER) {
+		pcapng = true; // byte order gets known from the section header block
+	} else if (magic == PCAP_MAGIC_US || magic == PCAP_MAGIC_NS || swap32(magic) == PCAP_MAGIC_US || swap32(magic) == PCAP_MAGIC_NS) {
+		swapped = (magic != PCAP_MAGIC_US && magic != PCAP_MAGIC_NS);
+		unitsPerSecond = (read32(data) == PCAP_MAGIC_NS) ? 1000000000 : 1000000;
+		linktype = read32(data + 20);
+		pos = 24;
+	} else {
+		munmap((void *) data, size);
+		string errtext = filename + " is not a pcap or pcapng file (unknown magic number)";
+		throw errtext;
+	}
+}
+
+/**
+ *	Destructor: unmaps the file
+ */
+CPcapReader::~CPcapReader() {
+	munmap((void *) data, size);
+}
+
+/**
+ *	Checks the magic number of a file
+ *
+ *	\param filename File to check
+ *
+ *	\return True if the file starts like a pcap or pcapng file
+ */
+bool CPcapReader::isPcapFile(const std::string & filename) {
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd == -1)
+		return false;
+	uint32_t magic = 0;
+	bool valid = (read(fd, &magic, 4) == 4);
+	close(fd);
+	return valid && (magic == PCAPNG_SECTION_HEADER || magic == PCAP_MAGIC_US || magic == PCAP_MAGIC_NS || swap32(magic) == PCAP_MAGIC_US
+	      || swap32(magic) == PCAP_MAGIC_NS);
+}
+
+/**
+ *	\return True for pcapng files
+ */
+bool CPcapReader::isPcapng() const {
+	return pcapng;
+}
+
+/**
+ *	\return True if the file ended within a record (e.g. capture was interrupted)
+ */
+bool CPcapReader::isTruncated() const {
+	return truncated;
+}
+
+/**
+ *	Reads a 16 bit value in file byte order
+ *
+ *	\param p Position within the mapped file
+ *
+ *	\return Value in host byte order
+ */
+uint16_t CPcapReader::read16(const unsigned char * p) const {
+	uint16_t value;
+	memcpy(&value, p, 2);
+	return swapped ? (uint16_t) ((value >> 8) | (value << 8)) : value;
+}
+
+/**
+ *	Reads a 32 bit value in file byte order
+ *
+ *	\param p Position within the mapped file
+ *
+ *	\return Value in host byte order
+ */
+uint32_t CPcapReader::read32(const unsigned char * p) const {
+	uint32_t value;
+	memcpy(&value, p, 4);
+	return swapped ? swap32(value) : value;
+}
+
+/**
+ *	Converts a timestamp to milliseconds
+ *
+ *	\param timestamp Timestamp in units of 1/unitsPerSecond seconds
+ *	\param unitsPerSecond Resolution of the timestamp
+ *
+ *	\return Milliseconds (cut off, not rounded)
+ */
+uint64_t CPcapReader::toMs(uint64_t timestamp, uint64_t unitsPerSecond) const {
+	return (timestamp / unitsPerSecond) * 1000 + (timestamp % unitsPerSecond) * 1000 / unitsPerSecond;
+}
+
+/**
+ *	Reads up to max packets
+ *
+ *	\param packets Array to fill
+ *	\param max Size of the array
+ *
+ *	\return Number of packets read, 0 at the end of the file
+ *
+ *	\exception std::string Errortext
+ */
+unsigned int CPcapReader::next_batch(pcap_packet * packets, unsigned int max) {
+	unsigned int count = 0;
+	while (count < max && next(packets[count]))
+		count++;
+	return count;
+}
+
+/**
+ *	Reads the next packet
+ *
+ *	\param packet Packet to fill
+ *
+ *	\return False at the end of the file
+ *
+ *	\exception std::string Errortext
+ */
+bool CPcapReader::next(pcap_packet & packet) {
+	return pcapng ? next_pcapng(packet) : next_pcap(packet);
+}
+
+/**
+ *	Reads the next packet of a pcap file
+ *
+ *	\param packet Packet to fill
+ *
+ *	\return False at the end of the file
+ */
+bool CPcapReader::next_pcap(pcap_packet & packet) {
+	if (pos + 16 > size) {
+		truncated = (pos != size);
+		return false;
+	}
+	const unsigned char * record = data + pos;
+	uint32_t caplen = read32(record + 8);
+	if (pos + 16 + caplen > size) {
+		truncated = true;
+		return false;
+	}
+	packet.data = record + 16;
+	packet.caplen = caplen;
+	packet.len = read32(record + 12);
+	packet.startMs = read32(record) * (uint64_t) 1000 + toMs(read32(record + 4), unitsPerSecond);
+	packet.linktype = linktype;
+	pos += 16 + caplen;
+	return true;
+}
+
+/**
+ *	Reads the next packet of a pcapng file, processing the section and interface blocks on the way
+ *
+ *	\param packet Packet to fill
+ *
+ *	\return False at the end of the file
+ *
+ *	\exception std::string Errortext
+ */
+bool CPcapReader::next_pcapng(pcap_packet & packet) {
+	while (true) {
+		if (pos + 12 > size) {
+			truncated = (pos != size);
+			return false;
+		}
+		const unsigned char * block = data + pos;
+		uint32_t type;
+		memcpy(&type, block, 4); // the section header type reads the same in both byte orders
+		if (type == PCAPNG_SECTION_HEADER) {
+			uint32_t magic;
+			memcpy(&magic, block + 8, 4);
+			if (magic != PCAPNG_BYTE_ORDER_MAGIC && swap32(magic) != PCAPNG_BYTE_ORDER_MAGIC) {
+				stringstream error;
+				error << filename << ": bad pcapng section header at offset " << pos;
+				throw error.str();
+			}
+			swapped = (magic != PCAPNG_BYTE_ORDER_MAGIC);
+		}
+		type = read32(block);
+		uint32_t length = read32(block + 4);
+		if (length < 12 || length % 4 != 0) {
+			stringstream error;
+			error << filename << ": bad pcapng block length at offset " << pos;
+			throw error.str();
+		}
+		if (pos + length > size) {
+			truncated = true;
+			return false;
+		}
+		pos += length;
+
+		switch (type) {
+			case PCAPNG_SECTION_HEADER:
+				interfaces.clear();
+				break;
+			case PCAPNG_INTERFACE:
+				read_interface(block, length);
+				break;
+			case PCAPNG_ENHANCED_PACKET:
+			case PCAPNG_PACKET: {
+				if (length < 32)
+					break;
+				uint32_t id = (type == PCAPNG_PACKET) ? read16(block + 8) : read32(block + 8);
+				if (id >= interfaces.size())
+					break;
+				uint64_t timestamp = ((uint64_t) read32(block + 12) << 32) | read32(block + 16);
+				packet.caplen = read32(block + 20);
+				if (packet.caplen > length - 32)
+					packet.caplen = length - 32;
+				packet.len = read32(block + 24);
+				packet.data = block + 28;
+				packet.linktype = interfaces[id].linktype;
+				packet.startMs = toMs(timestamp, interfaces[id].unitsPerSecond);
+				lastMs = packet.startMs;
+				return true;
+			}
+			case PCAPNG_SIMPLE_PACKET: {
+				if (length < 16 || interfaces.empty())
+					break;
+				packet.len = read32(block + 8);
+				packet.caplen = (packet.len < length - 16) ? packet.len : length - 16;
+				packet.data = block + 12;
+				packet.linktype = interfaces[0].linktype;
+				packet.startMs = lastMs; // no timestamp in this block
+				return true;
+			}
+			default:
+				break; // statistics, name resolution, custom blocks etc.
+		}
+	}
+}
+
+/**
+ *	Reads an interface description block of a pcapng file
+ *
+ *	\param block Start of the block
+ *	\param length Total length of the block
+ */
+void CPcapReader::read_interface(const unsigned char * block, uint32_t length) {
+	interface iface;
+	iface.linktype = (length >= 20) ? read16(block + 8) : 0;
+	iface.unitsPerSecond = 1000000;
+
+	// Options: look for if_tsresol
+	uint32_t offset = 16;
+	while (offset + 4 <= length - 4) {
+		uint16_t code = read16(block + offset);
+		uint16_t optlen = read16(block + offset + 2);
+		if (code == 0 || offset + 4 + optlen > length - 4)
+			break;
+		if (code == 9 && optlen >= 1) {
+			uint8_t resolution = block[offset + 4];
+			uint64_t units = 1;
+			for (uint8_t i = 0; i < (resolution & 0x7f) && units < 1000000000000000000ULL; i++)
+				units *= (resolution & 0x80) ? 2 : 10;
+			iface.unitsPerSecond = units;
+		}
+		offset += 4 + ((optlen + 3) & ~3);
+	}
+	interfaces.push_back(iface);
+}
@@ -0,0 +1,85 @@
+#ifndef GPCAPREADER_H_
+#define GPCAPREADER_H_
+
+/**
+ *	\file gpcapreader.h
+ *	\brief Reads packets from pcap and pcapng files
+ *
+ * 	This file is subject to the terms and conditions defined in
+ * 	files 'BSD.txt' and 'GPL.txt'. For a list of authors see file 'AUTHORS'.
+ */
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <cstddef>
+
+#define LINKTYPE_NULL 0 ///< BSD loopback: 4 byte address family
+#define LINKTYPE_ETHERNET 1 ///< Ethernet
+#define LINKTYPE_RAW 101 ///< Raw IPv4 or IPv6
+#define LINKTYPE_LINUX_SLL 113 ///< Linux "cooked" capture
+#define LINKTYPE_IPV4 228 ///< Raw IPv4
+#define LINKTYPE_IPV6 229 ///< Raw IPv6
+
+/**
+ *	\struct	pcap_packet
+ *	\brief	A packet of a pcap or pcapng file. The data points into the mapped file.
+ */
+struct pcap_packet {
+	const unsigned char * data; ///< Captured bytes, starting with the link layer header
+	uint32_t caplen; ///< Number of captured bytes
+	uint32_t len; ///< Length of the packet on the wire
+	uint64_t startMs; ///< Timestamp in milliseconds since the epoch
+	uint16_t linktype; ///< Link layer type (LINKTYPE_*)
+};
+
+/**
+ *	\class	CPcapReader
+ *	\brief	Reads pcap and pcapng files without libpcap
+ *
+ *	The file is mapped into memory and the record headers are walked in place, thus reading a
+ *	packet neither copies its data nor allocates memory. Both byte orders are supported, as well as
+ *	pcap files with nanosecond timestamps and pcapng files with several sections and interfaces.
+ */
+class CPcapReader {
+	public:
+		CPcapReader(const std::string & filename);
+		~CPcapReader();
+
+		static bool isPcapFile(const std::string & filename);
+		unsigned int next_batch(pcap_packet * packets, unsigned int max);
+		bool isPcapng() const;
+		bool isTruncated() const;
+
+	private:
+		/**
+		 *	\struct	interface
+		 *	\brief	Interface of a pcapng section
+		 */
+		struct interface {
+			uint16_t linktype; ///< Link layer type
+			uint64_t unitsPerSecond; ///< Timestamp resolution
+		};
+
+		bool next(pcap_packet & packet);
+		bool next_pcap(pcap_packet & packet);
+		bool next_pcapng(pcap_packet & packet);
+		void read_interface(const unsigned char * block, uint32_t length);
+		uint64_t toMs(uint64_t timestamp, uint64_t unitsPerSecond) const;
+		uint16_t read16(const unsigned char * p) const;
+		uint32_t read32(const unsigned char * p) const;
+
+		std::string filename; ///< Name of the file (for messages)
+		const unsigned char * data; ///< Mapped file
+		size_t size; ///< Size of the file
+		size_t pos; ///< Offset of the next record or block
+		bool pcapng; ///< True for pcapng, false for pcap
+		bool swapped; ///< True if the byte order of the file differs from ours
+		bool truncated; ///< True if the file ends within a record
+		uint16_t linktype; ///< pcap only: link layer type
+		uint64_t unitsPerSecond; ///< pcap only: timestamp resolution
+		uint64_t lastMs; ///< Timestamp of the previous packet (for pcapng packets without timestamp)
+		std::vector<interface> interfaces; ///< pcapng only: interfaces of the current section
+};
+
+#endif /* GPCAPREADER_H_ */
@@ -0,0 +1,306 @@
+/**
+ *	\file gradixsort.cpp
+ *	\brief Multi-threaded radix sort of flowlists.
+ *
+ *	The flows are not moved while sorting. Instead an index array is sorted by an LSD radix sort
+ *	over the 64 bit words of the sort key, least significant word first. Before each word the
+ *	word gets gathered from the flows in the current index order into a key array, then the key
+ *	and index arrays are scattered by one byte per pass. Passes in which all keys share the same
+ *	digit are skipped, which removes most passes for IPv4 addresses and clustered start times.
+ *
+ *	Each pass is split into one chunk per worker: the chunks count their digits, the offsets of
+ *	every (chunk, digit) pair are summed up serially and the chunks then scatter independently.
+ *	A scatter moves keys between chunks, so after the first pass of a word the chunks count the
+ *	digits of the next byte again. The scatter is stable, therefore flows with equal keys keep
+ *	their original order.
+ *
+ * 	This file is subject to the terms and conditions defined in
+ * 	files 'BSD.txt' and 'GPL.txt'. For a list of authors see file 'AUTHORS'.
+ */
+
+#include <stdint.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "gradixsort.h"
+#include "gparallel.h"
+
+using namespace std;
+
+namespace util {
+
+	/**
+	 *	\typedef flow_key_word
+	 *	\brief Extracts one 64 bit word of the sort key of a flow
+	 */
+	typedef uint64_t (*flow_key_word)(const cflow_t & flow);
+
+	/**
+	 *	Load 8 bytes in network byte order, such that the integer order equals the byte wise order.
+	 */
+	static inline uint64_t load_be64(const unsigned char * p) {
+		uint64_t value = 0;
+		for (unsigned int i = 0; i < 8; i++)
+			value = (value << 8) | p[i];
+		return value;
+	}
+
+	static uint64_t local_ip_high(const cflow_t & flow) {
+		return load_be64(flow.localIP.data());
+	}
+
+	static uint64_t local_ip_low(const cflow_t & flow) {
+		return load_be64(flow.localIP.data() + 8);
+	}
+
+	static uint64_t remote_ip_high(const cflow_t & flow) {
+		return load_be64(flow.remoteIP.data());
+	}
+
+	static uint64_t remote_ip_low(const cflow_t & flow) {
+		return load_be64(flow.remoteIP.data() + 8);
+	}
+
+	static uint64_t start_ms(const cflow_t & flow) {
+		return flow.startMs;
+	}
+
+	/**
+	 *	\struct radix_state
+	 *	\brief Arrays shared by all chunks of one radix sort
+	 */
+	struct radix_state {
+			const CFlowList * flowlist; ///< Flows to sort
+			size_t count; ///< Number of flows
+			unsigned int chunks; ///< Number of chunks
+			size_t chunk_size; ///< Flows per chunk (the last chunk may be shorter)
+			flow_key_word word; ///< Word of the key currently sorted by
+			unsigned int byte; ///< Byte of word currently sorted by
+			vector<uint64_t> keys, keys_out; ///< Current word of the flows in index order
+			vector<uint32_t> index, index_out; ///< Flow numbers in sorted order
+			vector<size_t> counts; ///< Digit counts per chunk and byte (chunks * 8 * 256)
+			vector<size_t> offsets; ///< Output position per chunk and digit of the current pass (chunks * 256)
+
+			size_t chunk_begin(unsigned int chunk) const {
+				return min(count, chunk * chunk_size);
+			}
+			size_t chunk_end(unsigned int chunk) const {
+				return min(count, (chunk + 1) * chunk_size);
+			}
+	};
+
+	/**
+	 *	\class CRadixGatherTask
+	 *	\brief Fetch the current word of a chunk and count the digits of all its bytes
+	 */
+	class CRadixGatherTask: public CParallelTask {
+		public:
+			CRadixGatherTask(radix_state & state) :
+				state(state) {
+			}
+			void run(unsigned int chunk) {
+				size_t * counts = &state.counts[chunk * 8 * 256];
+				fill(counts, counts + 8 * 256, 0);
+				for (size_t i = state.chunk_begin(chunk); i < state.chunk_end(chunk); i++) {
+					uint64_t key = state.word((*state.flowlist)[state.index[i]]);
+					state.keys[i] = key;
+					for (unsigned int b = 0; b < 8; b++)
+						counts[b * 256 + ((key >> (8 * b)) & 0xff)]++;
+				}
+			}
+
+		private:
+			radix_state & state;
+	};
+
+	/**
+	 *	\class CRadixCountTask
+	 *	\brief Count the digits of the current byte of a chunk after a scatter changed its keys
+	 */
+	class CRadixCountTask: public CParallelTask {
+		public:
+			CRadixCountTask(radix_state & state) :
+				state(state) {
+			}
+			void run(unsigned int chunk) {
+				size_t * counts = &state.counts[(chunk * 8 + state.byte) * 256];
+				unsigned int shift = 8 * state.byte;
+				fill(counts, counts + 256, 0);
+				for (size_t i = state.chunk_begin(chunk); i < state.chunk_end(chunk); i++)
+					counts[(state.keys[i] >> shift) & 0xff]++;
+			}
+
+		private:
+			radix_state & state;
+	};
+
+	/**
+	 *	\class CRadixScatterTask
+	 *	\brief Move the keys and flow numbers of a chunk to their position for the current byte
+	 */
+	class CRadixScatterTask: public CParallelTask {
+		public:
+			CRadixScatterTask(radix_state & state) :
+				state(state) {
+			}
+			void run(unsigned int chunk) {
+				size_t * offsets = &state.offsets[chunk * 256];
+				unsigned int shift = 8 * state.byte;
+				for (size_t i = state.chunk_begin(chunk); i < state.chunk_end(chunk); i++) {
+					uint64_t key = state.keys[i];
+					size_t pos = offsets[(key >> shift) & 0xff]++;
+					state.keys_out[pos] = key;
+					state.index_out[pos] = state.index[i];
+				}
+			}
+
+		private:
+			radix_state & state;
+	};
+
+	/**
+	 *	\class CFlowGatherTask
+	 *	\brief Copy the flows of a chunk into sorted order
+	 */
+	class CFlowGatherTask: public CParallelTask {
+		public:
+			CFlowGatherTask(const radix_state & state, CFlowList & sorted) :
+				state(state), sorted(sorted) {
+			}
+			void run(unsigned int chunk) {
+				for (size_t i = state.chunk_begin(chunk); i < state.chunk_end(chunk); i++)
+					sorted[i] = (*state.flowlist)[state.index[i]];
+			}
+
+		private:
+			const radix_state & state;
+			CFlowList & sorted;
+	};
+
+	/**
+	 *	Check whether a byte needs a scatter pass. The digit totals over all chunks do not change
+	 *	when keys move between chunks, therefore the counts of the gather are sufficient.
+	 *
+	 *	\param state Sort state with counts of the current word
+	 *	\param byte Byte of the current word
+	 *
+	 *	\return False if all keys have the same digit, i.e. the pass can be skipped
+	 */
+	static bool radix_pass_needed(const radix_state & state, unsigned int byte) {
+		for (unsigned int digit = 0; digit < 256; digit++) {
+			size_t total = 0;
+			for (unsigned int chunk = 0; chunk < state.chunks; chunk++)
+				total += state.counts[(chunk * 8 + byte) * 256 + digit];
+			if (total == state.count)
+				return false;
+			if (total != 0)
+				return true;
+		}
+		return true;
+	}
+
+	/**
+	 *	Compute the output position of every (chunk, digit) pair for one byte.
+	 *
+	 *	\param state Sort state with counts of the chunks as they are now
+	 *	\param byte Byte of the current word
+	 */
+	static void radix_offsets(radix_state & state, unsigned int byte) {
+		size_t pos = 0;
+		for (unsigned int digit = 0; digit < 256; digit++) {
+			for (unsigned int chunk = 0; chunk < state.chunks; chunk++) {
+				state.offsets[chunk * 256 + digit] = pos;
+				pos += state.counts[(chunk * 8 + byte) * 256 + digit];
+			}
+		}
+	}
+
+	/**
+	 *	Sort the flow numbers of flowlist by a key made up of several words.
+	 *
+	 *	\param state Sort state to initialize, holds the sorted flow numbers in state.index afterwards
+	 *	\param flowlist Flows to sort
+	 *	\param words Words of the key, most significant first
+	 *	\param word_count Number of words
+	 *
+	 *	\exception std::string Errormessage
+	 */
+	static void radix_sort_index(radix_state & state, const CFlowList & flowlist, const flow_key_word * words, unsigned int word_count) {
+		state.flowlist = &flowlist;
+		state.count = flowlist.size();
+		if (state.count > 0xffffffffUL)
+			throw string("Too many flows for the radix sort");
+		state.chunks = max(1u, min(getWorkerCount(), (unsigned int) (state.count / RADIX_MIN_CHUNK)));
+		state.chunk_size = (state.count + state.chunks - 1) / state.chunks;
+		state.keys.resize(state.count);
+		state.keys_out.resize(state.count);
+		state.index.resize(state.count);
+		state.index_out.resize(state.count);
+		state.counts.resize(state.chunks * 8 * 256);
+		state.offsets.resize(state.chunks * 256);
+		for (size_t i = 0; i < state.count; i++)
+			state.index[i] = i;
+
+		CRadixGatherTask gather(state);
+		CRadixCountTask recount(state);
+		CRadixScatterTask scatter(state);
+		for (unsigned int w = word_count; w-- > 0;) {
+			state.word = words[w];
+			runParallel(gather, state.chunks);
+			bool scattered = false;
+			for (state.byte = 0; state.byte < 8; state.byte++) {
+				if (!radix_pass_needed(state, state.byte))
+					continue;
+				// The counts of the gather describe the chunks before the first scatter of the word
+				if (scattered && state.chunks > 1)
+					runParallel(recount, state.chunks);
+				radix_offsets(state, state.byte);
+				runParallel(scatter, state.chunks);
+				scattered = true;
+				state.keys.swap(state.keys_out);
+				state.index.swap(state.index_out);
+			}
+		}
+	}
+
+	/**
+	 *	Sort a flowlist in the order of cflow_t::operator< (localIP, remoteIP, startMs).
+	 *	Flows with equal keys keep their relative order.
+	 *
+	 *	Needs temporary memory for a second copy of the flowlist plus 24 bytes per flow.
+	 *
+	 *	\param flowlist Flowlist to sort
+	 *
+	 *	\exception std::string Errormessage
+	 */
+	void sortFlowlist(CFlowList & flowlist) {
+		static const flow_key_word words[] = { local_ip_high, local_ip_low, remote_ip_high, remote_ip_low, start_ms };
+		radix_state state;
+		radix_sort_index(state, flowlist, words, sizeof(words) / sizeof(words[0]));
+		state.keys.clear();
+		state.keys_out.clear();
+		state.index_out.clear();
+
+		CFlowList sorted(flowlist.size());
+		CFlowGatherTask copy(state, sorted);
+		runParallel(copy, state.chunks);
+		flowlist.swap(sorted);
+	}
+
+	/**
+	 *	Get the flow numbers of a flowlist in ascending order of the remote IP addresses.
+	 *	Flows with equal remote IP address stay in the order of the flowlist.
+	 *
+	 *	\param flowlist Flowlist
+	 *	\param index Receives the flow numbers: index[i] is the flow with the i-th smallest remote IP
+	 *
+	 *	\exception std::string Errormessage
+	 */
+	void sortIndexByRemoteIP(const CFlowList & flowlist, vector<int> & index) {
+		static const flow_key_word words[] = { remote_ip_high, remote_ip_low };
+		radix_state state;
+		radix_sort_index(state, flowlist, words, sizeof(words) / sizeof(words[0]));
+		index.assign(state.index.begin(), state.index.end());
+	}
+}
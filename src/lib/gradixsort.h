@@ -0,0 +1,24 @@
+#ifndef GRADIXSORT_H_
+#define GRADIXSORT_H_
+
+/**
+ *	\file gradixsort.h
+ *	\brief Multi-threaded radix sort of flowlists.
+ *
+ * 	This file is subject to the terms and conditions defined in
+ * 	files 'BSD.txt' and 'GPL.txt'. For a list of authors see file 'AUTHORS'.
+ */
+
+#include <vector>
+
+#include "cflow.h"
+
+#define RADIX_MIN_CHUNK 65536 ///< Minimum number of flows per thread of the radix sort
+
+namespace util {
+	void sortFlowlist(CFlowList & flowlist);
+	void sortIndexByRemoteIP(const CFlowList & flowlist, std::vector<int> & index);
+}
+;
+
+#endif /* GRADIXSORT_H_ */
@@ -53,6 +53,8 @@ CRole::CRole(Subflowlist flow_list, const prefs_t & prefs) :
 	role_count = 0;
 	first2 = true;
 	first = true;
+	full_flowlist = NULL;
+	rating_count = 0;
 }
 
 /**
@@ -68,26 +70,46 @@ void CRole::rate_role(role_t& role, const CFlowList& full_flowlist, const Subflo
 }
 
 /**
- * Create ratings for all roles of this type. Uses rate_role to rate roles. Only implemented in sub-classes.
+ * Set the flowlist the roles are rated against. Roles are rated on demand, i.e., only when
+ * getRating() is called for a role involved in a flow conflict.
  *
  * \param full_flowlist Flowlist containing all available data
  */
-void CRole::rate_roles(const CFlowList& full_flowlist) {
-	assert(false);
-	// only used for sub-classes
+void CRole::set_full_flowlist(const CFlowList& full_flowlist) {
+	this->full_flowlist = &full_flowlist;
+}
+
+/**
+ * Get the rating of a role, rating it on first use. Uses rate_role to rate the role.
+ *
+ * \param role Role to be rated
+ *
+ * \return float Flow rating
+ */
+float CRole::get_role_rating(role_t& role) {
+	if (!role.rated) {
+		assert(full_flowlist != NULL);
+		rate_role(role, *full_flowlist, flowlist);
+		role.rated = true;
+		rating_count++;
+	}
+	return role.rating;
 }
 
 /**
- * Get the role rating for the specified role. Only implemented in sub-classes.
+ * Get the role rating for the specified role. The role is rated on first use.
  *
  * \param role_id Role id
  *
  * \return float Flow rating
  */
 float CRole::getRating(const int role_id) {
-	assert(false);
-	return 0.0;
-	// only used for sub-classes
+	role_t * role = getRole(role_id);
+	if (role == NULL) {
+		cout << "unable to find role with role id " << role_id << endl;
+		return 0;
+	}
+	return get_role_rating(*role);
 }
 
 /**
@@ -108,67 +130,75 @@ void CP2pRole::rate_role(role_t& role, const CFlowList& full_flowlist, const Sub
 	// calculate flow rating
 	uint32_t flow_counter = flowlist_size;
 	// step 1: prepare "filters" used to identify candidates
-	bool local_ip_set = false; // helps to avoid unnecessary copying of the local ip address
-	set<IPv6_addr> remote_ips;
-	IPv6_addr local_ip;
-	uint32_t protocol = role.prot;
+	// (addresses are compared by their ids: the ids of full_flowlist are stored in the dictionary)
+	const CIpDictionary & ipDictionary = proleMembership->get_ip_dictionary();
+	const CRemoteServiceIndex & serviceIndex = proleMembership->get_service_index();
+	CIpDictionary::ipId local_ip = CIpDictionary::no_id;
+	uint8_t protocol = role.prot;
+	vector<CIpDictionary::ipId> remote_ips; // the role's remote IPs
 	for (set<int>::const_iterator it = role.flow_set->begin(); it != role.flow_set->end(); it++) {
-		if (!local_ip_set) {
-			local_ip = sub_flowlist[*it].localIP;
-			local_ip_set = true;
-		}
-		remote_ips.insert(sub_flowlist[*it].remoteIP);
-	}
-		// step 1.1 calculate client candidates with high role number
-		// generate candidates
-		p2pClientCandidateHashMap client_candidates;
-		for (Subflowlist::const_iterator it = full_flowlist.begin(); it != full_flowlist.end(); it++) {
-			// flow is not a candidate because it..
-			if (it->localIP == local_ip || // ..is part of the graphlet
-					it->prot != protocol || // ..uses another protocol
-					remote_ips.find(it->remoteIP) == remote_ips.end()) { // ..communicates with other remote IPs(== is not in the role's remote ip set)
+		if (local_ip == CIpDictionary::no_id)
+			local_ip = proleMembership->get_local_id(*it);
+		remote_ips.push_back(proleMembership->get_remote_id(*it));
+	}
+	sort(remote_ips.begin(), remote_ips.end());
+	remote_ips.erase(unique(remote_ips.begin(), remote_ips.end()), remote_ips.end());
+	// Only flows with one of the role's remote IPs and the role's protocol can be candidates: the index
+	// holds them as one range per remote IP
+	vector<CRemoteServiceIndex::const_iterator> range_begin(remote_ips.size()), range_end(remote_ips.size());
+	for (size_t r = 0; r < remote_ips.size(); r++)
+		serviceIndex.find(remote_ips[r], protocol, range_begin[r], range_end[r]);
+
+	// step 1.1 calculate client candidates with high role number
+	// generate candidates
+	p2pClientCandidateHashMap client_candidates;
+	for (size_t r = 0; r < remote_ips.size(); r++) {
+		for (CRemoteServiceIndex::const_iterator e = range_begin[r]; e != range_end[r]; ++e) {
+			const cflow_t * it = &full_flowlist[e->flow];
+			// flow is not a candidate because it is part of the graphlet
+			if (ipDictionary.get_local_id(e->flow) == local_ip)
 				continue;
-			}
-			HashKeyIPv6_5T_2 client_key(it->localIP, it->remoteIP, it->prot, it->localPort, it->flowtype);
+			p2pClientCandidateHashKey client_key(ipDictionary.get_local_id(e->flow), remote_ips[r], it->prot, it->localPort, it->flowtype);
 			p2pClientCandidateHashMap::iterator candidate_set = client_candidates.find(client_key);
 			if (candidate_set == client_candidates.end()) { // entry does not exist => create
 				set<const cflow_t*> candidates;
-				candidates.insert(&(*it));
+				candidates.insert(it);
 				client_candidates[client_key] = candidates;
 			} else { // entry exists => update
-				candidate_set->second.insert(&(*it));
+				candidate_set->second.insert(it);
 			}
 		}
-		// accept candidates with remote_port
-		set<const cflow_t*> accepted_client_candidates;
-		for (p2pClientCandidateHashMap::iterator it = client_candidates.begin(); it != client_candidates.end(); it++) {
-			if (it->second.size() < client_threshold) { // ignore roles with less than client_threshold flows
-				continue;
-			}
-			for (set<const cflow_t*>::iterator flow_set_it = it->second.begin(); flow_set_it != it->second.end(); flow_set_it++) {
-				if ((*flow_set_it)->remotePort >= p2p_port_threshold) { // port is greater than p2p_port_threshold => accept candidate
-					accepted_client_candidates.insert(*flow_set_it);
-				}
+	}
+	// accept candidates with remote_port
+	set<const cflow_t*> accepted_client_candidates;
+	for (p2pClientCandidateHashMap::iterator it = client_candidates.begin(); it != client_candidates.end(); it++) {
+		if (it->second.size() < client_threshold) { // ignore roles with less than client_threshold flows
+			continue;
+		}
+		for (set<const cflow_t*>::iterator flow_set_it = it->second.begin(); flow_set_it != it->second.end(); flow_set_it++) {
+			if ((*flow_set_it)->remotePort >= p2p_port_threshold) { // port is greater than p2p_port_threshold => accept candidate
+				accepted_client_candidates.insert(*flow_set_it);
 			}
 		}
+	}
 
 	// step 2: find flows outside of the current graphlet, that would share the role
-	for (vector<cflow_t>::const_iterator it = full_flowlist.begin(); it != full_flowlist.end(); it++) {
-		// flow is not counted because it..
-		if (it->localIP == local_ip || // ..already is
-				(it->remotePort < p2p_port_threshold && it->localPort < p2p_port_threshold) || // ..has both port numbers < p2p_port_threshold
-					it->prot != protocol || // ..uses another protocol
-					remote_ips.find(it->remoteIP) == remote_ips.end()) { // ..communicates with other remote IPs(== is not in the role's remote ip set)
-			continue;
-		}
-		// check if the candidate flows match the p2p criteria
-		bool high_ports = (it->remotePort >= p2p_port_threshold && it->localPort >= p2p_port_threshold);
-		bool client_high_service = accepted_client_candidates.find(&(*it)) != accepted_client_candidates.end();
-		// hosts using both protocols are automatically included by the normal candidate generation&prining process
-		if (high_ports ||
-				client_high_service) {
-			// role candidate outside current graphlet found => increment counter
-			flow_counter++;
+	for (size_t r = 0; r < remote_ips.size(); r++) {
+		for (CRemoteServiceIndex::const_iterator e = range_begin[r]; e != range_end[r]; ++e) {
+			const cflow_t * it = &full_flowlist[e->flow];
+			// flow is not counted because it..
+			if (ipDictionary.get_local_id(e->flow) == local_ip || // ..already is
+					(it->remotePort < p2p_port_threshold && it->localPort < p2p_port_threshold)) { // ..has both port numbers < p2p_port_threshold
+				continue;
+			}
+			// check if the candidate flows match the p2p criteria
+			bool high_ports = (it->remotePort >= p2p_port_threshold && it->localPort >= p2p_port_threshold);
+			bool client_high_service = accepted_client_candidates.find(it) != accepted_client_candidates.end();
+			// hosts using both protocols are automatically included by the normal candidate generation&prining process
+			if (high_ports || client_high_service) {
+				// role candidate outside current graphlet found => increment counter
+				flow_counter++;
+			}
 		}
 	}
 
@@ -177,37 +207,6 @@ void CP2pRole::rate_role(role_t& role, const CFlowList& full_flowlist, const Sub
 	role.rating = min(role.rating, 1.0f); // ensures that rating is <= 1
 }
 
-/**
- * Create ratings for all roles of this type. Uses rate_role to rate roles.
- *
- * \param full_flowlist Flowlist containing all available data
- */
-void CP2pRole::rate_roles(const CFlowList& full_flowlist) {
-	for (p2pRoleHashMap::iterator it = hm_p2p_role->begin(); it != hm_p2p_role->end(); it++) {
-		if ((it->second)->role_num == 0) { // skip invalid roles
-			continue;
-		}
-		rate_role(*(it->second), full_flowlist, flowlist);
-	}
-}
-
-/**
- * Get the role rating for the specified role.
- *
- * \param role_id Role id
- *
- * \return float Flow rating
- */
-float CP2pRole::getRating(const int role_id) {
-	for (p2pRoleHashMap::iterator it = hm_p2p_role->begin(); it != hm_p2p_role->end(); it++) {
-		if ((it->second)->role_num == role_id) { // skip invalid roles
-			return (*(it->second)).rating;
-		}
-	}
-	cout << "unable to find p2p role with role id " << role_id << endl;
-	return 0;
-}
-
 /**
  * Create ratings for a specific role. Ratings are used to resolve role conflicts.
  *
@@ -223,37 +222,6 @@ void CServerRole::rate_role(role_t& role, const CFlowList& full_flowlist, const
 	role.rating = min(role.rating, 1.0f); // ensures that rating is <= 1
 }
 
-/**
- * Create ratings for all roles of this type. Uses rate_role to rate roles.
- *
- * \param full_flowlist Flowlist containing all available data
- */
-void CServerRole::rate_roles(const CFlowList& full_flowlist) {
-	for (srvRoleHashMap::iterator it = hm_server_role->begin(); it != hm_server_role->end(); it++) {
-		if ((it->second)->role_num == 0) { // skip invalid roles
-			continue;
-		}
-		rate_role(*(it->second), full_flowlist, flowlist);
-	}
-}
-
-/**
- * Get the role rating for the specified role.
- *
- * \param role_id Role id
- *
- * \return float Flow rating
- */
-float CServerRole::getRating(const int role_id) {
-	for (srvRoleHashMap::iterator it = hm_server_role->begin(); it != hm_server_role->end(); it++) {
-		if ((it->second)->role_num == role_id) { // skip invalid roles
-			return (*(it->second)).rating;
-		}
-	}
-	cout << "unable to find server role with role id " << role_id << endl;
-	return 0;
-}
-
 /**
  * Create ratings for a specific role. Ratings are used to resolve role conflicts.
  *
@@ -274,10 +242,10 @@ void CClientRole::rate_role(role_t& role, const CFlowList& full_flowlist, const
 	// calculate flow rating
 	uint32_t flow_counter = 0;
 	// step 1: prepare "filters" used to identify candidates
-	bool local_ip_set = false; // helps to avoid unnecessary copying of the local ip address
-	set<IPv6_addr> remote_ips;
-	IPv6_addr local_ip;
-	uint32_t protocol = role.prot;
+	// (addresses are compared by their ids: the ids of full_flowlist are stored in the dictionary)
+	const CIpDictionary & ipDictionary = proleMembership->get_ip_dictionary();
+	const CRemoteServiceIndex & serviceIndex = proleMembership->get_service_index();
+	uint8_t protocol = role.prot;
 	uint16_t remote_port = role.remotePort;
 	set<int> flow_set;
 	flow_set.insert(role.flow_set->begin(), role.flow_set->end());
@@ -288,74 +256,34 @@ void CClientRole::rate_role(role_t& role, const CFlowList& full_flowlist, const
 		}
 	}
 	flow_counter = flow_set.size();
+	CIpDictionary::ipId local_ip = CIpDictionary::no_id;
+	vector<CIpDictionary::ipId> remote_ips; // the role's remote IPs
 	for (set<int>::const_iterator it = flow_set.begin(); it != flow_set.end(); it++) {
-		if (!local_ip_set) {
-			local_ip = sub_flowlist[*it].localIP;
-			local_ip_set = true;
-		}
-		remote_ips.insert(sub_flowlist[*it].remoteIP);
+		if (local_ip == CIpDictionary::no_id)
+			local_ip = proleMembership->get_local_id(*it);
+		remote_ips.push_back(proleMembership->get_remote_id(*it));
 	}
+	sort(remote_ips.begin(), remote_ips.end());
+	remote_ips.erase(unique(remote_ips.begin(), remote_ips.end()), remote_ips.end());
 
 	// step 2: find flows outside of the current graphlet, that would share the role
-	for (vector<cflow_t>::const_iterator it = full_flowlist.begin(); it != full_flowlist.end(); it++) {
-		// flow is not counted because it..
-		if (it->localIP == local_ip || // ..already is
-				it->remotePort != remote_port || // ..uses the wrong remote port
-				it->prot != protocol || // ..uses another protocol
-				remote_ips.find(it->remoteIP) == remote_ips.end()) { // ..communicates with other remote IPs(== is not in the role's remote ip set)
-			continue;
+	// (the index yields the flows of each remote IP using the role's protocol and remote port)
+	for (size_t r = 0; r < remote_ips.size(); r++) {
+		CRemoteServiceIndex::const_iterator first, last;
+		serviceIndex.find(remote_ips[r], protocol, remote_port, first, last);
+		for (CRemoteServiceIndex::const_iterator e = first; e != last; ++e) {
+			// flow is not counted because it already is
+			if (ipDictionary.get_local_id(e->flow) == local_ip)
+				continue;
+			// role candidate outside current graphlet found => increment counter
+			flow_counter++;
 		}
-		// role candidate outside current graphlet found => increment counter
-		flow_counter++;
 	}
 	// step 3: calculate rating
 	role.rating = flow_counter/((float)flow_rate_threshold);
 	role.rating = min(role.rating, 1.0f); // ensures that rating is <= 1
 }
 
-/**
- * Create ratings for all roles of this type. Uses rate_role to rate roles.
- *
- * \param full_flowlist Flowlist containing all available data
- */
-void CClientRole::rate_roles(const CFlowList& full_flowlist) {
-	for (cltRoleHashMap::iterator it = hm_client_role->begin(); it != hm_client_role->end(); it++) {
-		if ((it->second)->role_num == 0) { // skip invalid roles
-			continue;
-		}
-		rate_role(*(it->second), full_flowlist, flowlist);
-	}
-	for (cltRoleHashMap::iterator it = hm_multiclient_role->begin(); it != hm_multiclient_role->end(); it++) {
-		if ((it->second)->role_num == 0) { // skip invalid roles
-			continue;
-		}
-		rate_role(*(it->second), full_flowlist, flowlist);
-	}
-}
-
-/**
- * Get the role rating for the specified role.
- *
- * \param role_id Role id
- *
- * \return float Flow rating
- */
-float CClientRole::getRating(const int role_id) {
-	// need to check both client and multi client hash-map
-	for (cltRoleHashMap::iterator it = hm_multiclient_role->begin(); it != hm_multiclient_role->end(); it++) {
-		if ((it->second)->role_num == role_id) { // skip invalid roles
-			return (*(it->second)).rating;
-		}
-	}
-	for (cltRoleHashMap::iterator it = hm_client_role->begin(); it != hm_client_role->end(); it++) {
-		if ((it->second)->role_num == role_id) { // skip invalid roles
-			return (*(it->second)).rating;
-		}
-	}
-	cout << "unable to find client role with role id " << role_id << endl;
-	return 0;
-}
-
 /**
  * Destructor
  */
@@ -367,7 +295,7 @@ CRole::~CRole() {
  * Default constructor for rhost_t. Used in candidate generation.
  */
 CRole::rhost_t::rhost_t() {
-	remoteIP = IPv6_addr(); // was: remoteIP = 0;
+	remoteId = CIpDictionary::no_id;
 	uses_tcp = false;
 	uses_udp = true;
 	flows = 0;
@@ -377,12 +305,12 @@ CRole::rhost_t::rhost_t() {
 /**
  * Constructor for rhost_t. Used in candidate generation.
  *
- * \param remoteIP Remote IP address
+ * \param remoteId Id of the remote IP address
  * \param flows Number of flows
  * \param packets Number of packets
  */
-CRole::rhost_t::rhost_t(IPv6_addr remoteIP, int flows, int packets) {
-	this->remoteIP = remoteIP;
+CRole::rhost_t::rhost_t(CIpDictionary::ipId remoteId, int flows, int packets) {
+	this->remoteId = remoteId;
 	uses_tcp = false;
 	uses_udp = true;
 	this->flows = flows;
@@ -482,17 +410,18 @@ void CRole::role_t::recalculateSummaries(const Subflowlist& flow_list, const int
 	}
 
 	// update summary node data
-	CRoleMembership::sumnode_t * sn = role_membership.get_summaryNode(flow_list[flow_id].remoteIP);
+	CIpDictionary::ipId remoteId = role_membership.get_remote_id(flow_id);
+	CRoleMembership::sumnode_t * sn = role_membership.get_summaryNode(remoteId);
 	if (sn != NULL) {
 		map<int, uint64_t>::iterator sn_iter = sn->role_map.find(this->role_num);
 		if (sn_iter != sn->role_map.end()) { // found the entry
 			uint32_t sn_p = (sn_iter->second) & 0xffff;
 			uint32_t sn_f = (sn_iter->second) >> 32;
 			if (sn_f == 1) { // only one flow left => remove role from summary node
-				role_membership.remove_role(flow_list[flow_id].remoteIP, this);
+				role_membership.remove_role(remoteId, this);
 				if (debug) {
 					cout << "removed link to summary node containing ip " << flow_list[flow_id].remoteIP << endl;
-					this->rIP_set->erase(flow_list[flow_id].remoteIP);
+					this->rIP_set->erase(remoteId);
 				}
 			} else { // other flows exists => decrement values
 				if (debug) {
@@ -516,16 +445,38 @@ void CRole::role_t::recalculateSummaries(const Subflowlist& flow_list, const int
 }
 
 /**
- * Find the role that corresponds to a role number. Only implemented in sub-classes.
+ * Find the role that corresponds to a role number.
  *
  * \param role_id Role number
  *
  * \return CRole::role_t* Pointer to the role(if found), NULL otherwise
  */
 CRole::role_t* CRole::getRole(const int role_id) {
-	assert(false);
-	// only implemented by sub-classes
-	return NULL;
+	if (role_id <= 0 || (size_t) role_id >= role_table.size())
+		return NULL; // role not found
+	return role_table[role_id];
+}
+
+/**
+ * Register a role of this type, making it available to getRole().
+ *
+ * \param role Role to be registered
+ */
+void CRole::add_role(role_t * role) {
+	if ((size_t) role->role_num >= role_table.size())
+		role_table.resize(role->role_num + 1, NULL);
+	role_table[role->role_num] = role;
+}
+
+/**
+ * Mark a role as invalid (role number 0) and remove it from the role table.
+ *
+ * \param role Role to be dismissed
+ */
+void CRole::dismiss_role(role_t & role) {
+	if ((size_t) role.role_num < role_table.size())
+		role_table[role.role_num] = NULL;
+	role.role_num = 0;
 }
 
 /**
@@ -542,7 +493,7 @@ void CRole::create_pseudo_roles(role_t& role, CRoleMembership& membership) {
 		for (set<role_pattern>::const_iterator sub_pattern = sub_patterns.begin(); sub_pattern != sub_patterns.end(); ++sub_pattern) {
 			// copy data from original role
 			boost::shared_ptr<role_t> p_r(
-			      new role_t(membership.get_next_role_num(role.role_type), role.prot, role.localPort, role.remotePort, role.remoteIP, role.flows, role.flowtype,
+			      new role_t(membership.get_next_role_num(role.role_type), role.prot, role.localPort, role.remotePort, role.remoteId, role.flows, role.flowtype,
 			            role.bytes, role.packets, role.role_type));
 			(*p_r.get()).rIP_set->insert(role.rIP_set->begin(), role.rIP_set->end());
 			(*p_r.get()).flow_set->insert(role.flow_set->begin(), role.flow_set->end());
@@ -558,10 +509,12 @@ void CRole::create_pseudo_roles(role_t& role, CRoleMembership& membership) {
 
 /**
  * Print a remote host to cout. Used for debugging.
+ *
+ * \param ipDictionary Dictionary of remoteId
  */
-void CRole::rhost_t::print_rhost() {
+void CRole::rhost_t::print_rhost(const CIpDictionary & ipDictionary) {
 	cout << "rhost details:";
-	cout << "\n\t remoteIP = " << remoteIP << " tcp = " << (uses_tcp ? "TRUE" : "FALSE") << " udp = " << (uses_udp ? "TRUE" : "FALSE");
+	cout << "\n\t remoteIP = " << ipDictionary.get_ip(remoteId) << " tcp = " << (uses_tcp ? "TRUE" : "FALSE") << " udp = " << (uses_udp ? "TRUE" : "FALSE");
 	cout << ", flows = " << flows << ", packets = " << packets;
 	cout << "\n\trole_map = ";
 	for (map<int, uint64_t>::iterator it = role_map.begin(); it != role_map.end(); it++) {
@@ -577,25 +530,26 @@ void CRole::rhost_t::print_rhost() {
  * \param prot Protocol number
  * \param localPort Local port
  * \param remotePort Remote port
- * \param remoteIP Remote IP address
+ * \param remoteId Id of the remote IP address
  * \param flows number of flows in the role
  * \param flowtype Flowtype(contains information like flow direction)
  * \param bytes Total number of bytes
  */
-CRole::role_t::role_t(int role_num, uint32_t prot, uint16_t localPort, uint16_t remotePort, IPv6_addr remoteIP, int flows, uint8_t flowtype, uint64_t bytes,
-      uint32_t packets, char role_type) {
+CRole::role_t::role_t(int role_num, uint32_t prot, uint16_t localPort, uint16_t remotePort, CIpDictionary::ipId remoteId, int flows, uint8_t flowtype,
+      uint64_t bytes, uint32_t packets, char role_type) {
 	this->role_num = role_num, this->prot = prot;
 	this->localPort = localPort;
 	this->remotePort = remotePort;
-	this->remoteIP = remoteIP;
+	this->remoteId = remoteId;
 	this->flows = flows;
 	this->flowtype = flowtype;
 	this->bytes = bytes;
 	this->packets = packets;
 	this->role_type = role_type;
 	this->rating = 0;
+	this->rated = false;
 
-	rIP_set = new set<IPv6_addr>;
+	rIP_set = new set<CIpDictionary::ipId>;
 	flow_set = new set<int>;
 	role_set = new set<int>;
 	role_set_ = new set<role_t*>;
@@ -762,19 +716,21 @@ CRole::role_t::~role_t() {
 
 /**
  * Print a role to cout. Used for debugging.
+ *
+ * \param ipDictionary Dictionary of the remote IP ids
  */
-void CRole::role_t::print_role() const {
+void CRole::role_t::print_role(const CIpDictionary & ipDictionary) const {
 	cout << "************************\n";
 	cout << "role details:\n\ttype = " << role_type << ", num = " << role_num << ", prot = " << util::ipV6ProtocolToString(prot) << ", localPort = "
 	      << localPort;
 	string buf;
-	cout << ", remotePort = " << remotePort << ", remoteIP = " << remoteIP << ", flows = " << flows;
+	cout << ", remotePort = " << remotePort << ", remoteIP = " << ipDictionary.get_ip(remoteId) << ", flows = " << flows;
 	cout << ", flowtype = " << util::print_flowtype(flowtype) << ", bytes = " << bytes << ", packets = " << packets;
 	cout << ", pattern: " << util::graphletSummarizationToString(pattern);
 	cout << "\n\trIP_set =";
 	int cnt = 0;
-	for (set<IPv6_addr>::iterator it = rIP_set->begin(); it != rIP_set->end(); it++) {
-		cout << " " << *it;
+	for (set<CIpDictionary::ipId>::iterator it = rIP_set->begin(); it != rIP_set->end(); it++) {
+		cout << " " << ipDictionary.get_ip(*it);
 		cnt++;
 	}
 	if (cnt == 0)
@@ -797,8 +753,13 @@ void CRole::role_t::print_role() const {
 
 /**
  * Constructor for CRoleMembership
+ *
+ * \param ipDictionary Ids of the addresses of the full flowlist
+ * \param serviceIndex Flows of the full flowlist by (remoteIP, prot, remotePort), used by the role rating
+ * \param flow_offset Index of the first flow of the active flowlist within the full flowlist
  */
-CRoleMembership::CRoleMembership() {
+CRoleMembership::CRoleMembership(const CIpDictionary & ipDictionary, const CRemoteServiceIndex & serviceIndex, size_t flow_offset) :
+	ipDictionary(ipDictionary), serviceIndex(serviceIndex), flow_offset(flow_offset) {
 	hm_remote_IP = new CRole::remoteIpHashMap();
 	role_num = 2;
 	role_type.push_back('n');
@@ -848,22 +809,22 @@ int CRoleMembership::get_next_role_num(char role_type_code) {
  *	the situation in which this remoteIP is also involved in one
  *	or more roles.
  *
- *	\param	remoteIP	IP address of remote host
+ *	\param	remoteId	Id of the IP address of remote host
  *	\param	role_num		Number of role to be registered (o for none)
  * \param 	flows			Number of flows exchanged with this host
  * \param 	packets		Number of packets exchanged with this host
  *
  *	return	Count of role memberships (including new one)
  */
-int CRoleMembership::add_remote_host(IPv6_addr remoteIP, int role_num, int flows, int packets) {
-	CRole::remoteIpHashKey rmkey(remoteIP);
+int CRoleMembership::add_remote_host(CIpDictionary::ipId remoteId, int role_num, int flows, int packets) {
+	CRole::remoteIpHashKey rmkey(remoteId);
 	CRole::remoteIpHashMap::iterator it = hm_remote_IP->find(rmkey);
 	struct CRole::rhost_t * el;
 	if (it == hm_remote_IP->end()) {
-		el = new CRole::rhost_t(remoteIP, flows, packets);
+		el = new CRole::rhost_t(remoteId, flows, packets);
 		/*
 		 el = new CRole::rhost_t();
-		 el->remoteIP = remoteIP;
+		 el->remoteId = remoteId;
 		 el->flows = flows;
 		 el->packets = packets;
 		 */
@@ -896,13 +857,13 @@ int CRoleMembership::add_remote_host(IPv6_addr remoteIP, int role_num, int flows
  *	These flows get assigned a virtual role number out of the pool of unassigned
  *	role numbers.
  *
- *	\param	remoteIP	IP address of remote host
+ *	\param	remoteId	Id of the IP address of remote host
  * \param 	packets		Number of packets exchanged with this host
  *
  *	\return	Assigned role number
  */
-int CRoleMembership::add_single_flow(IPv6_addr remoteIP, int packets) {
-	CRole::remoteIpHashKey rmkey(remoteIP);
+int CRoleMembership::add_single_flow(CIpDictionary::ipId remoteId, int packets) {
+	CRole::remoteIpHashKey rmkey(remoteId);
 	CRole::remoteIpHashMap::iterator it = hm_remote_IP->find(rmkey);
 	if (it == hm_remote_IP->end()) {
 		cerr << "\nERROR in CRoleMembership::add_single_flow(): remoteIP not found.\n\n";
@@ -919,11 +880,11 @@ int CRoleMembership::add_single_flow(IPv6_addr remoteIP, int packets) {
 /**
  *	Remove a stale role number from role set of a particular remote host.
  *
- *	\param	remoteIP	IP address of remote host
+ *	\param	remoteId	Id of the IP address of remote host
  *	\param	role		Role to be removed from remoteIP
  */
-void CRoleMembership::remove_role(IPv6_addr remoteIP, CRole::role_t * role) {
-	CRole::remoteIpHashKey rmkey(remoteIP);
+void CRoleMembership::remove_role(CIpDictionary::ipId remoteId, CRole::role_t * role) {
+	CRole::remoteIpHashKey rmkey(remoteId);
 	CRole::remoteIpHashMap::iterator it = hm_remote_IP->find(rmkey);
 	if (it == hm_remote_IP->end()) {
 		cerr << "\nERROR in CRoleMembership::remove_role(): remoteIP not found.\n\n";
@@ -947,7 +908,7 @@ void CRoleMembership::fill_summaryNodeList() {
 	// Identify all role combinations associated with remoteIPs and
 	// fill a list with a summary node for each role combination found
 	bool role_info_flag = false;
-	IPv6_addr old_remoteIP = IPv6_addr();
+	CIpDictionary::ipId old_remoteId = CIpDictionary::no_id;
 	CRole::remoteIpHashMap::iterator it;
 	for (it = hm_remote_IP->begin(); it != hm_remote_IP->end(); it++) {
 		CRole::rhost_t * el = it->second;
@@ -960,20 +921,20 @@ void CRoleMembership::fill_summaryNodeList() {
 			if (k < 8) {
 				setarr[k] = (int16_t) it2->first; // Up to max. 8 role numbers
 			} else {
-				if (el->remoteIP != old_remoteIP) {
-					old_remoteIP = el->remoteIP;
+				if (el->remoteId != old_remoteId) {
+					old_remoteId = el->remoteId;
 					if (!role_info_flag) {
 						role_info_flag = true;
 						cerr << "INFO: more than 8 roles in role_set for remote IP = ";
 					}
-					cerr << "  " << el->remoteIP;
+					cerr << "  " << ipDictionary.get_ip(el->remoteId);
 				}
 			}
 			k++;
 		}
 		if (k == 0) {
 			cerr << "\nERROR in fill_summaryNodeList(): encountered remote IP without role membership.\n\n";
-			el->print_rhost();
+			el->print_rhost(ipDictionary);
 			exit(1);
 		}
 
@@ -982,7 +943,7 @@ void CRoleMembership::fill_summaryNodeList() {
 
 		// if (k <= 1) continue; // Do not add remote hosts involved in just 1 role
 
-		CHashKey8 myKey(setarr);
+		multiSummaryNodeKey myKey(setarr);
 		multiSummaryNodeHashMap::iterator it3;
 		sumnode_t * sn = NULL;
 		it3 = hm_multiSummaryNode->find(myKey);
@@ -992,7 +953,7 @@ void CRoleMembership::fill_summaryNodeList() {
 			sn->role_num = multisummary_role_num;
 			//cerr<<"---"<<multisummary_role_num<<endl;
 			sn->clients = 1;
-			sn->firstRemoteIP = el->remoteIP;
+			sn->firstRemoteIP = ipDictionary.get_ip(el->remoteId);
 
 			// Go through role list of this r->IP and update/insert role with its total flows
 			for (map<int, uint64_t>::iterator it4 = el->role_map.begin(); it4 != el->role_map.end(); it4++) {
@@ -1025,7 +986,7 @@ void CRoleMembership::fill_summaryNodeList() {
 			}
 		}
 		// Add this remoteIP to IP-to-summayrNode list
-		remoteIpHashKey2 myKey2((el->remoteIP));
+		remoteIpHashKey2 myKey2((el->remoteId));
 		(*hm_remote_IP2)[myKey2] = sn;
 	}
 	if (role_info_flag)
@@ -1035,10 +996,10 @@ void CRoleMembership::fill_summaryNodeList() {
 /**
  *	Get multi-summary node containing this IP
  *
- *	\param	remoteIP	IP address of remote IP searched for
+ *	\param	remoteId	Id of the IP address of remote IP searched for
  *	\return	Summary node object or NULL (if no such node exists)
  */
-struct CRoleMembership::sumnode_t * CRoleMembership::get_summaryNode(IPv6_addr remoteIP) {
+struct CRoleMembership::sumnode_t * CRoleMembership::get_summaryNode(CIpDictionary::ipId remoteId) {
 	/*
 	 cout<<"summary_nodes: #"<<hm_remote_IP2->size()<<endl;
 	 for (remoteIpHashMap2::iterator it = hm_remote_IP2->begin(); it != hm_remote_IP2->end(); ++it) {
@@ -1046,7 +1007,7 @@ struct CRoleMembership::sumnode_t * CRoleMembership::get_summaryNode(IPv6_addr r
 	 cout<<"hm_remote_IP2[value]: "<<(it->second)<<endl;
 	 }
 	 */
-	remoteIpHashKey2 myKey2(remoteIP);
+	remoteIpHashKey2 myKey2(remoteId);
 	remoteIpHashMap2::iterator it;
 	it = hm_remote_IP2->find(myKey2);
 	if (it == hm_remote_IP2->end()) {
@@ -1059,11 +1020,11 @@ struct CRoleMembership::sumnode_t * CRoleMembership::get_summaryNode(IPv6_addr r
 /**
  *	Get all flows a remote host is involved
  *
- *	\param	remoteIP	IP address of remote IP searched for
+ *	\param	remoteId	Id of the IP address of remote IP searched for
  *	\return	Total flow count of this remote IP (0 if not found)
  */
-int CRoleMembership::get_flowcount(IPv6_addr remoteIP) {
-	CRole::remoteIpHashKey rmkey(remoteIP);
+int CRoleMembership::get_flowcount(CIpDictionary::ipId remoteId) {
+	CRole::remoteIpHashKey rmkey(remoteId);
 	CRole::remoteIpHashMap::iterator it = hm_remote_IP->find(rmkey);
 	if (it == hm_remote_IP->end()) {
 		cerr << "\nERROR in CRoleMembership::get_flows(): remoteIP not found.\n\n";
@@ -1077,17 +1038,17 @@ int CRoleMembership::get_flowcount(IPv6_addr remoteIP) {
 /**
  *	Get all flows & packets for a particular role and remote IP address.
  *
- *	\param	remoteIP 	IP address of remote host for which to look up flows/packet counts on role_num
+ *	\param	remoteId 	Id of the IP address of remote host for which to look up flows/packet counts on role_num
  *	\param	role_num		Number of role for which flows are asked for
  *	\param	packets		Count of packets
  *	\return	count of flows
  */
-int CRoleMembership::get_role_flowpacket_count(IPv6_addr remoteIP, int role_num, int & packets) {
-	CRole::remoteIpHashKey rmkey(remoteIP);
+int CRoleMembership::get_role_flowpacket_count(CIpDictionary::ipId remoteId, int role_num, int & packets) {
+	CRole::remoteIpHashKey rmkey(remoteId);
 	CRole::remoteIpHashMap::iterator it = hm_remote_IP->find(rmkey);
 	if (it == hm_remote_IP->end()) {
 		cerr << "\nERROR in CRoleMembership::get_flows(): remoteIP not found.\n\n";
-		cerr << "\tremote IP = " << remoteIP << "\n\trole num = " << role_num << "\n\n";
+		cerr << "\tremote IP = " << ipDictionary.get_ip(remoteId) << "\n\trole num = " << role_num << "\n\n";
 		packets = 0;
 		return 0;
 	} else {
@@ -1096,8 +1057,8 @@ int CRoleMembership::get_role_flowpacket_count(IPv6_addr remoteIP, int role_num,
 		std::map<int, uint64_t>::iterator it2 = el->role_map.find(role_num);
 		if (it2 == el->role_map.end()) {
 			cerr << "ERROR: get_role_flowpacket_count() cannot find role for IP\n";
-			cerr << "\tremote IP = " << remoteIP << "\n\trole num = " << role_num << "\n";
-			el->print_rhost();
+			cerr << "\tremote IP = " << ipDictionary.get_ip(remoteId) << "\n\trole num = " << role_num << "\n";
+			el->print_rhost(ipDictionary);
 			packets = 0;
 			return 0;
 		} else {
@@ -1133,7 +1094,7 @@ void CRoleMembership::print_multi_members() {
 	for (it = hm_remote_IP->begin(); it != hm_remote_IP->end(); it++) {
 		struct CRole::rhost_t * el = it->second;
 		if (el->role_map.size() > 1) {
-			cout << el->remoteIP << " :";
+			cout << ipDictionary.get_ip(el->remoteId) << " :";
 			map<int, uint64_t>::iterator it2;
 			for (it2 = el->role_map.begin(); it2 != el->role_map.end(); it2++) {
 				int role_num = it2->first;
@@ -1183,29 +1144,6 @@ CClientRole::~CClientRole() {
 	delete hm_multiclient_role;
 }
 
-/**
- * Find the role that corresponds to a role number.
- *
- * \param role_id Role number
- *
- * \return CRole::role_t* Pointer to the role(if found), NULL otherwise
- */
-CRole::role_t* CClientRole::getRole(const int role_id) {
-	// loop for normal client roles
-	for (cltRoleHashMap::iterator it = hm_client_role->begin(); it != hm_client_role->end(); it++) {
-		if ((it->second)->role_num == role_id) {
-			return it->second;
-		}
-	}
-	// loop for multi-client roles
-	for (cltRoleHashMap::iterator it = hm_multiclient_role->begin(); it != hm_multiclient_role->end(); it++) {
-		if ((it->second)->role_num == role_id) { // skip invalid roles
-			return it->second;
-		}
-	}
-	return NULL; // role not found
-}
-
 /**
  *  Generate sub-roles used by desummarization.
  */
@@ -1241,7 +1179,7 @@ bool CClientRole::add_candidate(int i) {
 	// Here we implement client role summarization step 1
 	// --------------------------------------------------
 
-	IPv6_addr remoteIP = flowlist[i].remoteIP;
+	CIpDictionary::ipId remoteId = proleMembership->get_remote_id(i);
 	uint16_t remotePort = flowlist[i].remotePort;
 	uint8_t prot = flowlist[i].prot;
 	uint64_t bytes = flowlist[i].dOctets;
@@ -1251,17 +1189,18 @@ bool CClientRole::add_candidate(int i) {
 	//
 	// Store candidate role
 	// --------------------
-	cltRoleHashKey mykey(remoteIP, prot, remotePort, flowtype);
+	cltRoleHashKey mykey(remoteId, prot, remotePort, flowtype);
 	cltRoleHashMap::iterator citer = hm_client_role->find(mykey);
 	int cur_role_num = 0;
 	int cur_flows = 1;
 	if (citer == hm_client_role->end()) {
 		// Not found: add as a new role
 		cur_role_num = flow_role[i] = proleMembership->get_next_role_num('c');
-		role_t * role = new role_t(cur_role_num, prot, 0, remotePort, remoteIP, 1, flowtype, bytes, packets, 'c');
-		role->rIP_set->insert(remoteIP);
+		role_t * role = new role_t(cur_role_num, prot, 0, remotePort, remoteId, 1, flowtype, bytes, packets, 'c');
+		role->rIP_set->insert(remoteId);
 		role->flow_set->insert(i);
 		(*hm_client_role)[mykey] = role;
+		add_role(role);
 		role_count++;
 
 	} else {
@@ -1274,7 +1213,7 @@ bool CClientRole::add_candidate(int i) {
 		role->bytes += bytes;
 		role->packets += packets;
 	}assert(packets > 0);
-	proleMembership->add_remote_host(remoteIP, cur_role_num, 1, packets);
+	proleMembership->add_remote_host(remoteId, cur_role_num, 1, packets);
 	return true; //FIXME speculative to remove compiler warning!
 }
 
@@ -1297,13 +1236,13 @@ void CClientRole::prune_candidates() {
 		}
 		if (role->flows < client_threshold) {
 			// Dismiss this role number
-			set<IPv6_addr>::iterator it2; // Remove from role set of each remote host involved
+			set<CIpDictionary::ipId>::iterator it2; // Remove from role set of each remote host involved
 			for (it2 = role->rIP_set->begin(); it2 != role->rIP_set->end(); it2++) {
-				IPv6_addr remoteIP = *it2;
-				proleMembership->remove_role(remoteIP, role);
+				CIpDictionary::ipId remoteId = *it2;
+				proleMembership->remove_role(remoteId, role);
 			}
 			// Mark role as invalid
-			role->role_num = 0;
+			dismiss_role(*role);
 			set<int>::iterator it3;
 			for (it3 = role->flow_set->begin(); it3 != role->flow_set->end(); it3++) {
 				flow_role[*it3] = 0;
@@ -1345,18 +1284,19 @@ void CClientRole::check_multiclient(const vector<uint32_t> & flow_server_role, c
 			cout << "mc-role: added client role: " << crole->role_num << " with " << crole->flows << " flows\n";
 		}
 		uint8_t prot = (uint8_t) crole->prot;
-		cltRoleHashKey mykey(IPv6_addr(), prot, (crole->remotePort), (crole->flowtype));
+		cltRoleHashKey mykey(CIpDictionary::no_id, prot, (crole->remotePort), (crole->flowtype));
 		cltRoleHashMap::iterator citer = hm_multiclient_role->find(mykey);
 		int cur_role_num = 0;
 		if (citer == hm_multiclient_role->end()) {
 			// Not found: add role as a new multiclient role
 			cur_role_num = proleMembership->get_next_role_num('m');
-			role_t * mrole = new role_t(cur_role_num, crole->prot, 0, crole->remotePort, crole->remoteIP, crole->flows, crole->flowtype, crole->bytes,
+			role_t * mrole = new role_t(cur_role_num, crole->prot, 0, crole->remotePort, crole->remoteId, crole->flows, crole->flowtype, crole->bytes,
 			      crole->packets, 'm');
-			mrole->rIP_set->insert(crole->remoteIP); // Remember IPs of all remote servers
+			mrole->rIP_set->insert(crole->remoteId); // Remember IPs of all remote servers
 			mrole->role_set->insert(crole->role_num);
 			mrole->role_set_->insert(crole);
 			(*hm_multiclient_role)[mykey] = mrole;
+			add_role(mrole);
 			mrole_count++;
 		} else {
 			// Found: update with data from new role
@@ -1364,12 +1304,12 @@ void CClientRole::check_multiclient(const vector<uint32_t> & flow_server_role, c
 			mrole->flows += crole->flows; // Yields #connections
 			mrole->bytes += crole->bytes;
 			mrole->packets += crole->packets;
-			mrole->rIP_set->insert(crole->remoteIP);
+			mrole->rIP_set->insert(crole->remoteId);
 			mrole->role_set->insert(crole->role_num);
 			mrole->role_set_->insert(crole);
 			cur_role_num = mrole->role_num;
 		}assert(crole->packets > 0);
-		proleMembership->add_remote_host(crole->remoteIP, cur_role_num, crole->flows, crole->packets);
+		proleMembership->add_remote_host(crole->remoteId, cur_role_num, crole->flows, crole->packets);
 	}
 	// b) Check single flows with remote Port < 1024 which are not yet members of client or server roles
 	for (unsigned int j = 0; j < flowlist.size(); j++) {
@@ -1381,19 +1321,20 @@ void CClientRole::check_multiclient(const vector<uint32_t> & flow_server_role, c
 			if (debug2) {
 				cout << "mc-role: added single flow: " << j << endl;
 			}
-			cltRoleHashKey mykey(IPv6_addr(), (flowlist[j].prot), (flowlist[j].remotePort), (flowlist[j].flowtype));
+			cltRoleHashKey mykey(CIpDictionary::no_id, (flowlist[j].prot), (flowlist[j].remotePort), (flowlist[j].flowtype));
 			cltRoleHashMap::iterator citer = hm_multiclient_role->find(mykey);
 			int cur_role_num = 0;
 			int cur_packets = 0;
 			if (citer == hm_multiclient_role->end()) {
 				// Not found: add role as a new multiclient role
 				cur_role_num = proleMembership->get_next_role_num('m');
-				role_t * mrole = new role_t(cur_role_num, flowlist[j].prot, 0, flowlist[j].remotePort, flowlist[j].remoteIP, 1, flowlist[j].flowtype,
+				role_t * mrole = new role_t(cur_role_num, flowlist[j].prot, 0, flowlist[j].remotePort, proleMembership->get_remote_id(j), 1, flowlist[j].flowtype,
 				      flowlist[j].dOctets, flowlist[j].dOctets, 'm');
-				mrole->rIP_set->insert(flowlist[j].remoteIP); // Remember IPs of all remote servers
+				mrole->rIP_set->insert(proleMembership->get_remote_id(j)); // Remember IPs of all remote servers
 				mrole->flow_set->insert(j);
 				mrole->role_set->insert(0);
 				(*hm_multiclient_role)[mykey] = mrole;
+				add_role(mrole);
 				mrole_count++;
 			} else {
 				// Found: update with data from new role
@@ -1401,12 +1342,12 @@ void CClientRole::check_multiclient(const vector<uint32_t> & flow_server_role, c
 				mrole->flows++;
 				mrole->bytes += flowlist[j].dOctets;
 				cur_packets = mrole->packets += flowlist[j].dPkts;
-				mrole->rIP_set->insert(flowlist[j].remoteIP);
+				mrole->rIP_set->insert(proleMembership->get_remote_id(j));
 				mrole->role_set->insert(0);
 				mrole->flow_set->insert(j);
 				cur_role_num = mrole->role_num;
 			}assert(flowlist[j].dPkts > 0);
-			proleMembership->add_remote_host(flowlist[j].remoteIP, cur_role_num, 1, flowlist[j].dPkts);
+			proleMembership->add_remote_host(proleMembership->get_remote_id(j), cur_role_num, 1, flowlist[j].dPkts);
 		}
 	}
 	// 2) Pruning of unsuitable candidates
@@ -1433,11 +1374,11 @@ void CClientRole::check_multiclient(const vector<uint32_t> & flow_server_role, c
 					if (debug2) {
 						cout << "mc-summarize:dismiss client role: " << crole->role_num << endl;
 					}
-					for (set<IPv6_addr>::iterator it5 = crole->rIP_set->begin(); it5 != crole->rIP_set->end(); it5++) {
+					for (set<CIpDictionary::ipId>::iterator it5 = crole->rIP_set->begin(); it5 != crole->rIP_set->end(); it5++) {
 						proleMembership->remove_role(*it5, crole);
 					}
 					// Dismiss this role number
-					crole->role_num = 0;
+					dismiss_role(*crole);
 				}
 			}
 			if (debug) {
@@ -1461,10 +1402,10 @@ void CClientRole::check_multiclient(const vector<uint32_t> & flow_server_role, c
 		} else {
 			// Prune this multiclient-role: mark it as invalid
 			// Remove role from all it's remote host objects
-			for (set<IPv6_addr>::iterator it2 = mrole->rIP_set->begin(); it2 != mrole->rIP_set->end(); it2++) {
+			for (set<CIpDictionary::ipId>::iterator it2 = mrole->rIP_set->begin(); it2 != mrole->rIP_set->end(); it2++) {
 				proleMembership->remove_role(*it2, mrole);
 			}
-			mrole->role_num = 0;
+			dismiss_role(*mrole);
 			mrole_count--;
 		}
 	}
@@ -1476,20 +1417,25 @@ void CClientRole::check_multiclient(const vector<uint32_t> & flow_server_role, c
  * Clean up flow_role vector and update values with multi-client role numbers
  */
 void CClientRole::cleanConsumedClientRoles() {
-	// update flow_role with multi-client data
+	// map each consumed client role to the first multi-client role consuming it
+	vector<int> consumer(role_table.size(), 0);
 	for (cltRoleHashMap::const_iterator mc_role_iter = hm_multiclient_role->begin(); mc_role_iter != hm_multiclient_role->end(); mc_role_iter++) {
 		role_t* mc_role = mc_role_iter->second;
 		if (mc_role->role_num == 0) { // ignore this role
 			continue;
 		}
-		set<int> consumed_roles;
-		consumed_roles.insert(mc_role->role_set->begin(), mc_role->role_set->end());
-		for (uint32_t idx = 0; idx < flow_role.size(); idx++) {
-			if (consumed_roles.find(flow_role[idx]) != consumed_roles.end() && flow_role[idx] != 0) { // flow is part of consumed role
-				flow_role[idx] = mc_role->role_num;
+		for (set<int>::const_iterator it = mc_role->role_set->begin(); it != mc_role->role_set->end(); it++) {
+			if (*it != 0 && (size_t) *it < consumer.size() && consumer[*it] == 0) {
+				consumer[*it] = mc_role->role_num;
 			}
 		}
 	}
+	// update flow_role with multi-client data
+	for (uint32_t idx = 0; idx < flow_role.size(); idx++) {
+		if (flow_role[idx] < consumer.size() && consumer[flow_role[idx]] != 0) { // flow is part of consumed role
+			flow_role[idx] = consumer[flow_role[idx]];
+		}
+	}
 }
 
 /**
@@ -1592,22 +1538,6 @@ void CServerRole::create_sub_roles() {
 	}
 }
 
-/**
- * Find the role that corresponds to a role.
- *
- * \param role_id Role id
- *
- * \return CRole::role_t* Pointer to the role(if found), NULL otherwise
- */
-CRole::role_t* CServerRole::getRole(const int role_id) {
-	for (srvRoleHashMap::iterator it = hm_server_role->begin(); it != hm_server_role->end(); it++) {
-		if ((it->second)->role_num == role_id) { // skip invalid roles
-			return it->second;
-		}
-	}
-	return NULL; // role not found
-}
-
 /**
  * Register a CRoleMembership object
  *
@@ -1629,7 +1559,8 @@ bool CServerRole::add_candidate(int i) {
 	// --------------------------------------------------
 	//uint32_t localIP	= flowlist[i].localIP;
 	uint16_t localPort = flowlist[i].localPort;
-	IPv6_addr remoteIP = flowlist[i].remoteIP;
+	IPv6_addr remoteIP = flowlist[i].remoteIP; // Used by debug3 only
+	CIpDictionary::ipId remoteId = proleMembership->get_remote_id(i);
 	uint8_t prot = flowlist[i].prot;
 	uint64_t bytes = flowlist[i].dOctets;
 	uint32_t packets = flowlist[i].dPkts;
@@ -1649,10 +1580,11 @@ bool CServerRole::add_candidate(int i) {
 			}
 		}
 		cur_role_num = flow_role[i] = proleMembership->get_next_role_num('s');
-		role_t * role = new role_t(cur_role_num, prot, localPort, 0, remoteIP, 1, flowtype, bytes, packets, 's');
-		role->rIP_set->insert(remoteIP);
+		role_t * role = new role_t(cur_role_num, prot, localPort, 0, remoteId, 1, flowtype, bytes, packets, 's');
+		role->rIP_set->insert(remoteId);
 		role->flow_set->insert(i);
 		(*hm_server_role)[mykey] = role;
+		add_role(role);
 		role_count++;
 	} else {
 		// Found: update role with data from new flow
@@ -1667,7 +1599,7 @@ bool CServerRole::add_candidate(int i) {
 		cur_flows += role->flows;
 		role->bytes += bytes;
 		role->packets += packets;
-		role->rIP_set->insert(remoteIP);
+		role->rIP_set->insert(remoteId);
 		cur_role_num = flow_role[i] = role->role_num;
 
 		if (debug3) {
@@ -1676,7 +1608,7 @@ bool CServerRole::add_candidate(int i) {
 			}
 		}
 	}assert(packets > 0);
-	proleMembership->add_remote_host(remoteIP, cur_role_num, 1, packets);
+	proleMembership->add_remote_host(remoteId, cur_role_num, 1, packets);
 	return true; //FIXME speculative to remove compiler warning!
 }
 
@@ -1691,10 +1623,10 @@ void CServerRole::prune_candidates() {
 		// int num = role->role_num;
 		if (role->flows < server_threshold) {
 			// Dismiss this role number
-			set<IPv6_addr>::iterator it2; // Remove from role set of each remote host involved
+			set<CIpDictionary::ipId>::iterator it2; // Remove from role set of each remote host involved
 			for (it2 = role->rIP_set->begin(); it2 != role->rIP_set->end(); it2++) {
-				IPv6_addr remoteIP = *it2;
-				proleMembership->remove_role(remoteIP, role);
+				CIpDictionary::ipId remoteId = *it2;
+				proleMembership->remove_role(remoteId, role);
 			}
 
 			set<int>::iterator it3;
@@ -1703,7 +1635,7 @@ void CServerRole::prune_candidates() {
 			}
 			role_count--;
 			// Mark role as invalid
-			role->role_num = 0;
+			dismiss_role(*role);
 		} else {
 			if (debug)
 				sroleSet.insert(role->role_num);
@@ -1799,22 +1731,6 @@ void CP2pRole::create_sub_roles() {
 	}
 }
 
-/**
- * Find the role that corresponds to an id.
- *
- * \param role_id Role id
- *
- * \return CRole::role_t* Pointer to the role(if found), NULL otherwise
- */
-CRole::role_t* CP2pRole::getRole(const int role_id) {
-	for (p2pRoleHashMap::iterator it = hm_p2p_role->begin(); it != hm_p2p_role->end(); it++) {
-		if ((it->second)->role_num == role_id) { // skip invalid roles
-			return it->second;
-		}
-	}
-	return NULL; // role not found
-}
-
 /**
  * Register a CRoleMembership object
  *
@@ -1842,8 +1758,9 @@ bool CP2pRole::add_candidate(int i) {
 	p2p_candidate_flows.insert(i);
 
 	// Remember per remote IP protocol usage
-	IPv6_addr remoteIP = flowlist[i].remoteIP;
-	CRole::remoteIpHashKey rmkey(remoteIP);
+	IPv6_addr remoteIP = flowlist[i].remoteIP; // Used by debug3 only
+	CIpDictionary::ipId remoteId = proleMembership->get_remote_id(i);
+	CRole::remoteIpHashKey rmkey(remoteId);
 	CRole::remoteIpHashMap::iterator it = hm_remote_IP_p2p->find(rmkey);
 	if (it == hm_remote_IP_p2p->end()) {
 		// Not found: add to list
@@ -1856,7 +1773,7 @@ bool CP2pRole::add_candidate(int i) {
 			el->uses_udp = true;
 			el->uses_tcp = false;
 		}
-		el->remoteIP = remoteIP;
+		el->remoteId = remoteId;
 		(*hm_remote_IP_p2p)[rmkey] = el;
 		if (debug3) {
 			if (remoteIP == ip) {
@@ -1906,7 +1823,7 @@ void CP2pRole::prune_candidates(CClientRole & clientRole, CServerRole & serverRo
 		if (flowlist[k].localPort < p2p_port_threshold || flowlist[k].remotePort < p2p_port_threshold) {
 			// Prune flow if one or both ports <1024 and rIP does not use tcp+udp
 			// Check if remote host uses both tcp and udp
-			CRole::remoteIpHashKey rmkey((flowlist[k].remoteIP));
+			CRole::remoteIpHashKey rmkey((proleMembership->get_remote_id(k)));
 			CRole::remoteIpHashMap::iterator it2 = hm_remote_IP_p2p->find(rmkey);
 			if (it2 == hm_remote_IP_p2p->end()) {
 				// Not found: error
@@ -1937,11 +1854,12 @@ void CP2pRole::prune_candidates(CClientRole & clientRole, CServerRole & serverRo
 		if (citer == hm_p2p_role->end()) {
 			// Not found: add to list
 			cur_role_num = flow_role[k] = proleMembership->get_next_role_num('p');
-			role_t * role = new role_t(cur_role_num, flowlist[k].prot, 0, 0, flowlist[k].remoteIP, 1, flowlist[k].flowtype, flowlist[k].dOctets, flowlist[k].dPkts,
+			role_t * role = new role_t(cur_role_num, flowlist[k].prot, 0, 0, proleMembership->get_remote_id(k), 1, flowlist[k].flowtype, flowlist[k].dOctets, flowlist[k].dPkts,
 			      'p');
-			role->rIP_set->insert(flowlist[k].remoteIP);
+			role->rIP_set->insert(proleMembership->get_remote_id(k));
 			role->flow_set->insert(k);
 			(*hm_p2p_role)[mykey] = role;
+			add_role(role);
 			role_count++;
 //			if (debug4 && cur_role_num==63546) { cout << __FILE__ << ":#" << __LINE__ <<":" << __FUNCTION__ << ": "; role->print_role(); }
 
@@ -1953,11 +1871,11 @@ void CP2pRole::prune_candidates(CClientRole & clientRole, CServerRole & serverRo
 			cur_flows = role->flows;
 			role->bytes += flowlist[k].dOctets;
 			role->packets += flowlist[k].dPkts;
-			role->rIP_set->insert(flowlist[k].remoteIP);
+			role->rIP_set->insert(proleMembership->get_remote_id(k));
 			role->flow_set->insert(k);
 //			if (debug4 && cur_role_num==63546) { cout << __FILE__ << ":#" << __LINE__ <<":" << __FUNCTION__ << ": "; role->print_role(); }
 		}assert(flowlist[k].dPkts > 0);
-		proleMembership->add_remote_host(flowlist[k].remoteIP, cur_role_num, 1, flowlist[k].dPkts);
+		proleMembership->add_remote_host(proleMembership->get_remote_id(k), cur_role_num, 1, flowlist[k].dPkts);
 	}
 
 	// Next, add client roles with high remote port number (>1024) as candidates
@@ -1971,10 +1889,11 @@ void CP2pRole::prune_candidates(CClientRole & clientRole, CServerRole & serverRo
 			if (citer == hm_p2p_role->end()) {
 				// Not found: add to list
 				cur_role_num = proleMembership->get_next_role_num('p');
-				role_t * role = new role_t(cur_role_num, crole->prot, 0, 0, crole->remoteIP, crole->flows, crole->flowtype, crole->bytes, crole->packets, 'p');
-				role->rIP_set->insert(crole->remoteIP);
+				role_t * role = new role_t(cur_role_num, crole->prot, 0, 0, crole->remoteId, crole->flows, crole->flowtype, crole->bytes, crole->packets, 'p');
+				role->rIP_set->insert(crole->remoteId);
 				role->role_set->insert(crole->role_num);
 				(*hm_p2p_role)[mykey] = role;
+				add_role(role);
 				role_count++;
 //				if (debug4 && cur_role_num==63546) { cout << __FILE__ << ":#" << __LINE__ <<":" << __FUNCTION__ << ": "; role->print_role(); }
 			} else {
@@ -1985,7 +1904,7 @@ void CP2pRole::prune_candidates(CClientRole & clientRole, CServerRole & serverRo
 				cur_flows = role->flows;
 				role->bytes += crole->bytes;
 				role->packets += crole->packets;
-				role->rIP_set->insert(crole->remoteIP);
+				role->rIP_set->insert(crole->remoteId);
 				role->role_set->insert(crole->role_num);
 //				role->flow_set->insert(k);
 //				if (debug4 && cur_role_num==63546) { cout << __FILE__ << ":#" << __LINE__ <<":" << __FUNCTION__ << ": "; role->print_role(); }
@@ -1993,7 +1912,7 @@ void CP2pRole::prune_candidates(CClientRole & clientRole, CServerRole & serverRo
 			if (debug3) {
 				cout << " ** P2P: added client candidate role: " << crole->role_num << endl;
 			}assert(crole->packets > 0);
-			proleMembership->add_remote_host(crole->remoteIP, cur_role_num, crole->flows, crole->packets);
+			proleMembership->add_remote_host(crole->remoteId, cur_role_num, crole->flows, crole->packets);
 		}
 	}
 
@@ -2008,23 +1927,20 @@ void CP2pRole::prune_candidates(CClientRole & clientRole, CServerRole & serverRo
 		if (p2prole->role_set->size() < p2p_threshold) {
 //			if (debug4 && p2prole->role_num==63546) { cout << __FILE__ << ":#" << __LINE__ << ": removing client roles from " << p2prole->role_num << "\n";  }
 			// Remove client roles from p2p role
-			for (CClientRole::cltRoleHashMap::iterator it3 = clientRole.get_hm_client_role()->begin(); it3 != clientRole.get_hm_client_role()->end(); it3++) {
-				role_t * crole = it3->second;
-				if (crole->role_num == 0)
+			const set<int> member_roles(*p2prole->role_set);
+			for (set<int>::const_iterator it3 = member_roles.begin(); it3 != member_roles.end(); it3++) {
+				role_t * crole = clientRole.getRole(*it3);
+				if (crole == NULL || crole->role_type != 'c')
 					continue; // Skip deprecated entries
-				set<int>::iterator it4;
-				it4 = p2prole->role_set->find(crole->role_num);
-				if (it4 != p2prole->role_set->end()) {
-					// Remove
+				// Remove
 //					if (debug4 && p2prole->role_num==63546) { cout << "\tclient role = " << crole->role_num << endl;  }
-					proleMembership->remove_role(crole->remoteIP, p2prole);
-					p2prole->rIP_set->erase(crole->remoteIP); // For a client role there is only one remoteIP, namely the server side IP
-					p2prole->role_set->erase(crole->role_num);
-					// Subtract flow/byte/packet counts
-					p2prole->flows -= crole->flows;
-					p2prole->bytes -= crole->bytes;
-					p2prole->packets -= crole->packets;
-				}
+				proleMembership->remove_role(crole->remoteId, p2prole);
+				p2prole->rIP_set->erase(crole->remoteId); // For a client role there is only one remoteIP, namely the server side IP
+				p2prole->role_set->erase(crole->role_num);
+				// Subtract flow/byte/packet counts
+				p2prole->flows -= crole->flows;
+				p2prole->bytes -= crole->bytes;
+				p2prole->packets -= crole->packets;
 			}
 		} else { // Accept role
 //			if (debug4 && p2prole->role_num==63546) { cout << __FILE__ << ":#" << __LINE__ << ": accepting client role " << p2prole->role_num << "\n";  }
@@ -2043,13 +1959,13 @@ void CP2pRole::prune_candidates(CClientRole & clientRole, CServerRole & serverRo
 				if ((int)flow_role[j] == p2prole->role_num)
 					flow_role[j] = 0;
 			}
-			set<IPv6_addr>::iterator it2; // Remove from role set each remote host involved
+			set<CIpDictionary::ipId>::iterator it2; // Remove from role set each remote host involved
 			for (it2 = p2prole->rIP_set->begin(); it2 != p2prole->rIP_set->end(); it2++) {
-				IPv6_addr remoteIP = *it2;
-				proleMembership->remove_role(remoteIP, p2prole);
+				CIpDictionary::ipId remoteId = *it2;
+				proleMembership->remove_role(remoteId, p2prole);
 			}
 			// Mark role as invalid
-			p2prole->role_num = 0;
+			dismiss_role(*p2prole);
 			role_count--;
 		} else {
 			if (debug)
@@ -2078,13 +1994,12 @@ void CP2pRole::cleanConsumedClientRoles(CClientRole& clientRole) {
 		if (p2prole->role_num == 0) {
 			continue;
 		}
-		for (CClientRole::cltRoleHashMap::iterator it3 = clientRole.get_hm_client_role()->begin(); it3 != clientRole.get_hm_client_role()->end(); it3++) {
-			role_t * crole = it3->second;
-			set<int>::iterator it4 = p2prole->role_set->find(crole->role_num);
-			if (it4 != p2prole->role_set->end()) {
+		for (set<int>::const_iterator it3 = p2prole->role_set->begin(); it3 != p2prole->role_set->end(); it3++) {
+			role_t * crole = clientRole.getRole(*it3);
+			if (crole != NULL && crole->role_type == 'c') {
 				// Mark this client role as invalid
-				proleMembership->remove_role(crole->remoteIP, crole);
-				crole->role_num = 0;
+				proleMembership->remove_role(crole->remoteId, crole);
+				clientRole.dismiss_role(*crole);
 				p2prole->flow_set->insert(crole->flow_set->begin(), crole->flow_set->end());
 				for (set<int>::iterator flow_iter = crole->flow_set->begin(); flow_iter != crole->flow_set->end(); flow_iter++) {
 					clientRole.set_flow_role_value(*flow_iter, 0);
@@ -22,6 +22,8 @@
 #include "HashMapE.h"
 #include "cflow.h"
 #include "global.h"
+#include "gipdictionary.h"
+#include "gserviceindex.h"
 
 /**
  *	\enum summarization_type
@@ -144,10 +146,13 @@ class CRole {
 
 		static const uint32_t flow_rate_threshold = 1024 * 1024;
 
+		const CFlowList * full_flowlist; // Flowlist the roles are rated against (see set_full_flowlist())
+		uint32_t rating_count; // Number of roles rated so far
+
 	public:
 		// For tracking of remote host activities
 		struct rhost_t {
-				IPv6_addr remoteIP;
+				CIpDictionary::ipId remoteId;
 				std::map<int, uint64_t> role_map; // key: role# rIP is a member of; entry: (#flow<<32) + #packets for this rIP
 				bool uses_tcp;
 				bool uses_udp;
@@ -155,8 +160,8 @@ class CRole {
 				int packets;
 
 				rhost_t();
-				rhost_t(IPv6_addr remoteIP, int flows, int packets);
-				void print_rhost();
+				rhost_t(CIpDictionary::ipId remoteId, int flows, int packets);
+				void print_rhost(const CIpDictionary & ipDictionary);
 		};
 
 		// For tracking of roles
@@ -166,7 +171,7 @@ class CRole {
 				uint32_t prot;
 				uint16_t localPort;
 				uint16_t remotePort;
-				IPv6_addr remoteIP;
+				CIpDictionary::ipId remoteId;
 				uint32_t flows;
 				uint8_t flowtype;
 				uint64_t bytes;
@@ -174,18 +179,19 @@ class CRole {
 				char role_type; // Type of role: n = none, c = client, s = server, p = p2p, m = multiclient, f = single flow
 				role_pattern pattern;
 				float rating; // value between 0 and 1, containing a flow rating used for flow conflict resolution
+				bool rated; // true once rating has been calculated
 
-				std::set<IPv6_addr> * rIP_set; // For remoteIPs summarized in summary node
+				std::set<CIpDictionary::ipId> * rIP_set; // For remoteIPs (ids) summarized in summary node
 				std::set<int> * flow_set; // All flows associated with this role
 				std::set<int> * role_set; // All client roles associated with this multiclient role // TODO: remove? role_set_ provides access to the same information
 				std::set<role_t *> * role_set_;
 				std::set<boost::shared_ptr<CRole::role_t> > * sub_role_set;
 
-				role_t(int role_num, uint32_t prot, uint16_t localPort, uint16_t remotePort, IPv6_addr remoteIP, int flows, uint8_t flowtype, uint64_t bytes,
-				      uint32_t packets, char role_type);
+				role_t(int role_num, uint32_t prot, uint16_t localPort, uint16_t remotePort, CIpDictionary::ipId remoteId, int flows, uint8_t flowtype,
+				      uint64_t bytes, uint32_t packets, char role_type);
 				virtual ~role_t();
 
-				void print_role() const;
+				void print_role(const CIpDictionary & ipDictionary) const;
 				std::set<role_pattern> getSubPatterns();
 				bool partition_summarized(const graphlet_partition p);
 				graphlet_partition_association get_partition_association(const graphlet_partition p1, const graphlet_partition p2);
@@ -198,11 +204,14 @@ class CRole {
 				void recalculateSummaries(const Subflowlist& flow_list, const int flow_id, CRoleMembership& role_membership);
 		};
 
-		typedef HashKeyIPv6 remoteIpHashKey;
+		typedef CKeyId remoteIpHashKey;
 
-		// key = remoteIP
+		// key = remoteIP id
 		// data = remote host object reference
-		typedef hash_map<HashKeyIPv6, rhost_t *, HashFunction<HashKeyIPv6> , HashFunction<HashKeyIPv6> > remoteIpHashMap;
+		typedef flat_hash_map<CKeyId, rhost_t *, KeyHashFunction<CKeyId> , KeyHashFunction<CKeyId> > remoteIpHashMap;
+
+	protected:
+		std::vector<role_t *> role_table; // Valid roles of this type by role number (NULL for other role numbers)
 
 	public:
 		CRole(Subflowlist flowlist, const prefs_t & prefs);
@@ -225,12 +234,18 @@ class CRole {
 			return role_count;
 		}
 		virtual void create_sub_roles();
-		virtual void rate_roles(const CFlowList& full_flowlist);
-		virtual float getRating(const int role_id);
-		virtual role_t* getRole(const int role_id);
+		void set_full_flowlist(const CFlowList& full_flowlist);
+		float getRating(const int role_id);
+		role_t* getRole(const int role_id);
+		void dismiss_role(role_t & role);
+		uint32_t get_rating_count() const {
+			return rating_count;
+		}
 
 	protected:
 		virtual void create_pseudo_roles(role_t & role, CRoleMembership & membership);
+		void add_role(role_t * role);
+		float get_role_rating(role_t& role);
 
 	private:
 		virtual void rate_role(role_t& role, const CFlowList& full_flowlist, const Subflowlist& sub_flowlist);
@@ -258,6 +273,10 @@ class CRole {
  *	- update list of summary nodes in case a new membership set {role1, role2, .. }
  *	  occurs
  *	- add a remote host to a summary node
+ *
+ *	Remote hosts are identified by the ids of a CIpDictionary. The dictionary and the position
+ *	of the active flowlist within its flowlist are passed to the constructor, get_remote_id()
+ *	returns the id of the remoteIP of a flow of the active flowlist.
  */
 class CRoleMembership {
 	public:
@@ -268,12 +287,15 @@ class CRoleMembership {
 				std::map<int, uint64_t> role_map; // key: role# rIP is a member of; entry: (#flow<<32) + #packets for this rIP
 				int get_flowpacket_count(int role_num, int & packets);
 		};
-		typedef CHashKey8 multiSummaryNodeKey; // Hash map: key=set of role numbers (up to 8)
+		typedef CKeyRoles8 multiSummaryNodeKey; // Hash map: key=set of role numbers (up to 8)
 		// key = set of role numbers (up to 8)
 		// data = ref to summary node object
-		typedef hash_map<CHashKey8, sumnode_t *, HashFunction<CHashKey8> , HashFunction<CHashKey8> > multiSummaryNodeHashMap;
+		typedef flat_hash_map<CKeyRoles8, sumnode_t *, KeyHashFunction<CKeyRoles8> , KeyHashFunction<CKeyRoles8> > multiSummaryNodeHashMap;
 	private:
-		CRole::remoteIpHashMap * hm_remote_IP; // Hash map: key=remoteIP, entry=role set
+		const CIpDictionary & ipDictionary;
+		const CRemoteServiceIndex & serviceIndex; // Flows of the flowlist of ipDictionary by (remoteIP, prot, remotePort)
+		size_t flow_offset; // Index of the first active flow in the flowlist of ipDictionary
+		CRole::remoteIpHashMap * hm_remote_IP; // Hash map: key=remoteIP id, entry=role set
 		int role_num;
 		std::vector<char> role_type; // For each role number store its role type
 		// (n: none, c: client, s: server, p:p2p, m:multiclient, f: single flow)
@@ -281,29 +303,42 @@ class CRoleMembership {
 		multiSummaryNodeHashMap * hm_multiSummaryNode;
 		int multisummary_role_num;
 
-		typedef HashKeyIPv6 remoteIpHashKey2;
+		typedef CKeyId remoteIpHashKey2;
 
-		// key = remoteIP
+		// key = remoteIP id
 		// data = remote host object reference
-		typedef hash_map<HashKeyIPv6, sumnode_t *, HashFunction<HashKeyIPv6> , HashFunction<HashKeyIPv6> > remoteIpHashMap2;
+		typedef flat_hash_map<CKeyId, sumnode_t *, KeyHashFunction<CKeyId> , KeyHashFunction<CKeyId> > remoteIpHashMap2;
 
 		remoteIpHashMap2 * hm_remote_IP2;
 
 	public:
-		CRoleMembership();
+		CRoleMembership(const CIpDictionary & ipDictionary, const CRemoteServiceIndex & serviceIndex, size_t flow_offset);
 		~CRoleMembership();
 
+		const CIpDictionary & get_ip_dictionary() const {
+			return ipDictionary;
+		}
+		const CRemoteServiceIndex & get_service_index() const {
+			return serviceIndex;
+		}
+		CIpDictionary::ipId get_remote_id(int flow) const {
+			return ipDictionary.get_remote_id(flow_offset + flow);
+		}
+		CIpDictionary::ipId get_local_id(int flow) const {
+			return ipDictionary.get_local_id(flow_offset + flow);
+		}
+
 		int get_next_role_num(char role_type_code);
 		int get_role_num() {
 			return role_num;
 		}
-		int add_remote_host(IPv6_addr remoteIP, int role_num, int flows, int packets);
-		int add_single_flow(IPv6_addr remoteIP, int packets);
-		void remove_role(IPv6_addr remoteIP, CRole::role_t * role);
+		int add_remote_host(CIpDictionary::ipId remoteId, int role_num, int flows, int packets);
+		int add_single_flow(CIpDictionary::ipId remoteId, int packets);
+		void remove_role(CIpDictionary::ipId remoteId, CRole::role_t * role);
 		void fill_summaryNodeList();
-		struct sumnode_t * get_summaryNode(IPv6_addr remoteIP);
-		int get_flowcount(IPv6_addr remoteIP);
-		int get_role_flowpacket_count(IPv6_addr remoteIP, int role_num, int & packets);
+		struct sumnode_t * get_summaryNode(CIpDictionary::ipId remoteId);
+		int get_flowcount(CIpDictionary::ipId remoteId);
+		int get_role_flowpacket_count(CIpDictionary::ipId remoteId, int role_num, int & packets);
 		void print_multi_members();
 		void print_multisummary_rolecount();
 		multiSummaryNodeHashMap* get_hm_multiSummaryNode() {
@@ -320,11 +355,11 @@ class CRoleMembership {
  */
 class CClientRole: public CRole {
 	public:
-		typedef HashKeyIPv6_4T cltRoleHashKey; // key = 4-tuple {IP, prot, port, flowtype}
+		typedef CKeyId_4T cltRoleHashKey; // key = 4-tuple {IP id, prot, port, flowtype}
 
-		// key = { remoteIP, prot, remotePort, flowtype }
+		// key = { remoteIP id, prot, remotePort, flowtype }
 		// data = role object reference
-		typedef hash_map<HashKeyIPv6_4T, role_t *, HashFunction<HashKeyIPv6_4T> , HashFunction<HashKeyIPv6_4T> > cltRoleHashMap;
+		typedef flat_hash_map<CKeyId_4T, role_t *, KeyHashFunction<CKeyId_4T> , KeyHashFunction<CKeyId_4T> > cltRoleHashMap;
 
 	private:
 		cltRoleHashMap * hm_client_role;
@@ -351,9 +386,6 @@ class CClientRole: public CRole {
 			return hm_multiclient_role;
 		}
 		virtual void create_sub_roles();
-		virtual void rate_roles(const CFlowList& full_flowlist);
-		virtual float getRating(const int role_id);
-		virtual role_t* getRole(const int role_id);
 		void cleanConsumedClientRoles();
 };
 
@@ -365,11 +397,11 @@ class CClientRole: public CRole {
  */
 class CServerRole: public CRole {
 	public:
-		typedef HashKeyIPv6_3T srvRoleHashKey; // key = 3-tuple {IP, prot, port}
+		typedef CKeyIP_3T srvRoleHashKey; // key = 3-tuple {IP, prot, port}
 
 		// key = { flowtype, prot, localPort }
 		// data = role object reference
-		typedef hash_map<HashKeyIPv6_3T, role_t *, HashFunction<HashKeyIPv6_3T> , HashFunction<HashKeyIPv6_3T> > srvRoleHashMap;
+		typedef flat_hash_map<CKeyIP_3T, role_t *, KeyHashFunction<CKeyIP_3T> , KeyHashFunction<CKeyIP_3T> > srvRoleHashMap;
 
 	private:
 		srvRoleHashMap * hm_server_role;
@@ -389,9 +421,6 @@ class CServerRole: public CRole {
 			return hm_server_role;
 		}
 		virtual void create_sub_roles();
-		virtual void rate_roles(const CFlowList& full_flowlist);
-		virtual float getRating(const int role_id);
-		virtual role_t* getRole(const int role_id);
 };
 
 //********************************************************************************
@@ -402,12 +431,13 @@ class CServerRole: public CRole {
  */
 class CP2pRole: public CRole {
 	public:
-		typedef HashKeyProtoFlowtype p2pRoleHashKey; // key = (prot<<16) + flowtype
+		typedef CKeyProtoFlowtype p2pRoleHashKey; // key = (prot<<16) + flowtype
 
 		// key = { prot, flowtype }	(see key coding rule above)
 		// data = role object object reference
-		typedef hash_map<HashKeyProtoFlowtype, role_t *, HashFunction<HashKeyProtoFlowtype> , HashFunction<HashKeyProtoFlowtype> > p2pRoleHashMap;
-		typedef hash_map<HashKeyIPv6_5T_2, std::set<const cflow_t*>, HashFunction<HashKeyIPv6_5T_2> , HashFunction<HashKeyIPv6_5T_2> > p2pClientCandidateHashMap;
+		typedef flat_hash_map<CKeyProtoFlowtype, role_t *, KeyHashFunction<CKeyProtoFlowtype> , KeyHashFunction<CKeyProtoFlowtype> > p2pRoleHashMap;
+		typedef CKeyId_5T_2 p2pClientCandidateHashKey; // key = 5-tuple {localIP id, remoteIP id, prot, localPort, flowtype}
+		typedef hash_map<CKeyId_5T_2, std::set<const cflow_t*>, KeyHashFunction<CKeyId_5T_2> , KeyHashFunction<CKeyId_5T_2> > p2pClientCandidateHashMap;
 
 	private:
 		CP2pRole::p2pRoleHashMap * hm_p2p_role;
@@ -431,9 +461,6 @@ class CP2pRole: public CRole {
 			return cand_flow_num;
 		}
 		virtual void create_sub_roles();
-		virtual void rate_roles(const CFlowList& full_flowlist);
-		virtual float getRating(const int role_id);
-		virtual role_t* getRole(const int role_id);
 		void cleanConsumedClientRoles(CClientRole & clientRole);
 };
 #endif
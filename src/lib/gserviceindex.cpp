@@ -0,0 +1,116 @@
+/**
+ *	\file gserviceindex.cpp
+ *	\brief Index of the flows of a flowlist by remote address, protocol and remote port.
+ *
+ * 	This file is subject to the terms and conditions defined in
+ * 	files 'BSD.txt' and 'GPL.txt'. For a list of authors see file 'AUTHORS'.
+ */
+
+#include <algorithm>
+
+#include "gserviceindex.h"
+
+using namespace std;
+
+/**
+ *	Orders entries by service, then by flow number
+ */
+struct service_entry_less {
+		bool operator()(const CRemoteServiceIndex::entry_t & a, const CRemoteServiceIndex::entry_t & b) const {
+			return a.service < b.service || (a.service == b.service && a.flow < b.flow);
+		}
+};
+
+/**
+ *	Orders entries against a service or a range of services (services within [low, high] are equal)
+ */
+struct service_range_less {
+		uint32_t low, high;
+
+		service_range_less(uint32_t low, uint32_t high) :
+			low(low), high(high) {
+		}
+		bool operator()(const CRemoteServiceIndex::entry_t & e, uint32_t) const {
+			return e.service < low;
+		}
+		bool operator()(uint32_t, const CRemoteServiceIndex::entry_t & e) const {
+			return high < e.service;
+		}
+};
+
+CRemoteServiceIndex::CRemoteServiceIndex() {
+}
+
+/**
+ *	Replace the index by the flows of flowlist.
+ *
+ *	\param ipDictionary Dictionary built from flowlist
+ *	\param flowlist Flowlist to index
+ */
+void CRemoteServiceIndex::build(const CIpDictionary & ipDictionary, const CFlowList & flowlist) {
+	// Counting sort by remote address id keeps the flows of each id in flowlist order
+	offsets.assign(ipDictionary.size() + 1, 0);
+	for (size_t i = 0; i < flowlist.size(); i++)
+		offsets[ipDictionary.get_remote_id(i) + 1]++;
+	for (size_t id = 0; id < ipDictionary.size(); id++)
+		offsets[id + 1] += offsets[id];
+
+	vector<size_t> next(offsets.begin(), offsets.end() - 1);
+	entries.resize(flowlist.size());
+	for (size_t i = 0; i < flowlist.size(); i++) {
+		entry_t & e = entries[next[ipDictionary.get_remote_id(i)]++];
+		e.service = ((uint32_t) flowlist[i].prot << 16) | flowlist[i].remotePort;
+		e.flow = i;
+	}
+	for (size_t id = 0; id < ipDictionary.size(); id++)
+		sort(entries.begin() + offsets[id], entries.begin() + offsets[id + 1], service_entry_less());
+}
+
+/**
+ *	Remove all flows.
+ */
+void CRemoteServiceIndex::clear() {
+	offsets.clear();
+	entries.clear();
+}
+
+/**
+ *	Get the flows of a remote address using a protocol (any remote port).
+ *
+ *	\param remoteId Id of the remote address
+ *	\param prot Protocol
+ *	\param first Receives the first entry
+ *	\param last Receives the entry after the last one
+ */
+void CRemoteServiceIndex::find(CIpDictionary::ipId remoteId, uint8_t prot, const_iterator & first, const_iterator & last) const {
+	if ((size_t) remoteId + 1 >= offsets.size()) { // Not in the indexed flowlist
+		first = last = entries.end();
+		return;
+	}
+	uint32_t low = (uint32_t) prot << 16;
+	pair<const_iterator, const_iterator> range = equal_range(entries.begin() + offsets[remoteId], entries.begin() + offsets[remoteId + 1], low,
+	      service_range_less(low, low | 0xffff));
+	first = range.first;
+	last = range.second;
+}
+
+/**
+ *	Get the flows of a remote address using a protocol and a remote port.
+ *
+ *	\param remoteId Id of the remote address
+ *	\param prot Protocol
+ *	\param remotePort Remote port
+ *	\param first Receives the first entry
+ *	\param last Receives the entry after the last one
+ */
+void CRemoteServiceIndex::find(CIpDictionary::ipId remoteId, uint8_t prot, uint16_t remotePort, const_iterator & first, const_iterator & last) const {
+	if ((size_t) remoteId + 1 >= offsets.size()) { // Not in the indexed flowlist
+		first = last = entries.end();
+		return;
+	}
+	uint32_t service = ((uint32_t) prot << 16) | remotePort;
+	pair<const_iterator, const_iterator> range = equal_range(entries.begin() + offsets[remoteId], entries.begin() + offsets[remoteId + 1], service,
+	      service_range_less(service, service));
+	first = range.first;
+	last = range.second;
+}
@@ -0,0 +1,67 @@
+#ifndef GSERVICEINDEX_H_
+#define GSERVICEINDEX_H_
+
+/**
+ *	\file gserviceindex.h
+ *	\brief Index of the flows of a flowlist by remote address, protocol and remote port.
+ *
+ * 	This file is subject to the terms and conditions defined in
+ * 	files 'BSD.txt' and 'GPL.txt'. For a list of authors see file 'AUTHORS'.
+ */
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+
+#include "cflow.h"
+#include "gipdictionary.h"
+
+/**
+ *	\class CRemoteServiceIndex
+ *	\brief Groups the flow numbers of a flowlist by (remoteIP, prot, remotePort)
+ *
+ *	The flows are grouped by the id of their remote address (see CIpDictionary), which is dense,
+ *	thus the groups are found through an offset array. Within a group the flows are sorted by
+ *	protocol, remote port and flow number, so the flows of a remote host using one protocol, and
+ *	the flows using one protocol and remote port, are contiguous ranges found by binary search.
+ *
+ *	The role rating uses the index to count the flows of other graphlets sharing a role: the
+ *	work per role depends on the flows of the role's remote hosts instead of the whole flowlist.
+ */
+class CRemoteServiceIndex {
+	public:
+		/**
+		 *	\struct entry_t
+		 *	\brief A flow number with its protocol and remote port
+		 */
+		struct entry_t {
+				uint32_t service; ///< prot << 16 | remotePort
+				uint32_t flow; ///< Flow number in the flowlist passed to build()
+		};
+		/**
+		 *	\typedef const_iterator
+		 *	\brief Iterator over the entries of a range
+		 */
+		typedef std::vector<entry_t>::const_iterator const_iterator;
+
+		CRemoteServiceIndex();
+
+		void build(const CIpDictionary & ipDictionary, const CFlowList & flowlist);
+		void clear();
+
+		void find(CIpDictionary::ipId remoteId, uint8_t prot, const_iterator & first, const_iterator & last) const;
+		void find(CIpDictionary::ipId remoteId, uint8_t prot, uint16_t remotePort, const_iterator & first, const_iterator & last) const;
+
+		/**
+		 *	\return Number of indexed flows
+		 */
+		size_t size() const {
+			return entries.size();
+		}
+
+	private:
+		std::vector<size_t> offsets; ///< First entry of each remote address id (one more than ids)
+		std::vector<entry_t> entries; ///< Flows grouped by remote address id, then sorted by service and flow
+};
+
+#endif /* GSERVICEINDEX_H_ */
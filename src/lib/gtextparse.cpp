@@ -0,0 +1,43 @@
+/**
+ *	\file gtextparse.cpp
+ *	\brief Fast parsing of text flow records: tokenizing and number conversion without copies.
+ *
+ * 	This file is subject to the terms and conditions defined in
+ * 	files 'BSD.txt' and 'GPL.txt'. For a list of authors see file 'AUTHORS'.
+ */
+
+#include <cstring>
+#include <arpa/inet.h>
+
+#include "gtextparse.h"
+
+namespace util {
+	/**
+	 *	Converts an IPv4 (dotted decimal) or IPv6 address. Unlike the string constructor of IPv6_addr,
+	 *	neither a copy of the text nor a regular expression is needed.
+	 *
+	 *	\param token Field
+	 *	\param ip Receives the address
+	 *
+	 *	\return False if the field is not a valid address
+	 */
+	bool parse_ip(const text_token & token, IPv6_addr & ip) {
+		char text[INET6_ADDRSTRLEN];
+		if (token.length == 0 || token.length >= sizeof(text))
+			return false;
+		memcpy(text, token.begin, token.length);
+		text[token.length] = '\0';
+		if (memchr(text, ':', token.length) != NULL) {
+			in6_addr ipv6;
+			if (inet_pton(AF_INET6, text, &ipv6) != 1)
+				return false;
+			ip = ipv6;
+		} else {
+			uint32_t ipv4;
+			if (inet_pton(AF_INET, text, &ipv4) != 1)
+				return false;
+			ip = IPv6_addr(ntohl(ipv4));
+		}
+		return true;
+	}
+}
@@ -0,0 +1,147 @@
+#ifndef GTEXTPARSE_H_
+#define GTEXTPARSE_H_
+
+/**
+ *	\file gtextparse.h
+ *	\brief Fast parsing of text flow records: tokenizing and number conversion without copies.
+ *
+ * 	This file is subject to the terms and conditions defined in
+ * 	files 'BSD.txt' and 'GPL.txt'. For a list of authors see file 'AUTHORS'.
+ */
+
+#include <stdint.h>
+#include <cstddef>
+#include <string>
+
+#include "IPv6_addr.h"
+
+namespace util {
+	/**
+	 *	\struct text_token
+	 *	\brief A field of a line: points into the text, which is not copied
+	 */
+	struct text_token {
+			const char * begin; ///< First character
+			size_t length; ///< Number of characters
+
+			std::string toString() const {
+				return std::string(begin, length);
+			}
+	};
+
+	/**
+	 *	Cuts the next field off a line
+	 *
+	 *	\param pos Current position, advanced behind the field and its separator
+	 *	\param end End of the line
+	 *	\param token Receives the field
+	 *	\param separator Field separator; 0 means fields are separated by any amount of blanks
+	 *
+	 *	\return False if there are no more fields
+	 */
+	inline bool next_field(const char * & pos, const char * end, text_token & token, char separator = 0) {
+		if (separator == 0) {
+			while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\r'))
+				pos++;
+			if (pos == end)
+				return false;
+			token.begin = pos;
+			while (pos < end && *pos != ' ' && *pos != '\t' && *pos != '\r')
+				pos++;
+			token.length = pos - token.begin;
+			return true;
+		}
+		if (pos > end)
+			return false;
+		token.begin = pos;
+		while (pos < end && *pos != separator)
+			pos++;
+		token.length = pos - token.begin;
+		if (token.length > 0 && token.begin[token.length - 1] == '\r')
+			token.length--;
+		pos++; // behind the separator (or one behind end for the last field)
+		return true;
+	}
+
+	/**
+	 *	Converts a decimal number
+	 *
+	 *	\param token Field consisting of digits only
+	 *	\param value Receives the value
+	 *
+	 *	\return False if the field is empty, contains other characters or overflows
+	 */
+	inline bool parse_uint(const text_token & token, uint64_t & value) {
+		if (token.length == 0 || token.length > 20)
+			return false;
+		uint64_t result = 0;
+		for (size_t i = 0; i < token.length; i++) {
+			unsigned int digit = (unsigned char) token.begin[i] - '0';
+			if (digit > 9 || result > (~(uint64_t) 0 - digit) / 10)
+				return false;
+			result = result * 10 + digit;
+		}
+		value = result;
+		return true;
+	}
+
+	/**
+	 *	Converts a decimal number of seconds with an optional fraction (e.g. "1286485200.123456")
+	 *
+	 *	\param token Field
+	 *	\param ms Receives the value in milliseconds (fraction cut off, not rounded)
+	 *
+	 *	\return False if the field is not a number of this form
+	 */
+	inline bool parse_seconds_ms(const text_token & token, uint64_t & ms) {
+		size_t dot = 0;
+		while (dot < token.length && token.begin[dot] != '.')
+			dot++;
+		text_token integer = { token.begin, dot };
+		uint64_t seconds = 0;
+		if (dot > 0 && !parse_uint(integer, seconds))
+			return false;
+		uint64_t fraction = 0;
+		size_t digits = 0;
+		for (size_t i = dot + 1; i < token.length; i++) {
+			unsigned int digit = (unsigned char) token.begin[i] - '0';
+			if (digit > 9)
+				return false;
+			if (digits < 3) {
+				fraction = fraction * 10 + digit;
+				digits++;
+			}
+		}
+		if (dot == 0 && token.length <= 1)
+			return false; // neither integer nor fraction digits
+		for (; digits < 3; digits++)
+			fraction *= 10;
+		ms = seconds * 1000 + fraction;
+		return true;
+	}
+
+	/**
+	 *	Compares a field to a lower case string, ignoring the case of the field
+	 *
+	 *	\param token Field
+	 *	\param lower Lower case string
+	 *
+	 *	\return True if equal
+	 */
+	inline bool token_equals(const text_token & token, const char * lower) {
+		size_t i = 0;
+		for (; i < token.length; i++) {
+			char c = token.begin[i];
+			if (c >= 'A' && c <= 'Z')
+				c += 'a' - 'A';
+			if (lower[i] != c) // also stops at the end of lower
+				return false;
+		}
+		return lower[i] == '\0';
+	}
+
+	bool parse_ip(const text_token & token, IPv6_addr & ip);
+}
+;
+
+#endif /* GTEXTPARSE_H_ */
@@ -12,6 +12,8 @@
 #include <netinet/in.h>		// IP protocol type definitions
 #include <arpa/inet.h>
 #include <sys/stat.h>
+#include <dirent.h>
+#include <glob.h>
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
@@ -114,6 +116,56 @@ namespace util {
 		return true;
 	}
 
+	/**
+	 *	Expand a name given by the user into a list of files: a directory stands for all the files in it
+	 *	(except hidden ones), a name containing wildcards is expanded like by the shell. Anything else
+	 *	is returned as it is.
+	 *
+	 *	\param name File, directory or glob pattern (e.g. /data/nfcapd.20101007*)
+	 *
+	 *	\return Files in ascending order of their names (empty if a pattern does not match)
+	 */
+	std::vector<std::string> expandFilenames(const std::string & name) {
+		vector<string> files;
+		struct stat statbuf;
+		if (stat(name.c_str(), &statbuf) == 0) {
+			if (!S_ISDIR(statbuf.st_mode)) {
+				files.push_back(name);
+				return files;
+			}
+			DIR * dir = opendir(name.c_str());
+			if (dir == NULL)
+				return files;
+			string prefix = name;
+			if (prefix[prefix.size() - 1] != '/')
+				prefix += '/';
+			struct dirent * entry;
+			while ((entry = readdir(dir)) != NULL) {
+				if (entry->d_name[0] == '.')
+					continue;
+				string file = prefix + entry->d_name;
+				if (stat(file.c_str(), &statbuf) == 0 && S_ISREG(statbuf.st_mode))
+					files.push_back(file);
+			}
+			closedir(dir);
+			sort(files.begin(), files.end());
+			return files;
+		}
+		if (name.find_first_of("*?[") == string::npos) {
+			files.push_back(name); // does not exist: let the caller report it
+			return files;
+		}
+		glob_t matches;
+		if (glob(name.c_str(), 0, NULL, &matches) == 0) {
+			for (size_t i = 0; i < matches.gl_pathc; i++) {
+				if (stat(matches.gl_pathv[i], &statbuf) == 0 && S_ISREG(statbuf.st_mode))
+					files.push_back(matches.gl_pathv[i]);
+			}
+		}
+		globfree(&matches);
+		return files; // glob() sorts already
+	}
+
 	/**
 	 *	Get filesize of a file.
 	 *
@@ -140,7 +192,6 @@ namespace util {
 		uint64_t p2 = ipv6_parts[1];
 		memcpy(addr.begin(), &p1, sizeof(uint64_t));
 		memcpy(addr.begin() + sizeof(uint64_t), &p2, sizeof(uint64_t));
-		cout << util::bin2hexstring(addr.begin(), sizeof(IPv6_addr)) << endl;
 		return addr; // FIXME: is the byte order correct? ~reto
 	}
 
@@ -13,6 +13,7 @@
 #include <string>
 #include <iostream>
 #include <set>
+#include <vector>
 #include <stdint.h>
 #include <netinet/in.h>
 #include <stdio.h>
@@ -26,6 +27,7 @@ namespace util {
 	void open_infile(std::ifstream & infs, std::string ifname);
 	uint64_t getFileSize(std::string in_filename);
 	bool fileExists(std::string in_filename);
+	std::vector<std::string> expandFilenames(const std::string & name);
 	FILE * openFile(std::string in_filename, std::string openmode);
 	void closeFile(FILE * file);
 	IPv6_addr ipV6NfDumpToIpV6(const uint64_t * ipv6_parts);
@@ -0,0 +1,93 @@
+#include <iostream>
+#include <vector>
+#include <sys/time.h>
+#include <netinet/in.h>
+
+#include "cute.h"
+#include "ide_listener.h"
+#include "cute_runner.h"
+#include "HashMapE.h"
+
+using namespace std;
+
+static double now_ms() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+void typedKeysCompareFields() {
+	IPv6_addr a("10.0.0.1"), b("2001:db8::1");
+	KeyHashFunction<CKeyIP_5T> hash5;
+	ASSERT(CKeyIP_5T(a, b, 1024, 80, IPPROTO_TCP) == CKeyIP_5T(a, b, 1024, 80, IPPROTO_TCP));
+	ASSERT_EQUAL(hash5(CKeyIP_5T(a, b, 1024, 80, IPPROTO_TCP)), hash5(CKeyIP_5T(a, b, 1024, 80, IPPROTO_TCP)));
+	ASSERT(!(CKeyIP_5T(a, b, 1024, 80, IPPROTO_TCP) == CKeyIP_5T(b, a, 1024, 80, IPPROTO_TCP)));
+	ASSERT(!(CKeyIP_5T(a, b, 1024, 80, IPPROTO_TCP) == CKeyIP_5T(a, b, 80, 1024, IPPROTO_TCP)));
+	ASSERT(!(CKeyIP_5T(a, b, 1024, 80, IPPROTO_TCP) == CKeyIP_5T(a, b, 1024, 80, IPPROTO_UDP)));
+	ASSERT(!(CKeyIP_4T(a, IPPROTO_TCP, 80, 1) == CKeyIP_4T(a, IPPROTO_TCP, 80, 2)));
+	ASSERT(!(CKeyIP_3T(a, IPPROTO_TCP, 80) == CKeyIP_3T(a, IPPROTO_TCP, 81)));
+	ASSERT(!(CKeyIP_5T_2(a, b, IPPROTO_UDP, 53, 1) == CKeyIP_5T_2(a, b, IPPROTO_UDP, 53, 3)));
+	ASSERT(!(CKeyProtoFlowtype(IPPROTO_TCP, 1) == CKeyProtoFlowtype(IPPROTO_UDP, 1)));
+	ASSERT_EQUAL(a, CKeyIP(a).getIP());
+
+	// same encoding as CHashKey6_6: numbers and addresses of both halves
+	ASSERT(CKey6_6((uint32_t) 7, (uint32_t) 9) == CKey6_6((uint64_t) 7, (uint64_t) 9));
+	ASSERT(!(CKey6_6(a, (uint64_t) 6) == CKey6_6((uint64_t) 6, a)));
+	ASSERT(!(CKey6_6(a, b) == CKey6_6(b, a)));
+
+	boost::array<uint16_t, 8> roles = { { 3, 5, 65535, 0, 0, 0, 0, 1 } };
+	ASSERT(roles == CKeyRoles8(roles).getRoles());
+}
+
+/**
+ *	Microbenchmark: builds the flow key of every flow and looks it up, once with HashKeyIPv6_5T and
+ *	HashFunction (byte array, lookup3) and once with CKeyIP_5T and KeyHashFunction
+ */
+template<typename Key, typename Hash>
+static double lookupFlows(const vector<cflow_t> & flows, const char * name) {
+	typedef flat_hash_map<Key, unsigned int, Hash, Hash> keyMap;
+	keyMap map;
+	double start = now_ms();
+	for (unsigned int i = 0; i < flows.size(); i++)
+		map[Key(flows[i].localIP, flows[i].remoteIP, flows[i].localPort, flows[i].remotePort, flows[i].prot)] = i;
+	unsigned int found = 0;
+	for (unsigned int round = 0; round < 4; round++) {
+		for (unsigned int i = 0; i < flows.size(); i++) {
+			typename keyMap::const_iterator it = map.find(Key(flows[i].localIP, flows[i].remoteIP, flows[i].localPort, flows[i].remotePort,
+			      flows[i].prot));
+			if (it != map.end() && it->second == i)
+				found++;
+		}
+	}
+	double elapsed = now_ms() - start;
+	ASSERT_EQUAL(flows.size(), map.size());
+	ASSERT_EQUAL(4 * flows.size(), found);
+	cout << name << ": " << elapsed << " ms" << endl;
+	return elapsed;
+}
+
+void benchFlowKeys() {
+	vector<cflow_t> flows(200000);
+	for (unsigned int i = 0; i < flows.size(); i++) {
+		flows[i].localIP = IPv6_addr((uint32_t) (0x0a000000 + i % 1000));
+		flows[i].remoteIP = IPv6_addr((uint32_t) (0xc0a80000 + i / 1000));
+		flows[i].localPort = 1024 + i % 50000;
+		flows[i].remotePort = (i & 1) ? 80 : 53;
+		flows[i].prot = (i & 1) ? IPPROTO_TCP : IPPROTO_UDP;
+	}
+	lookupFlows<HashKeyIPv6_5T, HashFunction<HashKeyIPv6_5T> > (flows, "HashKeyIPv6_5T");
+	lookupFlows<CKeyIP_5T, KeyHashFunction<CKeyIP_5T> > (flows, "CKeyIP_5T");
+}
+
+void runSuite() {
+	cute::suite s;
+	s.push_back(CUTE(typedKeysCompareFields));
+	s.push_back(CUTE(benchFlowKeys));
+	cute::ide_listener lis;
+	cute::makeRunner(lis)(s, "hash keys");
+}
+
+int main() {
+	runSuite();
+	return 0;
+}
@@ -13,9 +13,46 @@ void HashKeyIPv6Pair_HashKeyIPv4Pair() {
 	ASSERT_EQUAL(*(IPv6_addr*)(&hkp.getkey()[16]), b);
 }
 
+void flat_hash_map_insert_find_erase() {
+	typedef flat_hash_map<HashKeyIPv6, int> ipMap;
+	ipMap map;
+	ASSERT(map.empty());
+	ASSERT(map.find(HashKeyIPv6(IPv6_addr(1))) == map.end());
+
+	// enough keys to grow the slot table several times
+	for (int i = 0; i < 10000; i++)
+		map[HashKeyIPv6(IPv6_addr(i))] = i;
+	ASSERT_EQUAL(10000, map.size());
+	ASSERT(!map.insert(std::make_pair(HashKeyIPv6(IPv6_addr(5)), 0)).second);
+	ASSERT_EQUAL(5, map[HashKeyIPv6(IPv6_addr(5))]);
+
+	// iteration follows the insertion order
+	int expected = 0;
+	for (ipMap::const_iterator it = map.begin(); it != map.end(); ++it, expected++)
+		ASSERT_EQUAL(expected, it->second);
+
+	for (int i = 0; i < 10000; i += 2)
+		ASSERT_EQUAL(1, map.erase(HashKeyIPv6(IPv6_addr(i))));
+	ASSERT_EQUAL(0, map.erase(HashKeyIPv6(IPv6_addr(0))));
+	ASSERT_EQUAL(5000, map.size());
+	for (int i = 0; i < 10000; i++) {
+		ipMap::iterator it = map.find(HashKeyIPv6(IPv6_addr(i)));
+		if (i % 2) {
+			ASSERT(it != map.end());
+			ASSERT_EQUAL(i, it->second);
+		} else
+			ASSERT(it == map.end());
+	}
+
+	map.clear();
+	ASSERT(map.empty());
+	ASSERT_EQUAL(0, map.count(HashKeyIPv6(IPv6_addr(1))));
+}
+
 void runSuite() {
 	cute::suite s;
 	s.push_back(CUTE(HashKeyIPv6Pair_HashKeyIPv4Pair));
+	s.push_back(CUTE(flat_hash_map_insert_find_erase));
 	cute::ide_listener lis;
 	cute::makeRunner(lis)(s, "hash_map");
 }
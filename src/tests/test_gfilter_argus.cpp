@@ -0,0 +1,102 @@
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+
+#include "cute.h"
+#include "ide_listener.h"
+#include "cute_runner.h"
+
+#include "gfilter_argus.h"
+
+using namespace std;
+
+/**
+ *	Installs a fake ra in the current directory which prints the given text for any argus file
+ */
+static void installFakeRa(const string & output) {
+	ofstream data("test_gfilter_argus.out");
+	data << output;
+	data.close();
+	ofstream script("ra");
+	script << "#!/bin/sh\ncat test_gfilter_argus.out\n";
+	script.close();
+	chmod("ra", 0755);
+	char cwd[4096];
+	if (getcwd(cwd, sizeof(cwd)) == NULL)
+		return;
+	string path = string(cwd) + ":" + getenv("PATH");
+	setenv("PATH", path.c_str(), 1);
+}
+
+static void removeFakeRa() {
+	remove("ra");
+	remove("test_gfilter_argus.out");
+}
+
+void testReadFile() {
+	string output;
+	output += "1286485200.123456 0.500000  tcp 10.0.0.1 192.168.0.1 -> 1024 80 3 2 300 200 0 16\n";
+	output += "1286485201.000000 1.250000 ICMP 192.168.0.2 10.0.0.2 <?> 0x0008 0x0000 1 1 84 84 0 0\n";
+	output += "\n";
+	// enough lines to fill several chunks
+	for (int i = 0; i < 40000; i++)
+		output += "1286485202.5 0.0 udp 10.0.0.3 192.168.0.3 <-> 53 53 1 1 60 120 0 0\n";
+	installFakeRa(output);
+
+	GFilter_argus testImport;
+	CFlowList flowlist;
+	testImport.read_file("test.log", flowlist, IPv6_addr(0x0a000000), IPv6_addr(0xff000000), false);
+	removeFakeRa();
+
+	ASSERT_EQUAL(40002, flowlist.size());
+	ASSERT_EQUAL(IPPROTO_TCP, flowlist[0].prot);
+	ASSERT_EQUAL(outflow, flowlist[0].flowtype);
+	ASSERT_EQUAL(1286485200123ULL, flowlist[0].startMs);
+	ASSERT_EQUAL(500, flowlist[0].durationMs);
+	ASSERT_EQUAL(IPv6_addr(0x0a000001), flowlist[0].localIP);
+	ASSERT_EQUAL(1024, flowlist[0].localPort);
+	ASSERT_EQUAL(80, flowlist[0].remotePort);
+	ASSERT_EQUAL(5, flowlist[0].dPkts);
+	ASSERT_EQUAL(500, flowlist[0].dOctets);
+	ASSERT_EQUAL(16, flowlist[0].tos_flags);
+
+	// inflow from a remote host: turned around
+	ASSERT_EQUAL(IPPROTO_ICMP, flowlist[1].prot);
+	ASSERT_EQUAL(biflow, flowlist[1].flowtype);
+	ASSERT_EQUAL(IPv6_addr(0x0a000002), flowlist[1].localIP);
+	ASSERT_EQUAL(0, flowlist[1].localPort);
+
+	ASSERT_EQUAL(IPPROTO_UDP, flowlist[40001].prot);
+	ASSERT_EQUAL(1286485202500ULL, flowlist[40001].startMs);
+}
+
+void testParseError() {
+	installFakeRa("1286485200.1 0.5 tcp 10.0.0.1 192.168.0.1 -> http 80 3 2 300 200 0 16\n");
+	GFilter_argus testImport;
+	CFlowList flowlist;
+	bool failed = false;
+	try {
+		testImport.read_file("test.log", flowlist, IPv6_addr(0x0a000000), IPv6_addr(0xff000000), false);
+	} catch (string & e) {
+		failed = true;
+	}
+	removeFakeRa();
+	ASSERT(failed);
+}
+
+void runSuite() {
+	cute::suite s;
+	s.push_back(CUTE(testReadFile));
+	s.push_back(CUTE(testParseError));
+	cute::ide_listener lis;
+	cute::makeRunner(lis)(s, "test_GFilter_argus");
+}
+
+int main() {
+	runSuite();
+	return 0;
+}
@@ -0,0 +1,221 @@
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <cstring>
+#include <netinet/in.h>
+
+#include "cute.h"
+#include "ide_listener.h"
+#include "cute_runner.h"
+
+#include "gfilter_cflow.h"
+
+using namespace std;
+
+static CFlowList getTestFlows(unsigned int count) {
+	CFlowList flowlist;
+	for (unsigned int i = 0; i < count; i++) {
+		IPv6_addr localIP(0x0a000001 + i / 4);
+		IPv6_addr remoteIP(0xc0a80001 + i);
+		flowlist.push_back(cflow_t(localIP, 1024 + i, remoteIP, 80, IPPROTO_TCP, biflow, 1000 * i, 10, 100 * i, i + 1));
+	}
+	return flowlist;
+}
+
+void testRawAcceptFilename() {
+	GFilter_cflow6raw filter;
+	ASSERTM("Should not accept filename demo-glatz.gz", !filter.acceptFilename("demo-glatz.gz"));
+	ASSERTM("Should not accept filename nfcapd.201009212300", !filter.acceptFilename("nfcapd.201009212300"));
+	ASSERTM("Should not accept an empty filename", !filter.acceptFilename(""));
+	ASSERTM("Should accept filename demo-glatz.cflow6raw", filter.acceptFilename("demo-glatz.cflow6raw"));
+}
+
+void testRawRoundtrip() {
+	string filename = "test_gfilter_cflow.cflow6raw";
+	GFilter_cflow6raw filter;
+	CFlowList flowlist = getTestFlows(1000);
+	filter.write_file(filename, flowlist, false);
+	ASSERTM("Written file should be accepted", filter.acceptFileForReading(filename));
+
+	CFlowList readlist;
+	filter.read_file(filename, readlist);
+	ASSERT_EQUAL(flowlist.size(), readlist.size());
+	for (unsigned int i = 0; i < flowlist.size(); i++) {
+		ASSERT_EQUAL(0, memcmp(&flowlist[i], &readlist[i], sizeof(cflow_t)));
+	}
+
+	// appending keeps the file sorted
+	filter.write_file(filename, getTestFlows(10), true);
+	filter.read_file(filename, readlist);
+	ASSERT_EQUAL(flowlist.size() + 10, readlist.size());
+	for (unsigned int i = 1; i < readlist.size(); i++) {
+		ASSERT(!(readlist[i] < readlist[i - 1]));
+	}
+	unlink(filename.c_str());
+}
+
+void testBlockRoundtrip() {
+	string filename = "test_gfilter_cflow_blocks.gz";
+	GFilter_cflow6 filter;
+	CFlowList flowlist = getTestFlows(2 * CFLOW_BLOCK_FLOWS + 123);
+	filter.write_file(filename, flowlist, false);
+	ASSERTM("Written file should be accepted", filter.acceptFileForReading(filename));
+
+	CFlowList readlist;
+	filter.read_file(filename, readlist);
+	ASSERT_EQUAL(flowlist.size(), readlist.size());
+	for (unsigned int i = 0; i < flowlist.size(); i++) {
+		ASSERT_EQUAL(0, memcmp(&flowlist[i], &readlist[i], sizeof(cflow_t)));
+	}
+	unlink(filename.c_str());
+}
+
+void testSingleStreamStillReadable() {
+	string filename = "test_gfilter_cflow_stream.gz";
+	GFilter_cflow6 filter;
+	CFlowList flowlist = getTestFlows(1000);
+	filter.GFilter_cflow::write_file(filename, flowlist, false);
+
+	CFlowList readlist;
+	filter.read_file(filename, readlist);
+	ASSERT_EQUAL(flowlist.size(), readlist.size());
+	for (unsigned int i = 0; i < flowlist.size(); i++) {
+		ASSERT_EQUAL(0, memcmp(&flowlist[i], &readlist[i], sizeof(cflow_t)));
+	}
+	unlink(filename.c_str());
+}
+
+void testConcatenatedStreams() {
+	string filename1 = "test_gfilter_cflow_part1.gz";
+	string filename2 = "test_gfilter_cflow_part2.gz";
+	GFilter_cflow6 filter;
+	filter.GFilter_cflow::write_file(filename1, getTestFlows(1000), false);
+	filter.GFilter_cflow::write_file(filename2, getTestFlows(500), false);
+
+	// cat part1 part2 > part1: a multi-member gzip file whose ISIZE trailer only covers the last member
+	ifstream part2(filename2.c_str(), ios::binary);
+	ofstream part1(filename1.c_str(), ios::binary | ios::app);
+	part1 << part2.rdbuf();
+	part1.close();
+
+	CFlowList readlist;
+	filter.read_file(filename1, readlist);
+	ASSERT_EQUAL(1500, readlist.size());
+	unlink(filename1.c_str());
+	unlink(filename2.c_str());
+}
+
+void testReadHosts() {
+	string filename = "test_gfilter_cflow_hosts.gz";
+	GFilter_cflow6 filter;
+	CFlowList flowlist = getTestFlows(2 * CFLOW_BLOCK_FLOWS + 123);
+	sort(flowlist.begin(), flowlist.end());
+	filter.write_file(filename, flowlist, false);
+
+	// Two hosts, starting with one whose flows span a block boundary
+	unsigned int first = CFLOW_BLOCK_FLOWS - 2;
+	while (first > 0 && flowlist[first - 1].localIP == flowlist[first].localIP)
+		first--;
+	unsigned int last = first + 1;
+	unsigned int hosts = 1;
+	for (; last < flowlist.size(); last++) {
+		if (flowlist[last].localIP != flowlist[last - 1].localIP && ++hosts > 2)
+			break;
+	}
+
+	CFlowList readlist;
+	ASSERTM("File should have a host index", filter.read_file_hosts(filename, readlist, flowlist[first].localIP, 2));
+	ASSERT_EQUAL(last - first, readlist.size());
+	for (unsigned int i = 0; i < readlist.size(); i++) {
+		ASSERT_EQUAL(0, memcmp(&flowlist[first + i], &readlist[i], sizeof(cflow_t)));
+	}
+
+	// Unknown host: nothing
+	ASSERT(filter.read_file_hosts(filename, readlist, IPv6_addr("2001:db8::1"), 1));
+	ASSERT_EQUAL(0, readlist.size());
+	unlink(filename.c_str());
+}
+
+void testAppendSegments() {
+	string filename = "test_gfilter_cflow_append.gz";
+	GFilter_cflow6 filter;
+	CFlowList expected = getTestFlows(CFLOW_BLOCK_FLOWS + 100);
+	filter.write_file(filename, expected, false);
+
+	// Each append adds a segment with flows interleaving the existing ones, some get compacted
+	for (unsigned int n = 1; n <= 6; n++) {
+		CFlowList flows = getTestFlows(1000 * n);
+		for (CFlowList::iterator it = flows.begin(); it != flows.end(); it++)
+			it->startMs += n;
+		reverse(flows.begin(), flows.end());
+		filter.write_file(filename, flows, true);
+		copy(flows.begin(), flows.end(), back_inserter(expected));
+	}
+	sort(expected.begin(), expected.end());
+
+	CFlowList readlist;
+	filter.read_file(filename, readlist);
+	ASSERT_EQUAL(expected.size(), readlist.size());
+	for (unsigned int i = 0; i < expected.size(); i++) {
+		ASSERT_EQUAL(0, memcmp(&expected[i], &readlist[i], sizeof(cflow_t)));
+	}
+
+	// The host index covers all segments
+	IPv6_addr host(0x0a000001 + 10);
+	CFlowList hostflows;
+	for (CFlowList::const_iterator it = expected.begin(); it != expected.end(); it++) {
+		if (!(it->localIP < host) && it->localIP < IPv6_addr(0x0a000001 + 13))
+			hostflows.push_back(*it);
+	}
+	ASSERTM("File should have a host index", filter.read_file_hosts(filename, readlist, host, 3));
+	ASSERT_EQUAL(hostflows.size(), readlist.size());
+	for (unsigned int i = 0; i < hostflows.size(); i++) {
+		ASSERT_EQUAL(0, memcmp(&hostflows[i], &readlist[i], sizeof(cflow_t)));
+	}
+	unlink(filename.c_str());
+}
+
+void testInterruptedAppendKeepsIndex() {
+	string filename = "test_gfilter_cflow_interrupted.gz";
+	GFilter_cflow6 filter;
+	CFlowList flowlist = getTestFlows(CFLOW_BLOCK_FLOWS + 100);
+	filter.write_file(filename, flowlist, false);
+	struct stat filestat;
+	ASSERT_EQUAL(0, stat(filename.c_str(), &filestat));
+
+	// A small segment does not get compacted, the old index stays in front of it
+	filter.write_file(filename, getTestFlows(10), true);
+	CFlowList readlist;
+	filter.read_file(filename, readlist);
+	ASSERT_EQUAL(flowlist.size() + 10, readlist.size());
+
+	// Cut off as if the append was interrupted before its final member
+	ASSERT_EQUAL(0, truncate(filename.c_str(), filestat.st_size));
+	filter.read_file(filename, readlist);
+	ASSERT_EQUAL(flowlist.size(), readlist.size());
+	for (unsigned int i = 0; i < flowlist.size(); i++) {
+		ASSERT_EQUAL(0, memcmp(&flowlist[i], &readlist[i], sizeof(cflow_t)));
+	}
+	unlink(filename.c_str());
+}
+
+void runSuite() {
+	cute::suite s;
+	s.push_back(CUTE(testRawAcceptFilename));
+	s.push_back(CUTE(testRawRoundtrip));
+	s.push_back(CUTE(testBlockRoundtrip));
+	s.push_back(CUTE(testSingleStreamStillReadable));
+	s.push_back(CUTE(testConcatenatedStreams));
+	s.push_back(CUTE(testReadHosts));
+	s.push_back(CUTE(testAppendSegments));
+	s.push_back(CUTE(testInterruptedAppendKeepsIndex));
+	cute::ide_listener lis;
+	cute::makeRunner(lis)(s, "test_GFilter_cflow");
+}
+
+int main() {
+	runSuite();
+	return 0;
+}
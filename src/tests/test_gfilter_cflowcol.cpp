@@ -0,0 +1,96 @@
+#include <string>
+#include <unistd.h>
+#include <cstring>
+#include <netinet/in.h>
+
+#include "cute.h"
+#include "ide_listener.h"
+#include "cute_runner.h"
+
+#include "gfilter_cflowcol.h"
+
+using namespace std;
+
+static CFlowList getTestFlows(unsigned int count) {
+	CFlowList flowlist;
+	for (unsigned int i = 0; i < count; i++) {
+		IPv6_addr localIP(0x0a000000 + i / 100);
+		IPv6_addr remoteIP(0xc0a80001 + i);
+		uint8_t prot = (i % 3 == 0) ? IPPROTO_UDP : IPPROTO_TCP;
+		uint8_t flowtype = (i % 5 == 0) ? outflow : biflow;
+		flowlist.push_back(cflow_t(localIP, 1024 + i, remoteIP, 80, prot, flowtype, 1000 * i, 10, 100 * i, i + 1));
+	}
+	return flowlist;
+}
+
+void testColAcceptFilename() {
+	GFilter_cflow6col filter;
+	ASSERTM("Should not accept filename demo-glatz.gz", !filter.acceptFilename("demo-glatz.gz"));
+	ASSERTM("Should not accept filename demo-glatz.cflow6raw", !filter.acceptFilename("demo-glatz.cflow6raw"));
+	ASSERTM("Should accept filename demo-glatz.cflowcol", filter.acceptFilename("demo-glatz.cflowcol"));
+}
+
+void testColRoundtrip() {
+	string filename = "test_gfilter_cflowcol.cflowcol";
+	GFilter_cflow6col filter;
+	CFlowList flowlist = getTestFlows(2 * CFLOWCOL_GROUP_FLOWS + 77);
+	filter.write_file(filename, flowlist, false);
+	ASSERTM("Written file should be accepted", filter.acceptFileForReading(filename));
+
+	CFlowList readlist;
+	filter.read_file(filename, readlist);
+	ASSERT_EQUAL(flowlist.size(), readlist.size());
+	for (unsigned int i = 0; i < flowlist.size(); i++) {
+		ASSERT_EQUAL(0, memcmp(&flowlist[i], &readlist[i], sizeof(cflow_t)));
+	}
+	unlink(filename.c_str());
+}
+
+void testColPredicate() {
+	string filename = "test_gfilter_cflowcol_filtered.cflowcol";
+	GFilter_cflow6col filter;
+	CFlowList flowlist = getTestFlows(2 * CFLOWCOL_GROUP_FLOWS + 77);
+	filter.write_file(filename, flowlist, false);
+
+	prefs_t prefs;
+	prefs.filter_UDP = true;
+	prefs.filter_uniflows = true;
+	CFlowPredicate predicate(prefs);
+	predicate.setLocalNet(IPv6_addr(0x0a000500), IPv6_addr::getNetmask(120));
+
+	CFlowList expected;
+	for (CFlowList::const_iterator it = flowlist.begin(); it != flowlist.end(); it++) {
+		if (predicate.acceptType(it->prot, it->flowtype) && predicate.acceptLocalIP(it->localIP))
+			expected.push_back(*it);
+	}
+	ASSERT(expected.size() > 0);
+
+	CFlowList readlist;
+	filter.read_file_filtered(filename, readlist, predicate);
+	ASSERT_EQUAL(expected.size(), readlist.size());
+	for (unsigned int i = 0; i < expected.size(); i++) {
+		ASSERT_EQUAL(0, memcmp(&expected[i], &readlist[i], sizeof(cflow_t)));
+		ASSERT_EQUAL(IPPROTO_TCP, readlist[i].prot);
+		ASSERT_EQUAL(biflow, readlist[i].flowtype);
+	}
+
+	// Network not in file
+	predicate.setLocalNet(IPv6_addr("2001:db8::"), IPv6_addr::getNetmask(32));
+	filter.read_file_filtered(filename, readlist, predicate);
+	ASSERT_EQUAL(0, readlist.size());
+	unlink(filename.c_str());
+}
+
+void runSuite() {
+	cute::suite s;
+	s.push_back(CUTE(testColAcceptFilename));
+	s.push_back(CUTE(testColRoundtrip));
+	s.push_back(CUTE(testColPredicate));
+	cute::ide_listener lis;
+	cute::makeRunner(lis)(s, "test_GFilter_cflowcol");
+}
+
+int main() {
+	runSuite();
+	return 0;
+}
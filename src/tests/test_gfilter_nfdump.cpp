@@ -1,11 +1,23 @@
 #include <string>
+#include <vector>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
 #include <libgen.h>
+#include <netinet/in.h>
+#ifdef HAVE_BZIP2
+#include <bzlib.h>
+#endif
 
 #include "cute.h"
 #include "ide_listener.h"
 #include "cute_runner.h"
 
 #include "gfilter_nfdump.h"
+#include "gfilter_nfdump_gnfdump.h"
+
+using namespace std;
 
 void testAcceptFilename() {
 	GFilter_nfdump testImport;
@@ -21,9 +33,181 @@ void testAcceptFilename() {
 	ASSERTM("Should accept filename nfcapd.201009212300", testImport.acceptFilename("nfcapd.201009212300"));
 }
 
+/**
+ *	Builds an IPv4 flow record with 32 bit counters, using extension map 0
+ */
+static string getRecord(uint32_t srcIP, uint16_t srcPort, uint32_t dstIP, uint16_t dstPort, uint32_t first, uint32_t packets) {
+	string record(COMMON_RECORD_DATA_SIZE + 16, '\0');
+	common_record_t * r = (common_record_t *) &record[0];
+	r->type = CommonRecordType;
+	r->size = record.size();
+	r->first = first;
+	r->last = first + 2;
+	r->prot = IPPROTO_TCP;
+	r->srcport = srcPort;
+	r->dstport = dstPort;
+	uint32_t data[] = { srcIP, dstIP, packets, packets * 100 };
+	memcpy(&r->data, data, sizeof(data));
+	return record;
+}
+
+/**
+ *	Builds a data block, compressed if the file flags say so
+ */
+static string getBlock(const string & records, uint32_t count, uint32_t flags = 0) {
+	string data = records;
+#ifdef HAVE_BZIP2
+	if (flags & FLAG_BZ2) {
+		unsigned int size = records.size() * 2 + 600;
+		vector<char> compressed(size);
+		BZ2_bzBuffToBuffCompress(&compressed[0], &size, (char *) records.data(), records.size(), 9, 0, 0);
+		data.assign(&compressed[0], size);
+	}
+#endif
+	data_block_header_t header;
+	memset(&header, 0, sizeof(header));
+	header.NumRecords = count;
+	header.size = data.size();
+	header.id = DATA_BLOCK_TYPE_2;
+	return string((const char *) &header, sizeof(header)) + data;
+}
+
+/**
+ *	Writes an nfdump file with 2 extension maps and 100 blocks of 1000 flows each.
+ *	Map 1 is redefined in the middle of the file (the records remain the same).
+ */
+static void writeManyBlocks(const string & filename, uint32_t flags) {
+	file_header_t header;
+	memset(&header, 0, sizeof(header));
+	header.magic = MAGIC;
+	header.version = LAYOUT_VERSION_1;
+	header.flags = flags;
+	header.NumBlocks = 100;
+	stat_record_t stat;
+	memset(&stat, 0, sizeof(stat));
+
+	string map(12, '\0');
+	extension_map_t * m = (extension_map_t *) &map[0];
+	m->type = ExtensionMapType;
+	m->size = map.size();
+	m->map_id = 1;
+
+	ofstream out(filename.c_str(), ios::binary);
+	out << string((const char *) &header, sizeof(header)) << string((const char *) &stat, sizeof(stat));
+	for (uint32_t block = 0; block < 100; block++) {
+		string records;
+		uint32_t count = 0;
+		if (block == 0 || block == 50) {
+			records += map;
+			count++;
+		}
+		for (uint32_t i = 0; i < 1000; i++, count++) {
+			string record = getRecord(0x0a000000 + block % 7, 1024 + i % 300, 0xc0a80001 + i % 11, 80, 1000 + block, 1 + i % 3);
+			((common_record_t *) &record[0])->ext_map = 1;
+			records += record;
+		}
+		out << getBlock(records, count, flags);
+	}
+	out.close();
+}
+
+void testReadFile() {
+	file_header_t header;
+	memset(&header, 0, sizeof(header));
+	header.magic = MAGIC;
+	header.version = LAYOUT_VERSION_1;
+	header.NumBlocks = 3;
+	stat_record_t stat;
+	memset(&stat, 0, sizeof(stat));
+
+	// Extension map 0 without optional extensions
+	string map(12, '\0');
+	extension_map_t * m = (extension_map_t *) &map[0];
+	m->type = ExtensionMapType;
+	m->size = map.size();
+	m->map_id = 0;
+
+	string file((const char *) &header, sizeof(header));
+	file += string((const char *) &stat, sizeof(stat));
+	file += getBlock(map + getRecord(0x0a000001, 1024, 0xc0a80001, 80, 2000, 3), 2);
+	// reply, starting earlier than the first record
+	file += getBlock(getRecord(0xc0a80001, 80, 0x0a000001, 1024, 1000, 2), 1);
+	string records;
+	for (uint32_t i = 0; i < 1000; i++)
+		records += getRecord(0x0a000002, 2000 + i, 0xc0a80002, 443, 3000, 1);
+	file += getBlock(records, 1000);
+
+	string filename = "nfcapd.test_gfilter_nfdump";
+	ofstream out(filename.c_str(), ios::binary);
+	out << file;
+	out.close();
+
+	GFilter_nfdump testImport;
+	CFlowList flowlist;
+	flowlist.push_back(cflow_t());
+	testImport.read_file(filename, flowlist, IPv6_addr(0x0a000000), IPv6_addr(0xff000000), true);
+	remove(filename.c_str());
+
+	ASSERT_EQUAL(1 + 1 + 1000, flowlist.size());
+	const cflow_t & flow = flowlist[1];
+	ASSERT_EQUAL(biflow, flow.flowtype);
+	ASSERT_EQUAL(IPv6_addr(0x0a000001), flow.localIP);
+	ASSERT_EQUAL(IPv6_addr(0xc0a80001), flow.remoteIP);
+	ASSERT_EQUAL(1024, flow.localPort);
+	ASSERT_EQUAL(80, flow.remotePort);
+	ASSERT_EQUAL(5, flow.dPkts);
+	ASSERT_EQUAL(500, flow.dOctets);
+	ASSERT_EQUAL(1000000, flow.startMs);
+	ASSERT_EQUAL(1002000, flow.durationMs);
+	ASSERT_EQUAL(outflow, flowlist[1001].flowtype);
+	ASSERT_EQUAL(2999, flowlist[1001].localPort);
+}
+
+void testParallelMatchesSerial() {
+	string filename = "nfcapd.test_gfilter_nfdump";
+	writeManyBlocks(filename, 0);
+	GFilter_nfdump testImport;
+	CFlowList serial, parallel;
+	setenv("HAPVIEWER_THREADS", "1", 1);
+	testImport.read_file(filename, serial, IPv6_addr(0x0a000000), IPv6_addr(0xff000000), false);
+	setenv("HAPVIEWER_THREADS", "4", 1);
+	testImport.read_file(filename, parallel, IPv6_addr(0x0a000000), IPv6_addr(0xff000000), false);
+	unsetenv("HAPVIEWER_THREADS");
+	remove(filename.c_str());
+
+	ASSERT_EQUAL(7 * 1000, serial.size());
+	ASSERT_EQUAL(serial.size(), parallel.size());
+	ASSERT_EQUAL(0, memcmp(&serial[0], &parallel[0], serial.size() * sizeof(cflow_t)));
+	uint64_t packets = 0;
+	for (CFlowList::const_iterator it = serial.begin(); it != serial.end(); it++)
+		packets += it->dPkts;
+	ASSERT_EQUAL(100 * (334 + 333 * 2 + 333 * 3), packets);
+}
+
+#ifdef HAVE_BZIP2
+void testReadBzip2() {
+	string filename = "nfcapd.test_gfilter_nfdump";
+	GFilter_nfdump testImport;
+	CFlowList plain, compressed;
+	writeManyBlocks(filename, 0);
+	testImport.read_file(filename, plain, IPv6_addr(0x0a000000), IPv6_addr(0xff000000), false);
+	writeManyBlocks(filename, FLAG_BZ2);
+	testImport.read_file(filename, compressed, IPv6_addr(0x0a000000), IPv6_addr(0xff000000), false);
+	remove(filename.c_str());
+
+	ASSERT_EQUAL(plain.size(), compressed.size());
+	ASSERT_EQUAL(0, memcmp(&plain[0], &compressed[0], plain.size() * sizeof(cflow_t)));
+}
+#endif
+
 void runSuite() {
 	cute::suite s;
 	s.push_back(CUTE(testAcceptFilename));
+	s.push_back(CUTE(testReadFile));
+	s.push_back(CUTE(testParallelMatchesSerial));
+#ifdef HAVE_BZIP2
+	s.push_back(CUTE(testReadBzip2));
+#endif
 	cute::ide_listener lis;
 	cute::makeRunner(lis)(s, "test_GFilter_nfdump");
 }
@@ -1,11 +1,18 @@
 #include <string>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
 #include <libgen.h>
+#include <netinet/in.h>
 
 #include "cute.h"
 #include "ide_listener.h"
 #include "cute_runner.h"
 
 #include "gfilter_pcap.h"
+#include "gpcapreader.h"
+
+using namespace std;
 
 void testAcceptFilename() {
 	GFilter_pcap testImport;
@@ -17,13 +24,160 @@ void testAcceptFilename() {
 	ASSERTM("Should not accept an empty filename", !testImport.acceptFilename(""));
 	// good filenames
 	ASSERTM("Should accept filename wireshark.pcap", testImport.acceptFilename("wireshark.pcap"));
+	ASSERTM("Should accept filename wireshark.pcapng", testImport.acceptFilename("wireshark.pcapng"));
 	ASSERTM("Should accept filename ipv6-ssh-thinkpad2c2d-fe80::21c:25ff:fe16:d4f4.pcap",
 	      testImport.acceptFilename("ipv6-ssh-thinkpad2c2d-fe80::21c:25ff:fe16:d4f4.pcap"));
 }
 
+static void put16(string & s, uint16_t value) {
+	s.append((const char *) &value, 2);
+}
+
+static void put32(string & s, uint32_t value) {
+	s.append((const char *) &value, 4);
+}
+
+/**
+ *	Builds an Ethernet frame carrying an IPv4/UDP packet from 10.0.0.1:1024 to 192.168.0.1:53,
+ *	optionally with a VLAN tag and an MPLS label stack of two labels.
+ */
+static string getFrame(bool reply, bool vlan, bool mpls) {
+	string frame(12, '\0');
+	if (vlan)
+		frame += string("\x81\x00\x00\x05", 4);
+	if (mpls) {
+		frame += string("\x88\x47", 2);
+		frame += string("\x00\x01\x00\x40", 4);
+		frame += string("\x00\x02\x01\x40", 4); // bottom of stack
+	} else {
+		frame += string("\x08\x00", 2);
+	}
+	// IPv4 header with 4 bytes of options (IHL 6)
+	string ip("\x46\x10\x00\x20\x00\x00\x00\x00\x40\x11\x00\x00", 12);
+	const char local[] = { 10, 0, 0, 1 }, remote[] = { (char) 192, (char) 168, 0, 1 };
+	ip.append(reply ? remote : local, 4);
+	ip.append(reply ? local : remote, 4);
+	ip.append(4, '\0');
+	const char udp[] = { 0x04, 0x00, 0x00, 0x35 };
+	if (reply) {
+		ip += string(udp + 2, 2);
+		ip += string(udp, 2);
+	} else {
+		ip += string(udp, 4);
+	}
+	ip.append(4, '\0');
+	return frame + ip;
+}
+
+static void checkFlows(const CFlowList & flowlist) {
+	ASSERT_EQUAL(1, flowlist.size());
+	ASSERT_EQUAL(biflow, flowlist[0].flowtype);
+	ASSERT_EQUAL(IPv6_addr(0x0a000001), flowlist[0].localIP);
+	ASSERT_EQUAL(IPv6_addr(0xc0a80001), flowlist[0].remoteIP);
+	ASSERT_EQUAL(1024, flowlist[0].localPort);
+	ASSERT_EQUAL(53, flowlist[0].remotePort);
+	ASSERT_EQUAL(IPPROTO_UDP, flowlist[0].prot);
+	ASSERT_EQUAL(3, flowlist[0].dPkts);
+	ASSERT_EQUAL(3 * 32, flowlist[0].dOctets);
+	ASSERT_EQUAL(0x10, flowlist[0].tos_flags);
+	ASSERT_EQUAL(1000000, flowlist[0].startMs);
+	ASSERT_EQUAL(250, flowlist[0].durationMs);
+}
+
+void testReadPcap() {
+	string frames[] = { getFrame(false, false, false), getFrame(true, true, false), getFrame(false, true, true) };
+	string file;
+	put32(file, 0xa1b2c3d4);
+	put16(file, 2);
+	put16(file, 4);
+	put32(file, 0);
+	put32(file, 0);
+	put32(file, 65535);
+	put32(file, LINKTYPE_ETHERNET);
+	for (int i = 0; i < 3; i++) {
+		put32(file, 1000);
+		put32(file, 125000 * i);
+		put32(file, frames[i].size());
+		put32(file, frames[i].size());
+		file += frames[i];
+	}
+	// A record cut off by an interrupted capture
+	put32(file, 1001);
+	put32(file, 0);
+	put32(file, 100);
+	put32(file, 100);
+	file += "abc";
+
+	string filename = "test_gfilter_pcap.pcap";
+	ofstream out(filename.c_str(), ios::binary);
+	out << file;
+	out.close();
+
+	GFilter_pcap testImport;
+	ASSERT(testImport.acceptFileForReading(filename));
+	CFlowList flowlist;
+	testImport.read_file(filename, flowlist, IPv6_addr(0x0a000000), IPv6_addr(0xff000000), false);
+	remove(filename.c_str());
+	checkFlows(flowlist);
+}
+
+void testReadPcapng() {
+	string frames[] = { getFrame(false, false, false), getFrame(true, true, false), getFrame(false, true, true) };
+	string file;
+	// Section header block
+	put32(file, 0x0a0d0d0a);
+	put32(file, 28);
+	put32(file, 0x1a2b3c4d);
+	put16(file, 1);
+	put16(file, 0);
+	put32(file, 0xffffffff);
+	put32(file, 0xffffffff);
+	put32(file, 28);
+	// Interface description block with if_tsresol = 10^-9
+	put32(file, 1);
+	put32(file, 32);
+	put16(file, LINKTYPE_ETHERNET);
+	put16(file, 0);
+	put32(file, 65535);
+	put16(file, 9);
+	put16(file, 1);
+	put32(file, 9);
+	put32(file, 0);
+	put32(file, 32);
+	// Enhanced packet blocks
+	for (int i = 0; i < 3; i++) {
+		uint64_t timestamp = 1000000000000ULL + 125000000ULL * i;
+		uint32_t padded = (frames[i].size() + 3) & ~3;
+		put32(file, 6);
+		put32(file, 32 + padded);
+		put32(file, 0);
+		put32(file, timestamp >> 32);
+		put32(file, timestamp & 0xffffffff);
+		put32(file, frames[i].size());
+		put32(file, frames[i].size());
+		file += frames[i];
+		file.append(padded - frames[i].size(), '\0');
+		put32(file, 32 + padded);
+	}
+
+	string filename = "test_gfilter_pcap.pcapng";
+	ofstream out(filename.c_str(), ios::binary);
+	out << file;
+	out.close();
+
+	GFilter_pcap testImport;
+	ASSERT(testImport.acceptFileForReading(filename));
+	CFlowList flowlist;
+	testImport.read_file(filename, flowlist, IPv6_addr(0x0a000000), IPv6_addr(0xff000000), false);
+	remove(filename.c_str());
+	checkFlows(flowlist);
+}
+
 void runSuite() {
 	cute::suite s;
 	s.push_back(CUTE(testAcceptFilename));
+	s.push_back(CUTE(testReadPcap));
+	s.push_back(CUTE(testReadPcapng));
 	cute::ide_listener lis;
 	cute::makeRunner(lis)(s, "test_GFilter_pcap");
 }
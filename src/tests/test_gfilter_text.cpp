@@ -0,0 +1,126 @@
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <netinet/in.h>
+
+#include "cute.h"
+#include "ide_listener.h"
+#include "cute_runner.h"
+
+#include "gfilter_text.h"
+
+using namespace std;
+
+static void writeFile(const string & filename, const string & content) {
+	ofstream out(filename.c_str());
+	out << content;
+}
+
+void testReadTypes() {
+	GFilter_text testImport;
+	CFlowList flowlist;
+	IPv6_addr local_net(0x0a000000);
+	IPv6_addr netmask(0xff000000);
+
+	// type 1, commas and blanks mixed as in the mk_cflows examples
+	writeFile("test_gfilter_text.txt", "# type 1\n10.0.0.1, 1024, 192.168.0.1, 80, tcp, out\n\n10.0.0.1 53 192.168.0.2 53 udp qin\r\n");
+	ASSERT(testImport.acceptFileForReading("test_gfilter_text.txt"));
+	testImport.read_file("test_gfilter_text.txt", flowlist, local_net, netmask, false);
+	ASSERT_EQUAL(2, flowlist.size());
+	ASSERT_EQUAL(IPv6_addr(0x0a000001), flowlist[0].localIP);
+	ASSERT_EQUAL(1024, flowlist[0].localPort);
+	ASSERT_EQUAL(IPv6_addr(0xc0a80001), flowlist[0].remoteIP);
+	ASSERT_EQUAL(80, flowlist[0].remotePort);
+	ASSERT_EQUAL(IPPROTO_TCP, flowlist[0].prot);
+	ASSERT_EQUAL(outflow, flowlist[0].flowtype);
+	ASSERT_EQUAL(1, flowlist[0].dOctets);
+	ASSERT_EQUAL(1, flowlist[0].dPkts);
+	ASSERT_EQUAL(IPPROTO_UDP, flowlist[1].prot);
+	ASSERT_EQUAL(inflow | unibiflow, flowlist[1].flowtype);
+
+	// type 2, appended
+	writeFile("test_gfilter_text.txt", "10.0.0.1,1024,192.168.0.1,80,icmp,bi,1500,3\n");
+	testImport.read_file("test_gfilter_text.txt", flowlist, local_net, netmask, true);
+	ASSERT_EQUAL(3, flowlist.size());
+	ASSERT_EQUAL(IPPROTO_ICMP, flowlist[2].prot);
+	ASSERT_EQUAL(biflow, flowlist[2].flowtype);
+	ASSERT_EQUAL(1500, flowlist[2].dOctets);
+	ASSERT_EQUAL(3, flowlist[2].dPkts);
+
+	// type 3, IPv6 and both date/time forms
+	writeFile("test_gfilter_text.txt", "2001:db8::1, 1024, 2001:db8:1::1, 443, tcp, in, 300, 2, 20101007.2040, 123, 5000\n"
+		"10.0.0.1, 1024, 192.168.0.1, 443, 6, in, 300, 2, 20101007.204005, 0, 0\n");
+	testImport.read_file("test_gfilter_text.txt", flowlist, local_net, netmask, false);
+	ASSERT_EQUAL(2, flowlist.size());
+	ASSERT_EQUAL(IPv6_addr("2001:db8::1"), flowlist[0].localIP);
+	ASSERT_EQUAL(1286484000123ULL, flowlist[0].startMs);
+	ASSERT_EQUAL(5000, flowlist[0].durationMs);
+	ASSERT_EQUAL(1286484005000ULL, flowlist[1].startMs);
+	ASSERT_EQUAL(IPPROTO_TCP, flowlist[1].prot);
+	remove("test_gfilter_text.txt");
+}
+
+void testReadCsvHeader() {
+	GFilter_text testImport;
+	CFlowList flowlist;
+	// Columns in any order, unknown ones ignored, quoted values
+	stringstream csv;
+	csv << "remoteIP,remotePort,Protocol,localIP,localPort,comment,Direction,start,packets,bytes,durationMs\n";
+	// enough lines to be cut into several chunks
+	for (int i = 0; i < 100000; i++)
+		csv << "\"192.168.0.1\",80,tcp,\"10.0.0." << (i % 250) << "\"," << (1024 + i % 1000) << ",x,out,1286485200.5," << i << ",100,20\n";
+	writeFile("test_gfilter_text.csv", csv.str());
+	ASSERT(testImport.acceptFileForReading("test_gfilter_text.csv"));
+	testImport.read_file("test_gfilter_text.csv", flowlist, IPv6_addr(0x0a000000), IPv6_addr(0xff000000), false);
+	remove("test_gfilter_text.csv");
+
+	ASSERT_EQUAL(100000, flowlist.size());
+	for (int i = 0; i < 100000; i++) {
+		ASSERT_EQUAL((uint32_t) i, flowlist[i].dPkts); // order of the file is kept
+		ASSERT_EQUAL(IPv6_addr(0x0a000000 + i % 250), flowlist[i].localIP);
+	}
+	ASSERT_EQUAL(IPv6_addr(0xc0a80001), flowlist[0].remoteIP);
+	ASSERT_EQUAL(1024, flowlist[0].localPort);
+	ASSERT_EQUAL(80, flowlist[0].remotePort);
+	ASSERT_EQUAL(100, flowlist[0].dOctets);
+	ASSERT_EQUAL(1286485200500ULL, flowlist[0].startMs);
+	ASSERT_EQUAL(20, flowlist[0].durationMs);
+}
+
+void testRejectInvalid() {
+	GFilter_text testImport;
+	CFlowList flowlist;
+
+	writeFile("test_gfilter_text.txt", "10.0.0.1, 1024, 192.168.0.1, 80, tcp\n");
+	ASSERT(!testImport.acceptFileForReading("test_gfilter_text.txt"));
+	writeFile("test_gfilter_text.txt", "localIP,remoteIP,protocol\n10.0.0.1,192.168.0.1,tcp\n");
+	ASSERT(!testImport.acceptFileForReading("test_gfilter_text.txt"));
+
+	writeFile("test_gfilter_text.txt", "10.0.0.1, 1024, 192.168.0.1, 80, tcp, out\n10.0.0.1, 1024, 192.168.0.1, 80, tcp, sideways\n");
+	ASSERT(testImport.acceptFileForReading("test_gfilter_text.txt"));
+	bool failed = false;
+	try {
+		testImport.read_file("test_gfilter_text.txt", flowlist, IPv6_addr(0x0a000000), IPv6_addr(0xff000000), false);
+	} catch (string & e) {
+		failed = true;
+	}
+	ASSERT(failed);
+	remove("test_gfilter_text.txt");
+
+	ASSERT(!testImport.acceptFilename("test.pcap"));
+}
+
+void runSuite() {
+	cute::suite s;
+	s.push_back(CUTE(testReadTypes));
+	s.push_back(CUTE(testReadCsvHeader));
+	s.push_back(CUTE(testRejectInvalid));
+	cute::ide_listener lis;
+	cute::makeRunner(lis)(s, "test_GFilter_text");
+}
+
+int main() {
+	runSuite();
+	return 0;
+}
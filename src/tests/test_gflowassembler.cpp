@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <cstring>
+#include <netinet/in.h>
+
+#include "cute.h"
+#include "ide_listener.h"
+#include "cute_runner.h"
+
+#include "gflowassembler.h"
+
+using namespace std;
+
+static cflow_t getPacket(uint32_t remote, uint8_t flowtype, uint64_t startMs) {
+	return cflow_t(IPv6_addr(0x0a000001), 1024, IPv6_addr(remote), 80, IPPROTO_TCP, flowtype, startMs, 0, 100, 1);
+}
+
+void testBiflowMerge() {
+	CFlowList flowlist;
+	CFlowAssembler assembler(flowlist);
+	assembler.add_flow(getPacket(0xc0a80001, outflow, 1000));
+	assembler.add_flow(getPacket(0xc0a80001, inflow, 1500));
+	// Out of order packet moves the start
+	assembler.add_flow(getPacket(0xc0a80001, outflow, 900));
+	assembler.flush();
+
+	ASSERT_EQUAL(1, flowlist.size());
+	ASSERT_EQUAL(biflow, flowlist[0].flowtype);
+	ASSERT_EQUAL(900, flowlist[0].startMs);
+	ASSERT_EQUAL(600, flowlist[0].durationMs);
+	ASSERT_EQUAL(3, flowlist[0].dPkts);
+	ASSERT_EQUAL(300, flowlist[0].dOctets);
+}
+
+void testIdleTimeout() {
+	CFlowList flowlist;
+	CFlowAssembler assembler(flowlist, 5000, 0);
+	for (uint32_t i = 0; i < 100; i++) {
+		// A new short flow every second: never more than 6 flows are active
+		assembler.add_flow(getPacket(0xc0a80001 + i, outflow, 1000 * i));
+		assembler.add_flow(getPacket(0xc0a80001 + i, outflow, 1000 * i + 200));
+	}
+	ASSERT(assembler.getPeakActiveFlows() <= 7);
+	// A packet after the idle timeout starts a new flow record
+	assembler.add_flow(getPacket(0xc0a80001 + 99, outflow, 1000 * 99 + 200 + 6000));
+	assembler.flush();
+	ASSERT_EQUAL(101, flowlist.size());
+	ASSERT_EQUAL(0, assembler.getActiveFlows());
+}
+
+void testActiveTimeout() {
+	CFlowList flowlist;
+	CFlowAssembler assembler(flowlist, 0, 10000);
+	for (uint64_t t = 0; t <= 25000; t += 500)
+		assembler.add_flow(getPacket(0xc0a80001, outflow, t));
+	assembler.flush();
+	ASSERT_EQUAL(3, flowlist.size());
+	uint32_t packets = 0;
+	for (CFlowList::const_iterator it = flowlist.begin(); it != flowlist.end(); it++) {
+		ASSERT(it->durationMs <= 10000);
+		packets += it->dPkts;
+	}
+	ASSERT_EQUAL(51, packets);
+}
+
+void testBatchInsertAndStats() {
+	CFlowList flowlist;
+	CFlowAssembler assembler(flowlist, 0, 0);
+	// Enough flows to grow the table several times, every flow gets 3 packets
+	CFlowList packets;
+	for (uint32_t round = 0; round < 3; round++) {
+		for (uint32_t i = 0; i < 50000; i++)
+			packets.push_back(getPacket(0xc0a80001 + i, (round == 1) ? inflow : outflow, 1000 * round + i));
+	}
+	assembler.add_flows(&packets[0], packets.size());
+	ASSERT_EQUAL(50000, assembler.getActiveFlows());
+	const flow_assembler_stats & stats = assembler.getStats();
+	ASSERT_EQUAL(50000, stats.inserts);
+	ASSERT_EQUAL(100000, stats.hits);
+	ASSERT(stats.probes >= packets.size());
+	ASSERT_EQUAL(0, stats.expired);
+
+	// Without timeouts, the flows are delivered in the order of their first packet
+	assembler.flush();
+	ASSERT_EQUAL(50000, flowlist.size());
+	for (uint32_t i = 0; i < flowlist.size(); i++) {
+		ASSERT_EQUAL(IPv6_addr(0xc0a80001 + i), flowlist[i].remoteIP);
+		ASSERT_EQUAL(biflow, flowlist[i].flowtype);
+		ASSERT_EQUAL(3, flowlist[i].dPkts);
+	}
+}
+
+void testExpiryReusesRecords() {
+	CFlowList flowlist;
+	CFlowAssembler assembler(flowlist, 5000, 0);
+	// Many overlapping short flows: removing expired flows must not break the probe sequences
+	for (uint32_t t = 0; t < 100000; t++) {
+		assembler.add_flow(getPacket(0xc0a80001 + t % 20000, outflow, t));
+		assembler.add_flow(getPacket(0xc0a80001 + (t * 7) % 20000, inflow, t));
+	}
+	assembler.flush();
+	uint64_t packets = 0;
+	for (CFlowList::const_iterator it = flowlist.begin(); it != flowlist.end(); it++)
+		packets += it->dPkts;
+	ASSERT_EQUAL(200000, packets);
+	ASSERT(assembler.getStats().expired > 0);
+	ASSERT(flowlist.size() >= assembler.getStats().inserts);
+}
+
+void testShardedMatchesSingle() {
+	CFlowList single, sharded;
+	CFlowAssembler assembler(single);
+	CShardedFlowAssembler shardedAssembler(sharded, 4);
+	ASSERT_EQUAL(4, shardedAssembler.getShardCount());
+	for (uint32_t i = 0; i < 20000; i++) {
+		cflow_t packet = getPacket(0xc0a80001 + i % 3000, (i % 7 == 0) ? inflow : outflow, 10 * i);
+		assembler.add_flow(packet);
+		shardedAssembler.add_flow(packet);
+	}
+	assembler.flush();
+	shardedAssembler.flush();
+
+	ASSERT_EQUAL(single.size(), sharded.size());
+	sort(single.begin(), single.end());
+	sort(sharded.begin(), sharded.end());
+	for (unsigned int i = 0; i < single.size(); i++) {
+		ASSERT_EQUAL(0, memcmp(&single[i], &sharded[i], sizeof(cflow_t)));
+	}
+}
+
+void runSuite() {
+	cute::suite s;
+	s.push_back(CUTE(testBiflowMerge));
+	s.push_back(CUTE(testIdleTimeout));
+	s.push_back(CUTE(testActiveTimeout));
+	s.push_back(CUTE(testBatchInsertAndStats));
+	s.push_back(CUTE(testExpiryReusesRecords));
+	s.push_back(CUTE(testShardedMatchesSingle));
+	cute::ide_listener lis;
+	cute::makeRunner(lis)(s, "test_CFlowAssembler");
+}
+
+int main() {
+	runSuite();
+	return 0;
+}
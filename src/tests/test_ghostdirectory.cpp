@@ -0,0 +1,106 @@
+#include <vector>
+#include <netinet/in.h>
+
+#include "cute.h"
+#include "ide_listener.h"
+#include "cute_runner.h"
+#include "ghostdirectory.h"
+
+using namespace std;
+
+static cflow_t makeFlow(const char * localIP, const char * remoteIP, uint8_t prot, uint8_t flowtype) {
+	return cflow_t(IPv6_addr(localIP), 1000, IPv6_addr(remoteIP), 80, prot, flowtype, 0, 0, 100, 2);
+}
+
+/**
+ *	Three hosts with 2, 1 and 3 flows, sorted by localIP
+ */
+static CFlowList makeFlows() {
+	CFlowList flows;
+	flows.push_back(makeFlow("10.0.0.1", "192.168.0.1", IPPROTO_TCP, biflow));
+	flows.push_back(makeFlow("10.0.0.1", "192.168.0.2", IPPROTO_UDP, outflow));
+	flows.push_back(makeFlow("10.0.1.7", "192.168.0.1", IPPROTO_TCP, biflow));
+	flows.push_back(makeFlow("10.1.0.3", "192.168.0.1", IPPROTO_TCP, inflow));
+	flows.push_back(makeFlow("10.1.0.3", "192.168.0.2", IPPROTO_TCP, inflow));
+	flows.push_back(makeFlow("10.1.0.3", "192.168.0.3", IPPROTO_TCP, biflow));
+	return flows;
+}
+
+void buildAggregatesHosts() {
+	CFlowList flows = makeFlows();
+	CHostDirectory directory;
+	directory.build(flows.begin(), flows.end());
+	ASSERT_EQUAL(3, directory.size());
+
+	ASSERT_EQUAL(IPv6_addr("10.0.0.1"), directory[0].IP);
+	ASSERT_EQUAL(0, directory[0].graphlet_number);
+	ASSERT_EQUAL(0, directory[0].index);
+	ASSERT_EQUAL(2, directory[0].flow_count);
+	ASSERT_EQUAL(1, directory[0].uniflow_count);
+	ASSERT_EQUAL(2, directory[0].prot_count);
+	ASSERT_EQUAL(4, directory[0].packet_count);
+	ASSERT_EQUAL(200, directory[0].bytesForAllFlows);
+
+	ASSERT_EQUAL(2, directory[2].graphlet_number);
+	ASSERT_EQUAL(3, directory[2].index);
+	ASSERT_EQUAL(2, directory[2].uniflow_count);
+	ASSERT_EQUAL(1, directory[2].prot_count);
+	ASSERT_EQUAL(6, directory.flow_end(2));
+
+	// A part of a flowlist counts its flows from its begin
+	directory.build(flows.begin() + 2, flows.end());
+	ASSERT_EQUAL(2, directory.size());
+	ASSERT_EQUAL(1, directory[1].index);
+}
+
+void lookupsAreConsistent() {
+	CFlowList flows = makeFlows();
+	CHostDirectory directory;
+	directory.build(flows.begin(), flows.end());
+
+	ASSERT_EQUAL(1, directory.find(IPv6_addr("10.0.1.7")));
+	ASSERT_EQUAL(CHostDirectory::npos, directory.find(IPv6_addr("10.0.1.8")));
+	ASSERT_EQUAL(2, directory.rank(IPv6_addr("10.0.1.8")));
+	ASSERT_EQUAL(0, directory.rank(IPv6_addr("::1")));
+
+	ASSERT_EQUAL(0, directory.find_flow(1));
+	ASSERT_EQUAL(1, directory.find_flow(2));
+	ASSERT_EQUAL(2, directory.find_flow(5));
+	ASSERT_EQUAL(CHostDirectory::npos, directory.find_flow(6));
+
+	size_t first, last;
+	directory.find_prefix(IPv6_addr("10.0.0.0"), IPv6_addr::getNetmask(96 + 16), first, last);
+	ASSERT_EQUAL(0, first);
+	ASSERT_EQUAL(2, last);
+	directory.find_prefix(IPv6_addr("10.1.0.0"), IPv6_addr::getNetmask(96 + 24), first, last);
+	ASSERT_EQUAL(2, first);
+	ASSERT_EQUAL(3, last);
+	directory.find_prefix(IPv6_addr("10.2.0.0"), IPv6_addr::getNetmask(96 + 16), first, last);
+	ASSERT_EQUAL(first, last);
+}
+
+void unsortedFlowlistFallsBackToScan() {
+	CFlowList flows = makeFlows();
+	CFlowList unsorted(flows.begin() + 3, flows.end());
+	unsorted.insert(unsorted.end(), flows.begin(), flows.begin() + 3);
+	CHostDirectory directory;
+	directory.build(unsorted.begin(), unsorted.end());
+	ASSERT_EQUAL(3, directory.size());
+	ASSERT_EQUAL(0, directory.find(IPv6_addr("10.1.0.3")));
+	ASSERT_EQUAL(2, directory.find(IPv6_addr("10.0.1.7")));
+	ASSERT_EQUAL(CHostDirectory::npos, directory.find(IPv6_addr("10.0.1.8")));
+}
+
+void runSuite() {
+	cute::suite s;
+	s.push_back(CUTE(buildAggregatesHosts));
+	s.push_back(CUTE(lookupsAreConsistent));
+	s.push_back(CUTE(unsortedFlowlistFallsBackToScan));
+	cute::ide_listener lis;
+	cute::makeRunner(lis)(s, "test_ghostdirectory");
+}
+
+int main() {
+	runSuite();
+	return 0;
+}
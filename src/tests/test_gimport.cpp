@@ -0,0 +1,164 @@
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "cute.h"
+#include "ide_listener.h"
+#include "cute_runner.h"
+
+#include "gimport.h"
+#include "gutil.h"
+
+using namespace std;
+
+static const string testDir = "test_gimport.d";
+
+/**
+ *	Writes a text flow file (type 2) with one flow per local host: host i of file n gets i * files + n
+ */
+static void writeFlowFile(const string & filename, unsigned int n, unsigned int files, unsigned int hosts) {
+	ofstream out(filename.c_str());
+	for (unsigned int i = hosts; i > 0; i--) { // descending: the import has to sort each file
+		unsigned int host = (i - 1) * files + n;
+		out << "10.0." << (host / 256) << "." << (host % 256) << ", 1024, 192.168.0.1, 80, tcp, bi, 100, " << (n + 1) << "\n";
+	}
+}
+
+static void removeTestDir(unsigned int files) {
+	for (unsigned int n = 0; n < files; n++) {
+		stringstream name;
+		name << testDir << "/flows" << n << ".txt";
+		remove(name.str().c_str());
+	}
+	remove((testDir + "/README").c_str());
+	rmdir(testDir.c_str());
+}
+
+void testExpandFilenames() {
+	mkdir(testDir.c_str(), 0755);
+	writeFlowFile(testDir + "/flows1.txt", 1, 2, 1);
+	writeFlowFile(testDir + "/flows0.txt", 0, 2, 1);
+	ofstream(string(testDir + "/.hidden").c_str()) << "x";
+
+	vector<string> files = util::expandFilenames(testDir);
+	ASSERT_EQUAL(2, files.size());
+	ASSERT_EQUAL(testDir + "/flows0.txt", files[0]);
+	ASSERT_EQUAL(testDir + "/flows1.txt", files[1]);
+	ASSERT_EQUAL(2, util::expandFilenames(testDir + "/flows*.txt").size());
+	ASSERT_EQUAL(0, util::expandFilenames(testDir + "/nomatch*").size());
+	ASSERT_EQUAL(1, util::expandFilenames(testDir + "/flows1.txt").size());
+
+	remove((testDir + "/.hidden").c_str());
+	removeTestDir(2);
+}
+
+void testMergeSortedFlows() {
+	// Three sorted runs with interleaving local hosts, one of them empty
+	CFlowList lists[3];
+	for (unsigned int i = 0; i < 30; i++)
+		lists[i % 2].push_back(cflow_t(IPv6_addr(0x0a000000 + i), 1024, IPv6_addr(0xc0a80001), 80, 6, biflow, 0, 0, 100, i % 2 + 1));
+	vector<Subflowlist> runs;
+	for (unsigned int n = 0; n < 3; n++)
+		runs.push_back(Subflowlist(lists[n]));
+
+	CFlowList merged;
+	mergeSortedFlows(runs, merged);
+	ASSERT_EQUAL(30, merged.size());
+	for (unsigned int i = 0; i < merged.size(); i++) {
+		ASSERT_EQUAL(IPv6_addr(0x0a000000 + i), merged[i].localIP);
+		ASSERT_EQUAL(i % 2 + 1, merged[i].dPkts);
+	}
+}
+
+#ifdef HAPVIEWER_ENABLE_TEXT
+void testMultiFileImport() {
+	const unsigned int files = 5;
+	const unsigned int hosts = 2000;
+	mkdir(testDir.c_str(), 0755);
+	for (unsigned int n = 0; n < files; n++) {
+		stringstream name;
+		name << testDir << "/flows" << n << ".txt";
+		writeFlowFile(name.str(), n, files, hosts);
+	}
+	ofstream(string(testDir + "/README").c_str()) << "not a flow file\n"; // skipped
+
+	prefs_t prefs;
+	string dir = testDir;
+	ASSERT(CImport::acceptForImport(dir));
+	ASSERT_EQUAL("text", CImport::getFormatName(dir));
+	CImport import(testDir + "/", "test_gimport.hpg", prefs);
+	import.read_file(IPv6_addr(0x0a000000), IPv6_addr(0xff000000));
+	removeTestDir(files);
+
+	// The files interleave: the merged list has to be sorted by local host
+	ASSERT_EQUAL(files * hosts, import.get_flow_count());
+	Subflowlist flows = import.getActiveFlowlist();
+	for (unsigned int i = 0; i < flows.size(); i++) {
+		ASSERT_EQUAL(IPv6_addr(0x0a000000 + i), flows[i].localIP);
+		ASSERT_EQUAL(i % files + 1, flows[i].dPkts);
+	}
+}
+
+#endif
+
+/**
+ *	CImport exposing the r_index, to check that it is built on demand only
+ */
+class CTestImport: public CImport {
+	public:
+		CTestImport(const CFlowList & flowlist, const prefs_t & prefs) :
+			CImport(flowlist, prefs) {
+		}
+		size_t reverse_index_size() const {
+			return remoteIP_index.size();
+		}
+};
+
+void testOutsideGraphlet() {
+	CFlowList flowlist;
+	for (unsigned int i = 0; i < 100; i++) // 100 local hosts, each with one outflow to each of 5 servers
+		for (unsigned int j = 0; j < 5; j++)
+			flowlist.push_back(cflow_t(IPv6_addr(0x0a000000 + i), 1024 + j, IPv6_addr(0xc0a80000 + j), 80, 6, outflow, i));
+	prefs_t prefs;
+	CTestImport import(flowlist, prefs);
+	ASSERT_EQUAL(0, import.reverse_index_size());
+
+	CFlippedFlowlist view = import.get_outside_graphlet(IPv6_addr(0xc0a80003));
+	ASSERT_EQUAL(flowlist.size(), import.reverse_index_size());
+	ASSERT_EQUAL(100, view.size());
+	for (unsigned int k = 0; k < view.size(); k++) {
+		ASSERT_EQUAL(IPv6_addr(0xc0a80003), view.original(k).remoteIP);
+		cflow_t flow = view[k];
+		ASSERT_EQUAL(IPv6_addr(0xc0a80003), flow.localIP);
+		ASSERT_EQUAL(IPv6_addr(0x0a000000 + k), flow.remoteIP); // in the order of the local hosts
+		ASSERT_EQUAL(80, flow.localPort);
+		ASSERT_EQUAL(1024 + 3, flow.remotePort);
+		ASSERT_EQUAL(inflow, flow.flowtype);
+	}
+
+	CFlowList flows = import.get_outside_graphlet_flows(IPv6_addr(0xc0a80000));
+	ASSERT_EQUAL(100, flows.size());
+	ASSERT_EQUAL(IPv6_addr(0x0a000000), flows[0].remoteIP);
+	ASSERT_EQUAL(0, import.get_outside_graphlet(IPv6_addr(0xc0a80005)).size());
+	ASSERT_EQUAL(0, import.get_outside_graphlet_flows(IPv6_addr(0x0a000001)).size());
+}
+
+void runSuite() {
+	cute::suite s;
+	s.push_back(CUTE(testExpandFilenames));
+	s.push_back(CUTE(testMergeSortedFlows));
+#ifdef HAPVIEWER_ENABLE_TEXT
+	s.push_back(CUTE(testMultiFileImport));
+#endif
+	s.push_back(CUTE(testOutsideGraphlet));
+	cute::ide_listener lis;
+	cute::makeRunner(lis)(s, "test_gimport");
+}
+
+int main() {
+	runSuite();
+	return 0;
+}
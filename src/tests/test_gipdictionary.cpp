@@ -0,0 +1,70 @@
+#include <vector>
+
+#include "cute.h"
+#include "ide_listener.h"
+#include "cute_runner.h"
+#include "gipdictionary.h"
+
+using namespace std;
+
+static cflow_t makeFlow(const char * localIP, const char * remoteIP) {
+	cflow_t flow;
+	flow.localIP = IPv6_addr(localIP);
+	flow.remoteIP = IPv6_addr(remoteIP);
+	return flow;
+}
+
+void buildAssignsIdsPerFlow() {
+	CFlowList flows;
+	flows.push_back(makeFlow("10.0.0.1", "192.168.0.9"));
+	flows.push_back(makeFlow("10.0.0.1", "2001:db8::1"));
+	flows.push_back(makeFlow("10.0.0.2", "192.168.0.9"));
+	flows.push_back(makeFlow("10.0.0.2", "10.0.0.1")); // a local address seen as remote address
+
+	CIpDictionary dictionary;
+	dictionary.build(flows);
+	ASSERT_EQUAL(4, dictionary.size());
+	for (unsigned int i = 0; i < flows.size(); i++) {
+		ASSERT_EQUAL(flows[i].localIP, dictionary.get_ip(dictionary.get_local_id(i)));
+		ASSERT_EQUAL(flows[i].remoteIP, dictionary.get_ip(dictionary.get_remote_id(i)));
+	}
+	ASSERT_EQUAL(dictionary.get_remote_id(0), dictionary.get_remote_id(2));
+	ASSERT_EQUAL(dictionary.get_local_id(0), dictionary.get_remote_id(3));
+	ASSERT_EQUAL(dictionary.get_remote_id(2), dictionary.find(IPv6_addr("192.168.0.9")));
+	ASSERT_EQUAL(CIpDictionary::no_id, dictionary.find(IPv6_addr("10.0.0.3")));
+}
+
+void idsFollowAddressOrder() {
+	CFlowList flows;
+	flows.push_back(makeFlow("10.0.0.5", "192.168.0.9"));
+	flows.push_back(makeFlow("10.0.0.5", "1.2.3.4"));
+	flows.push_back(makeFlow("10.0.0.5", "2001:db8::1"));
+	flows.push_back(makeFlow("10.0.0.7", "10.0.0.6"));
+
+	CIpDictionary dictionary;
+	dictionary.build(flows);
+	for (CIpDictionary::ipId id = 1; id < dictionary.size(); id++)
+		ASSERT(dictionary.get_ip(id - 1) < dictionary.get_ip(id));
+
+	// Interning after build() appends new addresses
+	CIpDictionary::ipId id = dictionary.intern(IPv6_addr("0.0.0.1"));
+	ASSERT_EQUAL(dictionary.size() - 1, id);
+	ASSERT_EQUAL(id, dictionary.intern(IPv6_addr("0.0.0.1")));
+
+	dictionary.clear();
+	ASSERT_EQUAL(0, dictionary.size());
+	ASSERT_EQUAL(CIpDictionary::no_id, dictionary.find(IPv6_addr("10.0.0.5")));
+}
+
+void runSuite() {
+	cute::suite s;
+	s.push_back(CUTE(buildAssignsIdsPerFlow));
+	s.push_back(CUTE(idsFollowAddressOrder));
+	cute::ide_listener lis;
+	cute::makeRunner(lis)(s, "test_gipdictionary");
+}
+
+int main() {
+	runSuite();
+	return 0;
+}
@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include "cute.h"
+#include "ide_listener.h"
+#include "cute_runner.h"
+#include "gradixsort.h"
+
+using namespace std;
+
+/**
+ *	Reproducible flows with many duplicate addresses and start times, IPv4 and IPv6 mixed
+ */
+static CFlowList makeFlows(unsigned int count) {
+	CFlowList flows;
+	srand(42);
+	for (unsigned int i = 0; i < count; i++) {
+		IPv6_addr localIP((uint32_t) (0x0a000000 + rand() % 300));
+		IPv6_addr remoteIP((uint32_t) (0xc0a80000 + rand() % 5000));
+		if (rand() % 10 == 0) {
+			remoteIP = IPv6_addr("2001:db8::1");
+			remoteIP[15] = rand() % 256;
+		}
+		uint64_t startMs = 1300000000000ULL + rand() % 100000;
+		// The port numbers the flows, it is not part of the sort key
+		flows.push_back(cflow_t(localIP, i % 65536, remoteIP, i / 65536, 6, 1, startMs));
+	}
+	return flows;
+}
+
+/**
+ *	Sort flowlists of growing size with the given number of workers. The largest flowlist has
+ *	more than RADIX_MIN_CHUNK flows per worker, such that it is split into one chunk per worker.
+ */
+static void checkSortFlowlist(const char * threads) {
+	setenv("HAPVIEWER_THREADS", threads, 1);
+	for (unsigned int count = 0; count <= 300000; count = count ? count * 30 : 10) {
+		CFlowList flows = makeFlows(count);
+		CFlowList expected = flows;
+		stable_sort(expected.begin(), expected.end());
+		util::sortFlowlist(flows);
+		ASSERT_EQUAL(expected.size(), flows.size());
+		for (unsigned int i = 0; i < flows.size(); i++) {
+			ASSERT_EQUAL(expected[i].localPort, flows[i].localPort);
+			ASSERT_EQUAL(expected[i].remotePort, flows[i].remotePort);
+		}
+	}
+	unsetenv("HAPVIEWER_THREADS");
+}
+
+void sortFlowlistMatchesStableSort() {
+	checkSortFlowlist("1");
+}
+
+void sortFlowlistMatchesStableSortParallel() {
+	checkSortFlowlist("4");
+}
+
+static bool remote_ip_less(const cflow_t & a, const cflow_t & b) {
+	return a.remoteIP < b.remoteIP;
+}
+
+static void checkSortIndexByRemoteIP(const char * threads) {
+	setenv("HAPVIEWER_THREADS", threads, 1);
+	CFlowList flows = makeFlows(4 * RADIX_MIN_CHUNK + 1000);
+	CFlowList expected = flows;
+	stable_sort(expected.begin(), expected.end(), remote_ip_less);
+	vector<int> index;
+	util::sortIndexByRemoteIP(flows, index);
+	unsetenv("HAPVIEWER_THREADS");
+	ASSERT_EQUAL(flows.size(), index.size());
+	for (unsigned int i = 0; i < index.size(); i++) {
+		ASSERT_EQUAL(expected[i].localPort, flows[index[i]].localPort);
+		ASSERT_EQUAL(expected[i].remotePort, flows[index[i]].remotePort);
+	}
+}
+
+void sortIndexByRemoteIPIsStable() {
+	checkSortIndexByRemoteIP("1");
+}
+
+void sortIndexByRemoteIPIsStableParallel() {
+	checkSortIndexByRemoteIP("4");
+}
+
+void runSuite() {
+	cute::suite s;
+	s.push_back(CUTE(sortFlowlistMatchesStableSort));
+	s.push_back(CUTE(sortFlowlistMatchesStableSortParallel));
+	s.push_back(CUTE(sortIndexByRemoteIPIsStable));
+	s.push_back(CUTE(sortIndexByRemoteIPIsStableParallel));
+	cute::ide_listener lis;
+	cute::makeRunner(lis)(s, "test_gradixsort");
+}
+
+int main() {
+	runSuite();
+	return 0;
+}
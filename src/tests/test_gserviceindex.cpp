@@ -0,0 +1,63 @@
+#include <vector>
+#include <netinet/in.h>
+
+#include "cute.h"
+#include "ide_listener.h"
+#include "cute_runner.h"
+#include "gserviceindex.h"
+
+using namespace std;
+
+static cflow_t makeFlow(const char * localIP, const char * remoteIP, uint8_t prot, uint16_t remotePort) {
+	return cflow_t(IPv6_addr(localIP), 1024, IPv6_addr(remoteIP), remotePort, prot, biflow);
+}
+
+void findReturnsFlowsOfService() {
+	CFlowList flows;
+	flows.push_back(makeFlow("10.0.0.1", "192.168.0.1", IPPROTO_TCP, 80)); // 0
+	flows.push_back(makeFlow("10.0.0.1", "192.168.0.1", IPPROTO_UDP, 53)); // 1
+	flows.push_back(makeFlow("10.0.0.1", "192.168.0.2", IPPROTO_TCP, 80)); // 2
+	flows.push_back(makeFlow("10.0.0.2", "192.168.0.1", IPPROTO_TCP, 443)); // 3
+	flows.push_back(makeFlow("10.0.0.2", "192.168.0.1", IPPROTO_TCP, 80)); // 4
+	flows.push_back(makeFlow("10.0.0.3", "192.168.0.1", IPPROTO_TCP, 80)); // 5
+
+	CIpDictionary dictionary;
+	dictionary.build(flows);
+	CRemoteServiceIndex index;
+	index.build(dictionary, flows);
+	ASSERT_EQUAL(flows.size(), index.size());
+
+	CRemoteServiceIndex::const_iterator first, last;
+	CIpDictionary::ipId server = dictionary.find(IPv6_addr("192.168.0.1"));
+	index.find(server, IPPROTO_TCP, 80, first, last);
+	ASSERT_EQUAL(3, last - first);
+	ASSERT_EQUAL(0, first[0].flow);
+	ASSERT_EQUAL(4, first[1].flow);
+	ASSERT_EQUAL(5, first[2].flow);
+
+	index.find(server, IPPROTO_TCP, first, last); // any remote port
+	ASSERT_EQUAL(4, last - first);
+	index.find(server, IPPROTO_UDP, first, last);
+	ASSERT_EQUAL(1, last - first);
+	ASSERT_EQUAL(1, first->flow);
+	index.find(server, IPPROTO_UDP, 80, first, last);
+	ASSERT_EQUAL(0, last - first);
+
+	// Local addresses have ids too, but no flows as remote address
+	index.find(dictionary.find(IPv6_addr("10.0.0.1")), IPPROTO_TCP, first, last);
+	ASSERT_EQUAL(0, last - first);
+	index.find(CIpDictionary::no_id, IPPROTO_TCP, 80, first, last);
+	ASSERT_EQUAL(0, last - first);
+}
+
+void runSuite() {
+	cute::suite s;
+	s.push_back(CUTE(findReturnsFlowsOfService));
+	cute::ide_listener lis;
+	cute::makeRunner(lis)(s, "test_gserviceindex");
+}
+
+int main() {
+	runSuite();
+	return 0;
+}
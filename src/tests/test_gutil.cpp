@@ -12,6 +12,7 @@
 #include "cute_runner.h"
 
 #include "gutil.h"
+#include "gtextparse.h"
 
 using namespace std;
 
@@ -100,6 +101,55 @@ void test_lessthan() {
 	ASSERTM("ipv4 is smaller than a:b::", ipv4 < ab);
 }
 
+void test_textparse() {
+	const char line[] = "  1286485200.123456\t0.5 TCP 10.0.0.1   2001:db8::1 -> 80 x ";
+	const char * pos = line;
+	const char * end = line + sizeof(line) - 1;
+	util::text_token field;
+	uint64_t value;
+	IPv6_addr ip;
+
+	ASSERT(util::next_field(pos, end, field));
+	ASSERT(util::parse_seconds_ms(field, value));
+	ASSERT_EQUAL(1286485200123ULL, value);
+	ASSERT(util::next_field(pos, end, field));
+	ASSERT(util::parse_seconds_ms(field, value));
+	ASSERT_EQUAL(500, value);
+	ASSERT(util::next_field(pos, end, field));
+	ASSERT(util::token_equals(field, "tcp"));
+	ASSERT(!util::token_equals(field, "tc"));
+	ASSERT(util::next_field(pos, end, field));
+	ASSERT(util::parse_ip(field, ip));
+	ASSERT_EQUAL(IPv6_addr(0x0a000001), ip);
+	ASSERT(util::next_field(pos, end, field));
+	ASSERT(util::parse_ip(field, ip));
+	ASSERT_EQUAL(IPv6_addr("2001:db8::1"), ip);
+	ASSERT(util::next_field(pos, end, field));
+	ASSERT_EQUAL(string("->"), field.toString());
+	ASSERT(util::next_field(pos, end, field));
+	ASSERT(util::parse_uint(field, value));
+	ASSERT_EQUAL(80, value);
+	ASSERT(util::next_field(pos, end, field));
+	ASSERT(!util::parse_uint(field, value));
+	ASSERT(!util::parse_ip(field, ip));
+	ASSERT(!util::next_field(pos, end, field));
+
+	// Separated fields, including empty ones
+	const char csv[] = "1,,3\r";
+	pos = csv;
+	end = csv + sizeof(csv) - 1;
+	ASSERT(util::next_field(pos, end, field, ','));
+	ASSERT_EQUAL(string("1"), field.toString());
+	ASSERT(util::next_field(pos, end, field, ','));
+	ASSERT_EQUAL(0, field.length);
+	ASSERT(util::next_field(pos, end, field, ','));
+	ASSERT_EQUAL(string("3"), field.toString());
+	ASSERT(!util::next_field(pos, end, field, ','));
+
+	util::text_token overflow = { "18446744073709551616", 20 };
+	ASSERT(!util::parse_uint(overflow, value));
+}
+
 void runSuite() {
 	cute::suite s;
 	s.push_back(CUTE(test_ipV4ToIpV6));
@@ -107,6 +157,7 @@ void runSuite() {
 	s.push_back(CUTE(test_getDummyIpV6));
 	s.push_back(CUTE(test_getNetmask));
 	s.push_back(CUTE(test_lessthan));
+	s.push_back(CUTE(test_textparse));
 	cute::ide_listener lis;
 	cute::makeRunner(lis)(s, "test_gutil");
 }
@@ -0,0 +1,136 @@
+/**
+ *	\file	hashmap_bench.cpp
+ *	\brief Compares hash_map and flat_hash_map for the hash keys used by the graphlet and role code,
+ *	with the byte array keys (HashKey*) and the typed keys (CKey*).
+ *
+ *	For each key type N distinct keys are inserted, then looked up (hits and misses) and
+ *	iterated. The times are printed in ms per operation class.
+ *
+ * 	This file is subject to the terms and conditions defined in
+ * 	files 'BSD.txt' and 'GPL.txt'. For a list of authors see file 'AUTHORS'.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <sys/time.h>
+#include <netinet/in.h>
+
+#include <boost/program_options.hpp>
+
+#include "HashMap.h"
+#include "HashMapE.h"
+#include "IPv6_addr.h"
+
+using namespace std;
+
+static double now_ms() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+/**
+ *	Pseudo random but reproducible IPv4 address for key number i
+ */
+static IPv6_addr key_ip(unsigned int i) {
+	return IPv6_addr((uint32_t) (0x0a000000 + (i * 2654435761u >> 8)));
+}
+
+static HashKeyIPv6 make_ip_key(unsigned int i) {
+	return HashKeyIPv6(key_ip(i));
+}
+
+static HashKeyIPv6_4T make_role_key(unsigned int i) {
+	return HashKeyIPv6_4T(key_ip(i / 4), (i & 1) ? IPPROTO_UDP : IPPROTO_TCP, 1024 + i % 60000, (i & 2) ? 1 : 2);
+}
+
+static CHashKey6_6 make_graphlet_key(unsigned int i) {
+	return CHashKey6_6(key_ip(i), (uint64_t) i * 7);
+}
+
+static CKeyIP make_typed_ip_key(unsigned int i) {
+	return CKeyIP(key_ip(i));
+}
+
+static CKeyIP_4T make_typed_role_key(unsigned int i) {
+	return CKeyIP_4T(key_ip(i / 4), (i & 1) ? IPPROTO_UDP : IPPROTO_TCP, 1024 + i % 60000, (i & 2) ? 1 : 2);
+}
+
+static CKey6_6 make_typed_graphlet_key(unsigned int i) {
+	return CKey6_6(key_ip(i), (uint64_t) i * 7);
+}
+
+/**
+ *	Runs insert, hit, miss and iterate over count keys for the map type Map
+ */
+template<typename Map, typename Key>
+static void bench(const string & name, Key(*make_key)(unsigned int), unsigned int count) {
+	vector<Key> keys, misses;
+	keys.reserve(count);
+	misses.reserve(count);
+	for (unsigned int i = 0; i < count; i++) {
+		keys.push_back(make_key(i));
+		misses.push_back(make_key(i + count));
+	}
+
+	Map map;
+	double t0 = now_ms();
+	for (unsigned int i = 0; i < count; i++)
+		map[keys[i]] = i;
+	double t1 = now_ms();
+	unsigned long found = 0;
+	for (unsigned int i = 0; i < count; i++)
+		found += map.find(keys[i]) != map.end();
+	double t2 = now_ms();
+	for (unsigned int i = 0; i < count; i++)
+		found += map.find(misses[i]) != map.end();
+	double t3 = now_ms();
+	unsigned long sum = 0;
+	for (typename Map::const_iterator it = map.begin(); it != map.end(); ++it)
+		sum += it->second;
+	double t4 = now_ms();
+
+	cout << setw(28) << left << name << right << fixed << setprecision(1)
+			<< setw(10) << (t1 - t0) << setw(10) << (t2 - t1) << setw(10) << (t3 - t2) << setw(10) << (t4 - t3)
+			<< "   (" << map.size() << " keys, " << found << " found, sum " << sum << ")" << endl;
+}
+
+int main(int argc, char * argv[]) {
+	boost::program_options::variables_map variablesMap;
+	boost::program_options::options_description desc("Allowed options");
+	unsigned int count = 1000000;
+
+	try {
+		desc.add_options()
+				("count,c", boost::program_options::value<unsigned int>(&count)->default_value(1000000), "Number of distinct keys per run")
+				("help,h", "show this help message");
+		boost::program_options::store(boost::program_options::parse_command_line(argc, argv, desc), variablesMap);
+		boost::program_options::notify(variablesMap);
+	} catch (std::exception & e) {
+		std::cerr << "Error: " << e.what() << std::endl;
+		exit(1);
+	}
+
+	if (variablesMap.count("help")) {
+		cerr << desc;
+		exit(0);
+	}
+
+	cout << setw(28) << left << "map [ms]" << right << setw(10) << "insert" << setw(10) << "hit" << setw(10) << "miss" << setw(10)
+			<< "iterate" << endl;
+	bench<hash_map<HashKeyIPv6, unsigned int, HashFunction<HashKeyIPv6>, HashFunction<HashKeyIPv6> > >("hash_map IPv6", make_ip_key, count);
+	bench<flat_hash_map<HashKeyIPv6, unsigned int> >("flat_hash_map IPv6", make_ip_key, count);
+	bench<flat_hash_map<CKeyIP, unsigned int, KeyHashFunction<CKeyIP>, KeyHashFunction<CKeyIP> > >("flat_hash_map CKeyIP", make_typed_ip_key, count);
+	bench<hash_map<HashKeyIPv6_4T, unsigned int, HashFunction<HashKeyIPv6_4T>, HashFunction<HashKeyIPv6_4T> > >("hash_map IPv6_4T", make_role_key,
+			count);
+	bench<flat_hash_map<HashKeyIPv6_4T, unsigned int> >("flat_hash_map IPv6_4T", make_role_key, count);
+	bench<flat_hash_map<CKeyIP_4T, unsigned int, KeyHashFunction<CKeyIP_4T>, KeyHashFunction<CKeyIP_4T> > >("flat_hash_map CKeyIP_4T",
+			make_typed_role_key, count);
+	bench<hash_map<CHashKey6_6, unsigned int, HashFunction<CHashKey6_6>, HashFunction<CHashKey6_6> > >("hash_map 6_6", make_graphlet_key, count);
+	bench<flat_hash_map<CHashKey6_6, unsigned int> >("flat_hash_map 6_6", make_graphlet_key, count);
+	bench<flat_hash_map<CKey6_6, unsigned int, KeyHashFunction<CKey6_6>, KeyHashFunction<CKey6_6> > >("flat_hash_map CKey6_6",
+			make_typed_graphlet_key, count);
+	return 0;
+}
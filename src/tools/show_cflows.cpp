@@ -14,6 +14,7 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <cstdlib>
 
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -27,6 +28,7 @@
 
 #include "cflow.h"
 #include "gfilter_cflow.h"
+#include "gfilter_cflowcol.h"
 #include "gutil.h"
 #include "gimport.h"
 
@@ -47,6 +49,13 @@ int main(int argc, char * argv[]) {
 				("inputfile,i", boost::program_options::value<string>(), "File to read")
 				("textdump,o", boost::program_options::value<string>(), "Produce a text output file")
 				("cflowdump,w", boost::program_options::value<string>(), "Produce a cflow output file")
+				("rawdump,r", boost::program_options::value<string>(), "Produce an uncompressed cflow6raw output file (fast bulk read, no decompression)")
+				("columndump,k", boost::program_options::value<string>(), "Produce a columnar cflowcol output file (fast filtered loading)")
+				("localnet,n", boost::program_options::value<string>(), "Show only flows with a localIP in this network, e.g. 10.0.0.0/8 (cflowcol input only)")
+				("notcp", "Do not show TCP flows (cflowcol input only)")
+				("noudp", "Do not show UDP flows (cflowcol input only)")
+				("noicmp", "Do not show ICMP flows (cflowcol input only)")
+				("noother", "Do not show non TCP/UDP/ICMP flows (cflowcol input only)")
 				("limit,l", boost::program_options::value<int>(), "Count of flows to display (default: all)")
 				("countonly,c", "Do count only (no other output)")
 				("verbose,v", "Verbose output")
@@ -77,7 +86,9 @@ int main(int argc, char * argv[]) {
 
 	GFilter_cflow4 *filter_cflow4 = new GFilter_cflow4;
 	GFilter_cflow6 *filter_cflow6 = new GFilter_cflow6;
-	GFilter_cflow *filter_cflow;
+	GFilter_cflow6raw *filter_cflow6raw = new GFilter_cflow6raw;
+	GFilter_cflow6col *filter_cflow6col = new GFilter_cflow6col;
+	GFilter *filter_cflow;
 	int oldmagic = -1;
 	string infile = variablesMap["inputfile"].as<string>();
 
@@ -89,7 +100,13 @@ int main(int argc, char * argv[]) {
 	// 2. Check and open input file
 	// ****************************
 	try {
-		if (filter_cflow6->acceptFileForReading(infile)) {
+		if (filter_cflow6col->acceptFileForReading(infile)) {
+			filter_cflow = filter_cflow6col;
+			oldmagic = CFLOW_6_MAGIC_NUMBER;
+		} else if (filter_cflow6raw->acceptFileForReading(infile)) {
+			filter_cflow = filter_cflow6raw;
+			oldmagic = CFLOW_6_MAGIC_NUMBER;
+		} else if (filter_cflow6->acceptFileForReading(infile)) {
 			filter_cflow = filter_cflow6;
 			oldmagic = CFLOW_6_MAGIC_NUMBER;
 		} else if (filter_cflow4->acceptFileForReading(infile)) {
@@ -110,10 +127,29 @@ int main(int argc, char * argv[]) {
 	//	- show input data interpreted as "cflow_t" records on console in text form
 	//	- write console text to optional output file (option -o)
 	//	- write binary records to optional output file (option -w)
+	//	- write uncompressed binary records to optional output file (option -r)
 
 	CFlowList cflowlist;
 	try {
-		filter_cflow->read_file(infile, cflowlist);
+		if (filter_cflow == filter_cflow6col) {
+			// Columnar files evaluate the filters before the flows get assembled
+			prefs_t prefs;
+			prefs.filter_TCP = variablesMap.count("notcp");
+			prefs.filter_UDP = variablesMap.count("noudp");
+			prefs.filter_ICMP = variablesMap.count("noicmp");
+			prefs.filter_OTHER = variablesMap.count("noother");
+			CFlowPredicate predicate(prefs);
+			if (variablesMap.count("localnet")) {
+				string localnet = variablesMap["localnet"].as<string>();
+				string::size_type slash = localnet.find('/');
+				IPv6_addr net(localnet.substr(0, slash));
+				int prefix = (slash == string::npos) ? 128 : atoi(localnet.substr(slash + 1).c_str()) + (net.isIPv4() ? 96 : 0);
+				predicate.setLocalNet(net, IPv6_addr::getNetmask(prefix));
+			}
+			filter_cflow6col->read_file_filtered(infile, cflowlist, predicate);
+		} else {
+			filter_cflow->read_file(infile, cflowlist, IPv6_addr(), IPv6_addr(), false);
+		}
 	} catch (string & e) {
 		cerr << e << endl;
 		exit(1);
@@ -150,6 +186,26 @@ int main(int argc, char * argv[]) {
 			exit(1);
 		}
 	}
+
+	if(variablesMap.count("rawdump")) {
+		try {
+			filter_cflow6raw->write_file(variablesMap["rawdump"].as<string>(), cflowlist, append);
+		}
+		catch(string & e) {
+			cerr << e << endl;
+			exit(1);
+		}
+	}
+
+	if(variablesMap.count("columndump")) {
+		try {
+			filter_cflow6col->write_file(variablesMap["columndump"].as<string>(), cflowlist, append);
+		}
+		catch(string & e) {
+			cerr << e << endl;
+			exit(1);
+		}
+	}
 	return 0;
 }
 